@@ -5,27 +5,37 @@
 
 #include "Audio.h"
 #include "Bluetooth.h"
+#include "Catalog.h"
 #include "Cmd.h"
 #include "Common.h"
+#include "Dsp.h"
 #include "EnumUtils.h"
 #include "Led.h"
 #include "Log.h"
 #include "MemX.h"
 #include "Mqtt.h"
+#include "NatSort.h"
+#include "PlaybackStats.h"
 #include "Port.h"
 #include "Queues.h"
+#include "ResumeJournal.h"
 #include "Rfid.h"
 #include "RotaryEncoder.h"
+#include "SdArbiter.h"
 #include "SdCard.h"
+#include "SeekIndex.h"
+#include "SpeechCache.h"
+#include "StreamBuffer.h"
 #include "System.h"
+#include "TrackControl.h"
 #include "Web.h"
 #include "Wlan.h"
 #include "main.h"
 #include "strnatcmp.h"
 
+#include <driver/i2s.h>
 #include <esp_task_wdt.h>
 #include <freertos/task.h>
-#include <random>
 
 #define AUDIOPLAYER_VOLUME_MAX	21u
 #define AUDIOPLAYER_VOLUME_MIN	0u
@@ -56,6 +66,24 @@ time_t playTimeSecSinceStart = 0;
 // current station logo url
 static String AudioPlayer_StationLogoUrl;
 
+// Next track of the playlist, opened while the current one is still playing (see SdCard_Prefetch())
+static std::optional<Playlist::Path> AudioPlayer_PrefetchedTrack;
+static size_t AudioPlayer_PrefetchedTrackNumber = 0;
+static bool AudioPlayer_PrefetchAttempted = false;
+static int16_t AudioPlayer_PrefetchedGain = catalogNoGain;
+// Gap between the end of a track and the first sample of the next one
+static volatile bool AudioPlayer_TrackGapPending = false;
+static volatile uint32_t AudioPlayer_EofTimestamp = 0; // us
+static volatile uint32_t AudioPlayer_TrackGap = 0; // us
+// Set by audio_eof_mp3() when a clip of an announcement is over
+static volatile bool AudioPlayer_SpeechClipFinished = false;
+// Time between waking up the audio task with a command and handling it
+static volatile uint32_t AudioPlayer_WakeUpTimestamp = 0; // us, 0 if nothing is pending
+static uint32_t AudioPlayer_LatencyCount = 0;
+static uint32_t AudioPlayer_LatencyLast = 0;
+static uint32_t AudioPlayer_LatencyMax = 0;
+static uint64_t AudioPlayer_LatencySum = 0;
+
 #ifdef HEADPHONE_ADJUST_ENABLE
 static bool AudioPlayer_HeadphoneLastDetectionState;
 static uint32_t AudioPlayer_HeadphoneLastDetectionTimestamp = 0u;
@@ -68,10 +96,15 @@ static std::optional<Playlist *> AudioPlayer_ReturnPlaylistFromWebstream(const c
 static bool AudioPlayer_ArrSortHelper_strcmp(const char *a, const char *b);
 static bool AudioPlayer_ArrSortHelper_strnatcmp(const char *a, const char *b);
 static bool AudioPlayer_ArrSortHelper_strnatcasecmp(const char *a, const char *b);
-static void AudioPlayer_SortPlaylist(Playlist *playlist);
 static void AudioPlayer_RandomizePlaylist(Playlist *playlist);
 static size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const char *_track, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed, const uint16_t _numberOfTracks);
 static void AudioPlayer_ClearCover(void);
+static void AudioPlayer_PrefetchNextTrack(Audio *audio);
+static void AudioPlayer_ResetPrefetch(void);
+static void AudioPlayer_FlushDsp(void);
+static int16_t AudioPlayer_LookupTrackGain(const char *_track);
+static bool AudioPlayer_SeekRelative(Audio *audio, int32_t _seconds);
+static bool AudioPlayer_Announce(Audio *audio, uint8_t _tellMode);
 
 void AudioPlayer_Init(void) {
 	// load playtime total from NVS
@@ -80,6 +113,9 @@ void AudioPlayer_Init(void) {
 	uint8_t playListSortModeValue = gPrefsSettings.getUChar("PLSortMode", EnumUtils::underlying_value(AudioPlayer_PlaylistSortMode));
 	AudioPlayer_PlaylistSortMode = EnumUtils::to_enum<playlistSortMode>(playListSortModeValue);
 
+	Dsp_Init();
+	SeekIndex_Init();
+
 #ifndef USE_LAST_VOLUME_AFTER_REBOOT
 	// Get initial volume from NVS
 	uint32_t nvsInitialVolume = gPrefsSettings.getUInt("initVolume", 0);
@@ -372,6 +408,140 @@ public:
 	}
 };
 
+// Side effects of the decisions of TrackControl_Step()
+class AudioPlayerActions : public TrackControlActions {
+public:
+	explicit AudioPlayerActions(Audio *_audio)
+		: audio(_audio) { }
+
+	void stopSong(void) override {
+		audio->stopSong();
+		Dsp_Reset();
+		Bluetooth_Source_Flush();
+	}
+	void pauseResume(void) override {
+		Bluetooth_Source_Flush(); // what's collected so far is played before the pause
+		audio->pauseResume();
+		Web_SendWebsocketData(0, 30);
+	}
+	uint32_t playedSeconds(void) override {
+		return audio->getAudioCurrentTime();
+	}
+	void savePosition(size_t _entry, size_t _track, bool _atPlayPosition) override {
+		uint32_t position = 0;
+		if (_atPlayPosition) {
+			position = audio->getFilePos() - audio->inBufferFilled();
+			Log_Printf(LOGLEVEL_INFO, trackPausedAtPos, audio->getFilePos(), position);
+		}
+		AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(_entry), position, gPlayProperties.playMode, _track, gPlayProperties.playlist->size());
+	}
+	void indicateError(void) override {
+		System_IndicateError();
+	}
+	void indicateRewind(void) override {
+		Led_Indicate(LedIndicatorType::Rewind);
+	}
+	void requestSleep(void) override {
+		System_RequestSleep();
+	}
+	void repeatModeChanged(void) override {
+#ifdef MQTT_ENABLE
+		publishMqtt(topicRepeatModeState, AudioPlayer_GetRepeatMode(), false);
+#endif
+	}
+	void playlistEnded(void) override {
+		Audio_setTitle(noPlaylist);
+		AudioPlayer_ClearCover();
+#ifdef MQTT_ENABLE
+		publishMqtt(topicPlaymodeState, gPlayProperties.playMode, false);
+#endif
+	}
+	TrackStart play(bool _restart) override;
+
+private:
+	Audio *audio;
+};
+
+TrackStart AudioPlayerActions::play(bool _restart) {
+	if (_restart) {
+		AudioPlayer_ResetPrefetch();
+		const Playlist::Path track = gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
+		Dsp_SetTrackGain(AudioPlayer_LookupTrackGain(track));
+		Dsp_Reset();
+		SeekIndex_Prepare(track);
+		PlaybackStats_Rearm();
+		return (audio->connecttoFS(gFSystem, track)) ? TrackStart::Started : TrackStart::Failed;
+	}
+
+	// resolve the track only once, if possible it was already looked up while the previous track was playing
+	const bool prefetched = AudioPlayer_PrefetchedTrack && AudioPlayer_PrefetchedTrackNumber == gPlayProperties.currentTrackNumber;
+	const Playlist::Path track = (prefetched) ? *AudioPlayer_PrefetchedTrack : gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
+	const int16_t trackGain = (prefetched) ? AudioPlayer_PrefetchedGain : AudioPlayer_LookupTrackGain(track);
+	AudioPlayer_PrefetchedTrack.reset();
+	AudioPlayer_PrefetchAttempted = false;
+	if (!strncmp("http", track, 4)) {
+		gPlayProperties.isWebstream = true;
+	} else {
+		gPlayProperties.isWebstream = false;
+	}
+	gPlayProperties.currentRelPos = 0;
+	bool audioReturnCode = false;
+	SpeechCache_Cancel(); // an announcement that's still playing is replaced
+
+	if (gPlayProperties.playMode == WEBSTREAM || (gPlayProperties.playMode == LOCAL_M3U && gPlayProperties.isWebstream)) { // Webstream
+		Dsp_SetTrackGain(0);
+		Dsp_Reset();
+		SeekIndex_Clear();
+		PlaybackStats_Rearm();
+		StreamBuffer_Start();
+		audioReturnCode = audio->connecttohost(track);
+		if (!audioReturnCode && StreamBuffer_ScheduleReconnect()) {
+			// weak Wi-Fi: keep the station and try again shortly
+			audioReturnCode = true;
+		}
+		gPlayProperties.playlistFinished = false;
+		gTriedToConnectToHost = true;
+	} else if (gPlayProperties.playMode != WEBSTREAM && !gPlayProperties.isWebstream) {
+		// Files from SD
+		if (!prefetched && !gFSystem.exists(track)) { // Check first if file/folder exists
+			Log_Printf(LOGLEVEL_ERROR, dirOrFileDoesNotExist, track.c_str());
+			SdCard_DropPrefetch();
+			return TrackStart::Missing;
+		}
+		Dsp_SetTrackGain(trackGain);
+		Dsp_Reset(); // the rest of a track that was skipped
+		SeekIndex_Prepare(track);
+		StreamBuffer_Stop();
+		PlaybackStats_Rearm(); // the gap between tracks is no underrun
+		audioReturnCode = audio->connecttoFS(gFSystemPrefetch, track);
+	}
+	SdCard_DropPrefetch(); // if it wasn't the track that was opened
+	if (!audioReturnCode) {
+		return TrackStart::Failed;
+	}
+
+	if (gPlayProperties.currentTrackNumber) {
+		Led_Indicate(LedIndicatorType::PlaylistProgress);
+	}
+	if (gPlayProperties.startAtFilePos > 0) {
+		audio->setFilePos(gPlayProperties.startAtFilePos);
+		Log_Printf(LOGLEVEL_NOTICE, trackStartatPos, gPlayProperties.startAtFilePos);
+		gPlayProperties.startAtFilePos = 0;
+	}
+	const char *title = track.c_str();
+	if (gPlayProperties.isWebstream) {
+		title = "Webradio";
+	}
+	if (gPlayProperties.playlist->size() > 1) {
+		Audio_setTitle("(%u/%u): %s", gPlayProperties.currentTrackNumber + 1, gPlayProperties.playlist->size(), title);
+	} else {
+		Audio_setTitle("%s", title);
+	}
+	AudioPlayer_ClearCover();
+	Log_Printf(LOGLEVEL_NOTICE, currentlyPlaying, track.c_str(), (gPlayProperties.currentTrackNumber + 1), gPlayProperties.playlist->size());
+	return TrackStart::Started;
+}
+
 // Function to play music as task
 void AudioPlayer_Task(void *parameter) {
 #ifdef BOARD_HAS_PSRAM
@@ -397,10 +567,11 @@ void AudioPlayer_Task(void *parameter) {
 		audio->setTone(3, 0, 0);
 	}
 
+	constexpr uint32_t idleTimeout = 1000; // ms to sleep at most if there's nothing to play
 	uint8_t currentVolume;
 	BaseType_t trackQStatus = pdFAIL;
 	uint8_t trackCommand = NO_ACTION;
-	bool audioReturnCode;
+	AudioPlayerActions actions(audio);
 	AudioPlayer_CurrentTime = 0;
 	AudioPlayer_FileDuration = 0;
 	uint32_t AudioPlayer_LastPlaytimeStatsTimestamp = 0u;
@@ -430,18 +601,33 @@ void AudioPlayer_Task(void *parameter) {
 			// Update current playtime and duration
 			AudioPlayer_CurrentTime = audio->getAudioCurrentTime();
 			AudioPlayer_FileDuration = audio->getAudioFileDuration();
+			uint32_t indexTime;
+			const uint32_t indexDuration = SeekIndex_GetDuration();
+			const bool indexed = indexDuration && SeekIndex_ByteToTime(audio->getFilePos() - audio->inBufferFilled(), indexTime);
+			if (indexed) {
+				// the audio library estimates VBR files by their average bitrate
+				AudioPlayer_CurrentTime = indexTime / 1000;
+				AudioPlayer_FileDuration = indexDuration / 1000;
+			}
 			// Calculate relative position in file (for trackprogress neopixel & web-ui)
 			uint32_t fileSize = audio->getFileSize();
 			gPlayProperties.audioFileSize = fileSize;
+			Dsp_SetSampleRate(audio->getSampleRate());
+			PlaybackStats_SetSampleRate(audio->getSampleRate());
 			if (!gPlayProperties.playlistFinished && fileSize > 0) {
 				// for local files and web files with known size
 				if (!gPlayProperties.pausePlay && (gPlayProperties.seekmode != SEEK_POS_PERCENT)) { // To progress necessary when paused
-					gPlayProperties.currentRelPos = ((double) (audio->getFilePos() - audio->getAudioDataStartPos() - audio->inBufferFilled()) / fileSize) * 100;
+					if (indexed) {
+						gPlayProperties.currentRelPos = ((double) indexTime / indexDuration) * 100;
+					} else {
+						gPlayProperties.currentRelPos = ((double) (audio->getFilePos() - audio->getAudioDataStartPos() - audio->inBufferFilled()) / fileSize) * 100;
+					}
 				}
 			} else {
 				if (gPlayProperties.isWebstream && (audio->inBufferSize() > 0)) {
-					// calc current fillbuffer percent for webstream with unknown size/end
-					gPlayProperties.currentRelPos = (double) (audio->inBufferFilled() / (double) audio->inBufferSize()) * 100;
+					// webstream with unknown size/end: buffered playtime, 100 % at the high watermark
+					const streamBufferInfo buffer = StreamBuffer_GetInfo();
+					gPlayProperties.currentRelPos = (buffer.highWatermarkMs) ? std::min(100.0, (double) buffer.bufferedMs / buffer.highWatermarkMs * 100) : 0;
 				} else {
 					gPlayProperties.currentRelPos = 0;
 				}
@@ -450,19 +636,27 @@ void AudioPlayer_Task(void *parameter) {
 
 		Playlist *newPlaylist;
 		trackQStatus = xQueueReceive(gTrackQueue, &newPlaylist, 0);
+
+		const uint32_t wakeUpTimestamp = AudioPlayer_WakeUpTimestamp;
+		if (wakeUpTimestamp) {
+			AudioPlayer_WakeUpTimestamp = 0;
+			AudioPlayer_LatencyLast = micros() - wakeUpTimestamp;
+			AudioPlayer_LatencyMax = std::max(AudioPlayer_LatencyMax, AudioPlayer_LatencyLast);
+			AudioPlayer_LatencySum += AudioPlayer_LatencyLast;
+			AudioPlayer_LatencyCount++;
+		}
 		if (trackQStatus == pdPASS || gPlayProperties.trackFinished || trackCommand != NO_ACTION) {
 			if (trackQStatus == pdPASS) {
 				audio->stopSong();
 
 				// destroy the old playlist and assign the new
+				AudioPlayer_ResetPrefetch();
+				AudioPlayer_TrackGapPending = false;
 				freePlaylist(gPlayProperties.playlist);
 				gPlayProperties.playlist = newPlaylist;
 				Log_Printf(LOGLEVEL_NOTICE, newPlaylistReceived, gPlayProperties.playlist->size());
 				Log_Printf(LOGLEVEL_DEBUG, "Free heap: %u", ESP.getFreeHeap());
 				playbackTimeoutStart = millis();
-				gPlayProperties.pausePlay = false;
-				gPlayProperties.trackFinished = false;
-				gPlayProperties.playlistFinished = false;
 #ifdef MQTT_ENABLE
 				publishMqtt(topicPlaymodeState, gPlayProperties.playMode, false);
 				publishMqtt(topicRepeatModeState, AudioPlayer_GetRepeatMode(), false);
@@ -474,328 +668,36 @@ void AudioPlayer_Task(void *parameter) {
 					strncpy(gPlayProperties.playRfidTag, gCurrentRfidTagId, sizeof(gPlayProperties.playRfidTag) / sizeof(gPlayProperties.playRfidTag[0]));
 				}
 			}
-			if (gPlayProperties.trackFinished) {
-				gPlayProperties.trackFinished = false;
-				if (gPlayProperties.playMode == NO_PLAYLIST || gPlayProperties.playlist == nullptr) {
-					gPlayProperties.playlistFinished = true;
-					continue;
-				}
-				if (gPlayProperties.saveLastPlayPosition) { // Don't save for AUDIOBOOK_LOOP because not necessary
-					if (gPlayProperties.currentTrackNumber + 1 < gPlayProperties.playlist->size()) {
-						// Only save if there's another track, otherwise it will be saved at end of playlist anyway
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber + 1, gPlayProperties.playlist->size());
-					}
-				}
-				if (gPlayProperties.sleepAfterCurrentTrack) { // Go to sleep if "sleep after track" was requested
-					gPlayProperties.playlistFinished = true;
-					gPlayProperties.playMode = NO_PLAYLIST;
-					System_RequestSleep();
-					break;
-				}
-				if (!gPlayProperties.repeatCurrentTrack) { // If endless-loop requested, track-number will not be incremented
-					gPlayProperties.currentTrackNumber++;
-				} else {
-					Log_Println(repeatTrackDueToPlaymode, LOGLEVEL_INFO);
-					Led_Indicate(LedIndicatorType::Rewind);
-				}
-			}
-
-			if (gPlayProperties.playlistFinished && trackCommand != NO_ACTION) {
-				if (gPlayProperties.playMode != BUSY) { // Prevents from staying in mode BUSY forever when error occured (e.g. directory empty that should be played)
-					Log_Println(noPlaymodeChangeIfIdle, LOGLEVEL_NOTICE);
-					trackCommand = NO_ACTION;
-					System_IndicateError();
-					continue;
-				}
-			}
-			/* Check if track-control was called
-			   (stop, start, next track, prev. track, last track, first track...) */
-			switch (trackCommand) {
-				case STOP:
-					audio->stopSong();
-					trackCommand = NO_ACTION;
-					Log_Println(cmndStop, LOGLEVEL_INFO);
-					gPlayProperties.pausePlay = true;
-					gPlayProperties.playlistFinished = true;
-					gPlayProperties.playMode = NO_PLAYLIST;
-					Audio_setTitle(noPlaylist);
-					AudioPlayer_ClearCover();
-					continue;
-
-				case PAUSEPLAY:
-					trackCommand = NO_ACTION;
-					audio->pauseResume();
-					if (gPlayProperties.pausePlay) {
-						Log_Println(cmndResumeFromPause, LOGLEVEL_INFO);
-					} else {
-						Log_Println(cmndPause, LOGLEVEL_INFO);
-					}
-					if (gPlayProperties.saveLastPlayPosition && !gPlayProperties.pausePlay) {
-						Log_Printf(LOGLEVEL_INFO, trackPausedAtPos, audio->getFilePos(), audio->getFilePos() - audio->inBufferFilled());
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), audio->getFilePos() - audio->inBufferFilled(), gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-					}
-					gPlayProperties.pausePlay = !gPlayProperties.pausePlay;
-					Web_SendWebsocketData(0, 30);
-					continue;
-
-				case NEXTTRACK:
-					trackCommand = NO_ACTION;
-					if (gPlayProperties.pausePlay) {
-						audio->pauseResume();
-						gPlayProperties.pausePlay = false;
-					}
-					if (gPlayProperties.repeatCurrentTrack) { // End loop if button was pressed
-						gPlayProperties.repeatCurrentTrack = false;
-#ifdef MQTT_ENABLE
-						publishMqtt(topicRepeatModeState, AudioPlayer_GetRepeatMode(), false);
-#endif
-					}
-					// Allow next track if current track played in playlist isn't the last track.
-					// Exception: loop-playlist is active. In this case playback restarts at the first track of the playlist.
-					if ((gPlayProperties.currentTrackNumber + 1 < gPlayProperties.playlist->size()) || gPlayProperties.repeatPlaylist) {
-						if ((gPlayProperties.currentTrackNumber + 1 >= gPlayProperties.playlist->size()) && gPlayProperties.repeatPlaylist) {
-							gPlayProperties.currentTrackNumber = 0;
-						} else {
-							gPlayProperties.currentTrackNumber++;
-						}
-						if (gPlayProperties.saveLastPlayPosition) {
-							AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-							Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
-						}
-						Log_Println(cmndNextTrack, LOGLEVEL_INFO);
-						if (!gPlayProperties.playlistFinished) {
-							audio->stopSong();
-						}
-					} else {
-						Log_Println(lastTrackAlreadyActive, LOGLEVEL_NOTICE);
-						System_IndicateError();
-						continue;
-					}
-					break;
-
-				case PREVIOUSTRACK:
-					trackCommand = NO_ACTION;
-					if (gPlayProperties.pausePlay) {
-						audio->pauseResume();
-						gPlayProperties.pausePlay = false;
-					}
-					if (gPlayProperties.repeatCurrentTrack) { // End loop if button was pressed
-						gPlayProperties.repeatCurrentTrack = false;
-#ifdef MQTT_ENABLE
-						publishMqtt(topicRepeatModeState, AudioPlayer_GetRepeatMode(), false);
-#endif
-					}
-					if (gPlayProperties.playMode == WEBSTREAM) {
-						Log_Println(trackChangeWebstream, LOGLEVEL_INFO);
-						System_IndicateError();
-						continue;
-					} else if (gPlayProperties.playMode == LOCAL_M3U) {
-						Log_Println(cmndPrevTrack, LOGLEVEL_INFO);
-						if (gPlayProperties.currentTrackNumber > 0) {
-							gPlayProperties.currentTrackNumber--;
-						} else {
-							System_IndicateError();
-							continue;
-						}
-					} else {
-						if (gPlayProperties.currentTrackNumber > 0 || gPlayProperties.repeatPlaylist) {
-							if (audio->getAudioCurrentTime() < 5) { // play previous track when current track time is small, else play current track again
-								if (gPlayProperties.currentTrackNumber == 0 && gPlayProperties.repeatPlaylist) {
-									gPlayProperties.currentTrackNumber = gPlayProperties.playlist->size() - 1; // Go back to last track in loop-mode when first track is played
-								} else {
-									gPlayProperties.currentTrackNumber--;
-								}
-							}
-
-							if (gPlayProperties.saveLastPlayPosition) {
-								AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-								Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
-							}
-
-							Log_Println(cmndPrevTrack, LOGLEVEL_INFO);
-							if (!gPlayProperties.playlistFinished) {
-								audio->stopSong();
-							}
-						} else {
-							if (gPlayProperties.saveLastPlayPosition) {
-								AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-							}
-							audio->stopSong();
-							Led_Indicate(LedIndicatorType::Rewind);
-							audioReturnCode = audio->connecttoFS(gFSystem, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
-							// consider track as finished, when audio lib call was not successful
-							if (!audioReturnCode) {
-								System_IndicateError();
-								gPlayProperties.trackFinished = true;
-								continue;
-							}
-							Log_Println(trackStart, LOGLEVEL_INFO);
-							continue;
-						}
-					}
-					break;
-				case FIRSTTRACK:
-					trackCommand = NO_ACTION;
-					if (gPlayProperties.pausePlay) {
-						audio->pauseResume();
-						gPlayProperties.pausePlay = false;
-					}
-					gPlayProperties.currentTrackNumber = 0;
-					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-						Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
-					}
-					Log_Println(cmndFirstTrack, LOGLEVEL_INFO);
-					if (!gPlayProperties.playlistFinished) {
-						audio->stopSong();
-					}
-					break;
-
-				case LASTTRACK:
-					trackCommand = NO_ACTION;
-					if (gPlayProperties.pausePlay) {
-						audio->pauseResume();
-						gPlayProperties.pausePlay = false;
-					}
-					if (gPlayProperties.currentTrackNumber + 1 < gPlayProperties.playlist->size()) {
-						gPlayProperties.currentTrackNumber = gPlayProperties.playlist->size() - 1;
-						if (gPlayProperties.saveLastPlayPosition) {
-							AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-							Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
-						}
-						Log_Println(cmndLastTrack, LOGLEVEL_INFO);
-						if (!gPlayProperties.playlistFinished) {
-							audio->stopSong();
-						}
-					} else {
-						Log_Println(lastTrackAlreadyActive, LOGLEVEL_NOTICE);
-						System_IndicateError();
-						continue;
-					}
-					break;
-
-				case 0:
-					break;
-
-				default:
-					trackCommand = NO_ACTION;
-					Log_Println(cmndDoesNotExist, LOGLEVEL_NOTICE);
-					System_IndicateError();
-					continue;
-			}
-
-			if (gPlayProperties.playUntilTrackNumber == gPlayProperties.currentTrackNumber && gPlayProperties.playUntilTrackNumber > 0) {
-				if (gPlayProperties.saveLastPlayPosition) {
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 0, gPlayProperties.playMode, 0, gPlayProperties.playlist->size());
-				}
-				gPlayProperties.playlistFinished = true;
-				gPlayProperties.playMode = NO_PLAYLIST;
-				System_RequestSleep();
-				continue;
-			}
-
-			if (gPlayProperties.currentTrackNumber >= gPlayProperties.playlist->size()) { // Check if last element of playlist is already reached
-				Log_Println(endOfPlaylistReached, LOGLEVEL_NOTICE);
-				if (!gPlayProperties.repeatPlaylist) {
-					if (gPlayProperties.saveLastPlayPosition) {
-						// Set back to first track
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(0), 0, gPlayProperties.playMode, 0, gPlayProperties.playlist->size());
-					}
-					gPlayProperties.playlistFinished = true;
-					gPlayProperties.playMode = NO_PLAYLIST;
-					Audio_setTitle(noPlaylist);
-					AudioPlayer_ClearCover();
-#ifdef MQTT_ENABLE
-					publishMqtt(topicPlaymodeState, gPlayProperties.playMode, false);
-#endif
-					gPlayProperties.currentTrackNumber = 0;
-					if (gPlayProperties.sleepAfterPlaylist) {
-						System_RequestSleep();
-					}
-					continue;
-				} else { // Check if sleep after current track/playlist was requested
-					if (gPlayProperties.sleepAfterPlaylist || gPlayProperties.sleepAfterCurrentTrack) {
-						gPlayProperties.playlistFinished = true;
-						gPlayProperties.playMode = NO_PLAYLIST;
-						System_RequestSleep();
-						continue;
-					} // Repeat playlist; set current track number back to 0
-					Log_Println(repeatPlaylistDueToPlaymode, LOGLEVEL_NOTICE);
-					gPlayProperties.currentTrackNumber = 0;
-					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, gPlayProperties.playlist->at(0), 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber, gPlayProperties.playlist->size());
-					}
-				}
-			}
-
-			if (!strncmp("http", gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), 4)) {
-				gPlayProperties.isWebstream = true;
-			} else {
-				gPlayProperties.isWebstream = false;
-			}
-			gPlayProperties.currentRelPos = 0;
-			audioReturnCode = false;
-
-			if (gPlayProperties.playMode == WEBSTREAM || (gPlayProperties.playMode == LOCAL_M3U && gPlayProperties.isWebstream)) { // Webstream
-				audioReturnCode = audio->connecttohost(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
-				gPlayProperties.playlistFinished = false;
-				gTriedToConnectToHost = true;
-			} else if (gPlayProperties.playMode != WEBSTREAM && !gPlayProperties.isWebstream) {
-				// Files from SD
-				if (!gFSystem.exists(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber))) { // Check first if file/folder exists
-					Log_Printf(LOGLEVEL_ERROR, dirOrFileDoesNotExist, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
-					gPlayProperties.trackFinished = true;
-					continue;
-				} else {
-					audioReturnCode = audio->connecttoFS(gFSystem, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
-					// consider track as finished, when audio lib call was not successful
-				}
+			const TrackLoop step = TrackControl_Step(gPlayProperties, trackQStatus == pdPASS, trackCommand, actions);
+			if (step == TrackLoop::Quit) {
+				break;
 			}
-
-			if (!audioReturnCode) {
-				System_IndicateError();
-				gPlayProperties.trackFinished = true;
+			if (step == TrackLoop::Skip) {
 				continue;
-			} else {
-				if (gPlayProperties.currentTrackNumber) {
-					Led_Indicate(LedIndicatorType::PlaylistProgress);
-				}
-				if (gPlayProperties.startAtFilePos > 0) {
-					audio->setFilePos(gPlayProperties.startAtFilePos);
-					Log_Printf(LOGLEVEL_NOTICE, trackStartatPos, gPlayProperties.startAtFilePos);
-					gPlayProperties.startAtFilePos = 0;
-				}
-				const char *title = gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
-				if (gPlayProperties.isWebstream) {
-					title = "Webradio";
-				}
-				if (gPlayProperties.playlist->size() > 1) {
-					Audio_setTitle("(%u/%u): %s", gPlayProperties.currentTrackNumber + 1, gPlayProperties.playlist->size(), title);
-				} else {
-					Audio_setTitle("%s", title);
-				}
-				AudioPlayer_ClearCover();
-				Log_Printf(LOGLEVEL_NOTICE, currentlyPlaying, gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), (gPlayProperties.currentTrackNumber + 1), gPlayProperties.playlist->size());
-				gPlayProperties.playlistFinished = false;
 			}
 		}
 
 		// Handle seekmodes
 		if (gPlayProperties.seekmode != SEEK_NORMAL) {
 			if (gPlayProperties.seekmode == SEEK_FORWARDS) {
-				if (audio->setTimeOffset(jumpOffset)) {
+				if (AudioPlayer_SeekRelative(audio, jumpOffset)) {
 					Log_Printf(LOGLEVEL_NOTICE, secondsJumpForward, jumpOffset);
 				} else {
 					System_IndicateError();
 				}
 			} else if (gPlayProperties.seekmode == SEEK_BACKWARDS) {
-				if (audio->setTimeOffset(-(jumpOffset))) {
+				if (AudioPlayer_SeekRelative(audio, -(jumpOffset))) {
 					Log_Printf(LOGLEVEL_NOTICE, secondsJumpBackward, jumpOffset);
 				} else {
 					System_IndicateError();
 				}
 			} else if ((gPlayProperties.seekmode == SEEK_POS_PERCENT) && (gPlayProperties.currentRelPos > 0) && (gPlayProperties.currentRelPos < 100)) {
 				uint32_t newFilePos = uint32_t((double) (gPlayProperties.currentRelPos / 100) * audio->getFileSize());
+				const uint32_t indexDuration = SeekIndex_GetDuration();
+				if (indexDuration) {
+					// the position is meant in time, which isn't proportional to the bytes in a VBR file
+					SeekIndex_TimeToByte(uint32_t((double) (gPlayProperties.currentRelPos / 100) * indexDuration), newFilePos);
+				}
 				if (audio->setFilePos(newFilePos)) {
 					Log_Printf(LOGLEVEL_NOTICE, JumpToPosition, newFilePos, audio->getFileSize());
 				} else {
@@ -803,52 +705,26 @@ void AudioPlayer_Task(void *parameter) {
 				}
 			}
 			gPlayProperties.seekmode = SEEK_NORMAL;
+			PlaybackStats_Rearm();
 		}
 
-		// Handle IP-announcement
-		if (gPlayProperties.tellMode == TTS_IP_ADDRESS) {
+		// Handle IP- and time-announcement
+		if (gPlayProperties.tellMode != TTS_NONE) {
+			const uint8_t tellMode = gPlayProperties.tellMode;
 			gPlayProperties.tellMode = TTS_NONE;
-			String ipText = Wlan_GetIpAddress();
-			bool speechOk;
-			// make IP as text (replace thousand separator with locale text)
-			switch (LANGUAGE) {
-				case DE:
-					ipText.replace(".", "Punkt");
-					speechOk = audio->connecttospeech(ipText.c_str(), "de");
-					break;
-				case FR:
-					ipText.replace(".", "point");
-					speechOk = audio->connecttospeech(ipText.c_str(), "fr");
-					break;
-				default:
-					ipText.replace(".", "point");
-					speechOk = audio->connecttospeech(ipText.c_str(), "en");
-			}
-			if (!speechOk) {
+			SeekIndex_Clear(); // the track is replaced by the announcement
+			if (!AudioPlayer_Announce(audio, tellMode)) {
 				System_IndicateError();
 			}
 		}
 
-		// Handle time-announcement
-		if (gPlayProperties.tellMode == TTS_CURRENT_TIME) {
-			gPlayProperties.tellMode = TTS_NONE;
-			struct tm timeinfo;
-			getLocalTime(&timeinfo);
-			static char timeStringBuff[64];
-			bool speechOk;
-#if (LANGUAGE == DE)
-			snprintf(timeStringBuff, sizeof(timeStringBuff), "Es ist %02d:%02d Uhr", timeinfo.tm_hour, timeinfo.tm_min);
-			speechOk = audio->connecttospeech(timeStringBuff, "de");
-#else
-			if (timeinfo.tm_hour > 12) {
-				snprintf(timeStringBuff, sizeof(timeStringBuff), "It is %02d:%02d PM", timeinfo.tm_hour - 12, timeinfo.tm_min);
-			} else {
-				snprintf(timeStringBuff, sizeof(timeStringBuff), "It is %02d:%02d AM", timeinfo.tm_hour, timeinfo.tm_min);
-			}
-			speechOk = audio->connecttospeech(timeStringBuff, "en");
-#endif
-			if (!speechOk) {
-				System_IndicateError();
+		// Next clip of an announcement from the speech cache
+		if (AudioPlayer_SpeechClipFinished) {
+			AudioPlayer_SpeechClipFinished = false;
+			String clip;
+			if (!SpeechCache_NextClip(clip) || !audio->connecttoFS(gFSystem, clip.c_str())) {
+				SpeechCache_Cancel();
+				gPlayProperties.currentSpeechActive = false;
 			}
 		}
 
@@ -873,10 +749,44 @@ void AudioPlayer_Task(void *parameter) {
 			}
 		}
 
+		const bool playing = audio->isRunning() && !gPlayProperties.pausePlay;
+		const uint32_t filePos = audio->getFilePos();
+		const uint32_t loopStart = micros();
+		SdArbiter_AudioBegin();
 		audio->loop();
+		SdArbiter_AudioEnd(playing && !gPlayProperties.isWebstream, audio->inBufferFilled(), audio->inBufferSize());
+		if (playing && !gPlayProperties.currentSpeechActive) {
+			PlaybackStats_OnLoop(micros() - loopStart, !gPlayProperties.isWebstream && audio->getFilePos() != filePos, audio->inBufferFilled(), audio->inBufferSize());
+			if (gPlayProperties.isWebstream) {
+				const StreamBufferState previousState = StreamBuffer_GetState();
+				const StreamBufferState state = StreamBuffer_Update(audio->inBufferFilled(), audio->inBufferSize(), audio->getBitRate());
+				if (state == StreamBufferState::Stalled) {
+					// connected, but nothing arrives anymore
+					audio->stopSong();
+					if (!StreamBuffer_ScheduleReconnect()) {
+						System_IndicateError();
+						gPlayProperties.trackFinished = true;
+					}
+				} else if (state == StreamBufferState::Rebuffering && previousState != state) {
+					// websocket notify for slow stream. Playback goes on, pausing would stop reading the stream too.
+					Web_SendWebsocketData(0, 3);
+				}
+			}
+		} else {
+			PlaybackStats_Rearm();
+		}
+		AudioPlayer_PrefetchNextTrack(audio);
+		if (AudioPlayer_TrackGap) {
+			Log_Printf(LOGLEVEL_DEBUG, trackGapMeasured, AudioPlayer_TrackGap / 1000, (AudioPlayer_TrackGap % 1000) / 100);
+			AudioPlayer_TrackGap = 0;
+		} else if (AudioPlayer_TrackGapPending && gPlayProperties.playlistFinished) {
+			// there's no next track to measure
+			AudioPlayer_TrackGapPending = false;
+		}
 		if (gPlayProperties.playlistFinished || gPlayProperties.pausePlay) {
-			if (!gPlayProperties.currentSpeechActive) {
-				vTaskDelay(portTICK_PERIOD_MS * 10); // Waste some time if playlist is not active
+			if (!gPlayProperties.currentSpeechActive && !gPlayProperties.trackFinished) {
+				// Nothing to decode, sleep until a command arrives (see AudioPlayer_WakeUp())
+				ulTaskNotifyTake(pdTRUE, portTICK_PERIOD_MS * idleTimeout);
 			}
 		} else {
 			System_UpdateActivityTimer(); // Refresh if playlist is active so uC will not fall asleep due to reaching inactivity-time
@@ -891,11 +801,26 @@ void AudioPlayer_Task(void *parameter) {
 		const bool noAudio = (!audio->isRunning() && !gPlayProperties.pausePlay);
 		const bool timeout = ((millis() - playbackTimeoutStart) > playbackTimeout);
 		if (activeMode) {
+			if (gPlayProperties.isWebstream && !gPlayProperties.playlistFinished && !gPlayProperties.pausePlay && StreamBuffer_ReconnectDue()) {
+				const Playlist::Path url = gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
+				Log_Printf(LOGLEVEL_NOTICE, webstreamReconnect, url.c_str());
+				PlaybackStats_Rearm();
+				Dsp_Reset();
+				if (!audio->connecttohost(url) && !StreamBuffer_ScheduleReconnect()) {
+					System_IndicateError();
+					gPlayProperties.trackFinished = true;
+				}
+				playbackTimeoutStart = millis();
+			}
 			// we check for timeout
 			if (noAudio && timeout) {
-				// Audio playback timed out, move on to the next
-				System_IndicateError();
-				gPlayProperties.trackFinished = true;
+				if (gPlayProperties.isWebstream && (StreamBuffer_ReconnectPending() || StreamBuffer_ScheduleReconnect())) {
+					// connection lost: pause shortly and reconnect instead of skipping the station
+				} else {
+					// Audio playback timed out, move on to the next
+					System_IndicateError();
+					gPlayProperties.trackFinished = true;
+				}
 				playbackTimeoutStart = millis();
 			}
 		} else {
@@ -904,6 +829,8 @@ void AudioPlayer_Task(void *parameter) {
 		}
 		if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && audio->isRunning()) {
 			// do not delay here, audio task is time critical in BT-Source mode
+		} else if (gPlayProperties.trackFinished) {
+			// start the next track right away
 		} else {
 			vTaskDelay(portTICK_PERIOD_MS * 1);
 		}
@@ -924,6 +851,98 @@ void AudioPlayer_Task(void *parameter) {
 	vTaskDelete(NULL);
 }
 
+// Opens the next track while the current one is still playing. Once the current file is read completely into the
+// decoder's input buffer, the next entry is resolved (which might mean reading it from a m3u file), opened and its
+// first sector read. The track change after EOF hands the open file to the audio library (see gFSystemPrefetch),
+// so the gap between tracks no longer includes looking the file up on the SD card.
+static void AudioPlayer_PrefetchNextTrack(Audio *audio) {
+	if (AudioPlayer_PrefetchAttempted || gPlayProperties.isWebstream || gPlayProperties.pausePlay || gPlayProperties.playlistFinished || gPlayProperties.trackFinished || !gPlayProperties.playlist) {
+		return;
+	}
+	if (!audio->isRunning() || !audio->getFileSize() || audio->getFilePos() < audio->getFileSize()) {
+		// still reading the current file
+		return;
+	}
+	AudioPlayer_PrefetchAttempted = true;
+	size_t next = gPlayProperties.currentTrackNumber + ((gPlayProperties.repeatCurrentTrack) ? 0 : 1);
+	if (next >= gPlayProperties.playlist->size()) {
+		if (!gPlayProperties.repeatPlaylist) {
+			return;
+		}
+		next = 0;
+	}
+	const Playlist::Path track = gPlayProperties.playlist->at(next);
+	if (!strncmp("http", track, 4) || !SdCard_Prefetch(track)) {
+		// handled when the track is started
+		return;
+	}
+	AudioPlayer_PrefetchedTrack.emplace(track);
+	AudioPlayer_PrefetchedTrackNumber = next;
+	AudioPlayer_PrefetchedGain = AudioPlayer_LookupTrackGain(track);
+}
+
+// Loudness normalization gain (1/100 dB) of a local file. It was read from the file's ReplayGain tags by
+// the catalog scan, so this is only a lookup and nothing is analysed while playing.
+static int16_t AudioPlayer_LookupTrackGain(const char *_track) {
+	if (!Dsp_IsNormalizeEnabled()) {
+		return 0;
+	}
+	const int16_t gain = Catalog_GetTrackGain(_track);
+	return (gain == catalogNoGain) ? 0 : gain;
+}
+
+// Jumps relative to the current play position. With a seek index of the track the target frame is looked up, so this
+// is exact for VBR files as well and needs a single seek. Otherwise the audio library estimates the position.
+static bool AudioPlayer_SeekRelative(Audio *audio, int32_t _seconds) {
+	uint32_t currentMs;
+	if (!SeekIndex_ByteToTime(audio->getFilePos() - audio->inBufferFilled(), currentMs)) {
+		return audio->setTimeOffset(_seconds);
+	}
+	const int64_t targetMs = std::max<int64_t>(static_cast<int64_t>(currentMs) + _seconds * 1000, 0);
+	uint32_t bytePos;
+	if (!SeekIndex_TimeToByte(targetMs, bytePos)) {
+		// beyond the end
+		return false;
+	}
+	return audio->setFilePos(bytePos);
+}
+
+// Tells the IP address or the time (TTS_IP_ADDRESS, TTS_CURRENT_TIME). From the clips in the speech cache if
+// they're all there, otherwise by the online TTS service (the missing clips are fetched for the next time).
+static bool AudioPlayer_Announce(Audio *audio, uint8_t _tellMode) {
+	std::vector<String> phrases;
+	const char *lang = SpeechCache_Compose(_tellMode, phrases);
+	if (phrases.empty()) {
+		// nothing to tell, e.g. the time before NTP: the track goes on untouched
+		gPlayProperties.currentSpeechActive = false;
+		gPlayProperties.lastSpeechActive = false;
+		return false;
+	}
+	AudioPlayer_SpeechClipFinished = false;
+	Dsp_Reset(); // the announcement interrupts the track
+	if (SpeechCache_Start(lang, phrases)) {
+		String clip;
+		if (SpeechCache_NextClip(clip) && audio->connecttoFS(gFSystem, clip.c_str())) {
+			return true;
+		}
+		SpeechCache_Cancel();
+	}
+	String sentence;
+	for (const String &phrase : phrases) {
+		if (!sentence.isEmpty()) {
+			sentence += ' ';
+		}
+		sentence += phrase;
+	}
+	return audio->connecttospeech(sentence.c_str(), lang);
+}
+
+static void AudioPlayer_ResetPrefetch(void) {
+	AudioPlayer_PrefetchedTrack.reset();
+	AudioPlayer_PrefetchAttempted = false;
+	SdCard_DropPrefetch();
+}
+
 // Returns current repeat-mode (mix of repeat current track and current playlist)
 uint8_t AudioPlayer_GetRepeatMode(void) {
 	if (gPlayProperties.repeatPlaylist && gPlayProperties.repeatCurrentTrack) {
@@ -957,6 +976,7 @@ void AudioPlayer_VolumeToQueueSender(const int32_t _newVolume, bool reAdjustRota
 			RotaryEncoder_Readjust();
 		}
 		xQueueSend(gVolumeQueue, &_volume, 0);
+		AudioPlayer_WakeUp();
 		AudioPlayer_PauseOnMinVolume(_volumeBuf, _newVolume);
 	}
 }
@@ -1075,13 +1095,16 @@ void AudioPlayer_TrackQueueDispatcher(const char *_itemToPlay, const uint32_t _l
 			gPlayProperties.playUntilTrackNumber = 0;
 			Led_SetNightmode(true);
 			Log_Println(modeSingleTrackRandom, LOGLEVEL_NOTICE);
-			AudioPlayer_RandomizePlaylist(list);
-			// we have a random order, so pick the first entry and scrap the rest
-			auto first = list->at(0);
-			list->at(0) = nullptr; // prevent our entry from being destroyed
-			freePlaylist(list); // this also scrapped our vector --> recreate it
-			list = new Playlist();
-			list->push_back(first);
+			// just pick a random entry and scrap the rest, no need to shuffle the whole playlist
+			Playlist *single = new Playlist();
+			if (!single->push_back(list->at(esp_random() % list->size()))) {
+				Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+				freePlaylist(single);
+				error = true;
+				break;
+			}
+			freePlaylist(list);
+			list = single;
 			break;
 		}
 
@@ -1150,6 +1173,7 @@ void AudioPlayer_TrackQueueDispatcher(const char *_itemToPlay, const uint32_t _l
 	if (!error) {
 		gPlayProperties.playMode = _playMode;
 		xQueueSend(gTrackQueue, &list, 0);
+		AudioPlayer_WakeUp();
 		return;
 	}
 
@@ -1159,7 +1183,7 @@ void AudioPlayer_TrackQueueDispatcher(const char *_itemToPlay, const uint32_t _l
 	freePlaylist(list);
 }
 
-/* Wraps putString for writing settings into NVS for RFID-cards.
+/* Wraps putString for writing settings into NVS for RFID-cards (via ResumeJournal).
    Returns number of characters written. */
 size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const char *_track, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed, const uint16_t _numberOfTracks) {
 	if (_playMode == NO_PLAYLIST) {
@@ -1167,7 +1191,6 @@ size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const char *_tra
 		Log_Printf(LOGLEVEL_ERROR, modeInvalid, _playMode);
 		return 0;
 	}
-	Led_SetPause(true); // Workaround to prevent exceptions due to Neopixel-signalisation while NVS-write
 	char prefBuf[275];
 	char trackBuf[255];
 	snprintf(trackBuf, sizeof(trackBuf) / sizeof(trackBuf[0]), _track);
@@ -1188,8 +1211,14 @@ size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const char *_tra
 	snprintf(prefBuf, sizeof(prefBuf) / sizeof(prefBuf[0]), "%s%s%s%u%s%d%s%u", stringDelimiter, trackBuf, stringDelimiter, _playPosition, stringDelimiter, _playMode, stringDelimiter, _trackLastPlayed);
 	Log_Printf(LOGLEVEL_INFO, wroteLastTrackToNvs, prefBuf, _rfidCardId, _playMode, _trackLastPlayed);
 	Log_Println(prefBuf, LOGLEVEL_INFO);
+	// written to NVS in background, pausing doesn't wait for flash
+	if (ResumeJournal_Store(_rfidCardId, prefBuf)) {
+		return strlen(prefBuf);
+	}
+	Led_SetPause(true); // Workaround to prevent exceptions due to Neopixel-signalisation while NVS-write
+	const size_t written = gPrefsRfid.putString(_rfidCardId, prefBuf);
 	Led_SetPause(false);
-	return gPrefsRfid.putString(_rfidCardId, prefBuf);
+	return written;
 
 	// Examples for serialized RFID-actions that are stored in NVS
 	// #<file/folder>#<startPlayPositionInBytes>#<playmode>#<trackNumberToStartWith>
@@ -1204,17 +1233,12 @@ size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const char *_tra
 // Adds webstream to playlist; same like SdCard_ReturnPlaylist() but always only one entry
 std::optional<Playlist *> AudioPlayer_ReturnPlaylistFromWebstream(const char *_webUrl) {
 	Playlist *playlist = new Playlist();
-	const size_t len = strlen(_webUrl) + 1;
-	char *entry = static_cast<char *>(x_malloc(len));
-	if (!entry) {
+	if (!playlist->push_back(_webUrl)) {
 		// OOM
 		Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
 		freePlaylist(playlist);
 		return std::nullopt;
 	}
-	strncpy(entry, _webUrl, len);
-	entry[len - 1] = '\0';
-	playlist->push_back(entry);
 
 	return playlist;
 }
@@ -1222,18 +1246,39 @@ std::optional<Playlist *> AudioPlayer_ReturnPlaylistFromWebstream(const char *_w
 // Adds new control-command to control-queue
 void AudioPlayer_TrackControlToQueueSender(const uint8_t trackCommand) {
 	xQueueSend(gTrackControlQueue, &trackCommand, 0);
+	AudioPlayer_WakeUp();
+}
+
+// Wakes up the audio task if it's idle. Call after sending to one of its queues or changing
+// gPlayProperties it has to act on (seekmode, tellMode).
+void AudioPlayer_WakeUp(void) {
+	if (!AudioPlayer_WakeUpTimestamp) {
+		AudioPlayer_WakeUpTimestamp = micros() | 1; // never 0
+	}
+	if (AudioTaskHandle != NULL) {
+		xTaskNotifyGive(AudioTaskHandle);
+	}
 }
 
-// Knuth-Fisher-Yates-algorithm to randomize playlist
+commandLatency AudioPlayer_GetCommandLatency(void) {
+	commandLatency latency;
+	latency.count = AudioPlayer_LatencyCount;
+	latency.lastUs = AudioPlayer_LatencyLast;
+	latency.avgUs = (AudioPlayer_LatencyCount) ? AudioPlayer_LatencySum / AudioPlayer_LatencyCount : 0;
+	latency.maxUs = AudioPlayer_LatencyMax;
+	return latency;
+}
+
+// Randomizes the playlist order. The order is given by a 32 bit seed only, so it's reproducible
+// and the playlist is never touched.
 void AudioPlayer_RandomizePlaylist(Playlist *playlist) {
 	if (playlist->size() < 2) {
 		// we can not randomize less than 2 entries
 		return;
 	}
 
-	// randomize using the "normal" random engine and shuffle
-	std::default_random_engine rnd(millis());
-	std::shuffle(playlist->begin(), playlist->end(), rnd);
+	playlist->shuffle(esp_random());
+	Log_Printf(LOGLEVEL_DEBUG, playlistShuffled, playlist->size(), playlist->shuffleSeed());
 }
 
 // Helper to sort playlist - standard string comparison
@@ -1254,6 +1299,7 @@ static bool AudioPlayer_ArrSortHelper_strnatcasecmp(const char *a, const char *b
 // Sort playlist
 void AudioPlayer_SortPlaylist(Playlist *playlist) {
 	std::function<bool(const char *, const char *)> cmpFunc;
+	std::function<size_t(const char *, uint8_t *)> keyFunc;
 	const char *mode;
 	switch (AudioPlayer_PlaylistSortMode) {
 		case playlistSortMode::STRCMP:
@@ -1262,17 +1308,34 @@ void AudioPlayer_SortPlaylist(Playlist *playlist) {
 			break;
 		case playlistSortMode::STRNATCMP:
 			cmpFunc = AudioPlayer_ArrSortHelper_strnatcmp; // natural case-sensitive
+			keyFunc = [](const char *str, uint8_t *out) {
+				return NatSort_Key(str, out, false);
+			};
 			mode = "case-sensitive natural sorting";
 			break;
 		case playlistSortMode::STRNATCASECMP:
 		default:
 			cmpFunc = AudioPlayer_ArrSortHelper_strnatcasecmp; // natural case-insensitive
+			keyFunc = [](const char *str, uint8_t *out) {
+				return NatSort_Key(str, out, true);
+			};
 			mode = "case-insensitive natural sorting";
 			break;
 	}
 
+	if (playlist->isSorted()) {
+		// e.g. restored from a playlist index that was sorted the same way
+		Log_Printf(LOGLEVEL_DEBUG, "Playlist already sorted using %s", mode);
+		return;
+	}
 	Log_Printf(LOGLEVEL_INFO, "Sorting files using %s", mode);
-	std::sort(playlist->begin(), playlist->end(), cmpFunc);
+	// natural sorting re-parses both strings in every comparison, precomputed keys are a lot cheaper
+	if (keyFunc && playlist->sortByKey(keyFunc)) {
+		return;
+	}
+	if (!playlist->sort(cmpFunc)) {
+		Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+	}
 }
 
 // Clear cover send notification
@@ -1307,8 +1370,41 @@ void audio_id3data(const char *info) { // id3 metadata
 	}
 }
 
+// The audio library stops calling audio_process_i2s() at the end of a file, what the DSP chain still holds back
+// is sent from here: to the bluetooth source or straight to I2S (port 0, like the library). The partly filled
+// block of the bluetooth source goes out as well.
+static void AudioPlayer_FlushDsp(void) {
+	uint32_t samples[dspMaxLatency];
+	const uint32_t count = Dsp_Flush(samples);
+	uint32_t i2sCount = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (!Bluetooth_Source_SendAudioData(&samples[i])) {
+			samples[i2sCount++] = samples[i];
+		}
+	}
+	if (i2sCount) {
+		size_t written;
+		i2s_write(I2S_NUM_0, samples, i2sCount * sizeof(samples[0]), &written, pdMS_TO_TICKS(20));
+	}	Bluetooth_Source_Flush(); // the last block of the track is usually incomplete
+}
+
 void audio_eof_mp3(const char *info) { // end of file
 	Log_Printf(LOGLEVEL_INFO, "eof_mp3     : %s", info);
+	AudioPlayer_FlushDsp();
+	if (SpeechCache_IsActive()) {
+		// a clip of an announcement, not the track
+		AudioPlayer_SpeechClipFinished = true;
+		return;
+	}
+	gPlayProperties.trackFinished = true;
+	AudioPlayer_EofTimestamp = micros();
+	AudioPlayer_TrackGapPending = true;
+}
+
+void audio_eof_stream(const char *info) { // end of a web file (not of a station)
+	Log_Printf(LOGLEVEL_INFO, "eof_stream  : %s", info);
+	AudioPlayer_FlushDsp();
+	StreamBuffer_Stop();
 	gPlayProperties.trackFinished = true;
 }
 
@@ -1383,5 +1479,12 @@ void audio_eof_speech(const char *info) {
 
 // process audio sample extern (for bluetooth source)
 void audio_process_i2s(uint32_t *sample, bool *continueI2S) {
+	if (AudioPlayer_TrackGapPending) {
+		// first sample after a track change
+		AudioPlayer_TrackGapPending = false;
+		AudioPlayer_TrackGap = micros() - AudioPlayer_EofTimestamp;
+	}
+	PlaybackStats_OnSample();
+	Dsp_Process(sample);
 	*continueI2S = !Bluetooth_Source_SendAudioData(sample);
 }
@@ -44,6 +44,13 @@ typedef struct { // Bit field
 
 extern playProps gPlayProperties;
 
+typedef struct {
+	uint32_t count; // commands handled
+	uint32_t lastUs; // latency of the last command
+	uint32_t avgUs;
+	uint32_t maxUs;
+} commandLatency;
+
 void AudioPlayer_Init(void);
 void AudioPlayer_Exit(void);
 void AudioPlayer_Cyclic(void);
@@ -51,7 +58,10 @@ uint8_t AudioPlayer_GetRepeatMode(void);
 void AudioPlayer_VolumeToQueueSender(const int32_t _newVolume, bool reAdjustRotary);
 void AudioPlayer_TrackQueueDispatcher(const char *_itemToPlay, const uint32_t _lastPlayPos, const uint32_t _playMode, const uint16_t _trackLastPlayed);
 void AudioPlayer_TrackControlToQueueSender(const uint8_t trackCommand);
+void AudioPlayer_WakeUp(void);
+commandLatency AudioPlayer_GetCommandLatency(void);
 void AudioPlayer_PauseOnMinVolume(const uint8_t oldVolume, const uint8_t newVolume);
+void AudioPlayer_SortPlaylist(Playlist *playlist);
 
 playlistSortMode AudioPlayer_GetPlaylistSortMode(void);
 bool AudioPlayer_SetPlaylistSortMode(playlistSortMode value);
@@ -3,12 +3,14 @@
 
 #include "Bluetooth.h"
 
+#include "BluetoothFrames.h"
 #include "Common.h"
 #include "Log.h"
 #include "RotaryEncoder.h"
 #include "System.h"
 
 #include <AudioPlayer.h>
+#include <atomic>
 
 #ifdef BLUETOOTH_ENABLE
 	#include "esp_bt.h"
@@ -22,8 +24,19 @@
 
 BluetoothA2DPSink *a2dp_sink;
 BluetoothA2DPSource *a2dp_source;
-RingbufHandle_t audioSourceRingBuffer;
 String btDeviceName;
+
+// Lock-free single producer (audio task) / single consumer (A2DP task) ring of stereo samples.
+// Head and tail run freely and are only wrapped on access, so a full ring can be told from an empty one.
+// The audio task collects samples in a block and hands over the whole block at once.
+static constexpr uint32_t btSourceRingSize = 2048; // samples (power of 2)
+static constexpr uint32_t btSourceBlockSize = 128; // samples
+static uint32_t *btSourceRing = nullptr;
+static std::atomic<uint32_t> btSourceRingHead {0}; // written by the producer only
+static std::atomic<uint32_t> btSourceRingTail {0}; // written by the consumer only
+static uint32_t btSourceBlock[btSourceBlockSize];
+static uint32_t btSourceBlockFill = 0;
+static TaskHandle_t volatile btSourceWaitingProducer = NULL; // set while the producer waits for free space
 #endif
 
 #ifdef BLUETOOTH_ENABLE
@@ -109,26 +122,57 @@ int32_t get_data_channels(Frame *frame, int32_t channel_len) {
 	if (channel_len < 0 || frame == NULL) {
 		return 0;
 	}
+	if (btSourceRing == nullptr) {
+		return 0;
+	}
 	// Receive data from ring buffer
-	size_t len {};
-	vRingbufferGetInfo(audioSourceRingBuffer, nullptr, nullptr, nullptr, nullptr, &len);
-	if (len < (channel_len * 4)) {
-		// Serial.println("Bluetooth source => not enough data");
+	const uint32_t tail = btSourceRingTail.load(std::memory_order_relaxed);
+	const uint32_t available = btSourceRingHead.load(std::memory_order_acquire) - tail;
+	// hand over what's there, the last frames of a track don't fill a whole request
+	const uint32_t count = std::min<uint32_t>(available, channel_len);
+	if (count == 0) {
 		return 0;
-	};
-	size_t sampleSize = 0;
-	uint8_t *sampleBuff;
-	sampleBuff = (uint8_t *) xRingbufferReceiveUpTo(audioSourceRingBuffer, &sampleSize, (TickType_t) portMAX_DELAY, channel_len * 4);
-	if (sampleBuff != NULL) {
-		// fill the channel data
-		for (int sample = 0; sample < (channel_len); ++sample) {
-			frame[sample].channel1 = (sampleBuff[sample * 4 + 3] << 8) | sampleBuff[sample * 4 + 2];
-			frame[sample].channel2 = (sampleBuff[sample * 4 + 1] << 8) | sampleBuff[sample * 4];
-		};
-		vRingbufferReturnItem(audioSourceRingBuffer, (void *) sampleBuff);
-	};
-	return channel_len;
+	}
+	// fill the channel data, the frames may wrap around the end of the ring
+	const uint32_t start = tail & (btSourceRingSize - 1);
+	const uint32_t first = std::min<uint32_t>(count, btSourceRingSize - start);
+	Bluetooth_RepackFrames(frame, btSourceRing + start, first);
+	Bluetooth_RepackFrames(frame + first, btSourceRing, count - first);
+	btSourceRingTail.store(tail + count, std::memory_order_release);
+
+	TaskHandle_t producer = btSourceWaitingProducer;
+	if (producer != NULL) {
+		btSourceWaitingProducer = NULL;
+		xTaskNotifyGive(producer);
+	}
+	return count;
 };
+
+// Hands the collected block over to the A2DP task, waits for free space if the ring is full.
+// Returns false if the block was dropped because the connection got lost meanwhile.
+static bool Bluetooth_Source_PushBlock(void) {
+	const uint32_t head = btSourceRingHead.load(std::memory_order_relaxed);
+	while ((btSourceRingSize - (head - btSourceRingTail.load(std::memory_order_acquire))) < btSourceBlockFill) {
+		if (!a2dp_source->is_connected()) {
+			btSourceBlockFill = 0;
+			return false;
+		}
+		btSourceWaitingProducer = xTaskGetCurrentTaskHandle();
+		if ((btSourceRingSize - (head - btSourceRingTail.load(std::memory_order_acquire))) >= btSourceBlockFill) {
+			// space got freed before we announced that we're waiting
+			btSourceWaitingProducer = NULL;
+			break;
+		}
+		ulTaskNotifyTake(pdTRUE, portTICK_PERIOD_MS * 10);
+	}
+	const uint32_t start = head & (btSourceRingSize - 1);
+	const uint32_t first = std::min(btSourceBlockFill, btSourceRingSize - start);
+	memcpy(btSourceRing + start, btSourceBlock, first * sizeof(uint32_t));
+	memcpy(btSourceRing, btSourceBlock + first, (btSourceBlockFill - first) * sizeof(uint32_t));
+	btSourceRingHead.store(head + btSourceBlockFill, std::memory_order_release);
+	btSourceBlockFill = 0;
+	return true;
+}
 #endif
 
 #ifdef BLUETOOTH_ENABLE
@@ -201,9 +245,9 @@ void Bluetooth_Init(void) {
 		a2dp_sink->set_on_volumechange(Bluetooth_VolumeChanged);
 	} else if (System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) {
 		// create audio source ringbuffer on demand
-		audioSourceRingBuffer = xRingbufferCreate(8192, RINGBUF_TYPE_BYTEBUF);
-		if (audioSourceRingBuffer == NULL) {
-			Log_Println("cannot create audioSourceRingBuffer!", LOGLEVEL_ERROR);
+		btSourceRing = static_cast<uint32_t *>(malloc(btSourceRingSize * sizeof(uint32_t)));
+		if (btSourceRing == NULL) {
+			Log_Println("cannot create audio source ringbuffer!", LOGLEVEL_ERROR);
 		}
 		//  setup BT source
 		a2dp_source = new BluetoothA2DPSource();
@@ -312,8 +356,12 @@ void Bluetooth_SetVolume(const int32_t _newVolume, bool reAdjustRotary) {
 bool Bluetooth_Source_SendAudioData(uint32_t *sample) {
 #ifdef BLUETOOTH_ENABLE
 	// send audio data to ringbuffer
-	if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && (a2dp_source) && a2dp_source->is_connected()) {
-		return (pdTRUE == xRingbufferSend(audioSourceRingBuffer, sample, sizeof(uint32_t), (TickType_t) portMAX_DELAY));
+	if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && (a2dp_source) && (btSourceRing) && a2dp_source->is_connected()) {
+		btSourceBlock[btSourceBlockFill++] = *sample;
+		if (btSourceBlockFill == btSourceBlockSize) {
+			return Bluetooth_Source_PushBlock();
+		}
+		return true;
 	} else {
 		return false;
 	}
@@ -322,6 +370,21 @@ bool Bluetooth_Source_SendAudioData(uint32_t *sample) {
 #endif
 }
 
+// Hands over the samples collected in the current block, which would otherwise wait for the next track.
+// Called by the audio task at the end of a track, on stop and on pause.
+void Bluetooth_Source_Flush(void) {
+#ifdef BLUETOOTH_ENABLE
+	if (btSourceBlockFill == 0) {
+		return;
+	}
+	if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && (a2dp_source) && (btSourceRing) && a2dp_source->is_connected()) {
+		Bluetooth_Source_PushBlock();
+	} else {
+		btSourceBlockFill = 0;
+	}
+#endif
+}
+
 bool Bluetooth_Device_Connected() {
 #ifdef BLUETOOTH_ENABLE
 	// send audio data to ringbuffer
@@ -14,4 +14,5 @@ void Bluetooth_PreviousTrack(void);
 void Bluetooth_SetVolume(const int32_t _newVolume, bool reAdjustRotary);
 
 bool Bluetooth_Source_SendAudioData(uint32_t *sample);
+void Bluetooth_Source_Flush(void);
 bool Bluetooth_Device_Connected();
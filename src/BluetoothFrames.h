@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// Conversion of samples of the audio library (left channel in the upper half word) to the frames of the A2DP
+// source (channel1, channel2: two int16_t). Kept free of the A2DP library, so it's compiled and checked on a PC
+// as well. FrameT is Frame of ESP32-A2DP.
+
+// Reference implementation: one channel at a time
+template <typename FrameT>
+void Bluetooth_RepackFramesScalar(FrameT *frame, const uint32_t *samples, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		frame[i].channel1 = samples[i] >> 16;
+		frame[i].channel2 = samples[i] & 0xFFFF;
+	}
+}
+
+// Same as Bluetooth_RepackFramesScalar() on whole words: in memory a frame is the sample with swapped
+// half words, so each sample is rotated by 16 bits and stored with a single write.
+template <typename FrameT>
+void Bluetooth_RepackFrames(FrameT *frame, const uint32_t *samples, uint32_t count) {
+	static_assert(sizeof(FrameT) == sizeof(uint32_t), "frame must be one word");
+	static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "word layout of frames assumes little endian");
+	typedef uint32_t __attribute__((__may_alias__)) frameWord;
+
+	const uintptr_t frameAddr = reinterpret_cast<uintptr_t>(frame); // Frame is packed
+	if (frameAddr & (sizeof(uint32_t) - 1)) {
+		// unaligned word stores would trap
+		Bluetooth_RepackFramesScalar(frame, samples, count);
+		return;
+	}
+	frameWord *out = reinterpret_cast<frameWord *>(frameAddr);
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint32_t s0 = samples[i];
+		const uint32_t s1 = samples[i + 1];
+		const uint32_t s2 = samples[i + 2];
+		const uint32_t s3 = samples[i + 3];
+		out[i] = (s0 << 16) | (s0 >> 16);
+		out[i + 1] = (s1 << 16) | (s1 >> 16);
+		out[i + 2] = (s2 << 16) | (s2 >> 16);
+		out[i + 3] = (s3 << 16) | (s3 >> 16);
+	}
+	for (; i < count; i++) {
+		out[i] = (samples[i] << 16) | (samples[i] >> 16);
+	}
+}
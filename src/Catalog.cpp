@@ -0,0 +1,1078 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Catalog.h"
+
+#include "Common.h"
+#include "Hash.h"
+#include "Log.h"
+#include "MemX.h"
+#include "Mp3Header.h"
+#include "SdArbiter.h"
+#include "SdCard.h"
+
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#ifdef MEDIA_CATALOG_ENABLE
+// The catalog is a flat binary file: a header followed by a directory record for every directory,
+// each followed by the records of its tracks. It's built by a low priority task walking the card
+// breadth first. Directories still to visit are kept in a todo file, so the walk needs no memory for
+// the tree and can be continued after deep sleep. A new catalog is built next to the complete one
+// and replaces it when the walk is done, so queries always see a consistent state.
+static constexpr uint32_t catalogMagic = 0x54414345; // "ECAT"
+static constexpr uint16_t catalogVersion = 2;
+static constexpr uint32_t catalogIndexMagic = 0x58494345; // "ECIX"
+static constexpr uint32_t catalogStartDelay = 30000; // ms after boot, don't slow down the startup
+static constexpr uint32_t catalogRescanDelay = 10000; // ms to wait for further changes (e.g. an album being uploaded)
+static constexpr size_t catalogTagLength = 64; // including the terminator
+static constexpr size_t catalogProbeBytes = 4096; // read by a track probe: tags and first frame, a few sectors
+
+struct Catalog_Header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t trackCount;
+	uint32_t dirCount;
+};
+
+struct __attribute__((packed)) Catalog_DirRecord {
+	uint8_t type; // 'D'
+	uint8_t reserved;
+	uint16_t pathLen; // followed by the path (without terminator)
+};
+
+struct __attribute__((packed)) Catalog_TrackRecord {
+	uint8_t type; // 'T'
+	CatalogCodec codec;
+	uint8_t nameLen; // followed by name, title, artist and album (without terminators)
+	uint8_t titleLen;
+	uint8_t artistLen;
+	uint8_t albumLen;
+	int16_t gain; // ReplayGain track gain in 1/100 dB, catalogNoGain if unknown
+	uint32_t size;
+	uint32_t durationMs;
+};
+
+struct Catalog_Tags {
+	char title[catalogTagLength];
+	char artist[catalogTagLength];
+	char album[catalogTagLength];
+	int16_t gain;
+};
+
+// Directory index (catalog.idx), lets a single directory be found without streaming through the catalog
+struct Catalog_IndexHeader {
+	uint32_t magic;
+	uint32_t count;
+};
+
+struct Catalog_IndexEntry {
+	uint32_t pathHash;
+	uint32_t offset; // of the directory record within catalog.db
+};
+
+// Growing buffer collecting the records of a single directory before they're committed
+class Catalog_Buffer {
+public:
+	~Catalog_Buffer() { free(data); }
+	bool append(const void *_data, size_t _len) {
+		if (len + _len > capacity) {
+			const size_t newCapacity = std::max(len + _len, std::max<size_t>(capacity * 2, 1024));
+			uint8_t *newData = static_cast<uint8_t *>(x_realloc(data, newCapacity));
+			if (!newData) {
+				return false;
+			}
+			data = newData;
+			capacity = newCapacity;
+		}
+		memcpy(data + len, _data, _len);
+		len += _len;
+		return true;
+	}
+
+	uint8_t *data = nullptr;
+	size_t len = 0;
+	size_t capacity = 0;
+};
+
+static TaskHandle_t Catalog_TaskHandle = NULL;
+static volatile bool Catalog_StopRequested = false;
+static volatile bool Catalog_Dirty = false; // the card changed since the last complete walk
+static bool Catalog_Ready = false; // a complete catalog exists
+static bool Catalog_Scanning = false; // a walk is in progress
+static uint32_t Catalog_TodoPos = 0; // read position within the todo file
+static uint32_t Catalog_CommittedSize = 0; // size of the new catalog after the last complete directory
+static uint32_t Catalog_TodoSize = 0; // size of the todo file after the last complete directory
+static uint32_t Catalog_TrackCount = 0; // of the complete catalog
+static uint32_t Catalog_DirCount = 0;
+static SemaphoreHandle_t Catalog_DbMutex = NULL; // guards replacing catalog.db against lookups
+static uint32_t Catalog_Generation = 1; // counts the replacements of catalog.db, invalidates cursors
+static Catalog_IndexEntry *Catalog_Index = nullptr; // sorted by pathHash
+static uint32_t Catalog_IndexCount = 0;
+
+static String Catalog_FilePath(const char *_name) {
+	return String(cacheDir) + "/" + _name;
+}
+
+static CatalogCodec Catalog_CodecFromName(const char *_name) {
+	const char *ext = strrchr(_name, '.');
+	if (!ext) {
+		return CatalogCodec::Unknown;
+	}
+	// clang-format off
+	static constexpr struct {
+		const char *ext;
+		CatalogCodec codec;
+	} codecs[] = {
+		{".mp3", CatalogCodec::Mp3},
+		{".aac", CatalogCodec::Aac},
+		{".m4a", CatalogCodec::M4a},
+		{".wav", CatalogCodec::Wav},
+		{".flac", CatalogCodec::Flac},
+		{".ogg", CatalogCodec::Ogg},
+		{".oga", CatalogCodec::Ogg},
+		{".opus", CatalogCodec::Opus},
+	};
+	// clang-format on
+	for (const auto &c : codecs) {
+		if (strcasecmp(ext, c.ext) == 0) {
+			return c.codec;
+		}
+	}
+	return CatalogCodec::Unknown;
+}
+
+static uint32_t Catalog_Be32(const uint8_t *b) {
+	return (static_cast<uint32_t>(b[0]) << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+}
+
+static uint32_t Catalog_Le32(const uint8_t *b) {
+	return b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+}
+
+static uint32_t Catalog_SyncSafe(const uint8_t *b) {
+	return ((b[0] & 0x7f) << 21) | ((b[1] & 0x7f) << 14) | ((b[2] & 0x7f) << 7) | (b[3] & 0x7f);
+}
+
+// Parses a ReplayGain value like "-6.54 dB" to 1/100 dB
+static int16_t Catalog_ParseGain(const char *_value) {
+	char *end;
+	const float db = strtof(_value, &end);
+	if (end == _value || db < -60.0f || db > 60.0f) {
+		return catalogNoGain;
+	}
+	return static_cast<int16_t>(lroundf(db * 100.0f));
+}
+
+// Appends a unicode code point as UTF-8, never cuts a sequence at the end of the buffer
+static void Catalog_PutUtf8(char *_out, size_t &_pos, size_t _outLen, uint32_t _cp) {
+	char seq[3];
+	size_t n;
+	if (_cp < 0x80) {
+		seq[0] = _cp;
+		n = 1;
+	} else if (_cp < 0x800) {
+		seq[0] = 0xC0 | (_cp >> 6);
+		seq[1] = 0x80 | (_cp & 0x3F);
+		n = 2;
+	} else {
+		seq[0] = 0xE0 | (_cp >> 12);
+		seq[1] = 0x80 | ((_cp >> 6) & 0x3F);
+		seq[2] = 0x80 | (_cp & 0x3F);
+		n = 3;
+	}
+	if (_pos + n < _outLen) {
+		memcpy(_out + _pos, seq, n);
+		_pos += n;
+	}
+}
+
+// Converts the text of an ID3v2 text frame (encoding byte + text) to UTF-8
+static void Catalog_DecodeId3Text(const uint8_t *_data, size_t _len, char *_out, size_t _outLen) {
+	size_t pos = 0;
+	if (_len) {
+		const uint8_t encoding = _data[0];
+		_data++;
+		_len--;
+		if (encoding == 1 || encoding == 2) {
+			// UTF-16 with BOM or big endian, characters outside of the BMP are replaced
+			bool bigEndian = (encoding == 2);
+			if (encoding == 1 && _len >= 2) {
+				bigEndian = (_data[0] == 0xFE);
+				_data += 2;
+				_len -= 2;
+			}
+			for (size_t i = 0; i + 1 < _len; i += 2) {
+				const uint32_t cp = bigEndian ? (_data[i] << 8) | _data[i + 1] : _data[i] | (_data[i + 1] << 8);
+				if (cp == 0) {
+					break;
+				}
+				Catalog_PutUtf8(_out, pos, _outLen, (cp >= 0xD800 && cp <= 0xDFFF) ? '?' : cp);
+			}
+		} else {
+			// ISO-8859-1 or UTF-8
+			for (size_t i = 0; i < _len && _data[i]; i++) {
+				if (encoding == 3) {
+					if (pos + 1 < _outLen) {
+						_out[pos++] = _data[i];
+					}
+				} else {
+					Catalog_PutUtf8(_out, pos, _outLen, _data[i]);
+				}
+			}
+		}
+	}
+	_out[pos] = '\0';
+}
+
+// Reads title, artist and album of an ID3v2.3/2.4 tag at the start of the file.
+// Returns the size of the tag, which is where the audio data starts (0 if there's no tag).
+static uint32_t Catalog_ReadId3v2(File &f, Catalog_Tags &tags) {
+	uint8_t header[10];
+	if (!f.seek(0) || f.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "ID3", 3) != 0) {
+		return 0;
+	}
+	const uint8_t version = header[3];
+	const uint8_t flags = header[5];
+	const uint32_t tagEnd = Catalog_SyncSafe(header + 6) + 10;
+	const uint32_t tagSize = tagEnd + ((flags & 0x10) ? 10 : 0); // footer
+	if (version < 3 || version > 4 || (flags & 0x80)) {
+		// ID3v2.2 or unsynchronized tag, not worth the effort
+		return tagSize;
+	}
+	uint32_t pos = 10;
+	if (flags & 0x40) {
+		// skip extended header
+		uint8_t ext[4];
+		if (f.read(ext, sizeof(ext)) != sizeof(ext)) {
+			return tagSize;
+		}
+		pos += (version == 4) ? Catalog_SyncSafe(ext) : Catalog_Be32(ext) + 4;
+	}
+	uint8_t text[2 * catalogTagLength + 3]; // UTF-16 needs two bytes per character, plus encoding and BOM
+	while (pos + 10 <= tagEnd) {
+		uint8_t frame[10];
+		if (!f.seek(pos) || f.read(frame, sizeof(frame)) != sizeof(frame) || frame[0] == 0) {
+			// padding or broken tag
+			break;
+		}
+		const uint32_t frameSize = (version == 4) ? Catalog_SyncSafe(frame + 4) : Catalog_Be32(frame + 4);
+		char *target = nullptr;
+		if (memcmp(frame, "TXXX", 4) == 0) {
+			// user defined text: encoding, description, terminator, value
+			const size_t len = f.read(text, std::min<size_t>(frameSize, sizeof(text)));
+			const bool utf16 = (len && (text[0] == 1 || text[0] == 2));
+			size_t valueStart = 0;
+			for (size_t i = 1; i + (utf16 ? 1 : 0) < len; i += (utf16 ? 2 : 1)) {
+				if (text[i] == 0 && (!utf16 || text[i + 1] == 0)) {
+					valueStart = i + (utf16 ? 2 : 1);
+					break;
+				}
+			}
+			if (valueStart) {
+				char description[24];
+				char value[16];
+				Catalog_DecodeId3Text(text, valueStart, description, sizeof(description));
+				// the value needs the encoding byte in front, it replaces the last byte of the terminator
+				text[valueStart - 1] = text[0];
+				Catalog_DecodeId3Text(text + valueStart - 1, len - valueStart + 1, value, sizeof(value));
+				if (strcasecmp(description, "REPLAYGAIN_TRACK_GAIN") == 0) {
+					tags.gain = Catalog_ParseGain(value);
+				}
+			}
+		} else if (memcmp(frame, "TIT2", 4) == 0) {
+			target = tags.title;
+		} else if (memcmp(frame, "TPE1", 4) == 0) {
+			target = tags.artist;
+		} else if (memcmp(frame, "TALB", 4) == 0) {
+			target = tags.album;
+		}
+		if (target) {
+			const size_t len = f.read(text, std::min<size_t>(frameSize, sizeof(text)));
+			Catalog_DecodeId3Text(text, len, target, catalogTagLength);
+		}
+		pos += 10 + frameSize;
+	}
+	return tagSize;
+}
+
+// Falls back to the 128 byte ID3v1 tag at the end of the file
+static void Catalog_ReadId3v1(File &f, Catalog_Tags &tags) {
+	uint8_t tag[128];
+	if (f.size() < sizeof(tag) || !f.seek(f.size() - sizeof(tag)) || f.read(tag, sizeof(tag)) != sizeof(tag) || memcmp(tag, "TAG", 3) != 0) {
+		return;
+	}
+	const struct {
+		char *target;
+		size_t offset;
+	} fields[] = {{tags.title, 3}, {tags.artist, 33}, {tags.album, 63}};
+	for (const auto &field : fields) {
+		size_t pos = 0;
+		for (size_t i = 0; i < 30 && tag[field.offset + i]; i++) {
+			Catalog_PutUtf8(field.target, pos, catalogTagLength, tag[field.offset + i]);
+		}
+		// fields are padded with spaces
+		while (pos && field.target[pos - 1] == ' ') {
+			pos--;
+		}
+		field.target[pos] = '\0';
+	}
+}
+
+// Reads the ReplayGain track gain from an APEv2 tag at the end of the file (written by mp3gain).
+// The tag is either the last thing in the file or followed by an ID3v1 tag.
+static void Catalog_ReadApeGain(File &f, Catalog_Tags &tags) {
+	uint8_t footer[32];
+	for (const uint32_t trailer : {0u, 128u}) {
+		if (f.size() < sizeof(footer) + trailer || !f.seek(f.size() - trailer - sizeof(footer)) || f.read(footer, sizeof(footer)) != sizeof(footer) || memcmp(footer, "APETAGEX", 8) != 0) {
+			continue;
+		}
+		const uint32_t tagSize = Catalog_Le32(footer + 12); // items and footer
+		uint32_t items = Catalog_Le32(footer + 16);
+		if (tagSize < sizeof(footer) || tagSize > f.size() - trailer || !f.seek(f.size() - trailer - tagSize)) {
+			return;
+		}
+		char key[24];
+		char value[16];
+		while (items--) {
+			uint8_t item[8];
+			if (f.read(item, sizeof(item)) != sizeof(item)) {
+				return;
+			}
+			const uint32_t valueLen = Catalog_Le32(item);
+			size_t keyLen = 0;
+			int c;
+			while ((c = f.read()) > 0) {
+				if (keyLen < sizeof(key) - 1) {
+					key[keyLen++] = c;
+				}
+			}
+			key[keyLen] = '\0';
+			if (c < 0) {
+				return;
+			}
+			if (strcasecmp(key, "REPLAYGAIN_TRACK_GAIN") == 0) {
+				const size_t n = f.read(reinterpret_cast<uint8_t *>(value), std::min<size_t>(valueLen, sizeof(value) - 1));
+				value[n] = '\0';
+				tags.gain = Catalog_ParseGain(value);
+				return;
+			}
+			f.seek(valueLen, SeekCur);
+		}
+		return;
+	}
+}
+
+// Duration of a mp3 from the Xing/Info or VBRI header of the first frame, or from the bitrate for CBR files
+static uint32_t Catalog_Mp3Duration(File &f, uint32_t audioStart) {
+	uint8_t buf[512];
+	if (!f.seek(audioStart)) {
+		return 0;
+	}
+	const size_t len = f.read(buf, sizeof(buf));
+	for (size_t i = 0; i + 4 <= len; i++) {
+		Mp3FrameInfo info;
+		if (!Mp3_ParseFrameHeader(buf + i, info)) {
+			continue;
+		}
+		uint32_t frames = 0;
+		const size_t xing = i + info.xingOffset();
+		const size_t vbri = i + 4 + 32;
+		if (xing + 12 <= len && (memcmp(buf + xing, "Xing", 4) == 0 || memcmp(buf + xing, "Info", 4) == 0)) {
+			if (Catalog_Be32(buf + xing + 4) & 0x01) {
+				frames = Catalog_Be32(buf + xing + 8);
+			}
+		} else if (vbri + 18 <= len && memcmp(buf + vbri, "VBRI", 4) == 0) {
+			frames = Catalog_Be32(buf + vbri + 14);
+		}
+		if (frames) {
+			return static_cast<uint64_t>(frames) * info.samplesPerFrame * 1000 / info.sampleRate;
+		}
+		// CBR
+		const uint32_t audioBytes = f.size() - (audioStart + i);
+		return static_cast<uint64_t>(audioBytes) * 8 / info.kbps;
+	}
+	return 0;
+}
+
+// Duration and Vorbis comments from the metadata blocks of a flac file
+static uint32_t Catalog_ProbeFlac(File &f, uint32_t start, Catalog_Tags &tags) {
+	uint8_t buf[4];
+	if (!f.seek(start) || f.read(buf, 4) != 4 || memcmp(buf, "fLaC", 4) != 0) {
+		return 0;
+	}
+	uint32_t durationMs = 0;
+	uint32_t pos = start + 4;
+	bool last = false;
+	while (!last && f.seek(pos) && f.read(buf, 4) == 4) {
+		last = buf[0] & 0x80;
+		const uint8_t type = buf[0] & 0x7F;
+		const uint32_t blockLen = (buf[1] << 16) | (buf[2] << 8) | buf[3];
+		if (type == 0) {
+			// STREAMINFO
+			uint8_t info[18];
+			if (f.read(info, sizeof(info)) == sizeof(info)) {
+				const uint32_t sampleRate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+				const uint64_t samples = (static_cast<uint64_t>(info[13] & 0x0F) << 32) | Catalog_Be32(info + 14);
+				if (sampleRate) {
+					durationMs = samples * 1000 / sampleRate;
+				}
+			}
+		} else if (type == 4) {
+			// VORBIS_COMMENT, lengths are little endian
+			uint8_t len[4];
+			f.read(len, 4);
+			f.seek(Catalog_Le32(len), SeekCur); // vendor string
+			f.read(len, 4);
+			uint32_t comments = Catalog_Le32(len);
+			char comment[catalogTagLength + 8];
+			while (comments-- && f.read(len, 4) == 4) {
+				const uint32_t commentLen = Catalog_Le32(len);
+				const size_t n = f.read(reinterpret_cast<uint8_t *>(comment), std::min<size_t>(commentLen, sizeof(comment) - 1));
+				comment[n] = '\0';
+				if (commentLen > n) {
+					f.seek(commentLen - n, SeekCur);
+				}
+				if (strncasecmp(comment, "TITLE=", 6) == 0) {
+					strncpy(tags.title, comment + 6, catalogTagLength - 1);
+				} else if (strncasecmp(comment, "ARTIST=", 7) == 0) {
+					strncpy(tags.artist, comment + 7, catalogTagLength - 1);
+				} else if (strncasecmp(comment, "ALBUM=", 6) == 0) {
+					strncpy(tags.album, comment + 6, catalogTagLength - 1);
+				} else if (strncasecmp(comment, "REPLAYGAIN_TRACK_GAIN=", 22) == 0) {
+					tags.gain = Catalog_ParseGain(comment + 22);
+				}
+			}
+		}
+		pos += 4 + blockLen;
+	}
+	return durationMs;
+}
+
+// Duration of a wav file from the "fmt " and "data" chunks
+static uint32_t Catalog_ProbeWav(File &f) {
+	uint8_t buf[12];
+	if (!f.seek(0) || f.read(buf, 12) != 12 || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) {
+		return 0;
+	}
+	uint32_t byteRate = 0;
+	uint32_t pos = 12;
+	while (f.seek(pos) && f.read(buf, 8) == 8) {
+		const uint32_t chunkLen = Catalog_Le32(buf + 4);
+		if (memcmp(buf, "fmt ", 4) == 0 && f.read(buf, 12) == 12) {
+			byteRate = Catalog_Le32(buf + 8);
+		} else if (memcmp(buf, "data", 4) == 0) {
+			return (byteRate) ? static_cast<uint64_t>(chunkLen) * 1000 / byteRate : 0;
+		}
+		pos += 8 + chunkLen + (chunkLen & 1);
+	}
+	return 0;
+}
+
+// Reads duration and tags of a track. AAC, M4A, Ogg and Opus are cataloged without them.
+static uint32_t Catalog_ProbeTrack(File &f, CatalogCodec codec, Catalog_Tags &tags) {
+	switch (codec) {
+		case CatalogCodec::Mp3: {
+			const uint32_t audioStart = Catalog_ReadId3v2(f, tags);
+			if (!tags.title[0] && !tags.artist[0] && !tags.album[0]) {
+				Catalog_ReadId3v1(f, tags);
+			}
+			if (tags.gain == catalogNoGain) {
+				Catalog_ReadApeGain(f, tags);
+			}
+			return Catalog_Mp3Duration(f, audioStart);
+		}
+		case CatalogCodec::Flac:
+			return Catalog_ProbeFlac(f, Catalog_ReadId3v2(f, tags), tags);
+		case CatalogCodec::Wav:
+			return Catalog_ProbeWav(f);
+		default:
+			return 0;
+	}
+}
+
+static bool Catalog_AppendTrack(Catalog_Buffer &records, const char *name, CatalogCodec codec, uint32_t size, uint32_t durationMs, const Catalog_Tags &tags) {
+	Catalog_TrackRecord record = {};
+	record.type = 'T';
+	record.codec = codec;
+	record.nameLen = strlen(name);
+	record.titleLen = strlen(tags.title);
+	record.artistLen = strlen(tags.artist);
+	record.albumLen = strlen(tags.album);
+	record.gain = tags.gain;
+	record.size = size;
+	record.durationMs = durationMs;
+	return records.append(&record, sizeof(record)) && records.append(name, record.nameLen) && records.append(tags.title, record.titleLen) && records.append(tags.artist, record.artistLen) && records.append(tags.album, record.albumLen);
+}
+
+// Reads a string of _len bytes, cutting it to the buffer if the catalog is broken
+static void Catalog_ReadString(File &f, char *_buf, size_t _bufLen, uint8_t _len) {
+	const size_t n = f.read(reinterpret_cast<uint8_t *>(_buf), std::min<size_t>(_len, _bufLen - 1));
+	_buf[n] = '\0';
+	if (_len > n) {
+		f.seek(_len - n, SeekCur);
+	}
+}
+
+static bool Catalog_ReadHeader(File &f, Catalog_Header &header) {
+	return f && f.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) && header.magic == catalogMagic && header.version == catalogVersion;
+}
+
+static bool Catalog_LoadIndex(void) {
+	File f = gFSystem.open(Catalog_FilePath("catalog.idx"), FILE_READ);
+	Catalog_IndexHeader header;
+	if (!f || f.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) || header.magic != catalogIndexMagic) {
+		return false;
+	}
+	const size_t len = header.count * sizeof(Catalog_IndexEntry);
+	Catalog_IndexEntry *index = static_cast<Catalog_IndexEntry *>(x_malloc(std::max<size_t>(len, 1)));
+	if (!index || f.read(reinterpret_cast<uint8_t *>(index), len) != len) {
+		free(index);
+		return false;
+	}
+	free(Catalog_Index);
+	Catalog_Index = index;
+	Catalog_IndexCount = header.count;
+	return true;
+}
+
+static void Catalog_LoadInfo(void) {
+	File f = gFSystem.open(Catalog_FilePath("catalog.db"), FILE_READ);
+	Catalog_Header header;
+	Catalog_Ready = Catalog_ReadHeader(f, header);
+	Catalog_TrackCount = (Catalog_Ready) ? header.trackCount : 0;
+	Catalog_DirCount = (Catalog_Ready) ? header.dirCount : 0;
+	if (Catalog_Ready && !Catalog_LoadIndex()) {
+		// without the index single tracks can't be looked up, build both again
+		Catalog_Dirty = true;
+	}
+}
+
+static bool Catalog_StartPass(void) {
+	if (Catalog_Dirty) {
+		Catalog_Dirty = false;
+		gPrefsSettings.putBool("catalogDirty", false);
+	}
+	gFSystem.mkdir(cacheDir);
+	File f = gFSystem.open(Catalog_FilePath("catalog.new"), FILE_WRITE);
+	Catalog_Header header = {catalogMagic, catalogVersion, 0, 0, 0};
+	const bool headerOk = f && f.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) == sizeof(header);
+	f.close();
+	File todo = gFSystem.open(Catalog_FilePath("catalog.todo"), FILE_WRITE);
+	const bool todoOk = todo && todo.print("/\n") == 2;
+	todo.close();
+	if (!headerOk || !todoOk) {
+		Log_Printf(LOGLEVEL_ERROR, catalogWriteFailed, cacheDir);
+		return false;
+	}
+	Catalog_TodoPos = 0;
+	Catalog_TodoSize = 2;
+	Catalog_CommittedSize = sizeof(header);
+	Catalog_Scanning = true;
+	Log_Println(catalogScanStarted, LOGLEVEL_NOTICE);
+	return true;
+}
+
+enum class Catalog_StepResult {
+	Continue,
+	Done,
+	Failed,
+	Stopped
+};
+
+// Catalogs the next directory of the todo list. Its records and subdirectories are only committed
+// once it's complete, so a stop request in between just means the directory is walked again.
+static Catalog_StepResult Catalog_ScanNextDirectory(void) {
+	char dirPath[256];
+	uint32_t nextTodoPos;
+	{
+		File todo = gFSystem.open(Catalog_FilePath("catalog.todo"), FILE_READ);
+		if (!todo || !todo.seek(Catalog_TodoPos)) {
+			return Catalog_StepResult::Failed;
+		}
+		size_t len = 0;
+		int c;
+		while ((c = todo.read()) >= 0 && c != '\n') {
+			if (len < sizeof(dirPath) - 1) {
+				dirPath[len++] = c;
+			}
+		}
+		if (c < 0 && !len) {
+			return Catalog_StepResult::Done;
+		}
+		dirPath[len] = '\0';
+		nextTodoPos = todo.position();
+	}
+
+	Catalog_Buffer records;
+	Catalog_Buffer subdirs;
+	File directory = gFSystem.open(dirPath);
+	if (directory && directory.isDirectory()) {
+		const size_t dirLen = strlen(dirPath);
+		const Catalog_DirRecord dirRecord = {'D', 0, static_cast<uint16_t>(dirLen)};
+		bool ok = records.append(&dirRecord, sizeof(dirRecord)) && records.append(dirPath, dirLen);
+		while (ok) {
+			if (Catalog_StopRequested) {
+				return Catalog_StepResult::Stopped;
+			}
+			bool isDir;
+			const String path = directory.getNextFileName(&isDir);
+			if (path.isEmpty()) {
+				break;
+			}
+			const char *name = path.c_str() + path.lastIndexOf('/') + 1;
+			if (*name == '.') {
+				// skip hidden entries (e.g. cacheDir)
+				continue;
+			}
+			if (isDir) {
+				ok = subdirs.append(path.c_str(), path.length()) && subdirs.append("\n", 1);
+				continue;
+			}
+			const CatalogCodec codec = Catalog_CodecFromName(name);
+			if (codec == CatalogCodec::Unknown || strlen(name) > UINT8_MAX) {
+				continue;
+			}
+			// the arbiter throttles the probes while audio is read from the card
+			SdArbiter_BackgroundBegin(catalogProbeBytes);
+			File track = gFSystem.open(path, FILE_READ);
+			if (!track) {
+				SdArbiter_BackgroundEnd();
+				continue;
+			}
+			Catalog_Tags tags = {};
+			tags.gain = catalogNoGain;
+			const uint32_t durationMs = Catalog_ProbeTrack(track, codec, tags);
+			ok = Catalog_AppendTrack(records, name, codec, track.size(), durationMs, tags);
+			track.close();
+			SdArbiter_BackgroundEnd();
+			vTaskDelay(portTICK_PERIOD_MS);
+		}
+		if (!ok) {
+			Log_Println(unableToAllocateMem, LOGLEVEL_ERROR);
+			return Catalog_StepResult::Failed;
+		}
+	}
+
+	// commit the directory
+	if (subdirs.len) {
+		SdArbiter_BackgroundBegin(subdirs.len);
+		File todo = gFSystem.open(Catalog_FilePath("catalog.todo"), FILE_APPEND);
+		const bool written = todo && todo.write(subdirs.data, subdirs.len) == subdirs.len;
+		if (written) {
+			Catalog_TodoSize = todo.size();
+		}
+		todo.close();
+		SdArbiter_BackgroundEnd();
+		if (!written) {
+			return Catalog_StepResult::Failed;
+		}
+	}
+	if (records.len) {
+		SdArbiter_BackgroundBegin(records.len);
+		File f = gFSystem.open(Catalog_FilePath("catalog.new"), FILE_APPEND);
+		const bool written = f && f.write(records.data, records.len) == records.len;
+		if (written) {
+			Catalog_CommittedSize = f.size();
+		}
+		f.close();
+		SdArbiter_BackgroundEnd();
+		if (!written) {
+			return Catalog_StepResult::Failed;
+		}
+	}
+	Catalog_TodoPos = nextTodoPos;
+	return Catalog_StepResult::Continue;
+}
+
+// Counts the records of the new catalog, stores the totals in its header and makes it the current one.
+// Builds the directory index along the way.
+static bool Catalog_FinishPass(void) {
+	const String newFile = Catalog_FilePath("catalog.new");
+	Catalog_Header header;
+	Catalog_Buffer index;
+	{
+		File f = gFSystem.open(newFile, FILE_READ);
+		if (!Catalog_ReadHeader(f, header)) {
+			return false;
+		}
+		uint8_t type;
+		char path[256];
+		while (f.read(&type, 1) == 1) {
+			if (type == 'D') {
+				Catalog_IndexEntry entry;
+				entry.offset = f.position() - 1;
+				Catalog_DirRecord record;
+				f.read(reinterpret_cast<uint8_t *>(&record) + 1, sizeof(record) - 1);
+				const size_t len = f.read(reinterpret_cast<uint8_t *>(path), std::min<size_t>(record.pathLen, sizeof(path)));
+				if (record.pathLen > len) {
+					f.seek(record.pathLen - len, SeekCur);
+				}
+				entry.pathHash = Hash_Fnv1a(path, len);
+				if (!index.append(&entry, sizeof(entry))) {
+					return false;
+				}
+				header.dirCount++;
+			} else if (type == 'T') {
+				Catalog_TrackRecord record;
+				f.read(reinterpret_cast<uint8_t *>(&record) + 1, sizeof(record) - 1);
+				f.seek(record.nameLen + record.titleLen + record.artistLen + record.albumLen, SeekCur);
+				header.trackCount++;
+			} else {
+				return false;
+			}
+		}
+	}
+	File f = gFSystem.open(newFile, "r+");
+	if (!f || f.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	f.close();
+	Catalog_IndexEntry *entries = reinterpret_cast<Catalog_IndexEntry *>(index.data);
+	const Catalog_IndexHeader indexHeader = {catalogIndexMagic, header.dirCount};
+	std::sort(entries, entries + indexHeader.count, [](const Catalog_IndexEntry &a, const Catalog_IndexEntry &b) {
+		return a.pathHash < b.pathHash;
+	});
+
+	const String dbFile = Catalog_FilePath("catalog.db");
+	xSemaphoreTake(Catalog_DbMutex, portMAX_DELAY);
+	gFSystem.remove(dbFile);
+	const bool renamed = gFSystem.rename(newFile, dbFile);
+	File idx = (renamed) ? gFSystem.open(Catalog_FilePath("catalog.idx"), FILE_WRITE) : File();
+	const bool indexOk = idx && idx.write(reinterpret_cast<const uint8_t *>(&indexHeader), sizeof(indexHeader)) == sizeof(indexHeader) && idx.write(index.data, index.len) == index.len;
+	idx.close();
+	free(Catalog_Index);
+	Catalog_Index = (renamed) ? entries : nullptr;
+	Catalog_IndexCount = (renamed) ? indexHeader.count : 0;
+	Catalog_Generation++;
+	if (renamed) {
+		index.data = nullptr; // owned by Catalog_Index now
+	}
+	xSemaphoreGive(Catalog_DbMutex);
+	if (!renamed) {
+		return false;
+	}
+	gFSystem.remove(Catalog_FilePath("catalog.todo"));
+	Catalog_TrackCount = header.trackCount;
+	Catalog_DirCount = header.dirCount;
+	Catalog_Ready = true;
+	if (!indexOk) {
+		// a missing index makes the next boot rebuild the catalog
+		gFSystem.remove(Catalog_FilePath("catalog.idx"));
+	}
+	return indexOk;
+}
+
+// Waits _ms, but returns at once if Catalog_Exit() asks the task to stop
+static void Catalog_Sleep(uint32_t _ms) {
+	const uint32_t start = millis();
+	uint32_t elapsed = 0;
+	while (!Catalog_StopRequested && elapsed < _ms) {
+		ulTaskNotifyTake(pdTRUE, portTICK_PERIOD_MS * (_ms - elapsed));
+		elapsed = millis() - start;
+	}
+}
+
+static void Catalog_Task(void *parameter) {
+	Catalog_Sleep(catalogStartDelay);
+	while (!Catalog_StopRequested) {
+		if (!Catalog_Scanning && (Catalog_Dirty || !Catalog_Ready)) {
+			Catalog_StartPass();
+		}
+		if (Catalog_Scanning) {
+			const uint32_t start = millis();
+			Catalog_StepResult result;
+			do {
+				result = Catalog_ScanNextDirectory();
+			} while (result == Catalog_StepResult::Continue);
+
+			if (result == Catalog_StepResult::Stopped) {
+				// resumed with the current directory by Catalog_Init()
+				break;
+			}
+			Catalog_Scanning = false;
+			gPrefsSettings.putBool("catalogScan", false);
+			if (result == Catalog_StepResult::Done && Catalog_FinishPass()) {
+				Log_Printf(LOGLEVEL_NOTICE, catalogScanFinished, Catalog_TrackCount, Catalog_DirCount, millis() - start);
+				continue;
+			}
+			Log_Printf(LOGLEVEL_ERROR, catalogWriteFailed, cacheDir);
+		}
+		// up to date (or unable to write), sleep until the card changes
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		Catalog_Sleep(catalogRescanDelay);
+	}
+	Catalog_TaskHandle = NULL;
+	vTaskDelete(NULL);
+}
+#endif
+
+void Catalog_Init(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	Catalog_DbMutex = xSemaphoreCreateMutex();
+	Catalog_LoadInfo();
+	Catalog_Dirty = gPrefsSettings.getBool("catalogDirty", false);
+	if (gPrefsSettings.getBool("catalogScan", false)) {
+		// continue the walk interrupted by deep sleep, if nothing was written since
+		Catalog_TodoPos = gPrefsSettings.getUInt("catalogTodo", 0);
+		Catalog_CommittedSize = gPrefsSettings.getUInt("catalogSize", 0);
+		Catalog_TodoSize = gPrefsSettings.getUInt("catalogTodoSz", 0);
+		File f = gFSystem.open(Catalog_FilePath("catalog.new"), FILE_READ);
+		File todo = gFSystem.open(Catalog_FilePath("catalog.todo"), FILE_READ);
+		Catalog_Header header;
+		Catalog_Scanning = Catalog_ReadHeader(f, header) && todo && f.size() == Catalog_CommittedSize && todo.size() == Catalog_TodoSize;
+		if (Catalog_Scanning) {
+			Log_Printf(LOGLEVEL_NOTICE, catalogScanResumed, Catalog_TodoPos);
+		} else {
+			// written to after going to sleep (e.g. power loss), start over
+			Catalog_Dirty = true;
+		}
+	}
+
+	xTaskCreatePinnedToCore(
+		Catalog_Task, /* Function to implement the task */
+		"catalog", /* Name of the task */
+		4000, /* Stack size in words */
+		NULL, /* Task input parameter */
+		1, /* Priority of the task */
+		&Catalog_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+#endif
+}
+
+// Stops the walk at the next file and remembers where to continue after deep sleep
+void Catalog_Exit(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	if (Catalog_TaskHandle == NULL) {
+		return;
+	}
+	Catalog_StopRequested = true;
+	xTaskNotifyGive(Catalog_TaskHandle);
+	for (uint8_t i = 0; i < 200 && Catalog_TaskHandle != NULL; i++) {
+		vTaskDelay(portTICK_PERIOD_MS * 10u);
+	}
+	if (Catalog_TaskHandle != NULL) {
+		// still busy with a file, its position isn't reliable: start over after deep sleep
+		gPrefsSettings.putBool("catalogDirty", true);
+		return;
+	}
+	if (Catalog_Scanning) {
+		gPrefsSettings.putUInt("catalogTodo", Catalog_TodoPos);
+		gPrefsSettings.putUInt("catalogSize", Catalog_CommittedSize);
+		gPrefsSettings.putUInt("catalogTodoSz", Catalog_TodoSize);
+		gPrefsSettings.putBool("catalogScan", true);
+	}
+#endif
+}
+
+// Files or directories were changed, the catalog is rebuilt once things have settled down
+void Catalog_Invalidate(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	if (!Catalog_Dirty) {
+		Catalog_Dirty = true;
+		gPrefsSettings.putBool("catalogDirty", true);
+	}
+	if (Catalog_TaskHandle != NULL) {
+		xTaskNotifyGive(Catalog_TaskHandle);
+	}
+#endif
+}
+
+bool Catalog_IsReady(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	return Catalog_Ready;
+#else
+	return false;
+#endif
+}
+
+bool Catalog_IsScanning(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	return Catalog_Scanning;
+#else
+	return false;
+#endif
+}
+
+uint32_t Catalog_GetTrackCount(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	return Catalog_TrackCount;
+#else
+	return 0;
+#endif
+}
+
+uint32_t Catalog_GetDirCount(void) {
+#ifdef MEDIA_CATALOG_ENABLE
+	return Catalog_DirCount;
+#else
+	return 0;
+#endif
+}
+
+#ifdef MEDIA_CATALOG_ENABLE
+// Looks for _name among the tracks of the directory record at _offset, if it's the directory _dir
+static bool Catalog_FindTrack(File &f, uint32_t _offset, const char *_dir, size_t _dirLen, const char *_name, Catalog_TrackRecord &_track) {
+	Catalog_DirRecord dirRecord;
+	char buf[256];
+	if (!f.seek(_offset) || f.read(reinterpret_cast<uint8_t *>(&dirRecord), sizeof(dirRecord)) != sizeof(dirRecord) || dirRecord.type != 'D' || dirRecord.pathLen != _dirLen) {
+		return false;
+	}
+	if (f.read(reinterpret_cast<uint8_t *>(buf), _dirLen) != _dirLen || memcmp(buf, _dir, _dirLen) != 0) {
+		// hash collision
+		return false;
+	}
+	const size_t nameLen = strlen(_name);
+	while (f.read(reinterpret_cast<uint8_t *>(&_track), sizeof(_track)) == sizeof(_track) && _track.type == 'T') {
+		const size_t len = f.read(reinterpret_cast<uint8_t *>(buf), _track.nameLen);
+		if (len == nameLen && memcmp(buf, _name, len) == 0) {
+			return true;
+		}
+		f.seek(_track.titleLen + _track.artistLen + _track.albumLen, SeekCur);
+	}
+	return false;
+}
+#endif
+
+// Returns the ReplayGain track gain (1/100 dB) of the file _path, catalogNoGain if it's unknown.
+// Only reads the records of the file's directory, so it's fast enough to be called when a track starts.
+int16_t Catalog_GetTrackGain(const char *_path) {
+#ifdef MEDIA_CATALOG_ENABLE
+	const char *slash = (_path) ? strrchr(_path, '/') : nullptr;
+	if (!slash || Catalog_DbMutex == NULL) {
+		return catalogNoGain;
+	}
+	const size_t dirLen = (slash == _path) ? 1 : slash - _path; // the root directory is stored as "/"
+	const uint32_t hash = Hash_Fnv1a(_path, dirLen);
+	int16_t gain = catalogNoGain;
+
+	xSemaphoreTake(Catalog_DbMutex, portMAX_DELAY);
+	const Catalog_IndexEntry *end = Catalog_Index + Catalog_IndexCount;
+	const Catalog_IndexEntry *entry = std::lower_bound(static_cast<const Catalog_IndexEntry *>(Catalog_Index), end, hash, [](const Catalog_IndexEntry &e, uint32_t h) {
+		return e.pathHash < h;
+	});
+	if (entry != end && entry->pathHash == hash) {
+		File f = gFSystem.open(Catalog_FilePath("catalog.db"), FILE_READ);
+		Catalog_TrackRecord track;
+		for (; f && entry != end && entry->pathHash == hash; entry++) {
+			if (Catalog_FindTrack(f, entry->offset, _path, dirLen, slash + 1, track)) {
+				gain = track.gain;
+				break;
+			}
+		}
+	}
+	xSemaphoreGive(Catalog_DbMutex);
+	return gain;
+#else
+	return catalogNoGain;
+#endif
+}
+
+#ifdef MEDIA_CATALOG_ENABLE
+// Reads the directory record at the position of f (type already read) and tells if it's within the prefix
+static bool Catalog_ReadDir(File &f, char *_dir, size_t _dirLen, const char *_prefix, size_t _prefixLen) {
+	Catalog_DirRecord record;
+	f.read(reinterpret_cast<uint8_t *>(&record) + 1, sizeof(record) - 1);
+	const size_t len = f.read(reinterpret_cast<uint8_t *>(_dir), std::min<size_t>(record.pathLen, _dirLen - 1));
+	_dir[len] = '\0';
+	if (record.pathLen > len) {
+		f.seek(record.pathLen - len, SeekCur);
+	}
+	return strncmp(_dir, _prefix, _prefixLen) == 0 && (_dir[_prefixLen] == '\0' || _dir[_prefixLen] == '/' || _prefixLen == 0);
+}
+
+// Walks catalog.db for Catalog_ForEachTrack(), the caller holds Catalog_DbMutex
+static bool Catalog_WalkTracks(const char *_dirPrefix, const std::function<bool(const CatalogTrack &)> &_callback, CatalogCursor &_cursor, uint32_t _maxRecords) {
+	File f = gFSystem.open(Catalog_FilePath("catalog.db"), FILE_READ);
+	Catalog_Header header;
+	if (!Catalog_ReadHeader(f, header)) {
+		return false;
+	}
+	f.setBufferSize(512);
+	const char *prefix = (_dirPrefix) ? _dirPrefix : "";
+	size_t prefixLen = strlen(prefix);
+	while (prefixLen && prefix[prefixLen - 1] == '/') {
+		prefixLen--;
+	}
+	char dir[256] = "";
+	char name[256];
+	char title[catalogTagLength], artist[catalogTagLength], album[catalogTagLength];
+	bool match = false;
+	if (_cursor.generation == 0) {
+		_cursor.generation = Catalog_Generation;
+		_cursor.dirOffset = 0;
+		_cursor.offset = sizeof(header);
+	} else if (_cursor.generation != Catalog_Generation) {
+		// replaced by a new scan, the offsets are meaningless now
+		return false;
+	}
+	if (_cursor.dirOffset) {
+		uint8_t type;
+		if (!f.seek(_cursor.dirOffset) || f.read(&type, 1) != 1 || type != 'D') {
+			return false;
+		}
+		match = Catalog_ReadDir(f, dir, sizeof(dir), prefix, prefixLen);
+	}
+	if (!f.seek(_cursor.offset)) {
+		return false;
+	}
+	uint8_t type;
+	while (_maxRecords-- && f.read(&type, 1) == 1) {
+		if (type == 'D') {
+			_cursor.dirOffset = f.position() - 1;
+			match = Catalog_ReadDir(f, dir, sizeof(dir), prefix, prefixLen);
+		} else if (type == 'T') {
+			Catalog_TrackRecord record;
+			f.read(reinterpret_cast<uint8_t *>(&record) + 1, sizeof(record) - 1);
+			if (!match) {
+				f.seek(record.nameLen + record.titleLen + record.artistLen + record.albumLen, SeekCur);
+				continue;
+			}
+			Catalog_ReadString(f, name, sizeof(name), record.nameLen);
+			Catalog_ReadString(f, title, sizeof(title), record.titleLen);
+			Catalog_ReadString(f, artist, sizeof(artist), record.artistLen);
+			Catalog_ReadString(f, album, sizeof(album), record.albumLen);
+			const CatalogTrack track = {(strcmp(dir, "/") == 0) ? "" : dir, name, title, artist, album, record.size, record.durationMs, record.gain, record.codec};
+			if (!_callback(track)) {
+				_cursor.offset = f.position();
+				return true;
+			}
+		} else {
+			// unknown record, the file is broken
+			return false;
+		}
+	}
+	_cursor.offset = f.position();
+	_cursor.done = (_cursor.offset >= f.size());
+	return true;
+}
+#endif
+
+// Calls _callback for every track in _dirPrefix and its subdirectories (all tracks if it's empty) until it returns false.
+// Streams through the catalog on the card, so it needs no memory for it. Returns false if there's no catalog.
+// With _cursor the walk stops after _maxRecords records (or when the callback returns false) and continues where it
+// stopped on the next call; it returns false if the catalog was replaced in between.
+// Holds Catalog_DbMutex during the call, so a finished scan can't replace the file underneath. The callback must not
+// call Catalog_GetTrackGain() or Catalog_ForEachTrack().
+bool Catalog_ForEachTrack(const char *_dirPrefix, const std::function<bool(const CatalogTrack &)> &_callback, CatalogCursor *_cursor, uint32_t _maxRecords) {
+#ifdef MEDIA_CATALOG_ENABLE
+	if (Catalog_DbMutex == NULL) {
+		return false;
+	}
+	CatalogCursor cursor;
+	xSemaphoreTake(Catalog_DbMutex, portMAX_DELAY);
+	const bool ok = Catalog_WalkTracks(_dirPrefix, _callback, (_cursor) ? *_cursor : cursor, (_cursor) ? _maxRecords : UINT32_MAX);
+	xSemaphoreGive(Catalog_DbMutex);
+	return ok;
+#else
+	return false;
+#endif
+}
+
+const char *Catalog_CodecName(CatalogCodec _codec) {
+	static constexpr const char *names[] = {"unknown", "mp3", "aac", "m4a", "wav", "flac", "ogg", "opus"};
+	const size_t idx = static_cast<size_t>(_codec);
+	return (idx < sizeof(names) / sizeof(names[0])) ? names[idx] : names[0];
+}
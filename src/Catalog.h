@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+constexpr int16_t catalogNoGain = INT16_MIN; // track has no ReplayGain information
+
+enum class CatalogCodec : uint8_t {
+	Unknown = 0,
+	Mp3,
+	Aac,
+	M4a,
+	Wav,
+	Flac,
+	Ogg,
+	Opus
+};
+
+// A track as stored in the catalog. The strings are only valid during the callback.
+struct CatalogTrack {
+	const char *dir; // directory of the track without trailing '/'
+	const char *name; // basename
+	const char *title; // tags, empty if unknown
+	const char *artist;
+	const char *album;
+	uint32_t size; // bytes
+	uint32_t durationMs; // 0 if unknown
+	int16_t gain; // ReplayGain track gain in 1/100 dB
+	CatalogCodec codec;
+};
+
+// Position of a walk through the catalog, see Catalog_ForEachTrack()
+struct CatalogCursor {
+	uint32_t generation = 0; // catalog the offsets belong to, 0 starts a new walk
+	uint32_t dirOffset = 0; // record of the directory the walk is in
+	uint32_t offset = 0; // next record
+	bool done = false; // end of the catalog reached
+};
+
+void Catalog_Init(void);
+void Catalog_Exit(void);
+void Catalog_Invalidate(void);
+bool Catalog_IsReady(void);
+bool Catalog_IsScanning(void);
+uint32_t Catalog_GetTrackCount(void);
+uint32_t Catalog_GetDirCount(void);
+int16_t Catalog_GetTrackGain(const char *_path);
+bool Catalog_ForEachTrack(const char *_dirPrefix, const std::function<bool(const CatalogTrack &)> &_callback, CatalogCursor *_cursor = nullptr, uint32_t _maxRecords = UINT32_MAX);
+const char *Catalog_CodecName(CatalogCodec _codec);
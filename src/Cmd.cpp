@@ -252,6 +252,7 @@ void Cmd_Action(const uint16_t mod) {
 				gPlayProperties.tellMode = TTS_IP_ADDRESS;
 				gPlayProperties.currentSpeechActive = true;
 				gPlayProperties.lastSpeechActive = true;
+				AudioPlayer_WakeUp();
 				System_IndicateOk();
 			} else {
 				Log_Println(unableToTellIpAddress, LOGLEVEL_ERROR);
@@ -261,10 +262,12 @@ void Cmd_Action(const uint16_t mod) {
 		}
 
 		case CMD_TELL_CURRENT_TIME: {
-			if (Wlan_IsConnected()) {
+			struct tm timeinfo;
+			if (Wlan_IsConnected() || getLocalTime(&timeinfo, 0)) { // the speech cache works offline if the time is known
 				gPlayProperties.tellMode = TTS_CURRENT_TIME;
 				gPlayProperties.currentSpeechActive = true;
 				gPlayProperties.lastSpeechActive = true;
+				AudioPlayer_WakeUp();
 				System_IndicateOk();
 			} else {
 				Log_Println(unableToTellTime, LOGLEVEL_ERROR);
@@ -354,11 +357,13 @@ void Cmd_Action(const uint16_t mod) {
 
 		case CMD_SEEK_FORWARDS: {
 			gPlayProperties.seekmode = SEEK_FORWARDS;
+			AudioPlayer_WakeUp();
 			break;
 		}
 
 		case CMD_SEEK_BACKWARDS: {
 			gPlayProperties.seekmode = SEEK_BACKWARDS;
+			AudioPlayer_WakeUp();
 			break;
 		}
 
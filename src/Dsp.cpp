@@ -0,0 +1,522 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Dsp.h"
+
+#include "EnumUtils.h"
+#include "Log.h"
+#include "System.h"
+
+#ifdef DSP_ENABLE
+// Processing chain for the samples handed to audio_process_i2s(): equalizer (cascaded biquads),
+// gain with a ramp (preset pre-gain and loudness normalization) and a peak limiter. Everything runs in fixed point: samples arrive and leave as Q15,
+// inside the chain they are Q8.23 (1.0 = full scale, 8 bits headroom for EQ boosts), filter coefficients
+// are Q3.28 and gains Q16. The audio library delivers single samples, so they're collected in a block.
+// A processed block waits one more block for the limiter, which needs to see the block after it (lookahead),
+// so every sample leaves the chain two blocks (dspMaxLatency) late. A bypassed chain keeps that latency
+// (the samples are only delayed), so switching between both never drops or repeats a block. At the end of a
+// file Dsp_Flush() hands out what's still pending, Dsp_Reset() drops it when playback is stopped.
+// The volume is applied by the audio library before the samples get here and isn't ramped: its volume curve
+// can't be undone without knowing the library's internals, so a volume ramp here would need to replace it.
+// Settings are changed by other tasks, they're picked up at the next block boundary.
+static constexpr uint32_t dspBlockSize = 32; // stereo samples, 0.7 ms at 44.1 kHz
+static constexpr uint8_t dspMaxBands = dspCustomBandCount;
+static constexpr uint8_t dspCoefShift = 28;
+static constexpr uint8_t dspHeadroomShift = 8; // Q15 <-> Q8.23
+static constexpr int32_t dspUnityGain = 1 << 16;
+static constexpr uint32_t dspRampBlocks = 16; // a change of pre-gain or track gain is spread over ~12 ms, no zipper noise
+static constexpr int32_t dspLimiterThreshold = 32112 << dspHeadroomShift; // -0.2 dBFS
+static constexpr int32_t dspLimiterRelease = dspUnityGain / 512; // per block, ~0.4 s from -6 dB back to 0 dB
+static constexpr int16_t dspMinTrackGain = -2400; // 1/100 dB
+static constexpr int16_t dspMaxTrackGain = 1200;
+static_assert(dspMaxLatency == 2 * dspBlockSize, "the chain holds back the block being collected and the one waiting for the limiter");
+
+enum class Dsp_FilterType : uint8_t {
+	LowShelf,
+	Peak,
+	HighShelf
+};
+
+struct Dsp_Band {
+	Dsp_FilterType type;
+	uint16_t freq; // Hz
+	int8_t gainDb;
+	uint8_t q10; // Q * 10
+};
+
+struct Dsp_PresetDef {
+	uint8_t bandCount;
+	int8_t preGainDb; // makes room for the boosts, so the limiter rarely has to step in
+	Dsp_Band bands[dspMaxBands];
+};
+
+// indexed by dspPreset
+static constexpr Dsp_PresetDef dspPresets[] = {
+	{0, 0, {}},
+	{1, -3, {{Dsp_FilterType::LowShelf, 120, 6, 7}}},
+	{2, 0, {{Dsp_FilterType::LowShelf, 200, -6, 7}, {Dsp_FilterType::Peak, 2500, 4, 10}}},
+	{2, -3, {{Dsp_FilterType::LowShelf, 100, 6, 7}, {Dsp_FilterType::HighShelf, 8000, 4, 7}}},
+	{1, 0, {{Dsp_FilterType::HighShelf, 4000, -6, 7}}},
+	{0, 0, {}}, // CUSTOM, built from Dsp_CustomGains
+};
+static constexpr uint8_t dspPresetCount = sizeof(dspPresets) / sizeof(dspPresets[0]);
+
+// bands of the CUSTOM preset, gainDb is taken from the settings
+static constexpr Dsp_Band dspCustomBands[dspCustomBandCount] = {
+	{Dsp_FilterType::LowShelf, 60, 0, 7},
+	{Dsp_FilterType::Peak, 250, 0, 10},
+	{Dsp_FilterType::Peak, 1000, 0, 10},
+	{Dsp_FilterType::Peak, 4000, 0, 10},
+	{Dsp_FilterType::HighShelf, 12000, 0, 7},
+};
+
+struct Dsp_Biquad {
+	int32_t b0, b1, b2, a1, a2; // Q3.28, a1 and a2 negated
+	int32_t x1[2], x2[2], y1[2], y2[2]; // state per channel
+};
+
+// settings, written by any task
+static volatile dspPreset Dsp_Preset = dspPreset::FLAT;
+static volatile int8_t Dsp_CustomGains[dspCustomBandCount] = {};
+static volatile bool Dsp_LimiterEnabled = true;
+static volatile bool Dsp_NormalizeEnabled = false;
+static volatile uint32_t Dsp_SampleRate = 44100;
+static volatile bool Dsp_ConfigChanged = true;
+static volatile int16_t Dsp_TrackGain = 0; // 1/100 dB
+static volatile bool Dsp_TrackGainChanged = false;
+
+// state of the chain, only touched by the audio task
+static Dsp_Biquad Dsp_Bands[dspMaxBands];
+static uint8_t Dsp_BandCount = 0;
+static bool Dsp_Limiter = true;
+static int32_t Dsp_Gain = dspUnityGain; // Q16
+static int32_t Dsp_TargetGain = dspUnityGain;
+static int32_t Dsp_GainStep = 0; // per block
+static int32_t Dsp_LimiterGain = dspUnityGain; // Q16, at the end of the block handed out
+static bool Dsp_Bypass = true;
+
+static uint32_t Dsp_InBlock[dspBlockSize]; // block being collected (processed)
+static uint32_t Dsp_OutBlock[dspBlockSize]; // block being handed out
+static uint32_t Dsp_DelayBlock[dspBlockSize]; // block between both (bypassed)
+static uint32_t Dsp_BlockPos = 0;
+static uint32_t Dsp_Pending = 0; // samples held back since the last reset
+static int32_t Dsp_Buf[2][dspBlockSize]; // working buffer (Q8.23), 0 = left, 1 = right
+static int32_t Dsp_Held[2][dspBlockSize]; // processed block waiting for the limiter (Q8.23)
+static int32_t Dsp_HeldPeak = 0;
+
+static int32_t Dsp_ToQ28(float _value) {
+	return static_cast<int32_t>(lroundf(_value * (1 << dspCoefShift)));
+}
+
+// Bands and pre-gain of the selected preset
+static void Dsp_GetPresetDef(Dsp_PresetDef &_def) {
+	if (Dsp_Preset != dspPreset::CUSTOM) {
+		_def = dspPresets[EnumUtils::underlying_value(Dsp_Preset)];
+		return;
+	}
+	// flat bands cost nothing, the pre-gain covers half of the largest boost like the fixed presets
+	int8_t maxBoost = 0;
+	_def.bandCount = 0;
+	for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+		const int8_t gainDb = Dsp_CustomGains[i];
+		if (gainDb) {
+			_def.bands[_def.bandCount] = dspCustomBands[i];
+			_def.bands[_def.bandCount++].gainDb = gainDb;
+			maxBoost = std::max(maxBoost, gainDb);
+		}
+	}
+	_def.preGainDb = -maxBoost / 2;
+}
+
+// Gain of the preset and the track's loudness normalization, _trackGain in 1/100 dB
+static int32_t Dsp_CombinedGain(int8_t _presetDb, int16_t _trackGain) {
+	const float db = _presetDb + ((Dsp_NormalizeEnabled) ? _trackGain / 100.0f : 0.0f);
+	return static_cast<int32_t>(lroundf(powf(10.0f, db / 20.0f) * dspUnityGain));
+}
+
+// Biquad coefficients from the "Audio EQ Cookbook" by Robert Bristow-Johnson. Computed in float, that's only done on changes.
+static void Dsp_DesignBand(Dsp_Biquad &_bq, const Dsp_Band &_band, uint32_t _sampleRate) {
+	const float A = powf(10.0f, _band.gainDb / 40.0f);
+	const float w0 = 2.0f * PI * std::min<float>(_band.freq, _sampleRate * 0.45f) / _sampleRate;
+	const float cosW0 = cosf(w0);
+	const float alpha = sinf(w0) / (2.0f * (_band.q10 / 10.0f));
+	const float sqrtA2Alpha = 2.0f * sqrtf(A) * alpha;
+	float b0, b1, b2, a0, a1, a2;
+
+	switch (_band.type) {
+		case Dsp_FilterType::LowShelf:
+			b0 = A * ((A + 1) - (A - 1) * cosW0 + sqrtA2Alpha);
+			b1 = 2 * A * ((A - 1) - (A + 1) * cosW0);
+			b2 = A * ((A + 1) - (A - 1) * cosW0 - sqrtA2Alpha);
+			a0 = (A + 1) + (A - 1) * cosW0 + sqrtA2Alpha;
+			a1 = -2 * ((A - 1) + (A + 1) * cosW0);
+			a2 = (A + 1) + (A - 1) * cosW0 - sqrtA2Alpha;
+			break;
+
+		case Dsp_FilterType::HighShelf:
+			b0 = A * ((A + 1) + (A - 1) * cosW0 + sqrtA2Alpha);
+			b1 = -2 * A * ((A - 1) + (A + 1) * cosW0);
+			b2 = A * ((A + 1) + (A - 1) * cosW0 - sqrtA2Alpha);
+			a0 = (A + 1) - (A - 1) * cosW0 + sqrtA2Alpha;
+			a1 = 2 * ((A - 1) - (A + 1) * cosW0);
+			a2 = (A + 1) - (A - 1) * cosW0 - sqrtA2Alpha;
+			break;
+
+		case Dsp_FilterType::Peak:
+		default:
+			b0 = 1 + alpha * A;
+			b1 = -2 * cosW0;
+			b2 = 1 - alpha * A;
+			a0 = 1 + alpha / A;
+			a1 = -2 * cosW0;
+			a2 = 1 - alpha / A;
+			break;
+	}
+	_bq.b0 = Dsp_ToQ28(b0 / a0);
+	_bq.b1 = Dsp_ToQ28(b1 / a0);
+	_bq.b2 = Dsp_ToQ28(b2 / a0);
+	_bq.a1 = Dsp_ToQ28(-a1 / a0);
+	_bq.a2 = Dsp_ToQ28(-a2 / a0);
+	memset(_bq.x1, 0, sizeof(_bq.x1));
+	memset(_bq.x2, 0, sizeof(_bq.x2));
+	memset(_bq.y1, 0, sizeof(_bq.y1));
+	memset(_bq.y2, 0, sizeof(_bq.y2));
+}
+
+static void Dsp_SetTargetGain(int32_t _gain) {
+	Dsp_TargetGain = _gain;
+	Dsp_GainStep = std::max<int32_t>(abs(Dsp_TargetGain - Dsp_Gain) / dspRampBlocks, 1);
+}
+
+// Forgets the history of the filters, e.g. when the chain starts again after it was bypassed
+static void Dsp_ResetState(void) {
+	for (uint8_t i = 0; i < dspMaxBands; i++) {
+		memset(Dsp_Bands[i].x1, 0, sizeof(Dsp_Bands[i].x1));
+		memset(Dsp_Bands[i].x2, 0, sizeof(Dsp_Bands[i].x2));
+		memset(Dsp_Bands[i].y1, 0, sizeof(Dsp_Bands[i].y1));
+		memset(Dsp_Bands[i].y2, 0, sizeof(Dsp_Bands[i].y2));
+	}
+	Dsp_LimiterGain = dspUnityGain;
+}
+
+// Q15 samples into the working format, returns the peak
+static int32_t Dsp_Unpack(const uint32_t *_in, int32_t (*_buf)[dspBlockSize]) {
+	int32_t peak = 0;
+	for (uint32_t i = 0; i < dspBlockSize; i++) {
+		// left channel in the upper half word
+		_buf[0][i] = static_cast<int32_t>(static_cast<int16_t>(_in[i] >> 16)) << dspHeadroomShift;
+		_buf[1][i] = static_cast<int32_t>(static_cast<int16_t>(_in[i] & 0xFFFF)) << dspHeadroomShift;
+		peak = std::max({peak, abs(_buf[0][i]), abs(_buf[1][i])});
+	}
+	return peak;
+}
+
+// Gain the limiter needs for a block with this peak
+static int32_t Dsp_LimiterTarget(int32_t _peak) {
+	if (!Dsp_Limiter || _peak <= dspLimiterThreshold) {
+		return dspUnityGain;
+	}
+	return static_cast<int32_t>((static_cast<int64_t>(dspLimiterThreshold) << 16) / _peak);
+}
+
+// Hands out the held block. Its limiter gain moves linearly from where the previous block ended to a value that
+// fits both the held block and the next one, so it never steps and is down already when a peak arrives.
+// Both ends are at most the gain the held block needs, so no sample in between exceeds the threshold.
+static void Dsp_ReleaseHeld(int32_t _nextPeak) {
+	const int32_t heldTarget = Dsp_LimiterTarget(Dsp_HeldPeak);
+	const int32_t startGain = std::min(Dsp_LimiterGain, heldTarget); // only lower if the limiter was just switched on
+	const int32_t endGain = std::min({heldTarget, Dsp_LimiterTarget(_nextPeak), startGain + dspLimiterRelease});
+	const int32_t gainDelta = endGain - startGain;
+	Dsp_LimiterGain = endGain;
+	for (uint32_t i = 0; i < dspBlockSize; i++) {
+		const int32_t gain = startGain + gainDelta * static_cast<int32_t>(i + 1) / static_cast<int32_t>(dspBlockSize);
+		const int32_t leftQ23 = static_cast<int32_t>((static_cast<int64_t>(Dsp_Held[0][i]) * gain) >> 16);
+		const int32_t rightQ23 = static_cast<int32_t>((static_cast<int64_t>(Dsp_Held[1][i]) * gain) >> 16);
+		const int32_t left = constrain((leftQ23 + (1 << (dspHeadroomShift - 1))) >> dspHeadroomShift, INT16_MIN, INT16_MAX);
+		const int32_t right = constrain((rightQ23 + (1 << (dspHeadroomShift - 1))) >> dspHeadroomShift, INT16_MIN, INT16_MAX);
+		Dsp_OutBlock[i] = (static_cast<uint32_t>(static_cast<uint16_t>(left)) << 16) | static_cast<uint16_t>(right);
+	}
+}
+
+// Only called at block boundaries: the pending blocks are handed out in either mode
+static void Dsp_UpdateBypass(void) {
+	// the limiter can't do anything without a boost, the input is at most full scale. The held block is only
+	// handed over to the delay line if it's done without the limiter.
+	const bool unity = (Dsp_BandCount == 0) && (Dsp_Gain == dspUnityGain) && (Dsp_TargetGain == dspUnityGain) && (Dsp_LimiterGain == dspUnityGain);
+	const bool bypass = unity && (Dsp_Bypass || Dsp_LimiterTarget(Dsp_HeldPeak) == dspUnityGain);
+	if (Dsp_Bypass && !bypass) {
+		// the block in the delay line goes on as the held block, as it came in
+		Dsp_ResetState();
+		Dsp_HeldPeak = Dsp_Unpack(Dsp_DelayBlock, Dsp_Held);
+	} else if (!Dsp_Bypass && bypass) {
+		for (uint32_t i = 0; i < dspBlockSize; i++) {
+			const int32_t left = constrain((Dsp_Held[0][i] + (1 << (dspHeadroomShift - 1))) >> dspHeadroomShift, INT16_MIN, INT16_MAX);
+			const int32_t right = constrain((Dsp_Held[1][i] + (1 << (dspHeadroomShift - 1))) >> dspHeadroomShift, INT16_MIN, INT16_MAX);
+			Dsp_DelayBlock[i] = (static_cast<uint32_t>(static_cast<uint16_t>(left)) << 16) | static_cast<uint16_t>(right);
+		}
+	}
+	Dsp_Bypass = bypass;
+}
+
+static void Dsp_ApplyConfig(void) {
+	Dsp_ConfigChanged = false;
+	Dsp_PresetDef preset;
+	Dsp_GetPresetDef(preset);
+	const uint32_t sampleRate = Dsp_SampleRate;
+
+	Dsp_BandCount = preset.bandCount;
+	for (uint8_t i = 0; i < Dsp_BandCount; i++) {
+		Dsp_DesignBand(Dsp_Bands[i], preset.bands[i], sampleRate);
+	}
+	// a limiter that's switched off releases its gain like after a peak
+	Dsp_Limiter = Dsp_LimiterEnabled;
+	Dsp_SetTargetGain(Dsp_CombinedGain(preset.preGainDb, Dsp_TrackGain));
+	Dsp_UpdateBypass();
+}
+
+// A new track starts, its gain is applied right away instead of ramping into it
+static void Dsp_ApplyTrackGain(void) {
+	Dsp_TrackGainChanged = false;
+	Dsp_PresetDef preset;
+	Dsp_GetPresetDef(preset);
+	Dsp_Gain = Dsp_CombinedGain(preset.preGainDb, Dsp_TrackGain);
+	Dsp_SetTargetGain(Dsp_Gain);
+	Dsp_UpdateBypass();
+}
+
+// Direct form I, the feedback path keeps the 8 extra bits of Q8.23, so low frequency bands stay quiet
+static void Dsp_ProcessBiquad(Dsp_Biquad &_bq, uint8_t _ch, int32_t *_buf) {
+	int32_t x1 = _bq.x1[_ch], x2 = _bq.x2[_ch], y1 = _bq.y1[_ch], y2 = _bq.y2[_ch];
+	for (uint32_t i = 0; i < dspBlockSize; i++) {
+		const int32_t x0 = _buf[i];
+		int64_t acc = static_cast<int64_t>(_bq.b0) * x0;
+		acc += static_cast<int64_t>(_bq.b1) * x1;
+		acc += static_cast<int64_t>(_bq.b2) * x2;
+		acc += static_cast<int64_t>(_bq.a1) * y1;
+		acc += static_cast<int64_t>(_bq.a2) * y2;
+		const int32_t y0 = static_cast<int32_t>((acc + (1 << (dspCoefShift - 1))) >> dspCoefShift);
+		x2 = x1;
+		x1 = x0;
+		y2 = y1;
+		y1 = y0;
+		_buf[i] = y0;
+	}
+	_bq.x1[_ch] = x1;
+	_bq.x2[_ch] = x2;
+	_bq.y1[_ch] = y1;
+	_bq.y2[_ch] = y2;
+}
+
+static void Dsp_ProcessBlock(void) {
+	Dsp_Unpack(Dsp_InBlock, Dsp_Buf);
+	for (uint8_t band = 0; band < Dsp_BandCount; band++) {
+		Dsp_ProcessBiquad(Dsp_Bands[band], 0, Dsp_Buf[0]);
+		Dsp_ProcessBiquad(Dsp_Bands[band], 1, Dsp_Buf[1]);
+	}
+
+	// gain ramp, linear within the block
+	const int32_t startGain = Dsp_Gain;
+	if (Dsp_Gain < Dsp_TargetGain) {
+		Dsp_Gain = std::min(Dsp_Gain + Dsp_GainStep, Dsp_TargetGain);
+	} else if (Dsp_Gain > Dsp_TargetGain) {
+		Dsp_Gain = std::max(Dsp_Gain - Dsp_GainStep, Dsp_TargetGain);
+	}
+	const int32_t gainDelta = Dsp_Gain - startGain;
+	int32_t peak = 0;
+	for (uint32_t i = 0; i < dspBlockSize; i++) {
+		const int32_t gain = startGain + gainDelta * static_cast<int32_t>(i + 1) / static_cast<int32_t>(dspBlockSize);
+		for (uint8_t ch = 0; ch < 2; ch++) {
+			const int32_t value = static_cast<int32_t>((static_cast<int64_t>(Dsp_Buf[ch][i]) * gain) >> 16);
+			Dsp_Buf[ch][i] = value;
+			peak = std::max(peak, abs(value));
+		}
+	}
+
+	// the limiter finishes the block before, now that it knows what follows
+	Dsp_ReleaseHeld(peak);
+	memcpy(Dsp_Held, Dsp_Buf, sizeof(Dsp_Held));
+	Dsp_HeldPeak = peak;
+	Dsp_UpdateBypass();
+}
+#endif
+
+void Dsp_Init(void) {
+#ifdef DSP_ENABLE
+	const uint8_t preset = gPrefsSettings.getUChar("dspPreset", EnumUtils::underlying_value(dspPreset::FLAT));
+	Dsp_Preset = (preset < dspPresetCount) ? EnumUtils::to_enum<dspPreset>(preset) : dspPreset::FLAT;
+	Dsp_LimiterEnabled = gPrefsSettings.getBool("dspLimiter", true);
+	Dsp_NormalizeEnabled = gPrefsSettings.getBool("dspNormalize", false);
+	int8_t gains[dspCustomBandCount] = {};
+	if (gPrefsSettings.getBytesLength("dspBands") == sizeof(gains)) {
+		gPrefsSettings.getBytes("dspBands", gains, sizeof(gains));
+	}
+	for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+		Dsp_CustomGains[i] = constrain(gains[i], -dspCustomBandMaxDb, dspCustomBandMaxDb);
+	}
+	Dsp_ConfigChanged = true;
+#endif
+}
+
+// Called by the audio task for every sample before it's sent to I2S (or the bluetooth source)
+void Dsp_Process(uint32_t *sample) {
+#ifdef DSP_ENABLE
+	if (Dsp_BlockPos == 0) {
+		if (Dsp_ConfigChanged) {
+			Dsp_ApplyConfig();
+		}
+		if (Dsp_TrackGainChanged) {
+			Dsp_ApplyTrackGain();
+		}
+	}
+	const uint32_t in = *sample;
+	*sample = Dsp_OutBlock[Dsp_BlockPos];
+	if (Dsp_Bypass) {
+		// just a delay line, both blocks are refilled in place
+		Dsp_OutBlock[Dsp_BlockPos] = Dsp_DelayBlock[Dsp_BlockPos];
+		Dsp_DelayBlock[Dsp_BlockPos] = in;
+	} else {
+		Dsp_InBlock[Dsp_BlockPos] = in;
+	}
+	Dsp_Pending = std::min(Dsp_Pending + 1, dspMaxLatency);
+	if (++Dsp_BlockPos == dspBlockSize) {
+		Dsp_BlockPos = 0;
+		if (!Dsp_Bypass) {
+			Dsp_ProcessBlock();
+		}
+	}
+#endif
+}
+
+// Hands out the samples still held back when a file is over (the audio library stops calling Dsp_Process()
+// then) and starts over. _samples needs room for dspMaxLatency samples, returns their number.
+uint32_t Dsp_Flush(uint32_t *_samples) {
+#ifdef DSP_ENABLE
+	// silence pushes them out, the limiter sees it as the following block
+	const uint32_t pending = Dsp_Pending;
+	for (uint32_t i = 0; i < dspMaxLatency; i++) {
+		uint32_t sample = 0;
+		Dsp_Process(&sample);
+		if (i >= dspMaxLatency - pending) {
+			_samples[i - (dspMaxLatency - pending)] = sample;
+		}
+	}
+	Dsp_Reset();
+	return pending;
+#else
+	return 0;
+#endif
+}
+
+// Drops the samples held back, e.g. when playback is stopped. Otherwise they'd be played at the next start.
+void Dsp_Reset(void) {
+#ifdef DSP_ENABLE
+	memset(Dsp_InBlock, 0, sizeof(Dsp_InBlock));
+	memset(Dsp_OutBlock, 0, sizeof(Dsp_OutBlock));
+	memset(Dsp_DelayBlock, 0, sizeof(Dsp_DelayBlock));
+	memset(Dsp_Held, 0, sizeof(Dsp_Held));
+	Dsp_HeldPeak = 0;
+	Dsp_BlockPos = 0;
+	Dsp_Pending = 0;
+	Dsp_ResetState();
+#endif
+}
+
+// The filters depend on the sample rate of the current track
+void Dsp_SetSampleRate(uint32_t _sampleRate) {
+#ifdef DSP_ENABLE
+	if (_sampleRate && _sampleRate != Dsp_SampleRate) {
+		Dsp_SampleRate = _sampleRate;
+		Dsp_ConfigChanged = true;
+	}
+#endif
+}
+
+dspPreset Dsp_GetPreset(void) {
+#ifdef DSP_ENABLE
+	return Dsp_Preset;
+#else
+	return dspPreset::FLAT;
+#endif
+}
+
+bool Dsp_SetPreset(uint8_t _preset) {
+#ifdef DSP_ENABLE
+	if (_preset >= dspPresetCount) {
+		return false;
+	}
+	Dsp_Preset = EnumUtils::to_enum<dspPreset>(_preset);
+	Dsp_ConfigChanged = true;
+	return gPrefsSettings.putUChar("dspPreset", _preset) == 1;
+#else
+	return false;
+#endif
+}
+
+void Dsp_GetCustomBands(int8_t *_gains) {
+	for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+#ifdef DSP_ENABLE
+		_gains[i] = Dsp_CustomGains[i];
+#else
+		_gains[i] = 0;
+#endif
+	}
+}
+
+// Gains (dB) of the bands of the CUSTOM preset, dspCustomBandCount values
+bool Dsp_SetCustomBands(const int8_t *_gains) {
+#ifdef DSP_ENABLE
+	int8_t gains[dspCustomBandCount];
+	for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+		gains[i] = constrain(_gains[i], -dspCustomBandMaxDb, dspCustomBandMaxDb);
+		Dsp_CustomGains[i] = gains[i];
+	}
+	Dsp_ConfigChanged = true;
+	return gPrefsSettings.putBytes("dspBands", gains, sizeof(gains)) == sizeof(gains);
+#else
+	return false;
+#endif
+}
+
+bool Dsp_IsLimiterEnabled(void) {
+#ifdef DSP_ENABLE
+	return Dsp_LimiterEnabled;
+#else
+	return false;
+#endif
+}
+
+bool Dsp_SetLimiterEnabled(bool _enabled) {
+#ifdef DSP_ENABLE
+	Dsp_LimiterEnabled = _enabled;
+	Dsp_ConfigChanged = true;
+	return gPrefsSettings.putBool("dspLimiter", _enabled) == 1;
+#else
+	return false;
+#endif
+}
+
+bool Dsp_IsNormalizeEnabled(void) {
+#ifdef DSP_ENABLE
+	return Dsp_NormalizeEnabled;
+#else
+	return false;
+#endif
+}
+
+bool Dsp_SetNormalizeEnabled(bool _enabled) {
+#ifdef DSP_ENABLE
+	Dsp_NormalizeEnabled = _enabled;
+	Dsp_ConfigChanged = true;
+	return gPrefsSettings.putBool("dspNormalize", _enabled) == 1;
+#else
+	return false;
+#endif
+}
+
+// Sets the loudness normalization gain (1/100 dB) of the track that starts next
+void Dsp_SetTrackGain(int16_t _gain) {
+#ifdef DSP_ENABLE
+	Dsp_TrackGain = constrain(_gain, dspMinTrackGain, dspMaxTrackGain);
+	Dsp_TrackGainChanged = true;
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class dspPreset : uint8_t {
+	FLAT = 0, // no equalizer
+	BASS_BOOST = 1,
+	SPEECH = 2, // clearer voices on small speakers (audiobooks)
+	LOUDNESS = 3, // bass and treble lifted for low volumes
+	SOFT = 4, // tamed treble, e.g. for headphones
+	CUSTOM = 5, // graphic equalizer, gains set by the user
+};
+
+static constexpr uint8_t dspCustomBandCount = 5; // 60 Hz, 250 Hz, 1 kHz, 4 kHz, 12 kHz
+static constexpr int8_t dspCustomBandMaxDb = 12;
+static constexpr uint32_t dspMaxLatency = 64; // stereo samples the chain holds back
+
+void Dsp_Init(void);
+void Dsp_Process(uint32_t *sample);
+uint32_t Dsp_Flush(uint32_t *_samples);
+void Dsp_Reset(void);
+void Dsp_SetSampleRate(uint32_t _sampleRate);
+dspPreset Dsp_GetPreset(void);
+bool Dsp_SetPreset(uint8_t _preset);
+void Dsp_GetCustomBands(int8_t *_gains);
+bool Dsp_SetCustomBands(const int8_t *_gains);
+bool Dsp_IsLimiterEnabled(void);
+bool Dsp_SetLimiterEnabled(bool _enabled);
+bool Dsp_IsNormalizeEnabled(void);
+bool Dsp_SetNormalizeEnabled(bool _enabled);
+void Dsp_SetTrackGain(int16_t _gain);
@@ -0,0 +1,85 @@
+#include <Arduino.h>
+
+#include "ExplorerList.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+// Parses a paging parameter, a missing one keeps _value
+static bool ExplorerList_ParseCount(const String *_param, size_t &_value) {
+	if (!_param) {
+		return true;
+	}
+	char *end;
+	const char *str = _param->c_str();
+	errno = 0;
+	const long long value = strtoll(str, &end, 10);
+	if (end == str || *end != '\0' || value < 0) {
+		return false;
+	}
+	// more than there can be, all
+	_value = (errno == ERANGE || static_cast<unsigned long long>(value) > SIZE_MAX) ? SIZE_MAX : static_cast<size_t>(value);
+	return true;
+}
+
+// Offset and limit of a listing, both optional (nullptr). False if one of them is negative or no number.
+bool ExplorerList_ParsePaging(const String *_offset, const String *_limit, explorerPaging &_paging) {
+	_paging = {0, SIZE_MAX};
+	return ExplorerList_ParseCount(_offset, _paging.offset) && ExplorerList_ParseCount(_limit, _paging.limit);
+}
+
+ExplorerListCursor::ExplorerListCursor(File _dir, const explorerPaging &_paging, bool _details)
+	: dir(_dir)
+	, skip(_paging.offset)
+	, remaining(_paging.limit)
+	, details(_details) {
+}
+
+ExplorerListCursor::~ExplorerListCursor() {
+	dir.close();
+}
+
+// Every chunk of the response may read explorerChunkEntries directory entries
+void ExplorerListCursor::startChunk(void) {
+	chunkEntries = 0;
+}
+
+// The next entry to send. Skipping a large offset takes several chunks, so it doesn't block the web server.
+ExplorerStep ExplorerListCursor::next(explorerEntry &_entry) {
+	for (;;) {
+		if (!remaining) {
+			return ExplorerStep::Done;
+		}
+		if (chunkEntries == explorerChunkEntries) {
+			return ExplorerStep::ChunkFull;
+		}
+		chunkEntries++;
+		_entry = {String(), false, 0, 0};
+		if (details) {
+			File entry = dir.openNextFile();
+			if (entry) {
+				_entry.path = entry.path();
+				_entry.isDir = entry.isDirectory();
+				_entry.size = (_entry.isDir) ? 0 : entry.size();
+				_entry.mtime = entry.getLastWrite();
+				entry.close();
+			}
+		} else {
+			_entry.path = dir.getNextFileName(&_entry.isDir);
+		}
+		if (_entry.path.isEmpty()) {
+			return ExplorerStep::Done;
+		}
+		// ignore hidden files and folders, e.g. MacOS spotlight files
+		if (_entry.path[_entry.path.lastIndexOf('/') + 1] == '.') {
+			continue;
+		}
+		if (skip) {
+			skip--;
+			continue;
+		}
+		remaining--;
+		return ExplorerStep::Entry;
+	}
+}
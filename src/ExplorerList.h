@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Directory walk of the /explorer listing: paging (offset, limit) and the number of directory entries read per
+// chunk of the response. Kept free of the web server, so it's compiled and checked on a PC as well.
+
+static constexpr uint32_t explorerChunkEntries = 32; // directory entries read per chunk, skipped ones included
+
+typedef struct {
+	size_t offset;
+	size_t limit;
+} explorerPaging;
+
+typedef struct {
+	String path;
+	bool isDir;
+	size_t size; // with details only
+	time_t mtime; // with details only
+} explorerEntry;
+
+enum class ExplorerStep : uint8_t {
+	Entry, // an entry to send
+	ChunkFull, // explorerChunkEntries were read, continue with the next chunk
+	Done // end of the directory or the limit reached
+};
+
+bool ExplorerList_ParsePaging(const String *_offset, const String *_limit, explorerPaging &_paging);
+
+class ExplorerListCursor {
+public:
+	ExplorerListCursor(File _dir, const explorerPaging &_paging, bool _details);
+	~ExplorerListCursor();
+
+	void startChunk(void);
+	ExplorerStep next(explorerEntry &_entry);
+
+private:
+	File dir;
+	size_t skip; // entries still to skip (offset)
+	size_t remaining; // entries still to send (limit)
+	bool details;
+	uint32_t chunkEntries = 0; // directory entries read in this chunk
+};
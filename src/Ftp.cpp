@@ -3,6 +3,7 @@
 
 #include "Ftp.h"
 
+#include "Catalog.h"
 #include "Log.h"
 #include "MemX.h"
 #include "SdCard.h"
@@ -13,6 +14,8 @@
 
 #ifdef FTP_ENABLE
 	#include "ESP-FTP-Server-Lib.h"
+
+	#include <FSImpl.h>
 #endif
 
 // FTP
@@ -24,6 +27,60 @@ String Ftp_Password = "esp32"; // FTP-password (default; can be changed later vi
 FTPServer *ftpSrv; // Heap-alloction takes place later (when needed)
 bool ftpEnableLastStatus = false;
 bool ftpEnableCurrentStatus = false;
+
+// The FTP-server has no callbacks for changes. So it gets a filesystem that forwards everything to gFSystem and
+// invalidates the caches of the SD card whenever a file is written, deleted or renamed or a directory is created or
+// removed. Catalog_Invalidate() waits for further changes before it rescans, so an upload of many files is fine.
+class Ftp_NotifyingFSImpl : public fs::FSImpl {
+public:
+	explicit Ftp_NotifyingFSImpl(fs::FSImplPtr _impl)
+		: impl(_impl) {
+		mountpoint(_impl->mountpoint());
+	}
+
+	fs::FileImplPtr open(const char *path, const char *mode, const bool create) override {
+		if (mode[0] != 'r' || mode[1] == '+') {
+			changed();
+		}
+		return impl->open(path, mode, create);
+	}
+	bool exists(const char *path) override {
+		return impl->exists(path);
+	}
+	bool rename(const char *pathFrom, const char *pathTo) override {
+		changed();
+		return impl->rename(pathFrom, pathTo);
+	}
+	bool remove(const char *path) override {
+		changed();
+		return impl->remove(path);
+	}
+	bool mkdir(const char *path) override {
+		changed();
+		return impl->mkdir(path);
+	}
+	bool rmdir(const char *path) override {
+		changed();
+		return impl->rmdir(path);
+	}
+
+private:
+	static void changed(void) {
+		SdCard_InvalidateSubdirectoryCache();
+		Catalog_Invalidate();
+	}
+
+	fs::FSImplPtr impl;
+};
+
+// fs::FS keeps its implementation protected
+struct Ftp_FSAccess : fs::FS {
+	static fs::FSImplPtr implOf(fs::FS &_fs) {
+		return _fs.*(&Ftp_FSAccess::_impl);
+	}
+};
+
+fs::FS *ftpFSystem; // gFSystem as seen by the FTP-server
 #endif
 
 void ftpManager(void);
@@ -92,7 +149,8 @@ void ftpManager(void) {
 		ftpEnableCurrentStatus = true;
 		ftpSrv = new FTPServer();
 		ftpSrv->addUser(Ftp_User, Ftp_Password);
-		ftpSrv->addFilesystem("SD-Card", &gFSystem);
+		ftpFSystem = new fs::FS(std::make_shared<Ftp_NotifyingFSImpl>(Ftp_FSAccess::implOf(gFSystem)));
+		ftpSrv->addFilesystem("SD-Card", ftpFSystem);
 		ftpSrv->begin();
 		Log_Printf(LOGLEVEL_DEBUG, freeHeapWithFtp, ESP.getFreeHeap());
 		Log_Println(ftpServerStarted, LOGLEVEL_NOTICE);
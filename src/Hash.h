@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 32 bit FNV-1a hash, used to name cache files on the SD card and as checksum. It's streaming: the hash of
+// concatenated data can be built piece by piece by passing the hash of the previous pieces as _hash.
+constexpr uint32_t hashFnv1aInit = 2166136261u;
+
+inline uint32_t Hash_Fnv1a(const void *_data, size_t _len, uint32_t _hash = hashFnv1aInit) {
+	const uint8_t *data = static_cast<const uint8_t *>(_data);
+	for (size_t i = 0; i < _len; i++) {
+		_hash = (_hash ^ data[i]) * 16777619u;
+	}
+	return _hash;
+}
+
+// Same for a null-terminated string
+inline uint32_t Hash_Fnv1aStr(const char *_str, uint32_t _hash = hashFnv1aInit) {
+	while (*_str) {
+		_hash = (_hash ^ static_cast<uint8_t>(*_str++)) * 16777619u;
+	}
+	return _hash;
+}
@@ -0,0 +1,97 @@
+#include <Arduino.h>
+
+#include "HttpRange.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// ETag and Last-Modified from the directory entry, so a changed file is noticed without reading it.
+// _etag needs httpETagSize, _lastModified httpDateSize characters.
+void HttpRange_Validators(size_t _size, time_t _mtime, char *_etag, char *_lastModified) {
+	snprintf(_etag, httpETagSize, "\"%08x%08lx\"", static_cast<unsigned>(_size), static_cast<unsigned long>(_mtime));
+	struct tm mtimeTm;
+	gmtime_r(&_mtime, &mtimeTm);
+	strftime(_lastModified, httpDateSize, "%a, %d %b %Y %H:%M:%S GMT", &mtimeTm);
+}
+
+// If-None-Match: "*" or a list of entity tags, compared weakly (W/"x" matches "x")
+bool HttpRange_IfNoneMatch(const char *_header, const char *_etag) {
+	const size_t etagLen = strlen(_etag);
+	const char *pos = _header;
+	while (*pos) {
+		while (*pos == ' ' || *pos == '\t' || *pos == ',') {
+			pos++;
+		}
+		if (*pos == '*') {
+			return true;
+		}
+		if (pos[0] == 'W' && pos[1] == '/') {
+			pos += 2;
+		}
+		const char *end = pos;
+		while (*end && *end != ',') {
+			end++;
+		}
+		size_t len = end - pos;
+		while (len && (pos[len - 1] == ' ' || pos[len - 1] == '\t')) {
+			len--;
+		}
+		if (len == etagLen && !strncmp(pos, _etag, len)) {
+			return true;
+		}
+		pos = end;
+	}
+	return false;
+}
+
+// If-Range: the range only applies to the file the client has a part of. An entity tag is compared strongly,
+// a weak one never matches.
+bool HttpRange_IfRange(const char *_header, const char *_etag, const char *_lastModified) {
+	return !strcmp(_header, _etag) || !strcmp(_header, _lastModified);
+}
+
+// Digits of a byte position, false if there are none or they don't fit (saturates then)
+static bool HttpRange_ParseNumber(const char *&_pos, size_t &_value) {
+	if (!isdigit(static_cast<uint8_t>(*_pos))) {
+		return false;
+	}
+	_value = 0;
+	for (; isdigit(static_cast<uint8_t>(*_pos)); _pos++) {
+		const size_t digit = *_pos - '0';
+		_value = (_value > (SIZE_MAX - digit) / 10) ? SIZE_MAX : _value * 10 + digit;
+	}
+	return true;
+}
+
+// A single range "bytes=first-last", "bytes=first-" or "bytes=-suffix". _start and _end (exclusive) are only set
+// for Partial. Anything that's not a valid single range is ignored (Full), like several ranges.
+HttpRangeResult HttpRange_Parse(const char *_header, size_t _size, size_t &_start, size_t &_end) {
+	if (strncmp(_header, "bytes=", 6)) {
+		return HttpRangeResult::Full;
+	}
+	const char *pos = _header + 6;
+	size_t first = 0, last = SIZE_MAX;
+	const bool hasFirst = HttpRange_ParseNumber(pos, first);
+	if (*pos++ != '-') {
+		return HttpRangeResult::Full;
+	}
+	const bool hasLast = HttpRange_ParseNumber(pos, last);
+	if (*pos != '\0' || (!hasFirst && !hasLast) || (hasFirst && hasLast && last < first)) {
+		return HttpRangeResult::Full;
+	}
+	if (!hasFirst) {
+		// the last n bytes, none of them (-0) can't be satisfied
+		if (!last || !_size) {
+			return HttpRangeResult::Unsatisfiable;
+		}
+		_start = (last < _size) ? _size - last : 0;
+		_end = _size;
+		return HttpRangeResult::Partial;
+	}
+	if (first >= _size) {
+		return HttpRangeResult::Unsatisfiable;
+	}
+	_start = first;
+	_end = (hasLast && last < _size) ? last + 1 : _size;
+	return HttpRangeResult::Partial;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+// Conditional and partial requests of /explorerdownload (RFC 9110): the validators of a file, If-None-Match,
+// If-Range and a single byte range. Kept free of the web server, so it's compiled and checked on a PC as well.
+
+static constexpr size_t httpETagSize = 20; // "ssssssssmmmmmmmm" (size and mtime, hex) and the terminator
+static constexpr size_t httpDateSize = 32;
+
+enum class HttpRangeResult : uint8_t {
+	Full, // no range, a malformed one or several: the whole file (200)
+	Partial, // _start to _end (206)
+	Unsatisfiable // no byte of the range is in the file (416)
+};
+
+void HttpRange_Validators(size_t _size, time_t _mtime, char *_etag, char *_lastModified);
+bool HttpRange_IfNoneMatch(const char *_header, const char *_etag);
+bool HttpRange_IfRange(const char *_header, const char *_etag, const char *_lastModified);
+HttpRangeResult HttpRange_Parse(const char *_header, size_t _size, size_t &_start, size_t &_end);
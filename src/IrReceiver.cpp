@@ -94,6 +94,7 @@ void IrReceiver_Cyclic() {
 
 					uint8_t currentVolume = AudioPlayer_GetCurrentVolume();
 					xQueueSend(gVolumeQueue, &currentVolume, 0);
+					AudioPlayer_WakeUp();
 					Log_Println("RC: Mute", LOGLEVEL_NOTICE);
 				}
 				break;
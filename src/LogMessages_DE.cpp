@@ -251,4 +251,31 @@ const char cantConnectToWifi[] = "WLAN-Verbindung fehlgeschlagen.";
 const char wifiSetLastSSID[] = "Schreibe letzte erfolgreiche SSID in NVS für WLAN Schnellstart: %s";
 const char mDNSStarted[] = "mDNS gestartet: http://%s.local";
 const char mDNSFailed[] = "mDNS Start fehlgeschlagen, Hostname: %s";
+const char playlistFromIndex[] = "Playlist aus Index geladen (%u Dateien)";
+const char playlistIndexWritten[] = "Playlist-Index für %s geschrieben (%u Dateien, %u ms)";
+const char playlistIndexWriteFailed[] = "Playlist-Index %s konnte nicht geschrieben werden";
+const char m3uLineTooLong[] = "m3u-Eintrag bei Offset %u übersprungen, Zeile länger als %u Zeichen";
+const char m3uLazyIndexed[] = "Große m3u-Playlist, %u Einträge per Offset indiziert";
+const char playlistShuffled[] = "%u Titel gemischt (Seed: %08x)";
+const char catalogScanStarted[] = "Medienkatalog: SD-Karte wird im Hintergrund durchsucht";
+const char catalogScanResumed[] = "Medienkatalog: Suche wird fortgesetzt (Position %u)";
+const char catalogScanFinished[] = "Medienkatalog: %u Titel in %u Verzeichnissen (%lu ms)";
+const char catalogWriteFailed[] = "Medienkatalog: Schreiben nach %s fehlgeschlagen";
+const char trackGapMeasured[] = "Pause zwischen Titeln: %u.%u ms";
+const char seekIndexBuilt[] = "Sprungindex: %u Einträge für %s (%lu ms)";
+const char seekIndexPruned[] = "Sprungindex: %u alte Tabellen entfernt";
+const char resumeJournalReplayed[] = "Fortsetzungsjournal: %u Positionen in NVS geschrieben";
+const char resumeJournalWritten[] = "Fortsetzungsjournal: %u Einträge geschrieben";
+const char resumeJournalWriteFailed[] = "Fortsetzungsjournal: SD-Karte nicht beschreibbar, speichere in NVS";
+const char streamBufferLow[] = "Webstream-Puffer niedrig: %u ms (untere Marke %u ms, Jitter %u ms)";
+const char webstreamReconnectScheduled[] = "Webstream unterbrochen, neuer Verbindungsversuch in %u s (Versuch %u/%u)";
+const char webstreamReconnect[] = "Verbinde erneut mit Webstream: %s";
+const char speechCacheFetched[] = "Sprachcache: '%s' (%s) gespeichert, %d Bytes";
+const char speechCacheFetchFailed[] = "Sprachcache: Abruf von '%s' fehlgeschlagen (%d)";
+const char speechCachePrewarm[] = "Sprachcache: lade %u Phrasen";
+const char speechTimeUnknown[] = "Uhrzeit noch unbekannt (kein NTP), sie wird nicht angesagt";
+const char uploadThroughput[] = "Upload: %lu kiB in %lu ms, Webserver wartete %lu ms auf die SD-Karte (%lu Puffer zu %zu Bytes)";
+const char playlistPathTooLong[] = "Pfad länger als %u Zeichen, übersprungen: %s%s";
+const char playlistIndexStale[] = "Playlist-Index von %s ist veraltet, Verzeichnis wird neu gelesen";
+const char playlistIndexPruned[] = "%u verwaiste Playlist-Indexdateien gelöscht";
 #endif
@@ -252,4 +252,31 @@ const char cantConnectToWifi[] = "Failed to connect to WiFi.";
 const char wifiSetLastSSID[] = "Write last successful SSID to NVS for WiFi fast-path: %s";
 const char mDNSStarted[] = "mDNS started: http://%s.local";
 const char mDNSFailed[] = "mDNS failure, hostname: %s";
+const char playlistFromIndex[] = "Playlist restored from index (%u files)";
+const char playlistIndexWritten[] = "Wrote playlist index for %s (%u files, %u ms)";
+const char playlistIndexWriteFailed[] = "Unable to write playlist index %s";
+const char m3uLineTooLong[] = "Skipped m3u entry at offset %u, line longer than %u characters";
+const char m3uLazyIndexed[] = "Large m3u playlist, indexed %u entries by offset";
+const char playlistShuffled[] = "Shuffled %u tracks (seed: %08x)";
+const char catalogScanStarted[] = "Media catalog: scanning SD card in background";
+const char catalogScanResumed[] = "Media catalog: continuing scan (position %u)";
+const char catalogScanFinished[] = "Media catalog: %u tracks in %u directories (%lu ms)";
+const char catalogWriteFailed[] = "Media catalog: unable to write to %s";
+const char trackGapMeasured[] = "Gap between tracks: %u.%u ms";
+const char seekIndexBuilt[] = "Seek index: %u entries for %s (%lu ms)";
+const char seekIndexPruned[] = "Seek index: removed %u old tables";
+const char resumeJournalReplayed[] = "Resume journal: %u positions written to NVS";
+const char resumeJournalWritten[] = "Resume journal: %u entries written";
+const char resumeJournalWriteFailed[] = "Resume journal: unable to write to SD card, saving to NVS";
+const char streamBufferLow[] = "Webstream buffer low: %u ms (low watermark %u ms, jitter %u ms)";
+const char webstreamReconnectScheduled[] = "Webstream lost, reconnecting in %u s (attempt %u/%u)";
+const char webstreamReconnect[] = "Reconnecting to webstream: %s";
+const char speechCacheFetched[] = "Speech cache: '%s' (%s) stored, %d bytes";
+const char speechCacheFetchFailed[] = "Speech cache: fetching '%s' failed (%d)";
+const char speechCachePrewarm[] = "Speech cache: fetching %u phrases";
+const char speechTimeUnknown[] = "Time not known yet (no NTP), it is not announced";
+const char uploadThroughput[] = "Upload: %lu kiB in %lu ms, web server waited %lu ms for the SD card (%lu slots of %zu bytes)";
+const char playlistPathTooLong[] = "Path longer than %u characters, skipped: %s%s";
+const char playlistIndexStale[] = "Playlist index of %s is stale, rescanning";
+const char playlistIndexPruned[] = "Removed %u orphaned playlist index files";
 #endif
@@ -250,4 +250,31 @@ const char cantConnectToWifi[] = "Impossible de se connecter au WiFi.";
 const char wifiSetLastSSID[] = "Écrire le dernier SSID réussi dans le NVS pour le chemin rapide WiFi : %s";
 const char mDNSStarted[] = "mDNS démarré : http://%s.local";
 const char mDNSFailed[] = "Échec de mDNS, nom d'hôte : %s";
+const char playlistFromIndex[] = "Liste de lecture chargée depuis l'index (%u fichiers)";
+const char playlistIndexWritten[] = "Index de la liste de lecture écrit pour %s (%u fichiers, %u ms)";
+const char playlistIndexWriteFailed[] = "Impossible d'écrire l'index de la liste de lecture %s";
+const char m3uLineTooLong[] = "Entrée m3u ignorée à la position %u, ligne de plus de %u caractères";
+const char m3uLazyIndexed[] = "Grande liste m3u, %u entrées indexées par position";
+const char playlistShuffled[] = "%u titres mélangés (graine : %08x)";
+const char catalogScanStarted[] = "Catalogue média : analyse de la carte SD en arrière-plan";
+const char catalogScanResumed[] = "Catalogue média : reprise de l'analyse (position %u)";
+const char catalogScanFinished[] = "Catalogue média : %u titres dans %u répertoires (%lu ms)";
+const char catalogWriteFailed[] = "Catalogue média : impossible d'écrire dans %s";
+const char trackGapMeasured[] = "Pause entre les titres : %u.%u ms";
+const char seekIndexBuilt[] = "Index de saut : %u entrées pour %s (%lu ms)";
+const char seekIndexPruned[] = "Index de saut : %u anciennes tables supprimées";
+const char resumeJournalReplayed[] = "Journal de reprise : %u positions écrites dans la NVS";
+const char resumeJournalWritten[] = "Journal de reprise : %u entrées écrites";
+const char resumeJournalWriteFailed[] = "Journal de reprise : impossible d'écrire sur la carte SD, sauvegarde dans la NVS";
+const char streamBufferLow[] = "Tampon du webstream bas : %u ms (seuil bas %u ms, gigue %u ms)";
+const char webstreamReconnectScheduled[] = "Webstream interrompu, reconnexion dans %u s (tentative %u/%u)";
+const char webstreamReconnect[] = "Reconnexion au webstream : %s";
+const char speechCacheFetched[] = "Cache vocal : '%s' (%s) enregistré, %d octets";
+const char speechCacheFetchFailed[] = "Cache vocal : échec du téléchargement de '%s' (%d)";
+const char speechCachePrewarm[] = "Cache vocal : téléchargement de %u phrases";
+const char speechTimeUnknown[] = "Heure encore inconnue (pas de NTP), elle n'est pas annoncée";
+const char uploadThroughput[] = "Téléversement : %lu kiB en %lu ms, le serveur web a attendu %lu ms la carte SD (%lu tampons de %zu octets)";
+const char playlistPathTooLong[] = "Chemin de plus de %u caractères, ignoré : %s%s";
+const char playlistIndexStale[] = "L'index de la playlist de %s est obsolète, nouvelle analyse";
+const char playlistIndexPruned[] = "%u fichiers d'index de playlist orphelins supprimés";
 #endif
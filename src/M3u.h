@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Log.h"
+#include "MemX.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lines longer than this are skipped, it only protects against files without line breaks (e.g. no m3u at all).
+// Stream URLs with tokens easily exceed the 255 characters of a path.
+static constexpr size_t m3uMaxLineLength = 8192;
+
+// Streams through a m3u/m3u8 file using a fixed block buffer. Comments, "#EXTM3U" and "#EXTINF" lines as well as
+// empty lines are skipped, CRLF line endings and a leading UTF-8 BOM are handled. onEntry(const char *line,
+// uint32_t offset) is called for every entry with the trimmed line and its byte offset in the file.
+// Lines up to 255 characters are collected on the stack, only longer ones need a heap buffer.
+template <typename FileT, typename Callback>
+bool M3u_ForEachEntry(FileT &f, Callback onEntry) {
+	uint8_t block[512];
+	char shortLine[256];
+	char *line = shortLine;
+	size_t lineSize = sizeof(shortLine);
+	size_t lineLen = 0;
+	bool lineOverflow = false;
+	uint32_t lineStart = 0;
+	uint32_t filePos = 0;
+
+	// makes room for _len characters plus the terminator
+	auto growLine = [&](size_t _len) -> bool {
+		if (_len < lineSize) {
+			return true;
+		}
+		if (_len > m3uMaxLineLength) {
+			return false;
+		}
+		const size_t newSize = std::min(std::max(lineSize * 2, _len + 1), m3uMaxLineLength + 1);
+		char *newLine = static_cast<char *>((line == shortLine) ? x_malloc(newSize) : x_realloc(line, newSize));
+		if (!newLine) {
+			return false;
+		}
+		if (line == shortLine) {
+			memcpy(newLine, shortLine, lineLen);
+		}
+		line = newLine;
+		lineSize = newSize;
+		return true;
+	};
+
+	auto finishLine = [&]() -> bool {
+		size_t start = 0;
+		if (lineStart == 0 && lineLen >= 3 && memcmp(line, "\xEF\xBB\xBF", 3) == 0) {
+			// skip UTF-8 BOM
+			start = 3;
+		}
+		while (start < lineLen && isspace(static_cast<uint8_t>(line[start]))) {
+			start++;
+		}
+		while (lineLen > start && isspace(static_cast<uint8_t>(line[lineLen - 1]))) {
+			lineLen--;
+		}
+		bool ret = true;
+		if (lineOverflow) {
+			Log_Printf(LOGLEVEL_ERROR, m3uLineTooLong, lineStart, static_cast<unsigned>(m3uMaxLineLength));
+		} else if (lineLen > start && line[start] != '#') {
+			line[lineLen] = '\0';
+			ret = onEntry(line + start, lineStart + start);
+		}
+		lineLen = 0;
+		lineOverflow = false;
+		return ret;
+	};
+
+	bool ok = true;
+	f.seek(0);
+	while (ok) {
+		const size_t bytesRead = f.read(block, sizeof(block));
+		if (!bytesRead) {
+			// last line without trailing newline
+			ok = finishLine();
+			break;
+		}
+		size_t pos = 0;
+		while (pos < bytesRead) {
+			const uint8_t *eol = static_cast<const uint8_t *>(memchr(block + pos, '\n', bytesRead - pos));
+			const size_t chunkLen = (eol ? (eol - block) : bytesRead) - pos;
+			if (!lineOverflow && growLine(lineLen + chunkLen)) {
+				memcpy(line + lineLen, block + pos, chunkLen);
+				lineLen += chunkLen;
+			} else {
+				lineOverflow = true;
+			}
+			if (!eol) {
+				break;
+			}
+			if (!finishLine()) {
+				ok = false;
+				break;
+			}
+			pos = (eol - block) + 1;
+			lineStart = filePos + pos;
+		}
+		filePos += bytesRead;
+	}
+	if (line != shortLine) {
+		free(line);
+	}
+	return ok;
+}
@@ -31,3 +31,8 @@ char *x_calloc(uint32_t _allocSize, uint32_t _unitSize) {
 		return (char *) calloc(_allocSize, _unitSize);
 	}
 }
+
+// Wraps realloc(). Like x_malloc(), the (re)allocation prefers PSRAM if avaliable.
+void *x_realloc(void *_ptr, uint32_t _allocSize) {
+	return heap_caps_realloc_prefer(_ptr, _allocSize, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
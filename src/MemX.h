@@ -3,3 +3,4 @@
 char *x_calloc(uint32_t _allocSize, uint32_t _unitSize);
 void *x_malloc(uint32_t _allocSize);
 char *x_strdup(const char *_str);
+void *x_realloc(void *_ptr, uint32_t _allocSize);
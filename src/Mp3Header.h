@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fields of a MPEG audio frame header (MPEG 1/2/2.5, layer I-III)
+struct Mp3FrameInfo {
+	uint32_t sampleRate;
+	uint16_t samplesPerFrame;
+	uint16_t kbps;
+	uint32_t frameLen; // bytes including the header
+	bool mpeg1;
+	bool mono;
+
+	// Offset of a Xing/Info header from the start of the frame
+	uint32_t xingOffset() const { return 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17)); }
+};
+
+// Parses the 4 header bytes at _b, returns false if they're no valid frame header (free format is not supported)
+inline bool Mp3_ParseFrameHeader(const uint8_t *_b, Mp3FrameInfo &_info) {
+	// clang-format off
+	static constexpr uint16_t bitrates[5][15] = {
+		{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // MPEG1 layer I
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},    // MPEG1 layer II
+		{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},     // MPEG1 layer III
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},    // MPEG2/2.5 layer I
+		{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},         // MPEG2/2.5 layer II & III
+	};
+	static constexpr uint32_t sampleRates[3] = {44100, 48000, 32000};
+	// clang-format on
+	if (_b[0] != 0xFF || (_b[1] & 0xE0) != 0xE0) {
+		return false;
+	}
+	const uint8_t version = (_b[1] >> 3) & 0x03; // 0: MPEG2.5, 1: reserved, 2: MPEG2, 3: MPEG1
+	const uint8_t layer = (_b[1] >> 1) & 0x03; // 1: III, 2: II, 3: I
+	const uint8_t bitrateIdx = _b[2] >> 4;
+	const uint8_t rateIdx = (_b[2] >> 2) & 0x03;
+	if (version == 1 || layer == 0 || bitrateIdx == 0 || bitrateIdx == 15 || rateIdx == 3) {
+		return false;
+	}
+	const bool padding = (_b[2] >> 1) & 0x01;
+	_info.mpeg1 = (version == 3);
+	_info.mono = (_b[3] >> 6) == 3;
+	_info.kbps = bitrates[_info.mpeg1 ? 3 - layer : (layer == 3 ? 3 : 4)][bitrateIdx];
+	_info.sampleRate = sampleRates[rateIdx] >> (_info.mpeg1 ? 0 : (version == 2 ? 1 : 2));
+	_info.samplesPerFrame = (layer == 3) ? 384 : ((layer == 1 && !_info.mpeg1) ? 576 : 1152);
+	_info.frameLen = (_info.samplesPerFrame / 8) * _info.kbps * 1000 / _info.sampleRate + ((padding) ? ((layer == 3) ? 4 : 1) : 0);
+	return true;
+}
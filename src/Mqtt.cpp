@@ -7,6 +7,7 @@
 #include "Led.h"
 #include "Log.h"
 #include "MemX.h"
+#include "PlaybackStats.h"
 #include "Queues.h"
 #include "System.h"
 #include "Wlan.h"
@@ -38,6 +39,7 @@ static bool Mqtt_Enabled = true;
 static void Mqtt_ClientCallback(const char *topic, const byte *payload, uint32_t length);
 static bool Mqtt_Reconnect(void);
 static void Mqtt_PostWiFiRssi(void);
+static void Mqtt_PostPlaybackStats(void);
 #endif
 
 void Mqtt_Init() {
@@ -124,6 +126,7 @@ void Mqtt_Cyclic(void) {
 		Mqtt_Reconnect();
 		Mqtt_PubSubClient.loop();
 		Mqtt_PostWiFiRssi();
+		Mqtt_PostPlaybackStats();
 	}
 #endif
 }
@@ -198,6 +201,21 @@ void Mqtt_PostWiFiRssi(void) {
 #endif
 }
 
+// Cyclic posting of playback health (underruns, input buffer, decode and SD read times) as JSON
+void Mqtt_PostPlaybackStats(void) {
+#ifdef MQTT_ENABLE
+	static uint32_t lastMqttStatsTimestamp = 0;
+
+	if (!lastMqttStatsTimestamp || (millis() - lastMqttStatsTimestamp >= 60000)) {
+		lastMqttStatsTimestamp = millis();
+		const playbackStats stats = PlaybackStats_Get();
+		char buf[192];
+		snprintf(buf, sizeof(buf) / sizeof(buf[0]), "{\"underruns\":%u,\"starvedMs\":%u,\"inBufferLowPct\":%u,\"decodeP95Us\":%u,\"decodeMaxUs\":%u,\"sdReadP95Us\":%u,\"sdReadP99Us\":%u,\"sdReadMaxUs\":%u}", stats.underruns, stats.starvedMs, stats.inBufferFill[0], stats.decode.p95, stats.decode.max, stats.sdRead.p95, stats.sdRead.p99, stats.sdRead.max);
+		publishMqtt(topicPlaybackStatsState, buf, false);
+	}
+#endif
+}
+
 /* Connects/reconnects to MQTT-Broker unless connection is not already available.
 	Manages MQTT-subscriptions.
 */
@@ -0,0 +1,54 @@
+#include "NatSort.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <type_traits>
+
+/* Builds a binary key for natural sorting, memcmp() on two keys orders exactly like strnatcmp()/strnatcasecmp()
+   on the strings. Whitespace is dropped (strnatcmp skips it), digit runs with a leading zero are compared left
+   aligned (digits + terminator), all other digit runs by magnitude (marker + length + digits).
+   Returns the length of the key, out may be nullptr to just measure it. */
+size_t NatSort_Key(const char *str, uint8_t *out, bool foldCase) {
+	constexpr uint8_t signFlip = std::is_signed<char>::value ? 0x80 : 0x00; // strnatcmp compares plain chars
+	size_t len = 0;
+	auto put = [&](uint8_t c) {
+		if (out) {
+			out[len] = c;
+		}
+		len++;
+	};
+
+	while (*str) {
+		const uint8_t c = *str;
+		if (isspace(c)) {
+			str++;
+			continue;
+		}
+		if (isdigit(c)) {
+			const char *run = str;
+			while (isdigit(static_cast<uint8_t>(*str))) {
+				str++;
+			}
+			const size_t runLen = str - run;
+			if (c == '0') {
+				put('0' ^ signFlip);
+				for (size_t i = 0; i < runLen; i++) {
+					put(run[i]);
+				}
+				put(0); // shorter run is smaller
+			} else {
+				// any non-digit compares to '1' just like it would to the real leading digit
+				put('1' ^ signFlip);
+				put(std::min<size_t>(runLen, UINT8_MAX));
+				for (size_t i = 0; i < runLen; i++) {
+					put(run[i]);
+				}
+			}
+			continue;
+		}
+		put((foldCase ? toupper(c) : c) ^ signFlip);
+		str++;
+	}
+	put(0 ^ signFlip); // the terminating '\0' takes part in the comparison as well
+	return len;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sort keys for natural sorting of playlists (Playlist::sortByKey()). Free of hardware dependencies, so it's
+// compiled and checked on a PC as well.
+
+size_t NatSort_Key(const char *str, uint8_t *out, bool foldCase);
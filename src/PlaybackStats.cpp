@@ -0,0 +1,146 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "PlaybackStats.h"
+
+#include <algorithm>
+
+// Counters to tell a slow SD card from a decoder short of CPU when playback stutters. They're only written by
+// the audio task and 32 bit stores are atomic, so other tasks read them without locking.
+// - Underruns: the output is modelled as a buffer that gains one sample per audio_process_i2s() call and drains
+//   with the sample rate, timed by the CPU cycle counter (cheap enough for every sample). Running empty is an underrun.
+// - Every call of audio->loop() is timed. Calls that read from the file count as SD read (minus the average decode
+//   time if samples were produced as well), calls that only produced samples as decode time of a frame.
+// - The fill level of the input buffer is sampled at every call.
+static constexpr uint32_t playbackStatsOutputCapacity = 8192; // samples the I2S DMA buffers of the audio library hold (approx.)
+static constexpr uint8_t playbackStatsTimeBuckets = 16; // bucket i: < 2^(i + 6) µs, the last one is open
+static constexpr uint8_t playbackStatsTimeShift = 6;
+
+struct PlaybackStats_Histogram {
+	uint32_t count[playbackStatsTimeBuckets];
+	uint32_t max;
+};
+
+static struct {
+	uint32_t underruns;
+	uint32_t starvedUs;
+	uint32_t inBufferFill[playbackStatsFillBuckets];
+	PlaybackStats_Histogram decode;
+	PlaybackStats_Histogram sdRead;
+} PlaybackStats_Counters;
+
+static bool PlaybackStats_Armed = false; // false: next sample starts a new measurement (track start, resume)
+static uint32_t PlaybackStats_LastCycle = 0;
+static int32_t PlaybackStats_Level = 0; // output buffer level in CPU cycles
+static int32_t PlaybackStats_CyclesPerSample = 0; // 0: sample rate unknown
+static int32_t PlaybackStats_Capacity = 0;
+static uint32_t PlaybackStats_CyclesPerUs = 240;
+static uint32_t PlaybackStats_SampleRate = 0;
+static uint32_t PlaybackStats_SamplesSinceLoop = 0;
+static uint32_t PlaybackStats_DecodeAvgUs = 0;
+
+static void PlaybackStats_Add(PlaybackStats_Histogram &_histogram, uint32_t _us) {
+	const uint8_t bucket = (_us >> playbackStatsTimeShift) ? std::min<uint8_t>(32 - __builtin_clz(_us) - playbackStatsTimeShift, playbackStatsTimeBuckets - 1) : 0;
+	_histogram.count[bucket]++;
+	_histogram.max = std::max(_histogram.max, _us);
+}
+
+static playbackLatency PlaybackStats_Percentiles(const PlaybackStats_Histogram &_histogram) {
+	PlaybackStats_Histogram snapshot = _histogram;
+	uint64_t total = 0;
+	for (uint32_t c : snapshot.count) {
+		total += c;
+	}
+	playbackLatency latency = {0, 0, 0, snapshot.max};
+	if (!total) {
+		return latency;
+	}
+	const uint8_t percents[] = {50, 95, 99};
+	uint32_t *results[] = {&latency.p50, &latency.p95, &latency.p99};
+	for (uint8_t p = 0; p < 3; p++) {
+		const uint64_t target = (total * percents[p] + 99) / 100;
+		uint64_t cumulated = 0;
+		for (uint8_t i = 0; i < playbackStatsTimeBuckets; i++) {
+			cumulated += snapshot.count[i];
+			if (cumulated >= target) {
+				// upper bound of the bucket
+				*results[p] = (i + 1 < playbackStatsTimeBuckets) ? std::min<uint32_t>(1u << (i + playbackStatsTimeShift), snapshot.max) : snapshot.max;
+				break;
+			}
+		}
+	}
+	return latency;
+}
+
+// Called by the audio task whenever the sample rate might have changed
+void PlaybackStats_SetSampleRate(uint32_t _sampleRate) {
+	if (_sampleRate == PlaybackStats_SampleRate) {
+		return;
+	}
+	PlaybackStats_SampleRate = _sampleRate;
+	PlaybackStats_CyclesPerUs = getCpuFrequencyMhz();
+	PlaybackStats_CyclesPerSample = (_sampleRate) ? PlaybackStats_CyclesPerUs * 1000000u / _sampleRate : 0;
+	PlaybackStats_Capacity = PlaybackStats_CyclesPerSample * playbackStatsOutputCapacity;
+	PlaybackStats_Armed = false;
+}
+
+// Playback stopped or paused, the gap until the next sample is no underrun
+void PlaybackStats_Rearm(void) {
+	PlaybackStats_Armed = false;
+	PlaybackStats_SamplesSinceLoop = 0;
+}
+
+// Called for every sample handed to I2S
+void PlaybackStats_OnSample(void) {
+	const uint32_t now = ESP.getCycleCount();
+	PlaybackStats_SamplesSinceLoop++;
+	if (!PlaybackStats_Armed) {
+		PlaybackStats_Armed = (PlaybackStats_CyclesPerSample != 0);
+		PlaybackStats_LastCycle = now;
+		PlaybackStats_Level = PlaybackStats_CyclesPerSample;
+		return;
+	}
+	const uint32_t elapsed = now - PlaybackStats_LastCycle;
+	PlaybackStats_LastCycle = now;
+	int64_t level = static_cast<int64_t>(PlaybackStats_Level) - elapsed;
+	if (level < 0) {
+		PlaybackStats_Counters.underruns++;
+		PlaybackStats_Counters.starvedUs += -level / PlaybackStats_CyclesPerUs;
+		level = 0;
+	}
+	PlaybackStats_Level = std::min<int64_t>(level + PlaybackStats_CyclesPerSample, PlaybackStats_Capacity);
+}
+
+// Called by the audio task after every audio->loop() while playing
+void PlaybackStats_OnLoop(uint32_t _durationUs, bool _fileRead, uint32_t _inBufferFilled, uint32_t _inBufferSize) {
+	const bool decoded = (PlaybackStats_SamplesSinceLoop != 0);
+	PlaybackStats_SamplesSinceLoop = 0;
+	if (_inBufferSize) {
+		PlaybackStats_Counters.inBufferFill[std::min<uint32_t>(static_cast<uint64_t>(_inBufferFilled) * playbackStatsFillBuckets / _inBufferSize, playbackStatsFillBuckets - 1)]++;
+	}
+	if (_fileRead) {
+		const uint32_t decodeUs = (decoded) ? PlaybackStats_DecodeAvgUs : 0;
+		PlaybackStats_Add(PlaybackStats_Counters.sdRead, (_durationUs > decodeUs) ? _durationUs - decodeUs : 0);
+	} else if (decoded) {
+		PlaybackStats_Add(PlaybackStats_Counters.decode, _durationUs);
+		PlaybackStats_DecodeAvgUs = (PlaybackStats_DecodeAvgUs * 7 + _durationUs) / 8;
+	}
+}
+
+playbackStats PlaybackStats_Get(void) {
+	playbackStats stats;
+	stats.underruns = PlaybackStats_Counters.underruns;
+	stats.starvedMs = PlaybackStats_Counters.starvedUs / 1000;
+	uint32_t fill[playbackStatsFillBuckets];
+	uint64_t total = 0;
+	for (uint8_t i = 0; i < playbackStatsFillBuckets; i++) {
+		fill[i] = PlaybackStats_Counters.inBufferFill[i];
+		total += fill[i];
+	}
+	for (uint8_t i = 0; i < playbackStatsFillBuckets; i++) {
+		stats.inBufferFill[i] = (total) ? static_cast<uint64_t>(fill[i]) * 100 / total : 0;
+	}
+	stats.decode = PlaybackStats_Percentiles(PlaybackStats_Counters.decode);
+	stats.sdRead = PlaybackStats_Percentiles(PlaybackStats_Counters.sdRead);
+	return stats;
+}
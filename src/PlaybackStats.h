@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+constexpr uint8_t playbackStatsFillBuckets = 8; // input buffer fill in steps of 12.5 %
+
+typedef struct {
+	uint32_t p50;
+	uint32_t p95;
+	uint32_t p99;
+	uint32_t max;
+} playbackLatency; // µs
+
+typedef struct {
+	uint32_t underruns; // I2S ran dry while playing
+	uint32_t starvedMs; // total time without samples
+	uint8_t inBufferFill[playbackStatsFillBuckets]; // % of the time the input buffer was filled that much
+	playbackLatency decode; // decoding a frame
+	playbackLatency sdRead; // reading from the SD card
+} playbackStats;
+
+void PlaybackStats_SetSampleRate(uint32_t _sampleRate);
+void PlaybackStats_Rearm(void);
+void PlaybackStats_OnSample(void);
+void PlaybackStats_OnLoop(uint32_t _durationUs, bool _fileRead, uint32_t _inBufferFilled, uint32_t _inBufferSize);
+playbackStats PlaybackStats_Get(void);
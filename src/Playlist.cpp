@@ -0,0 +1,306 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Playlist.h"
+
+#include "Log.h"
+#include "MemX.h"
+
+Playlist::Playlist(const char *basePath) {
+	if (!basePath || !*basePath) {
+		return;
+	}
+	const size_t len = strlen(basePath);
+	const bool hasSlash = (basePath[len - 1] == '/');
+	prefix = static_cast<char *>(x_malloc(len + (hasSlash ? 1 : 2)));
+	if (!prefix) {
+		// no shared base path, all entries will be stored with their full path
+		return;
+	}
+	memcpy(prefix, basePath, len);
+	if (!hasSlash) {
+		prefix[len] = '/';
+	}
+	prefixLen = len + (hasSlash ? 0 : 1);
+	prefix[prefixLen] = '\0';
+}
+
+Playlist::~Playlist() {
+	free(prefix);
+	free(source);
+	free(pool);
+	free(offsets);
+}
+
+Playlist::Path Playlist::at(size_t idx) const {
+	if (idx >= count) {
+		// out of range, hand out an empty path
+		return Path();
+	}
+	return resolve(offsets[(shuffled) ? permute(idx) : idx]);
+}
+
+// Maps a play position to an entry with a 4-round Feistel network keyed by the seed. The network is a
+// bijection on the smallest 2^(2*h) >= count, positions landing outside of the playlist are walked
+// along their cycle until they hit a valid entry. As the domain is less than 4 * count, that's only
+// a few rounds on average, and the result is still a permutation of [0, count).
+size_t Playlist::permute(size_t idx) const {
+	if (count < 2) {
+		return idx;
+	}
+	const uint8_t bits = 32 - __builtin_clz(static_cast<uint32_t>(count - 1));
+	const uint8_t halfBits = (bits + 1) / 2;
+	const uint32_t mask = (1u << halfBits) - 1;
+
+	uint32_t x = idx;
+	do {
+		uint32_t left = x >> halfBits;
+		uint32_t right = x & mask;
+		for (uint32_t round = 0; round < 4; round++) {
+			// murmur3 finalizer as round function
+			uint32_t f = right ^ (seed + round * 0x9E3779B9u);
+			f ^= f >> 16;
+			f *= 0x85EBCA6Bu;
+			f ^= f >> 13;
+			f *= 0xC2B2AE35u;
+			f ^= f >> 16;
+			const uint32_t newRight = left ^ (f & mask);
+			left = right;
+			right = newRight;
+		}
+		x = (left << halfBits) | right;
+	} while (x >= count);
+	return x;
+}
+
+Playlist::Path Playlist::resolve(uint32_t offset) const {
+	Path path;
+	if (source) {
+		if (offset & pooledFlag) {
+			path.str = pool + (offset & ~pooledFlag);
+		} else if (!SdCard_ReadPlaylistEntry(source, offset, path.buf, sizeof(path.buf))) {
+			path.buf[0] = '\0';
+		}
+		return path;
+	}
+	const char *entry = pool + (offset & ~relativeFlag);
+	if (offset & relativeFlag) {
+		if (snprintf(path.buf, sizeof(path.buf), "%s%s", prefix, entry) >= static_cast<int>(sizeof(path.buf))) {
+			// can't happen for entries added by append(), but don't hand out a wrong path
+			Log_Printf(LOGLEVEL_ERROR, playlistPathTooLong, static_cast<unsigned>(maxPathLength - 1), prefix, entry);
+			path.buf[0] = '\0';
+		}
+	} else {
+		path.str = entry;
+	}
+	return path;
+}
+
+bool Playlist::reserve(size_t _entries, size_t _avgNameLen) {
+	return growTable(_entries) && growPool(_entries * (_avgNameLen + 1));
+}
+
+bool Playlist::push_back(const char *_path) {
+	if (!_path || source) {
+		return false;
+	}
+	if (prefixLen && strncmp(_path, prefix, prefixLen) == 0 && _path[prefixLen] != '\0') {
+		// only keep the basename, the base path is shared by all entries
+		return append(_path + prefixLen, true);
+	}
+	return append(_path, false);
+}
+
+bool Playlist::push_back_relative(const char *_name) {
+	if (!_name || source) {
+		return false;
+	}
+	return append(_name, prefixLen > 0);
+}
+
+bool Playlist::setSource(const char *_source) {
+	if (count || !_source) {
+		// can't mix stored and lazy entries
+		return false;
+	}
+	free(source);
+	source = x_strdup(_source);
+	return source != nullptr;
+}
+
+bool Playlist::push_back_offset(uint32_t _offset, const char *_entry) {
+	if (!source || (_offset & pooledFlag) || !growTable(count + 1)) {
+		return false;
+	}
+	const size_t len = strlen(_entry) + 1;
+	if (len <= maxPathLength) {
+		offsets[count++] = _offset;
+	} else {
+		// e.g. a stream URL with a token, it wouldn't fit into a Path when it's read again
+		if (!growPool(poolUsed + len)) {
+			return false;
+		}
+		memcpy(pool + poolUsed, _entry, len);
+		offsets[count++] = poolUsed | pooledFlag;
+		poolUsed += len;
+	}
+	sorted = false;
+	return true;
+}
+
+bool Playlist::append(const char *_entry, bool _relative) {
+	const size_t len = strlen(_entry) + 1;
+	if (_relative && prefixLen + len > maxPathLength) {
+		// the full path wouldn't fit into a Path, playing a truncated path would fail anyway. Absolute entries
+		// (m3u lines, webstream URLs) are handed out straight from the pool and have no limit.
+		Log_Printf(LOGLEVEL_ERROR, playlistPathTooLong, static_cast<unsigned>(maxPathLength - 1), prefix, _entry);
+		return true;
+	}
+	if (!growTable(count + 1) || !growPool(poolUsed + len)) {
+		return false;
+	}
+	memcpy(pool + poolUsed, _entry, len);
+	offsets[count++] = poolUsed | (_relative ? relativeFlag : 0);
+	poolUsed += len;
+	sorted = false;
+	return true;
+}
+
+bool Playlist::materialize() {
+	if (!source) {
+		return true;
+	}
+	// the offsets are in file order, so reading the file in one go yields the entries in the same order
+	Playlist loaded;
+	if (!loaded.growTable(count)) {
+		return false;
+	}
+	const bool ok = SdCard_ReadPlaylistEntries(source, [&loaded](const char *entry, uint32_t) {
+		return loaded.append(entry, false);
+	});
+	if (!ok) {
+		return false;
+	}
+	std::swap(pool, loaded.pool);
+	std::swap(poolUsed, loaded.poolUsed);
+	std::swap(poolSize, loaded.poolSize);
+	std::swap(offsets, loaded.offsets);
+	std::swap(count, loaded.count);
+	std::swap(capacity, loaded.capacity);
+	free(source);
+	source = nullptr;
+	shrink_to_fit();
+	return true;
+}
+
+bool Playlist::sortByKey(const std::function<size_t(const char *, uint8_t *)> &makeKey) {
+	struct SortKey {
+		uint32_t key; // start of the key in keyPool
+		uint32_t len;
+		uint32_t offset; // the entry's value of the offset table
+	};
+	if (count < 2) {
+		shuffled = false;
+		sorted = true;
+		return true;
+	}
+	if (source && !materialize()) {
+		return false;
+	}
+
+	// if all entries share the base path, the basenames are enough to build the keys
+	bool allRelative = !source;
+	for (size_t i = 0; i < count && allRelative; i++) {
+		allRelative = offsets[i] & relativeFlag;
+	}
+	Path path;
+	auto entry = [&](uint32_t offset) -> const char * {
+		if (allRelative) {
+			return pool + (offset & ~relativeFlag);
+		}
+		path = resolve(offset);
+		return path.c_str();
+	};
+
+	size_t keyPoolSize = 0;
+	for (size_t i = 0; i < count; i++) {
+		keyPoolSize += makeKey(entry(offsets[i]), nullptr);
+	}
+	SortKey *keys = static_cast<SortKey *>(x_malloc(count * sizeof(SortKey)));
+	uint8_t *keyPool = static_cast<uint8_t *>(x_malloc(std::max<size_t>(keyPoolSize, 1)));
+	if (!keys || !keyPool) {
+		free(keys);
+		free(keyPool);
+		return false;
+	}
+	uint32_t keyPos = 0;
+	for (size_t i = 0; i < count; i++) {
+		keys[i].key = keyPos;
+		keys[i].len = makeKey(entry(offsets[i]), keyPool + keyPos);
+		keys[i].offset = offsets[i];
+		keyPos += keys[i].len;
+	}
+
+	std::sort(keys, keys + count, [keyPool](const SortKey &a, const SortKey &b) {
+		const int res = memcmp(keyPool + a.key, keyPool + b.key, std::min(a.len, b.len));
+		return (res != 0) ? (res < 0) : (a.len < b.len);
+	});
+	for (size_t i = 0; i < count; i++) {
+		offsets[i] = keys[i].offset;
+	}
+	free(keys);
+	free(keyPool);
+	shuffled = false;
+	sorted = true;
+	return true;
+}
+
+void Playlist::shrink_to_fit() {
+	if (poolUsed && poolUsed < poolSize) {
+		char *newPool = static_cast<char *>(x_realloc(pool, poolUsed));
+		if (newPool) {
+			pool = newPool;
+			poolSize = poolUsed;
+		}
+	}
+	if (count && count < capacity) {
+		uint32_t *newOffsets = static_cast<uint32_t *>(x_realloc(offsets, count * sizeof(uint32_t)));
+		if (newOffsets) {
+			offsets = newOffsets;
+			capacity = count;
+		}
+	}
+}
+
+// Grows the string pool geometrically, so building a playlist needs only a handful of reallocs
+bool Playlist::growPool(size_t _minSize) {
+	if (_minSize <= poolSize) {
+		return true;
+	}
+	if (_minSize > ~relativeFlag) {
+		// offsets would collide with the flag bit
+		return false;
+	}
+	const size_t newSize = std::max<size_t>(_minSize, std::max<size_t>(poolSize * 2, 1024));
+	char *newPool = static_cast<char *>(x_realloc(pool, newSize));
+	if (!newPool) {
+		return false;
+	}
+	pool = newPool;
+	poolSize = newSize;
+	return true;
+}
+
+bool Playlist::growTable(size_t _minEntries) {
+	if (_minEntries <= capacity) {
+		return true;
+	}
+	const size_t newCapacity = std::max<size_t>(_minEntries, std::max<size_t>(capacity * 2, 64));
+	uint32_t *newOffsets = static_cast<uint32_t *>(x_realloc(offsets, newCapacity * sizeof(uint32_t)));
+	if (!newOffsets) {
+		return false;
+	}
+	offsets = newOffsets;
+	capacity = newCapacity;
+	return true;
+}
@@ -1,18 +1,184 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdint.h>
 #include <stdlib.h>
-#include <vector>
+#include <string.h>
 
-using Playlist = std::vector<char *>;
+// Playlist backed by a single string pool instead of one heap allocation per track.
+// Entries sharing the playlist's base path (e.g. all files of a directory) only store
+// their basename, every other entry (m3u, webstreams) is stored with its full path.
+// An offset table into the pool keeps the order, so sorting never moves strings and shuffling
+// doesn't even touch the table: a seeded permutation maps the play position to the entry.
+// Huge m3u files can be kept lazily: the table then holds the byte offsets of the entries
+// within the file and an entry is only read when it's requested.
+class Playlist {
+public:
+	// Buffer size of an entry resolved against the base path. FAT limits each path component (not the whole path)
+	// to 255 characters, so deeply nested entries can be longer: those are skipped with an error when they're
+	// added. Absolute entries (m3u lines, webstream URLs) aren't copied into a Path and have no limit.
+	static constexpr size_t maxPathLength = 256;
+
+	// A single entry, resolved to its full path. Only valid as long as the playlist is alive.
+	class Path {
+	public:
+		Path(const Path &other) { *this = other; }
+		Path &operator=(const Path &other) {
+			if (other.str == other.buf) {
+				memcpy(buf, other.buf, sizeof(buf));
+				str = buf;
+			} else {
+				str = other.str;
+			}
+			return *this;
+		}
+
+		const char *c_str() const { return str; }
+		operator const char *() const { return str; }
+
+	private:
+		friend class Playlist;
+		Path() { buf[0] = '\0'; }
+
+		const char *str = buf;
+		char buf[maxPathLength];
+	};
+
+	class const_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Path;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Path;
+
+		const_iterator(const Playlist *playlist, size_t idx)
+			: playlist(playlist)
+			, idx(idx) { }
+
+		Path operator*() const { return playlist->at(idx); }
+		const_iterator &operator++() {
+			idx++;
+			return *this;
+		}
+		bool operator==(const const_iterator &other) const { return idx == other.idx && playlist == other.playlist; }
+		bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+	private:
+		const Playlist *playlist;
+		size_t idx;
+	};
+
+	Playlist() = default;
+	explicit Playlist(const char *basePath);
+	~Playlist();
+
+	Playlist(const Playlist &) = delete;
+	Playlist &operator=(const Playlist &) = delete;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	Path at(size_t idx) const;
+	Path operator[](size_t idx) const { return at(idx); }
+	const char *basePath() const { return (prefix) ? prefix : ""; }
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+
+	// Pre-allocate space for _entries tracks with an average name length of _avgNameLen
+	bool reserve(size_t _entries, size_t _avgNameLen = 32);
+	// Append a track. Returns false if memory could not be allocated, entries relative to the base path which
+	// would resolve to more than maxPathLength are skipped (logged, returns true).
+	bool push_back(const char *_path);
+	// Append a track given relative to the base path (e.g. read from an index)
+	bool push_back_relative(const char *_name);
+	// Make this a lazy playlist, whose entries are lines of the given file
+	bool setSource(const char *_source);
+	// Append the byte offset of an entry within the source file (lazy playlists only). _entry is the line found
+	// there, it's kept in the pool if it's too long to be read into a Path on access.
+	bool push_back_offset(uint32_t _offset, const char *_entry);
+	bool isLazy() const { return source != nullptr; }
+	// Loads all entries of a lazy playlist into the pool with a single pass over the source file
+	bool materialize();
+	// Release unused pool and table memory
+	void shrink_to_fit();
+
+	// Sorts the playlist; cmp has the signature bool(const char *, const char *)
+	// A lazy playlist is loaded into RAM first, sorting it would read the source file for every comparison.
+	// Returns false (order untouched) if there's not enough memory for that.
+	template <typename Compare>
+	bool sort(Compare cmp) {
+		if (source && !materialize()) {
+			return false;
+		}
+		std::sort(offsets, offsets + count, [this, &cmp](uint32_t a, uint32_t b) {
+			if (!source && (a & relativeFlag) && (b & relativeFlag)) {
+				// same base path on both sides, the basenames decide
+				return cmp(pool + (a & ~relativeFlag), pool + (b & ~relativeFlag));
+			}
+			return cmp(resolve(a).c_str(), resolve(b).c_str());
+		});
+		shuffled = false;
+		sorted = true;
+		return true;
+	}
+
+	// Sorts the playlist by binary keys computed once per entry and compared with memcmp().
+	// makeKey(path, out) writes the key of an entry to out (only measures it if out is nullptr) and returns its length.
+	// Returns false if there's not enough memory for the keys (or to load a lazy playlist), the order is left
+	// untouched in that case.
+	bool sortByKey(const std::function<size_t(const char *, uint8_t *)> &makeKey);
+
+	// Plays the entries in a pseudo-random order given by _seed, the same seed always yields the same order.
+	// Costs no memory, the position is mapped to the entry on every access. Sorting drops the shuffle.
+	void shuffle(uint32_t _seed) {
+		seed = _seed;
+		shuffled = true;
+		sorted = false;
+	}
+	bool isShuffled() const { return shuffled; }
+	uint32_t shuffleSeed() const { return seed; }
+
+	// True if the current order is the result of sort() (or was restored from a sorted index)
+	bool isSorted() const { return sorted; }
+	void setSorted(bool _sorted) { sorted = _sorted; }
+
+private:
+	static constexpr uint32_t relativeFlag = 0x80000000u;
+	static constexpr uint32_t pooledFlag = relativeFlag; // lazy playlists: the entry is in the pool, not only in the file
+
+	Path resolve(uint32_t offset) const;
+	size_t permute(size_t idx) const;
+	bool growPool(size_t _minSize);
+	bool growTable(size_t _minEntries);
+	bool append(const char *_entry, bool _relative);
+
+	char *prefix = nullptr; // base path including the trailing '/'
+	char *source = nullptr; // file holding the entries of a lazy playlist
+	size_t prefixLen = 0;
+	char *pool = nullptr; // packed, null-terminated entries
+	size_t poolUsed = 0;
+	size_t poolSize = 0;
+	uint32_t *offsets = nullptr; // start of each entry in pool, MSB set if relative to prefix (lazy: file offset or pooledFlag)
+	size_t count = 0;
+	size_t capacity = 0;
+	bool sorted = false;
+	bool shuffled = false;
+	uint32_t seed = 0; // key of the shuffle permutation
+};
+
+// Reads the entry starting at _offset from a lazy playlist's source file (implemented in SdCard.cpp)
+bool SdCard_ReadPlaylistEntry(const char *_source, uint32_t _offset, char *_buf, size_t _bufLen);
+// Calls _onEntry(entry, offset) for all entries of a lazy playlist's source file in file order (implemented in SdCard.cpp)
+bool SdCard_ReadPlaylistEntries(const char *_source, const std::function<bool(const char *, uint32_t)> &_onEntry);
 
 // Release previously allocated memory
 inline void freePlaylist(Playlist *playlist) {
 	if (playlist == nullptr) {
 		return;
 	}
-	for (auto e : *playlist) {
-		free(e);
-	}
 	delete playlist;
 	playlist = nullptr;
 }
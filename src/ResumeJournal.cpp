@@ -0,0 +1,264 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "ResumeJournal.h"
+
+#include "Hash.h"
+#include "Led.h"
+#include "Log.h"
+#include "Rfid.h"
+#include "SdArbiter.h"
+#include "SdCard.h"
+#include "System.h"
+
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <map>
+
+// The NVS entry of a RFID tag carries the resume position and is rewritten on every pause of an audiobook.
+// Instead the latest entry per tag is kept in RAM and a background task appends it to a journal on the SD card,
+// at most once per resumeJournalFlushInterval and on shutdown. At boot the journal is replayed into NVS and
+// removed, so NVS is written at most once per tag and power cycle. Until then ResumeJournal_GetEntry() serves
+// the newer entries from RAM. Without SD card the task writes them to NVS instead (still coalesced).
+static constexpr uint32_t resumeJournalMagic = 0x4A525345; // "ESRJ"
+static constexpr uint8_t resumeJournalSlots = 8; // tags whose entry in NVS is outdated
+static constexpr uint32_t resumeJournalFlushInterval = 10000; // ms
+static constexpr size_t resumeJournalEntrySize = 276;
+static constexpr char resumeJournalClearAll[] = "*";
+static constexpr char resumeJournalFile[] = "/resume.jnl";
+
+// Fixed size, a record torn by power loss is detected by its checksum
+struct ResumeJournal_Record {
+	uint32_t magic;
+	uint32_t checksum; // of the fields below
+	char rfidId[cardIdStringSize]; // resumeJournalClearAll drops all previous records
+	char entry[resumeJournalEntrySize]; // empty: drops the previous records of the tag
+};
+
+struct ResumeJournal_Slot {
+	char rfidId[cardIdStringSize]; // empty if unused
+	String entry; // empty if NVS was changed otherwise meanwhile
+	bool dirty; // not yet in the journal
+};
+
+static TaskHandle_t ResumeJournal_TaskHandle = NULL;
+static SemaphoreHandle_t ResumeJournal_Mutex = NULL; // guards the slots
+static SemaphoreHandle_t ResumeJournal_FlushMutex = NULL; // one writer to the journal at a time
+static ResumeJournal_Slot ResumeJournal_Slots[resumeJournalSlots];
+static bool ResumeJournal_ClearPending = false; // NVS was erased, the journal needs a resumeJournalClearAll record
+static uint32_t ResumeJournal_LastFlushTimestamp = 0;
+
+static String ResumeJournal_FilePath(void) {
+	return String(cacheDir) + resumeJournalFile;
+}
+
+static uint32_t ResumeJournal_Checksum(const ResumeJournal_Record &_record) {
+	return Hash_Fnv1a(_record.rfidId, sizeof(_record.rfidId) + sizeof(_record.entry));
+}
+
+static void ResumeJournal_FillRecord(ResumeJournal_Record &_record, const char *_rfidId, const char *_entry) {
+	memset(&_record, 0, sizeof(_record));
+	_record.magic = resumeJournalMagic;
+	strncpy(_record.rfidId, _rfidId, sizeof(_record.rfidId) - 1);
+	strncpy(_record.entry, _entry, sizeof(_record.entry) - 1);
+	_record.checksum = ResumeJournal_Checksum(_record);
+}
+
+static void ResumeJournal_WriteNvs(const char *_rfidId, const char *_entry) {
+	Led_SetPause(true); // Workaround to prevent exceptions due to Neopixel-signalisation while NVS-write
+	gPrefsRfid.putString(_rfidId, _entry);
+	Led_SetPause(false);
+}
+
+// Appends the changed slots to the journal
+static void ResumeJournal_Flush(void) {
+	xSemaphoreTake(ResumeJournal_FlushMutex, portMAX_DELAY);
+	// collect under the lock, write without it, so a pause is never held up by the SD card
+	bool clearAll;
+	uint8_t count = 0;
+	ResumeJournal_Record *records = static_cast<ResumeJournal_Record *>(malloc(sizeof(ResumeJournal_Record) * (resumeJournalSlots + 1)));
+	if (!records) {
+		xSemaphoreGive(ResumeJournal_FlushMutex);
+		return;
+	}
+	xSemaphoreTake(ResumeJournal_Mutex, portMAX_DELAY);
+	clearAll = ResumeJournal_ClearPending;
+	ResumeJournal_ClearPending = false;
+	if (clearAll) {
+		ResumeJournal_FillRecord(records[count++], resumeJournalClearAll, "");
+	}
+	for (auto &slot : ResumeJournal_Slots) {
+		if (slot.dirty) {
+			ResumeJournal_FillRecord(records[count++], slot.rfidId, slot.entry.c_str());
+			slot.dirty = false;
+		}
+	}
+	xSemaphoreGive(ResumeJournal_Mutex);
+	ResumeJournal_LastFlushTimestamp = millis();
+
+	if (count) {
+		const size_t bytes = sizeof(ResumeJournal_Record) * count;
+		SdArbiter_BackgroundBegin(bytes);
+		gFSystem.mkdir(cacheDir);
+		File f = gFSystem.open(ResumeJournal_FilePath(), FILE_APPEND);
+		const bool written = f && f.write(reinterpret_cast<const uint8_t *>(records), bytes) == bytes;
+		f.close();
+		SdArbiter_BackgroundEnd();
+		if (written) {
+			Log_Printf(LOGLEVEL_DEBUG, resumeJournalWritten, count);
+		} else {
+			// no SD card, NVS is the only place left
+			Log_Println(resumeJournalWriteFailed, LOGLEVEL_ERROR);
+			for (uint8_t i = 0; i < count; i++) {
+				if (records[i].entry[0] != '\0') {
+					ResumeJournal_WriteNvs(records[i].rfidId, records[i].entry);
+				}
+			}
+		}
+	}
+	free(records);
+	xSemaphoreGive(ResumeJournal_FlushMutex);
+}
+
+static void ResumeJournal_Task(void *parameter) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		// further pauses until the interval is over end up in the same write
+		const uint32_t sinceLastFlush = millis() - ResumeJournal_LastFlushTimestamp;
+		if (sinceLastFlush < resumeJournalFlushInterval) {
+			vTaskDelay(portTICK_PERIOD_MS * (resumeJournalFlushInterval - sinceLastFlush));
+		}
+		ResumeJournal_Flush();
+	}
+}
+
+// Applies the journal of the last power cycle to NVS
+static void ResumeJournal_Replay(void) {
+	File f = gFSystem.open(ResumeJournal_FilePath(), FILE_READ);
+	if (!f) {
+		return;
+	}
+	std::map<String, String> latest;
+	ResumeJournal_Record record;
+	while (f.read(reinterpret_cast<uint8_t *>(&record), sizeof(record)) == sizeof(record)) {
+		if (record.magic != resumeJournalMagic || record.checksum != ResumeJournal_Checksum(record)) {
+			// torn by power loss
+			break;
+		}
+		record.rfidId[sizeof(record.rfidId) - 1] = '\0';
+		record.entry[sizeof(record.entry) - 1] = '\0';
+		if (strcmp(record.rfidId, resumeJournalClearAll) == 0) {
+			latest.clear();
+		} else {
+			latest[record.rfidId] = record.entry;
+		}
+	}
+	f.close();
+	uint32_t written = 0;
+	for (const auto &e : latest) {
+		if (!e.second.isEmpty() && gPrefsRfid.isKey(e.first.c_str()) && gPrefsRfid.getString(e.first.c_str(), "") != e.second) {
+			ResumeJournal_WriteNvs(e.first.c_str(), e.second.c_str());
+			written++;
+		}
+	}
+	gFSystem.remove(ResumeJournal_FilePath());
+	Log_Printf(LOGLEVEL_INFO, resumeJournalReplayed, written);
+}
+
+void ResumeJournal_Init(void) {
+	ResumeJournal_Mutex = xSemaphoreCreateMutex();
+	ResumeJournal_FlushMutex = xSemaphoreCreateMutex();
+	ResumeJournal_Replay();
+
+	xTaskCreatePinnedToCore(
+		ResumeJournal_Task, /* Function to implement the task */
+		"resumeJournal", /* Name of the task */
+		3000, /* Stack size in words */
+		NULL, /* Task input parameter */
+		1, /* Priority of the task */
+		&ResumeJournal_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+}
+
+// Writes what's pending without waiting for the interval, e.g. the position saved when shutting down
+void ResumeJournal_Exit(void) {
+	if (ResumeJournal_TaskHandle == NULL) {
+		return;
+	}
+	ResumeJournal_Flush();
+}
+
+// Remembers the NVS entry of a tag to be written in background. Returns false if there's no free slot, then the
+// caller has to write it to NVS itself.
+bool ResumeJournal_Store(const char *_rfidId, const char *_entry) {
+	if (ResumeJournal_TaskHandle == NULL) {
+		return false;
+	}
+	xSemaphoreTake(ResumeJournal_Mutex, portMAX_DELAY);
+	ResumeJournal_Slot *target = nullptr;
+	for (auto &slot : ResumeJournal_Slots) {
+		if (strcmp(slot.rfidId, _rfidId) == 0) {
+			target = &slot;
+			break;
+		}
+		if (!target && (slot.rfidId[0] == '\0' || (slot.entry.isEmpty() && !slot.dirty))) {
+			// unused or the journal already says NVS is valid for it
+			target = &slot;
+		}
+	}
+	if (target) {
+		strncpy(target->rfidId, _rfidId, sizeof(target->rfidId) - 1);
+		target->rfidId[sizeof(target->rfidId) - 1] = '\0';
+		target->entry = _entry;
+		target->dirty = true;
+	}
+	xSemaphoreGive(ResumeJournal_Mutex);
+	if (target) {
+		xTaskNotifyGive(ResumeJournal_TaskHandle);
+	}
+	return target != nullptr;
+}
+
+// To be called when the NVS entry of a tag was changed otherwise (e.g. assigned in the web-interface),
+// so it isn't overwritten by older records. nullptr for all tags (NVS was erased or restored).
+void ResumeJournal_Forget(const char *_rfidId) {
+	if (ResumeJournal_TaskHandle == NULL) {
+		return;
+	}
+	xSemaphoreTake(ResumeJournal_Mutex, portMAX_DELAY);
+	for (auto &slot : ResumeJournal_Slots) {
+		if (!_rfidId) {
+			slot.rfidId[0] = '\0';
+			slot.entry = "";
+			slot.dirty = false;
+		} else if (strcmp(slot.rfidId, _rfidId) == 0) {
+			slot.entry = "";
+			slot.dirty = true;
+		}
+	}
+	if (!_rfidId) {
+		ResumeJournal_ClearPending = true;
+	}
+	xSemaphoreGive(ResumeJournal_Mutex);
+	xTaskNotifyGive(ResumeJournal_TaskHandle);
+}
+
+// NVS entry of a tag, including a resume position that's not written to NVS yet
+String ResumeJournal_GetEntry(const char *_rfidId, const char *_default) {
+	if (ResumeJournal_Mutex) {
+		xSemaphoreTake(ResumeJournal_Mutex, portMAX_DELAY);
+		for (const auto &slot : ResumeJournal_Slots) {
+			if (!slot.entry.isEmpty() && strcmp(slot.rfidId, _rfidId) == 0) {
+				const String entry = slot.entry;
+				xSemaphoreGive(ResumeJournal_Mutex);
+				return entry;
+			}
+		}
+		xSemaphoreGive(ResumeJournal_Mutex);
+	}
+	if (!gPrefsRfid.isKey(_rfidId)) {
+		return _default;
+	}
+	return gPrefsRfid.getString(_rfidId, _default);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <WString.h>
+
+void ResumeJournal_Init(void);
+void ResumeJournal_Exit(void);
+bool ResumeJournal_Store(const char *_rfidId, const char *_entry);
+void ResumeJournal_Forget(const char *_rfidId);
+String ResumeJournal_GetEntry(const char *_rfidId, const char *_default);
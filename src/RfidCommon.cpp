@@ -8,6 +8,7 @@
 #include "MemX.h"
 #include "Mqtt.h"
 #include "Queues.h"
+#include "ResumeJournal.h"
 #include "Rfid.h"
 #include "System.h"
 #include "Web.h"
@@ -39,10 +40,7 @@ void Rfid_PreferenceLookupHandler(void) {
 		strncpy(gCurrentRfidTagId, rfidTagId, cardIdStringSize - 1);
 		Log_Printf(LOGLEVEL_INFO, "%s: %s", rfidTagReceived, gCurrentRfidTagId);
 		Web_SendWebsocketData(0, 10); // Push new rfidTagId to all websocket-clients
-		String s = "-1";
-		if (gPrefsRfid.isKey(gCurrentRfidTagId)) {
-			s = gPrefsRfid.getString(gCurrentRfidTagId, "-1"); // Try to lookup rfidId in NVS
-		}
+		String s = ResumeJournal_GetEntry(gCurrentRfidTagId, "-1"); // Try to lookup rfidId in NVS
 		if (!s.compareTo("-1")) {
 			Log_Println(rfidTagUnknownInNvs, LOGLEVEL_ERROR);
 			System_IndicateError();
@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SdArbiter.h"
+
+#include <algorithm>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Orders the accesses to the SD card, so background clients (upload via the web explorer, catalog scan, seek index
+// builder) don't starve the audio decoder:
+// - The audio task holds the card while audio->loop() runs. The lock is a mutex, so a background client holding it
+//   inherits the priority of the audio task and finishes its write quickly.
+// - While audio is read from the card, background clients are limited to sdBackgroundBandwidth (token bucket, a
+//   quarter of a second of burst) and wait as long as the input buffer of the decoder is less than half full.
+// FatFs serializes the accesses itself, this is only about who goes first. Several background clients (upload,
+// catalog scan, seek index) share one budget, so it's guarded by a second mutex that is never held while waiting.
+static constexpr uint32_t sdArbiterAudioTimeout = 200; // ms without reads before audio counts as idle
+static constexpr uint32_t sdArbiterMaxYield = 250; // ms a background access waits for the decoder at most
+
+static SemaphoreHandle_t SdArbiter_Lock = NULL;
+static SemaphoreHandle_t SdArbiter_BudgetLock = NULL; // SdArbiter_Tokens, SdArbiter_LastRefill, SdArbiter_Stats
+static volatile bool SdArbiter_AudioHungry = false; // input buffer below half
+static volatile uint32_t SdArbiter_LastAudioRead = 0; // millis() of the last read of the decoder
+static int32_t SdArbiter_Tokens = 0; // bytes background clients may still write (only used by background clients)
+static uint32_t SdArbiter_LastRefill = 0;
+static sdArbiterStats SdArbiter_Stats = {sdBackgroundBandwidth, 0, 0};
+
+void SdArbiter_Init(void) {
+	SdArbiter_Lock = xSemaphoreCreateMutex();
+	SdArbiter_BudgetLock = xSemaphoreCreateMutex();
+	SdArbiter_LastRefill = millis();
+}
+
+// Called by the audio task before audio->loop()
+void SdArbiter_AudioBegin(void) {
+	xSemaphoreTake(SdArbiter_Lock, portMAX_DELAY);
+}
+
+// Called by the audio task after audio->loop(). _reading tells if the decoder plays a file from the SD card.
+void SdArbiter_AudioEnd(bool _reading, uint32_t _inBufferFilled, uint32_t _inBufferSize) {
+	xSemaphoreGive(SdArbiter_Lock);
+	if (_reading) {
+		SdArbiter_LastAudioRead = millis();
+		SdArbiter_AudioHungry = (_inBufferSize > 0) && (_inBufferFilled < _inBufferSize / 2);
+	} else {
+		SdArbiter_AudioHungry = false;
+	}
+}
+
+static bool SdArbiter_AudioActive(void) {
+	return (millis() - SdArbiter_LastAudioRead) < sdArbiterAudioTimeout;
+}
+
+// Blocks until a background client may access _bytes on the SD card. Must be followed by SdArbiter_BackgroundEnd().
+void SdArbiter_BackgroundBegin(size_t _bytes) {
+	if (SdArbiter_AudioActive()) {
+		// give the decoder the chance to refill its input buffer first
+		const uint32_t yieldStart = millis();
+		while (SdArbiter_AudioHungry && SdArbiter_AudioActive() && (millis() - yieldStart) < sdArbiterMaxYield) {
+			vTaskDelay(portTICK_PERIOD_MS * 2);
+		}
+		const uint32_t yieldedMs = millis() - yieldStart;
+
+		// refill the budget and book _bytes at once, so concurrent clients queue up behind each other's debt
+		xSemaphoreTake(SdArbiter_BudgetLock, portMAX_DELAY);
+		const int32_t burst = sdBackgroundBandwidth / 4;
+		const uint32_t now = millis();
+		if ((int32_t) (now - SdArbiter_LastRefill) > 0) {
+			const int64_t refill = (int64_t) (now - SdArbiter_LastRefill) * sdBackgroundBandwidth / 1000;
+			SdArbiter_Tokens = std::min<int64_t>(SdArbiter_Tokens + refill, burst);
+			SdArbiter_LastRefill = now;
+		}
+		uint32_t waitMs = 0;
+		if (SdArbiter_Tokens < 0) {
+			// overdrawn by earlier accesses: wait till they are paid back
+			waitMs = (int64_t) -SdArbiter_Tokens * 1000 / sdBackgroundBandwidth + 1;
+		}
+		SdArbiter_Tokens -= (int32_t) _bytes;
+		SdArbiter_Stats.yieldedMs += yieldedMs;
+		SdArbiter_Stats.throttledMs += waitMs;
+		xSemaphoreGive(SdArbiter_BudgetLock);
+		if (waitMs) {
+			vTaskDelay(portTICK_PERIOD_MS * waitMs);
+		}
+	} else {
+		// nobody is competing, start with a full budget once audio starts
+		xSemaphoreTake(SdArbiter_BudgetLock, portMAX_DELAY);
+		SdArbiter_Tokens = sdBackgroundBandwidth / 4;
+		SdArbiter_LastRefill = millis();
+		xSemaphoreGive(SdArbiter_BudgetLock);
+	}
+	xSemaphoreTake(SdArbiter_Lock, portMAX_DELAY);
+}
+
+void SdArbiter_BackgroundEnd(void) {
+	xSemaphoreGive(SdArbiter_Lock);
+}
+
+sdArbiterStats SdArbiter_GetStats(void) {
+	xSemaphoreTake(SdArbiter_BudgetLock, portMAX_DELAY);
+	const sdArbiterStats stats = SdArbiter_Stats;
+	xSemaphoreGive(SdArbiter_BudgetLock);
+	return stats;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t bandwidth; // bytes/s background clients may use while audio reads from the SD card
+	uint32_t throttledMs; // background clients waited for the budget
+	uint32_t yieldedMs; // background clients waited, because the input buffer of the audio decoder ran low
+} sdArbiterStats;
+
+void SdArbiter_Init(void);
+void SdArbiter_AudioBegin(void);
+void SdArbiter_AudioEnd(bool _reading, uint32_t _inBufferFilled, uint32_t _inBufferSize);
+void SdArbiter_BackgroundBegin(size_t _bytes);
+void SdArbiter_BackgroundEnd(void);
+sdArbiterStats SdArbiter_GetStats(void);
@@ -3,12 +3,21 @@
 
 #include "SdCard.h"
 
+#include "AudioPlayer.h"
 #include "Common.h"
+#include "EnumUtils.h"
+#include "Hash.h"
 #include "Led.h"
 #include "Log.h"
+#include "M3u.h"
 #include "MemX.h"
+#include "SdArbiter.h"
 #include "System.h"
 
+#include <ff.h>
+#include <freertos/task.h>
+#include <vfs_api.h>
+
 #ifdef SD_MMC_1BIT_MODE
 fs::FS gFSystem = (fs::FS) SD_MMC;
 #else
@@ -16,6 +25,43 @@ SPIClass spiSD(HSPI);
 fs::FS gFSystem = (fs::FS) SD;
 #endif
 
+// The audio library opens the files it plays itself, it can't be handed a File. But it opens them through the
+// fs::FS it's given: this one hands out the file opened by SdCard_Prefetch() when it's opened for reading, so the
+// directory lookup and the first sector of the next track are read while the current one is still playing.
+class SdCardPrefetchImpl : public VFSImpl {
+public:
+	FileImplPtr open(const char *_path, const char *_mode, const bool _create) override {
+		if (file && !strcmp(_mode, FILE_READ) && !strcmp(path, _path)) {
+			FileImplPtr prefetched = std::move(file);
+			prefetched->seek(0, SeekSet);
+			return prefetched;
+		}
+		return VFSImpl::open(_path, _mode, _create);
+	}
+	bool exists(const char *_path) override {
+		return (file && !strcmp(path, _path)) || VFSImpl::exists(_path);
+	}
+	bool prefetch(const char *_path) {
+		file.reset();
+		FileImplPtr f = VFSImpl::open(_path, FILE_READ, false);
+		if (!f || !*f || f->isDirectory()) {
+			return false;
+		}
+		uint8_t header[10]; // e.g. the ID3 header, its sector stays in the buffer of the file
+		f->read(header, sizeof(header));
+		strncpy(path, _path, sizeof(path) - 1);
+		path[sizeof(path) - 1] = '\0';
+		file = std::move(f);
+		return true;
+	}
+
+	FileImplPtr file;
+	char path[Playlist::maxPathLength];
+};
+
+static std::shared_ptr<SdCardPrefetchImpl> SdCard_PrefetchImpl = std::make_shared<SdCardPrefetchImpl>();
+fs::FS gFSystemPrefetch = fs::FS(SdCard_PrefetchImpl);
+
 void SdCard_Init(void) {
 #ifdef NO_SDCARD
 	// Initialize without any SD card, e.g. for webplayer only
@@ -51,6 +97,22 @@ void SdCard_Init(void) {
 		}
 #endif
 	}
+#ifdef SD_MMC_1BIT_MODE
+	SdCard_PrefetchImpl->mountpoint("/sdcard");
+#else
+	SdCard_PrefetchImpl->mountpoint("/sd");
+#endif
+}
+
+// Opens a file ahead of time, the next time it's opened through gFSystemPrefetch the open file is used.
+// Returns false if it can't be opened.
+bool SdCard_Prefetch(const char *_path) {
+	return SdCard_PrefetchImpl->prefetch(_path);
+}
+
+// Closes the file opened by SdCard_Prefetch() if it wasn't used
+void SdCard_DropPrefetch(void) {
+	SdCard_PrefetchImpl->file.reset();
 }
 
 void SdCard_Exit(void) {
@@ -93,6 +155,20 @@ uint64_t SdCard_GetFreeSize() {
 #endif
 }
 
+// Size of a cluster of the mounted FAT volume: writes of whole clusters are the cheapest for the card
+size_t SdCard_GetClusterSize(void) {
+	FATFS *fs;
+	DWORD freeClusters;
+	if (f_getfree("0:", &freeClusters, &fs) != FR_OK || !fs) {
+		return 16384u; // typical for SDHC cards
+	}
+#if FF_MAX_SS != FF_MIN_SS
+	return fs->csize * fs->ssize;
+#else
+	return fs->csize * FF_MAX_SS;
+#endif
+}
+
 void SdCard_PrintInfo() {
 	// show SD card type
 	sdcard_type_t cardType = SdCard_GetType();
@@ -202,8 +278,38 @@ bool fileValid(const char *_fileItem) {
 	return false;
 }
 
+#ifdef SUBDIRECTORY_CACHE_ENABLE
+// Subdirectories of the directory used last for picking a random subdirectory
+static Playlist *SdCard_SubdirCache = nullptr;
+static String SdCard_SubdirCacheDir;
+static uint32_t SdCard_SubdirCacheGeneration = 0;
+static volatile uint32_t SdCard_DirGeneration = 0; // incremented whenever directories are changed
+
+// Has to be called whenever directories are created, renamed or deleted
+void SdCard_InvalidateSubdirectoryCache(void) {
+	SdCard_DirGeneration++;
+}
+
+static bool SdCard_SubdirCacheValid(const char *_directory) {
+	return SdCard_SubdirCache && SdCard_SubdirCacheGeneration == SdCard_DirGeneration && SdCard_SubdirCacheDir == _directory;
+}
+#else
+void SdCard_InvalidateSubdirectoryCache(void) { }
+#endif
+
 // Takes a directory as input and returns a random subdirectory from it
 const String SdCard_pickRandomSubdirectory(const char *_directory) {
+#ifdef SUBDIRECTORY_CACHE_ENABLE
+	if (SdCard_SubdirCacheValid(_directory)) {
+		const Playlist::Path picked = SdCard_SubdirCache->at(esp_random() % SdCard_SubdirCache->size());
+		if (gFSystem.exists(picked.c_str())) {
+			Log_Printf(LOGLEVEL_NOTICE, pickedRandomDir, picked.c_str());
+			return String(picked.c_str());
+		}
+		// changed behind our back (e.g. via FTP), scan again
+		SdCard_InvalidateSubdirectoryCache();
+	}
+#endif
 	// Look if folder requested really exists and is a folder. If not => break.
 	File directory = gFSystem.open(_directory);
 	if (!directory || !directory.isDirectory()) {
@@ -212,7 +318,12 @@ const String SdCard_pickRandomSubdirectory(const char *_directory) {
 	}
 	Log_Printf(LOGLEVEL_NOTICE, tryToPickRandomDir, _directory);
 
-	// iterate through and count all dirs
+#ifdef SUBDIRECTORY_CACHE_ENABLE
+	const uint32_t generation = SdCard_DirGeneration;
+	Playlist *subdirs = new Playlist(directory.path());
+#endif
+	// single pass reservoir sampling: the n-th subdirectory replaces the pick with probability 1/n
+	String picked;
 	size_t dirCount = 0;
 	while (1) {
 		bool isDir;
@@ -220,91 +331,408 @@ const String SdCard_pickRandomSubdirectory(const char *_directory) {
 		if (name.isEmpty()) {
 			break;
 		}
-		if (isDir) {
-			dirCount++;
+		if (!isDir || name.substring(name.lastIndexOf('/') + 1).startsWith(".")) {
+			// skip files and hidden directories (e.g. cacheDir)
+			continue;
+		}
+		dirCount++;
+		if (esp_random() % dirCount == 0) {
+			picked = name;
 		}
+#ifdef SUBDIRECTORY_CACHE_ENABLE
+		if (subdirs && !subdirs->push_back(name.c_str())) {
+			// not enough memory for the cache, we can live without
+			freePlaylist(subdirs);
+			subdirs = nullptr;
+		}
+#endif
 	}
-	if (!dirCount) {
-		// no paths in folder
-		return String();
+
+#ifdef SUBDIRECTORY_CACHE_ENABLE
+	freePlaylist(SdCard_SubdirCache);
+	SdCard_SubdirCache = nullptr;
+	if (subdirs && dirCount) {
+		subdirs->shrink_to_fit();
+		SdCard_SubdirCache = subdirs;
+		SdCard_SubdirCacheDir = _directory;
+		SdCard_SubdirCacheGeneration = generation;
+	} else {
+		freePlaylist(subdirs);
+	}
+#endif
+	if (dirCount) {
+		Log_Printf(LOGLEVEL_NOTICE, pickedRandomDir, picked.c_str());
 	}
+	// empty if there are no subdirectories
+	return picked;
+}
 
-	const uint32_t randomNumber = esp_random() % dirCount;
-	directory.rewindDirectory();
-	dirCount = 0;
-	while (1) {
+static bool SdCard_allocAndSave(Playlist *playlist, const char *s) {
+	if (!playlist->push_back(s)) {
+		// OOM, free playlist and return
+		Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+		freePlaylist(playlist);
+		return false;
+	}
+	return true;
+};
+
+// Cheap fingerprint of a directory's content, used to detect stale playlist indexes
+struct SdCard_IndexStamp {
+	uint32_t dirEntries; // number of entries (files & directories)
+	uint32_t nameHash; // sum of the FNV-1a hashes of all entry names
+	uint32_t dirMtime; // last write time of the directory
+
+	bool operator==(const SdCard_IndexStamp &other) const {
+		return dirEntries == other.dirEntries && nameHash == other.nameHash && dirMtime == other.dirMtime;
+	}
+};
+
+// Enumerates all valid audio files of a directory into the playlist.
+// The validation stamp (number of entries, hash over all names, mtime) is computed on the way, without a
+// playlist only the stamp is computed (a walk over the names, no allocations per entry or sorting).
+// Returns false on OOM, the playlist is freed in that case.
+static bool SdCard_ScanDirectory(File &directory, Playlist *playlist, SdCard_IndexStamp &stamp, size_t &hiddenFiles) {
+	stamp.dirEntries = 0;
+	stamp.nameHash = 0;
+	stamp.dirMtime = directory.getLastWrite();
+	hiddenFiles = 0;
+	while (true) {
 		bool isDir;
 		const String name = directory.getNextFileName(&isDir);
 		if (name.isEmpty()) {
 			break;
 		}
-		if (isDir) {
-			if (dirCount == randomNumber) {
-				return name;
+		// order independent, so the stamp doesn't depend on the FAT order of the entries
+		stamp.dirEntries++;
+		stamp.nameHash += Hash_Fnv1aStr(name.c_str());
+		if (isDir || !playlist) {
+			continue;
+		}
+		// Don't support filenames that start with "." and only allow .mp3 and other supported audio file formats
+		if (fileValid(name.c_str())) {
+			// save it to the playlist
+			if (!SdCard_allocAndSave(playlist, name.c_str())) {
+				// OOM, function already took care of house cleaning
+				return false;
 			}
-			dirCount++;
+		} else {
+			hiddenFiles++;
 		}
 	}
+	return true;
+}
+
+#ifdef PLAYLIST_INDEX_ENABLE
+// On-card index of a directory playlist: header, directory path and the packed, sorted basenames
+static constexpr uint32_t indexMagic = 0x58495045; // "EPIX"
+static constexpr uint16_t indexVersion = 1;
+
+struct SdCard_IndexHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t sortMode; // playlistSortMode the entries are sorted with
+	uint8_t reserved;
+	SdCard_IndexStamp stamp;
+	uint32_t entryCount;
+	uint32_t dirPathLen; // length of the directory path following the header (incl. '\0')
+	uint32_t poolSize; // length of the packed basenames following the path
+};
 
-	// if we reached here, something went wrong
-	return String();
+static TaskHandle_t SdCard_IndexTaskHandle = NULL;
+static bool SdCard_IndexesPruned = false; // orphaned index files are removed once per boot
+
+// Returns the name of the index file for a directory
+static String SdCard_IndexFileName(const char *_directory) {
+	char name[32];
+	snprintf(name, sizeof(name), "/idx/%08x.idx", Hash_Fnv1aStr(_directory));
+	return String(cacheDir) + name;
 }
 
-static bool SdCard_allocAndSave(Playlist *playlist, const String &s) {
-	const size_t len = s.length() + 1;
-	char *entry = static_cast<char *>(x_malloc(len));
-	if (!entry) {
-		// OOM, free playlist and return
-		Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+static bool SdCard_ReadIndexHeader(File &f, SdCard_IndexHeader &header) {
+	if (f.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (header.magic != indexMagic || header.version != indexVersion || !header.dirPathLen) {
+		return false;
+	}
+	return (sizeof(header) + header.dirPathLen + header.poolSize) == f.size();
+}
+
+// Restores a directory playlist from its index, if the stamp of the directory still matches the one of
+// the index. Otherwise SdCard_RefreshPlaylistIndex() has to rebuild it.
+static std::optional<Playlist *> SdCard_LoadPlaylistIndex(File &_directory) {
+	const char *dirPath = _directory.path();
+	File f = gFSystem.open(SdCard_IndexFileName(dirPath));
+	if (!f) {
+		return std::nullopt;
+	}
+	SdCard_IndexHeader header;
+	if (!SdCard_ReadIndexHeader(f, header)) {
+		return std::nullopt;
+	}
+	SdCard_IndexStamp stamp;
+	size_t hiddenFiles;
+	SdCard_ScanDirectory(_directory, nullptr, stamp, hiddenFiles);
+	_directory.rewindDirectory();
+	if (!(header.stamp == stamp)) {
+		// files were added, removed or renamed
+		Log_Printf(LOGLEVEL_DEBUG, playlistIndexStale, dirPath);
+		return std::nullopt;
+	}
+	// read path & names with a single block read
+	const size_t dataSize = header.dirPathLen + header.poolSize;
+	char *data = static_cast<char *>(x_malloc(dataSize));
+	if (!data) {
+		return std::nullopt;
+	}
+	if (f.read(reinterpret_cast<uint8_t *>(data), dataSize) != dataSize || data[header.dirPathLen - 1] != '\0' || strcmp(data, dirPath) != 0) {
+		// corrupt or the index of another directory with the same hash
+		free(data);
+		return std::nullopt;
+	}
+	Playlist *playlist = new Playlist(dirPath);
+	if (!playlist->reserve(header.entryCount, header.entryCount ? header.poolSize / header.entryCount : 0)) {
+		free(data);
 		freePlaylist(playlist);
+		return std::nullopt;
+	}
+	const char *name = data + header.dirPathLen;
+	const char *end = data + dataSize;
+	for (uint32_t i = 0; i < header.entryCount && name < end; i++) {
+		playlist->push_back_relative(name);
+		name += strnlen(name, end - name) + 1;
+	}
+	free(data);
+	if (playlist->size() != header.entryCount) {
+		freePlaylist(playlist);
+		return std::nullopt;
+	}
+	// only skip sorting if the index was sorted the way we would sort it now
+	playlist->setSorted(header.sortMode == EnumUtils::underlying_value(AudioPlayer_GetPlaylistSortMode()));
+	return playlist;
+}
+
+static bool SdCard_WritePlaylistIndex(const String &_indexFile, const char *_directory, const Playlist *playlist, const SdCard_IndexStamp &stamp) {
+	const size_t baseLen = strlen(playlist->basePath());
+	SdCard_IndexHeader header = {};
+	header.magic = indexMagic;
+	header.version = indexVersion;
+	header.sortMode = EnumUtils::underlying_value(AudioPlayer_GetPlaylistSortMode());
+	header.stamp = stamp;
+	header.entryCount = playlist->size();
+	header.dirPathLen = strlen(_directory) + 1;
+	for (const auto &path : *playlist) {
+		header.poolSize += strlen(path.c_str() + baseLen) + 1;
+	}
+
+	SdArbiter_BackgroundBegin(sizeof(header) + header.dirPathLen + header.poolSize);
+	gFSystem.mkdir(cacheDir);
+	gFSystem.mkdir(String(cacheDir) + "/idx");
+	// write to a temporary file first, a power loss must not leave a broken index behind
+	const String tmpFile = _indexFile + ".tmp";
+	File f = gFSystem.open(tmpFile, FILE_WRITE);
+	if (!f) {
+		SdArbiter_BackgroundEnd();
 		return false;
 	}
-	s.toCharArray(entry, len);
-	playlist->push_back(entry);
-	return true;
-};
+	bool ok = f.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) == sizeof(header);
+	ok &= f.write(reinterpret_cast<const uint8_t *>(_directory), header.dirPathLen) == header.dirPathLen;
+	for (const auto &path : *playlist) {
+		const char *name = path.c_str() + baseLen;
+		const size_t len = strlen(name) + 1;
+		ok &= f.write(reinterpret_cast<const uint8_t *>(name), len) == len;
+	}
+	f.close();
+	if (ok) {
+		gFSystem.remove(_indexFile);
+		ok = gFSystem.rename(tmpFile, _indexFile);
+	}
+	if (!ok) {
+		gFSystem.remove(tmpFile);
+	}
+	SdArbiter_BackgroundEnd();
+	return ok;
+}
 
-static std::optional<Playlist *> SdCard_ParseM3UPlaylist(File f, bool forceExtended = false) {
-	const String line = f.readStringUntil('\n');
-	const bool extended = line.startsWith("#EXTM3U") || forceExtended;
-	Playlist *playlist = new Playlist();
+// Removes index files of directories which don't exist anymore and leftovers of interrupted writes
+static void SdCard_PrunePlaylistIndexes(void) {
+	File idxDir = gFSystem.open(String(cacheDir) + "/idx");
+	if (!idxDir || !idxDir.isDirectory()) {
+		return;
+	}
+	uint32_t removed = 0;
+	while (true) {
+		bool isDir;
+		const String name = idxDir.getNextFileName(&isDir);
+		if (name.isEmpty()) {
+			break;
+		}
+		if (isDir) {
+			continue;
+		}
+		bool orphaned = !name.endsWith(".idx");
+		if (!orphaned) {
+			File f = gFSystem.open(name);
+			SdCard_IndexHeader header;
+			char dirPath[Playlist::maxPathLength];
+			if (f && SdCard_ReadIndexHeader(f, header) && header.dirPathLen <= sizeof(dirPath) && f.read(reinterpret_cast<uint8_t *>(dirPath), header.dirPathLen) == header.dirPathLen) {
+				dirPath[header.dirPathLen - 1] = '\0';
+				orphaned = !gFSystem.exists(dirPath);
+			} else {
+				orphaned = true; // unreadable or an old version
+			}
+		}
+		if (orphaned && gFSystem.remove(name)) {
+			removed++;
+		}
+	}
+	if (removed) {
+		Log_Printf(LOGLEVEL_INFO, playlistIndexPruned, removed);
+	}
+}
 
-	// reserve a sane amount of memory to reduce heap fragmentation
-	playlist->reserve(64);
-	if (extended) {
-		// extended m3u file format
-		// ignore all lines starting with '#'
-
-		while (f.available()) {
-			String line = f.readStringUntil('\n');
-			if (!line.startsWith("#")) {
-				// this something we have to save
-				line.trim();
-				// save string
-				if (!SdCard_allocAndSave(playlist, line)) {
-					return std::nullopt;
+// Task (re)building the index of a directory if it's missing or stale and pruning the orphaned ones.
+// parameter contains the directory path (nullptr: only prune) and must be freed by the task.
+static void SdCard_PlaylistIndexTask(void *parameter) {
+	const char *dirPath = static_cast<const char *>(parameter);
+	// give the audio task a head start, it has to fill its buffers first
+	vTaskDelay(portTICK_PERIOD_MS * 2000u);
+
+	File directory = (dirPath) ? gFSystem.open(dirPath) : File();
+	if (directory && directory.isDirectory()) {
+		const uint32_t start = millis();
+		Playlist *playlist = new Playlist(dirPath);
+		SdCard_IndexStamp stamp;
+		size_t hiddenFiles;
+		if (SdCard_ScanDirectory(directory, playlist, stamp, hiddenFiles)) {
+			const String indexFile = SdCard_IndexFileName(dirPath);
+			SdCard_IndexHeader header;
+			File f = gFSystem.open(indexFile);
+			const bool valid = f && SdCard_ReadIndexHeader(f, header) && header.stamp == stamp && header.sortMode == EnumUtils::underlying_value(AudioPlayer_GetPlaylistSortMode());
+			f.close();
+			if (!valid) {
+				AudioPlayer_SortPlaylist(playlist);
+				if (SdCard_WritePlaylistIndex(indexFile, dirPath, playlist, stamp)) {
+					Log_Printf(LOGLEVEL_INFO, playlistIndexWritten, dirPath, playlist->size(), millis() - start);
+				} else {
+					Log_Printf(LOGLEVEL_ERROR, playlistIndexWriteFailed, indexFile.c_str());
 				}
 			}
+			freePlaylist(playlist);
 		}
-		// resize std::vector memory to fit our count
-		playlist->shrink_to_fit();
-		return playlist;
 	}
+	directory.close();
+	if (!SdCard_IndexesPruned) {
+		// directories might have been deleted meanwhile (e.g. from a PC)
+		SdCard_IndexesPruned = true;
+		SdCard_PrunePlaylistIndexes();
+	}
+	free(parameter);
+	SdCard_IndexTaskHandle = NULL;
+	vTaskDelete(NULL);
+}
+
+// Validates (and if necessary rebuilds) the index of a directory in the background. Without a directory
+// only the orphaned index files are removed.
+static void SdCard_RefreshPlaylistIndex(const char *_directory) {
+	if (SdCard_IndexTaskHandle != NULL) {
+		// already busy, the next request will catch up
+		return;
+	}
+	char *dirPath = nullptr;
+	if (_directory) {
+		dirPath = x_strdup(_directory);
+		if (!dirPath) {
+			return;
+		}
+	}
+	if (xTaskCreatePinnedToCore(
+			SdCard_PlaylistIndexTask, /* Function to implement the task */
+			"sdIndexTask", /* Name of the task */
+			3000, /* Stack size in words */
+			dirPath, /* Task input parameter */
+			1, /* Priority of the task */
+			&SdCard_IndexTaskHandle, /* Task handle. */
+			0 /* Core where the task should run */
+			)
+		!= pdPASS) {
+		free(dirPath);
+		SdCard_IndexTaskHandle = NULL;
+	}
+}
+#endif
+
+// m3u files bigger than this are indexed by line offset instead of being loaded into RAM. Every access of an
+// entry then reads the file, so this is only meant for playlists which wouldn't fit into RAM at all.
+#ifdef BOARD_HAS_PSRAM
+static constexpr size_t m3uLazyThreshold = 1024 * 1024;
+#else
+static constexpr size_t m3uLazyThreshold = 65536;
+#endif
 
-	// normal m3u is just a bunch of filenames, 1 / line
-	f.seek(0);
-	while (f.available()) {
-		String line = f.readStringUntil('\n');
-		// save string
-		if (!SdCard_allocAndSave(playlist, line)) {
+static std::optional<Playlist *> SdCard_ParseM3UPlaylist(File f) {
+	Playlist *playlist = new Playlist();
+
+	if (f.size() > m3uLazyThreshold) {
+		// big playlist, just remember where each entry starts and read it when it's played
+		if (!playlist->setSource(f.path())) {
+			Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+			freePlaylist(playlist);
+			return std::nullopt;
+		}
+		const bool ok = M3u_ForEachEntry(f, [playlist](const char *line, uint32_t offset) {
+			return playlist->push_back_offset(offset, line);
+		});
+		if (!ok) {
+			Log_Println(unableToAllocateMemForLinearPlaylist, LOGLEVEL_ERROR);
+			freePlaylist(playlist);
 			return std::nullopt;
 		}
+		playlist->shrink_to_fit();
+		Log_Printf(LOGLEVEL_NOTICE, m3uLazyIndexed, playlist->size());
+		return playlist;
 	}
-	// resize memory to fit our count
+
+	// reserve a sane amount of memory to reduce heap fragmentation
+	playlist->reserve(64);
+	const bool ok = M3u_ForEachEntry(f, [playlist](const char *line, uint32_t) {
+		// function frees the playlist on OOM
+		return SdCard_allocAndSave(playlist, line);
+	});
+	if (!ok) {
+		return std::nullopt;
+	}
+	// resize pool memory to fit our count
 	playlist->shrink_to_fit();
 	return playlist;
 }
 
+bool SdCard_ReadPlaylistEntries(const char *_source, const std::function<bool(const char *, uint32_t)> &_onEntry) {
+	File f = gFSystem.open(_source);
+	if (!f) {
+		return false;
+	}
+	return M3u_ForEachEntry(f, _onEntry);
+}
+
+// Reads a single entry of a m3u playlist which was indexed by line offsets
+bool SdCard_ReadPlaylistEntry(const char *_source, uint32_t _offset, char *_buf, size_t _bufLen) {
+	File f = gFSystem.open(_source);
+	if (!f || !f.seek(_offset)) {
+		return false;
+	}
+	const size_t bytesRead = f.read(reinterpret_cast<uint8_t *>(_buf), _bufLen - 1);
+	_buf[bytesRead] = '\0';
+	// the entry ends at the end of the line
+	_buf[strcspn(_buf, "\r\n")] = '\0';
+	size_t len = strlen(_buf);
+	while (len > 0 && isspace(static_cast<uint8_t>(_buf[len - 1]))) {
+		_buf[--len] = '\0';
+	}
+	return len > 0;
+}
+
 /* Puts SD-file(s) or directory into a playlist
 	First element of array always contains the number of payload-items. */
 std::optional<Playlist *> SdCard_ReturnPlaylist(const char *fileName, const uint32_t _playMode) {
@@ -327,10 +755,10 @@ std::optional<Playlist *> SdCard_ReturnPlaylist(const char *fileName, const uint
 
 	// if we reach here, this was not a m3u
 	Log_Println(playlistGen, LOGLEVEL_NOTICE);
-	Playlist *playlist = new Playlist;
 
 	// File-mode
 	if (!fileOrDirectory.isDirectory()) {
+		Playlist *playlist = new Playlist();
 		if (!SdCard_allocAndSave(playlist, fileOrDirectory.path())) {
 			// OOM, function already took care of house cleaning
 			return std::nullopt;
@@ -339,27 +767,29 @@ std::optional<Playlist *> SdCard_ReturnPlaylist(const char *fileName, const uint
 	}
 
 	// Directory-mode (linear-playlist)
-	playlist->reserve(64); // reserve a sane amount of memory to reduce the number of reallocs
-	size_t hiddenFiles = 0;
-	while (true) {
-		bool isDir;
-		const String name = fileOrDirectory.getNextFileName(&isDir);
-		if (name.isEmpty()) {
-			break;
-		}
-		if (isDir) {
-			continue;
-		}
-		// Don't support filenames that start with "." and only allow .mp3 and other supported audio file formats
-		if (fileValid(name.c_str())) {
-			// save it to the vector
-			if (!SdCard_allocAndSave(playlist, name)) {
-				// OOM, function already took care of house cleaning
-				return std::nullopt;
-			}
-		} else {
-			hiddenFiles++;
+#ifdef PLAYLIST_INDEX_ENABLE
+	std::optional<Playlist *> indexed = SdCard_LoadPlaylistIndex(fileOrDirectory);
+	if (indexed) {
+		Log_Printf(LOGLEVEL_NOTICE, playlistFromIndex, indexed.value()->size());
+		if (!indexed.value()->isSorted()) {
+			// the sort mode was changed, store the new order
+			SdCard_RefreshPlaylistIndex(fileOrDirectory.path());
+		} else if (!SdCard_IndexesPruned) {
+			SdCard_RefreshPlaylistIndex(nullptr);
 		}
+		return indexed;
+	}
+	// missing or stale: rebuild it in background, this keeps sorting and writing out of the tap-to-play path
+	SdCard_RefreshPlaylistIndex(fileOrDirectory.path());
+#endif
+	// all files share the directory as base path, so only their basenames end up in the pool
+	Playlist *playlist = new Playlist(fileOrDirectory.path());
+	playlist->reserve(64); // reserve a sane amount of memory to reduce the number of reallocs
+	SdCard_IndexStamp stamp;
+	size_t hiddenFiles;
+	if (!SdCard_ScanDirectory(fileOrDirectory, playlist, stamp, hiddenFiles)) {
+		// OOM, function already took care of house cleaning
+		return std::nullopt;
 	}
 	playlist->shrink_to_fit();
 
@@ -7,14 +7,19 @@
 #endif
 
 extern fs::FS gFSystem;
+extern fs::FS gFSystemPrefetch; // gFSystem, using the file opened by SdCard_Prefetch()
 
 #include "Playlist.h"
 
 void SdCard_Init(void);
 void SdCard_Exit(void);
+bool SdCard_Prefetch(const char *_path);
+void SdCard_DropPrefetch(void);
 sdcard_type_t SdCard_GetType(void);
 uint64_t SdCard_GetSize();
 uint64_t SdCard_GetFreeSize();
+size_t SdCard_GetClusterSize(void);
 void SdCard_PrintInfo();
 std::optional<Playlist *> SdCard_ReturnPlaylist(const char *fileName, const uint32_t _playMode);
 const String SdCard_pickRandomSubdirectory(const char *_directory);
+void SdCard_InvalidateSubdirectoryCache(void);
@@ -0,0 +1,582 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SeekIndex.h"
+
+#include "Hash.h"
+#include "Log.h"
+#include "MemX.h"
+#include "Mp3Header.h"
+#include "SdArbiter.h"
+#include "SdCard.h"
+
+#include <algorithm>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <vector>
+
+#ifdef SEEK_INDEX_ENABLE
+// Maps play time to byte positions (and back) for the mp3 that is currently playing. With VBR files the
+// audio library can only estimate positions from the average bitrate, so jumps land seconds off and the
+// progress drifts. The table is derived from the VBRI table if the file has one, CBR files get a linear mapping.
+// Otherwise a low priority task walks all frame headers once and stores a sparse table (every n-th frame)
+// in cacheDir, so the next time the file is played the table is there at once. A Xing TOC is used while walking.
+// Between two entries the position is interpolated, the decoder syncs to the next frame after the jump.
+// The cached tables are named by path, size and mtime of the mp3. Only the most recently built ones are kept.
+static constexpr uint32_t seekIndexMagic = 0x58495345; // "ESIX"
+static constexpr uint16_t seekIndexVersion = 2;
+static constexpr uint16_t seekIndexMaxEntries = 1024; // 4 KiB, one entry per ~2 min for a 30 h file
+static constexpr uint32_t seekIndexMinInterval = 38; // frames between two entries (~1 s at 44.1 kHz)
+static constexpr size_t seekIndexReadSize = 4096;
+static constexpr uint32_t seekIndexMaxResync = 4096; // bytes of garbage between frames before giving up
+static constexpr size_t seekIndexMaxFiles = 100; // cached tables, the oldest are removed
+static constexpr uint32_t seekIndexReadPause = 2; // ms after each read while walking, SdArbiter throttles the reads while audio plays
+
+struct SeekIndex_Header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count; // offsets following the header
+	uint32_t pathHash;
+	uint32_t fileSize; // of the mp3, a replaced file is noticed by its size and mtime
+	uint32_t fileMtime;
+	uint32_t sampleRate;
+	uint32_t samplesPerEntry; // entry i is the frame playing at sample i * samplesPerEntry
+	uint64_t totalSamples;
+	uint32_t audioEnd; // byte after the last frame
+};
+
+struct SeekIndex_Table {
+	SeekIndex_Header header;
+	uint32_t *offsets;
+};
+
+static TaskHandle_t SeekIndex_TaskHandle = NULL;
+static SemaphoreHandle_t SeekIndex_Mutex = NULL; // guards the fields below
+static String SeekIndex_PendingTrack; // to be indexed by the task
+static uint32_t SeekIndex_Generation = 0; // incremented for every track, stops an outdated walk
+static SeekIndex_Table SeekIndex_Current = {};
+
+static uint32_t SeekIndex_Be32(const uint8_t *b) {
+	return (static_cast<uint32_t>(b[0]) << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+}
+
+static uint16_t SeekIndex_Be16(const uint8_t *b) {
+	return (b[0] << 8) | b[1];
+}
+
+static String SeekIndex_CachePath(const SeekIndex_Header &_header) {
+	uint32_t key = Hash_Fnv1a(&_header.fileSize, sizeof(_header.fileSize), _header.pathHash);
+	key = Hash_Fnv1a(&_header.fileMtime, sizeof(_header.fileMtime), key);
+	char name[20];
+	snprintf(name, sizeof(name), "/seek-%08x.idx", key);
+	return String(cacheDir) + name;
+}
+
+static bool SeekIndex_IsCurrent(uint32_t _generation) {
+	return _generation == SeekIndex_Generation;
+}
+
+// Hands the table over to the lookups, if the track didn't change meanwhile. Takes ownership of the offsets.
+static void SeekIndex_Publish(SeekIndex_Table &_table, uint32_t _generation) {
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	if (SeekIndex_IsCurrent(_generation)) {
+		free(SeekIndex_Current.offsets);
+		SeekIndex_Current = _table;
+	} else {
+		free(_table.offsets);
+	}
+	xSemaphoreGive(SeekIndex_Mutex);
+	_table.offsets = nullptr;
+}
+
+static bool SeekIndex_Alloc(SeekIndex_Table &_table, uint16_t _count) {
+	_table.offsets = static_cast<uint32_t *>(x_malloc(sizeof(uint32_t) * _count));
+	_table.header.count = _count;
+	return _table.offsets != nullptr;
+}
+
+// Start of the first frame behind an ID3v2 tag
+static bool SeekIndex_FindFirstFrame(File &f, uint32_t &_pos, Mp3FrameInfo &_info) {
+	uint8_t buf[512];
+	uint32_t start = 0;
+	if (f.read(buf, 10) == 10 && memcmp(buf, "ID3", 3) == 0) {
+		start = 10 + (((buf[6] & 0x7f) << 21) | ((buf[7] & 0x7f) << 14) | ((buf[8] & 0x7f) << 7) | (buf[9] & 0x7f));
+		if (buf[5] & 0x10) {
+			start += 10; // footer
+		}
+	}
+	if (!f.seek(start)) {
+		return false;
+	}
+	const size_t len = f.read(buf, sizeof(buf));
+	for (size_t i = 0; i + 4 <= len; i++) {
+		if (Mp3_ParseFrameHeader(buf + i, _info)) {
+			_pos = start + i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Size of the file without a trailing ID3v1 tag
+static uint32_t SeekIndex_AudioEnd(File &f) {
+	const uint32_t size = f.size();
+	uint8_t tag[3];
+	if (size > 128 && f.seek(size - 128) && f.read(tag, sizeof(tag)) == sizeof(tag) && memcmp(tag, "TAG", 3) == 0) {
+		return size - 128;
+	}
+	return size;
+}
+
+// Xing/Info header with frame count and TOC: 100 entries, each giving the position of a percent of the duration in 1/256 of the stream
+static bool SeekIndex_FromXing(const uint8_t *_xing, size_t _len, uint32_t _frameStart, uint32_t _audioEnd, const Mp3FrameInfo &_info, SeekIndex_Table &_table) {
+	if (_len < 16 || (memcmp(_xing, "Xing", 4) != 0 && memcmp(_xing, "Info", 4) != 0)) {
+		return false;
+	}
+	const uint32_t flags = SeekIndex_Be32(_xing + 4);
+	if ((flags & 0x05) != 0x05) {
+		// frame count and TOC are both needed
+		return false;
+	}
+	size_t pos = 8;
+	const uint32_t frames = SeekIndex_Be32(_xing + pos);
+	pos += 4;
+	uint32_t streamBytes = _audioEnd - _frameStart;
+	if (flags & 0x02) {
+		streamBytes = std::min(SeekIndex_Be32(_xing + pos), streamBytes);
+		pos += 4;
+	}
+	if (pos + 100 > _len || frames == 0 || !SeekIndex_Alloc(_table, 100)) {
+		return false;
+	}
+	uint32_t prev = _frameStart;
+	for (uint8_t i = 0; i < 100; i++) {
+		// must be ascending for the lookups
+		prev = std::max(prev, _frameStart + static_cast<uint32_t>(static_cast<uint64_t>(_xing[pos + i]) * streamBytes / 256));
+		_table.offsets[i] = prev;
+	}
+	_table.header.totalSamples = static_cast<uint64_t>(frames) * _info.samplesPerFrame;
+	_table.header.samplesPerEntry = std::max<uint64_t>(_table.header.totalSamples / 100, 1);
+	_table.header.audioEnd = _frameStart + streamBytes;
+	return true;
+}
+
+// VBRI header (Fraunhofer encoder): table of the byte sizes of fixed frame groups
+static bool SeekIndex_FromVbri(File &f, const uint8_t *_vbri, size_t _len, uint32_t _vbriPos, uint32_t _frameStart, const Mp3FrameInfo &_info, SeekIndex_Table &_table) {
+	if (_len < 26 || memcmp(_vbri, "VBRI", 4) != 0) {
+		return false;
+	}
+	const uint32_t streamBytes = SeekIndex_Be32(_vbri + 10);
+	const uint32_t frames = SeekIndex_Be32(_vbri + 14);
+	const uint16_t entries = SeekIndex_Be16(_vbri + 18);
+	const uint16_t scale = SeekIndex_Be16(_vbri + 20);
+	const uint16_t entrySize = SeekIndex_Be16(_vbri + 22);
+	const uint16_t framesPerEntry = SeekIndex_Be16(_vbri + 24);
+	if (frames == 0 || entries == 0 || entrySize == 0 || entrySize > 4 || framesPerEntry == 0) {
+		return false;
+	}
+	// keep every step-th entry if the table is larger than ours
+	const uint16_t step = (entries + seekIndexMaxEntries - 1) / seekIndexMaxEntries;
+	if (!SeekIndex_Alloc(_table, (entries + step - 1) / step) || !f.seek(_vbriPos + 26)) {
+		return false;
+	}
+	uint32_t pos = _frameStart;
+	uint8_t buf[4];
+	for (uint16_t i = 0; i < entries; i++) {
+		if (i % step == 0) {
+			_table.offsets[i / step] = pos;
+		}
+		if (f.read(buf, entrySize) != entrySize) {
+			return false;
+		}
+		uint32_t delta = 0;
+		for (uint8_t j = 0; j < entrySize; j++) {
+			delta = (delta << 8) | buf[j];
+		}
+		pos += delta * scale;
+	}
+	_table.header.totalSamples = static_cast<uint64_t>(frames) * _info.samplesPerFrame;
+	_table.header.samplesPerEntry = static_cast<uint32_t>(step) * framesPerEntry * _info.samplesPerFrame;
+	_table.header.audioEnd = _frameStart + streamBytes;
+	return true;
+}
+
+// Two consecutive frame headers near the given position
+static bool SeekIndex_ProbeBitrate(File &f, uint32_t _pos, uint16_t &_kbps) {
+	uint8_t buf[2048];
+	if (!f.seek(_pos)) {
+		return false;
+	}
+	const size_t len = f.read(buf, sizeof(buf));
+	for (size_t i = 0; i + 4 <= len; i++) {
+		Mp3FrameInfo info, next;
+		if (Mp3_ParseFrameHeader(buf + i, info) && i + info.frameLen + 4 <= len && Mp3_ParseFrameHeader(buf + i + info.frameLen, next)) {
+			_kbps = info.kbps;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Files without VBR header are mostly CBR, that's checked with a few samples across the file
+static bool SeekIndex_FromCbr(File &f, uint32_t _frameStart, uint32_t _audioEnd, const Mp3FrameInfo &_info, SeekIndex_Table &_table) {
+	const uint32_t audioBytes = _audioEnd - _frameStart;
+	for (uint8_t percent : {25, 50, 75}) {
+		uint16_t kbps;
+		if (!SeekIndex_ProbeBitrate(f, _frameStart + audioBytes / 100 * percent, kbps) || kbps != _info.kbps) {
+			return false;
+		}
+	}
+	if (!SeekIndex_Alloc(_table, 1)) {
+		return false;
+	}
+	_table.offsets[0] = _frameStart;
+	_table.header.totalSamples = static_cast<uint64_t>(audioBytes) * 8 * _info.sampleRate / (_info.kbps * 1000u);
+	_table.header.samplesPerEntry = std::max<uint64_t>(_table.header.totalSamples, 1);
+	_table.header.audioEnd = _audioEnd;
+	return true;
+}
+
+// Walks all frame headers and records every n-th frame. When the table is full, every second entry is dropped
+// and n is doubled, so the length of the file doesn't need to be known in advance.
+static bool SeekIndex_FromFrames(File &f, uint32_t _frameStart, const Mp3FrameInfo &_info, SeekIndex_Table &_table, uint32_t _generation) {
+	uint8_t *buf = static_cast<uint8_t *>(x_malloc(seekIndexReadSize));
+	if (!buf || !SeekIndex_Alloc(_table, seekIndexMaxEntries)) {
+		free(buf);
+		return false;
+	}
+	const uint32_t fileSize = f.size();
+	uint32_t bufPos = 0;
+	uint32_t bufLen = 0;
+	uint32_t pos = _frameStart;
+	uint32_t audioEnd = _frameStart;
+	uint32_t frames = 0;
+	uint32_t interval = seekIndexMinInterval;
+	uint32_t lost = 0;
+	uint16_t count = 0;
+	bool aborted = false;
+	while (pos + 4 <= fileSize) {
+		if (pos + 4 > bufPos + bufLen) {
+			if (!SeekIndex_IsCurrent(_generation)) {
+				aborted = true;
+				break;
+			}
+			vTaskDelay(portTICK_PERIOD_MS * seekIndexReadPause);
+			SdArbiter_BackgroundBegin(seekIndexReadSize);
+			bufPos = pos;
+			bufLen = f.seek(pos) ? f.read(buf, seekIndexReadSize) : 0;
+			SdArbiter_BackgroundEnd();
+			if (bufLen < 4) {
+				break;
+			}
+		}
+		Mp3FrameInfo info;
+		if (!Mp3_ParseFrameHeader(buf + (pos - bufPos), info)) {
+			// resync after garbage between the frames, a trailing tag ends the walk
+			if (++lost > seekIndexMaxResync) {
+				break;
+			}
+			pos++;
+			continue;
+		}
+		lost = 0;
+		if (frames % interval == 0) {
+			if (count == seekIndexMaxEntries) {
+				for (uint16_t i = 0; i < seekIndexMaxEntries / 2; i++) {
+					_table.offsets[i] = _table.offsets[i * 2];
+				}
+				count = seekIndexMaxEntries / 2;
+				interval *= 2;
+			}
+			if (frames % interval == 0) {
+				_table.offsets[count++] = pos;
+			}
+		}
+		frames++;
+		pos += info.frameLen;
+		audioEnd = pos;
+	}
+	free(buf);
+	if (aborted || frames == 0) {
+		return false;
+	}
+	_table.header.count = count;
+	_table.header.totalSamples = static_cast<uint64_t>(frames) * _info.samplesPerFrame;
+	_table.header.samplesPerEntry = interval * _info.samplesPerFrame;
+	_table.header.audioEnd = std::min(audioEnd, fileSize);
+	return true;
+}
+
+static bool SeekIndex_LoadCache(const SeekIndex_Header &_expected, SeekIndex_Table &_table) {
+	File f = gFSystem.open(SeekIndex_CachePath(_expected), FILE_READ);
+	if (!f) {
+		return false;
+	}
+	SeekIndex_Header header;
+	if (f.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) || header.magic != seekIndexMagic || header.version != seekIndexVersion || header.pathHash != _expected.pathHash || header.fileSize != _expected.fileSize || header.fileMtime != _expected.fileMtime || header.count == 0 || header.count > seekIndexMaxEntries) {
+		return false;
+	}
+	const size_t bytes = sizeof(uint32_t) * header.count;
+	if (!SeekIndex_Alloc(_table, header.count) || f.read(reinterpret_cast<uint8_t *>(_table.offsets), bytes) != bytes) {
+		return false;
+	}
+	_table.header = header;
+	return true;
+}
+
+// Removes the oldest cached tables (by their mtime, i.e. when they were built) to make room for a new one. Tables
+// of files that were replaced or are gone don't match any more and leave this way as well.
+static void SeekIndex_PruneCache(void) {
+	File dir = gFSystem.open(cacheDir);
+	if (!dir || !dir.isDirectory()) {
+		return;
+	}
+	std::vector<std::pair<time_t, String>> tables;
+	for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+		if (!entry.isDirectory() && !strncmp(entry.name(), "seek-", 5)) {
+			tables.emplace_back(entry.getLastWrite(), entry.path());
+		}
+	}
+	dir.close();
+	if (tables.size() < seekIndexMaxFiles) {
+		return;
+	}
+	std::sort(tables.begin(), tables.end(), [](const std::pair<time_t, String> &a, const std::pair<time_t, String> &b) {
+		return a.first < b.first;
+	});
+	const size_t excess = tables.size() - seekIndexMaxFiles + 1;
+	uint32_t removed = 0;
+	for (size_t i = 0; i < excess; i++) {
+		if (gFSystem.remove(tables[i].second)) {
+			removed++;
+		}
+	}
+	Log_Printf(LOGLEVEL_INFO, seekIndexPruned, removed);
+}
+
+static void SeekIndex_WriteCache(const SeekIndex_Table &_table) {
+	const size_t bytes = sizeof(uint32_t) * _table.header.count;
+	SdArbiter_BackgroundBegin(sizeof(_table.header) + bytes);
+	gFSystem.mkdir(cacheDir);
+	SeekIndex_PruneCache();
+	File f = gFSystem.open(SeekIndex_CachePath(_table.header), FILE_WRITE);
+	if (f) {
+		f.write(reinterpret_cast<const uint8_t *>(&_table.header), sizeof(_table.header));
+		f.write(reinterpret_cast<const uint8_t *>(_table.offsets), bytes);
+		f.close();
+	}
+	SdArbiter_BackgroundEnd();
+}
+
+static void SeekIndex_Build(const String &_track, uint32_t _generation) {
+	const uint32_t startTimestamp = millis();
+	File f = gFSystem.open(_track, FILE_READ);
+	if (!f) {
+		return;
+	}
+	SeekIndex_Table table = {};
+	table.header.magic = seekIndexMagic;
+	table.header.version = seekIndexVersion;
+	table.header.pathHash = Hash_Fnv1aStr(_track.c_str());
+	table.header.fileSize = f.size();
+	table.header.fileMtime = f.getLastWrite();
+
+	if (SeekIndex_LoadCache(table.header, table)) {
+		SeekIndex_Publish(table, _generation);
+		return;
+	}
+	free(table.offsets);
+	table.offsets = nullptr;
+
+	uint32_t frameStart;
+	Mp3FrameInfo info;
+	if (!SeekIndex_FindFirstFrame(f, frameStart, info)) {
+		return;
+	}
+	table.header.sampleRate = info.sampleRate;
+	const uint32_t audioEnd = SeekIndex_AudioEnd(f);
+	uint8_t buf[256];
+	size_t len = 0;
+	if (f.seek(frameStart)) {
+		len = f.read(buf, sizeof(buf));
+	}
+	const uint32_t xing = info.xingOffset();
+	const uint32_t vbri = 4 + 32;
+	bool ok = false;
+	bool walked = false;
+	if (len > xing && SeekIndex_FromXing(buf + xing, len - xing, frameStart, audioEnd, info, table)) {
+		// usable at once, but only accurate to 1/256 of the file (minutes for long audiobooks), so it's refined by a walk
+		SeekIndex_Publish(table, _generation);
+		SeekIndex_Table walk = table;
+		ok = walked = SeekIndex_FromFrames(f, frameStart + info.frameLen, info, walk, _generation);
+		table = walk;
+	} else if (len > vbri && SeekIndex_FromVbri(f, buf + vbri, len - vbri, frameStart + vbri, frameStart, info, table)) {
+		ok = true;
+	} else {
+		free(table.offsets);
+		table.offsets = nullptr;
+		// a Xing/Info frame without TOC carries no audio
+		uint32_t walkStart = frameStart;
+		if (len > xing + 4 && (memcmp(buf + xing, "Xing", 4) == 0 || memcmp(buf + xing, "Info", 4) == 0)) {
+			walkStart += info.frameLen;
+		}
+		if (SeekIndex_FromCbr(f, walkStart, audioEnd, info, table)) {
+			ok = true;
+		} else {
+			free(table.offsets);
+			table.offsets = nullptr;
+			ok = walked = SeekIndex_FromFrames(f, walkStart, info, table, _generation);
+		}
+	}
+	f.close();
+	if (!ok) {
+		free(table.offsets);
+		return;
+	}
+	if (walked) {
+		SeekIndex_WriteCache(table);
+		Log_Printf(LOGLEVEL_INFO, seekIndexBuilt, table.header.count, _track.c_str(), millis() - startTimestamp);
+	}
+	SeekIndex_Publish(table, _generation);
+}
+
+static void SeekIndex_Task(void *parameter) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+		const String track = SeekIndex_PendingTrack;
+		const uint32_t generation = SeekIndex_Generation;
+		SeekIndex_PendingTrack = "";
+		xSemaphoreGive(SeekIndex_Mutex);
+		if (!track.isEmpty()) {
+			SeekIndex_Build(track, generation);
+		}
+	}
+}
+
+static bool SeekIndex_IsMp3(const char *_track) {
+	const char *ext = strrchr(_track, '.');
+	return ext && strcasecmp(ext, ".mp3") == 0;
+}
+#endif
+
+void SeekIndex_Init(void) {
+#ifdef SEEK_INDEX_ENABLE
+	SeekIndex_Mutex = xSemaphoreCreateMutex();
+	xTaskCreatePinnedToCore(
+		SeekIndex_Task, /* Function to implement the task */
+		"seekIndex", /* Name of the task */
+		3000, /* Stack size in words */
+		NULL, /* Task input parameter */
+		1, /* Priority of the task */
+		&SeekIndex_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+#endif
+}
+
+// Called when a local file was started, the index is ready in background (immediately if it's cached)
+void SeekIndex_Prepare(const char *_track) {
+#ifdef SEEK_INDEX_ENABLE
+	if (SeekIndex_TaskHandle == NULL) {
+		return;
+	}
+	SeekIndex_Clear();
+	if (!SeekIndex_IsMp3(_track)) {
+		return;
+	}
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	SeekIndex_PendingTrack = _track;
+	xSemaphoreGive(SeekIndex_Mutex);
+	xTaskNotifyGive(SeekIndex_TaskHandle);
+#endif
+}
+
+// Drops the index of the previous track (e.g. when a webstream is started)
+void SeekIndex_Clear(void) {
+#ifdef SEEK_INDEX_ENABLE
+	if (SeekIndex_Mutex == NULL) {
+		return;
+	}
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	SeekIndex_Generation++;
+	SeekIndex_PendingTrack = "";
+	free(SeekIndex_Current.offsets);
+	SeekIndex_Current = {};
+	xSemaphoreGive(SeekIndex_Mutex);
+#endif
+}
+
+bool SeekIndex_IsReady(void) {
+#ifdef SEEK_INDEX_ENABLE
+	return SeekIndex_Current.offsets != nullptr;
+#else
+	return false;
+#endif
+}
+
+// Duration of the current track in ms, 0 if there's no index
+uint32_t SeekIndex_GetDuration(void) {
+#ifdef SEEK_INDEX_ENABLE
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	const SeekIndex_Header &header = SeekIndex_Current.header;
+	const uint32_t duration = (SeekIndex_Current.offsets) ? header.totalSamples * 1000 / header.sampleRate : 0;
+	xSemaphoreGive(SeekIndex_Mutex);
+	return duration;
+#else
+	return 0;
+#endif
+}
+
+// Byte position of the frame playing at the given time. False if there's no index or the time is beyond the end.
+bool SeekIndex_TimeToByte(uint32_t _ms, uint32_t &_bytePos) {
+#ifdef SEEK_INDEX_ENABLE
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	const SeekIndex_Header &header = SeekIndex_Current.header;
+	const uint32_t *offsets = SeekIndex_Current.offsets;
+	const uint64_t sample = static_cast<uint64_t>(_ms) * header.sampleRate / 1000;
+	const bool ok = offsets && sample < header.totalSamples;
+	if (ok) {
+		const uint32_t i = std::min<uint64_t>(sample / header.samplesPerEntry, header.count - 1);
+		const uint64_t t0 = static_cast<uint64_t>(i) * header.samplesPerEntry;
+		const bool last = (i + 1u == header.count);
+		const uint64_t t1 = (last) ? header.totalSamples : t0 + header.samplesPerEntry;
+		const uint32_t b0 = offsets[i];
+		const uint32_t b1 = std::max((last) ? header.audioEnd : offsets[i + 1], b0);
+		_bytePos = b0 + ((t1 > t0) ? (b1 - b0) * (sample - t0) / (t1 - t0) : 0);
+	}
+	xSemaphoreGive(SeekIndex_Mutex);
+	return ok;
+#else
+	return false;
+#endif
+}
+
+// Play time at the given byte position, the inverse of SeekIndex_TimeToByte()
+bool SeekIndex_ByteToTime(uint32_t _bytePos, uint32_t &_ms) {
+#ifdef SEEK_INDEX_ENABLE
+	xSemaphoreTake(SeekIndex_Mutex, portMAX_DELAY);
+	const SeekIndex_Header &header = SeekIndex_Current.header;
+	const uint32_t *offsets = SeekIndex_Current.offsets;
+	const bool ok = offsets != nullptr;
+	if (ok) {
+		uint64_t sample = 0;
+		if (_bytePos >= header.audioEnd) {
+			sample = header.totalSamples;
+		} else if (_bytePos > offsets[0]) {
+			const uint32_t i = std::upper_bound(offsets, offsets + header.count, _bytePos) - offsets - 1;
+			const uint64_t t0 = static_cast<uint64_t>(i) * header.samplesPerEntry;
+			const bool last = (i + 1u == header.count);
+			const uint64_t t1 = (last) ? header.totalSamples : t0 + header.samplesPerEntry;
+			const uint32_t b0 = offsets[i];
+			const uint32_t b1 = (last) ? header.audioEnd : offsets[i + 1];
+			sample = std::min(t0 + ((b1 > b0) ? (t1 - t0) * (_bytePos - b0) / (b1 - b0) : 0), header.totalSamples);
+		}
+		_ms = sample * 1000 / header.sampleRate;
+	}
+	xSemaphoreGive(SeekIndex_Mutex);
+	return ok;
+#else
+	return false;
+#endif
+}
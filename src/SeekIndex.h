@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+void SeekIndex_Init(void);
+void SeekIndex_Prepare(const char *_track);
+void SeekIndex_Clear(void);
+bool SeekIndex_IsReady(void);
+uint32_t SeekIndex_GetDuration(void);
+bool SeekIndex_TimeToByte(uint32_t _ms, uint32_t &_bytePos);
+bool SeekIndex_ByteToTime(uint32_t _bytePos, uint32_t &_ms);
@@ -0,0 +1,342 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SpeechCache.h"
+
+#include "Log.h"
+#include "SdArbiter.h"
+#include "SdCard.h"
+#include "SpeechPhrases.h"
+#include "Wlan.h"
+
+#include <HTTPClient.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Announcements (IP address, time) are split into phrases, e.g. "It is", "7", "oh", "5", "PM". Each phrase
+// is spoken once by the online TTS service and stored on the SD card, keyed by language and text. If all
+// phrases of an announcement are there, their clips are played one after another without any network access.
+// Otherwise the online service speaks the whole sentence as before and the missing clips are fetched in
+// background, so the next announcement starts at once. All phrases can be fetched in advance (pre-warmed),
+// optionally from another TTS endpoint (e.g. a stand-in on the local network).
+#ifdef SPEECH_CACHE_ENABLE
+static constexpr char speechCacheDir[] = "/tts";
+static constexpr uint16_t speechCacheMaxPending = 300; // enough for the whole vocabulary
+static constexpr uint32_t speechCacheFetchPause = 100; // ms between two requests, don't hammer the TTS service
+static constexpr uint32_t speechCacheTimeout = 5000; // ms
+
+struct SpeechCache_Phrase {
+	String lang;
+	String text;
+	bool custom; // from SpeechCache_CustomUrl instead of speechTtsUrl
+};
+
+static TaskHandle_t SpeechCache_TaskHandle = NULL;
+static SemaphoreHandle_t SpeechCache_Mutex = NULL; // guards the pending requests
+static std::vector<SpeechCache_Phrase> SpeechCache_Pending;
+static String SpeechCache_CustomUrl; // guarded by SpeechCache_Mutex as well
+
+// Clips of the announcement that is playing, only touched by the audio task
+static std::vector<String> SpeechCache_Sequence;
+static size_t SpeechCache_SequencePos = 0;
+
+static String SpeechCache_DirPath(void) {
+	return String(cacheDir) + speechCacheDir;
+}
+
+static String SpeechCache_ClipPath(const char *_lang, const char *_text) {
+	char name[speechClipNameSize];
+	SpeechPhrases_ClipName(_lang, _text, name);
+	return SpeechCache_DirPath() + name;
+}
+
+static String SpeechCache_UrlEncode(const String &_text) {
+	String encoded;
+	encoded.reserve(_text.length() * 3);
+	for (size_t i = 0; i < _text.length(); i++) {
+		const char c = _text[i];
+		if (isalnum(static_cast<uint8_t>(c)) || c == '-' || c == '_' || c == '.' || c == '~') {
+			encoded += c;
+		} else {
+			char hex[4];
+			snprintf(hex, sizeof(hex), "%%%02X", static_cast<uint8_t>(c));
+			encoded += hex;
+		}
+	}
+	return encoded;
+}
+
+// Queues a phrase to be fetched unless it's cached or queued already
+static void SpeechCache_Request(const char *_lang, const String &_text, bool _custom) {
+	if (gFSystem.exists(SpeechCache_ClipPath(_lang, _text.c_str()))) {
+		return;
+	}
+	xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+	bool queued = false;
+	for (const auto &request : SpeechCache_Pending) {
+		if (request.text == _text && request.lang == _lang) {
+			queued = true;
+			break;
+		}
+	}
+	if (!queued && SpeechCache_Pending.size() < speechCacheMaxPending) {
+		SpeechCache_Pending.push_back({_lang, _text, _custom});
+	}
+	xSemaphoreGive(SpeechCache_Mutex);
+}
+
+// Hands the chunks of a download to the clip file one at a time through SdArbiter, so the card is never held
+// while waiting for the network
+class SpeechCache_ClipWriter : public Stream {
+public:
+	explicit SpeechCache_ClipWriter(File &_file)
+		: file(_file) { }
+
+	size_t write(uint8_t _c) override {
+		return write(&_c, 1);
+	}
+	size_t write(const uint8_t *_buf, size_t _size) override {
+		SdArbiter_BackgroundBegin(_size);
+		const size_t written = file.write(_buf, _size);
+		SdArbiter_BackgroundEnd();
+		return written;
+	}
+	int available() override {
+		return 0;
+	}
+	int read() override {
+		return -1;
+	}
+	int peek() override {
+		return -1;
+	}
+
+private:
+	File &file;
+};
+
+static bool SpeechCache_Fetch(const SpeechCache_Phrase &_request) {
+	const String path = SpeechCache_ClipPath(_request.lang.c_str(), _request.text.c_str());
+	if (gFSystem.exists(path)) {
+		return true;
+	}
+	xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+	String url = (_request.custom) ? SpeechCache_CustomUrl : String(speechTtsUrl);
+	xSemaphoreGive(SpeechCache_Mutex);
+	url.replace("{lang}", _request.lang);
+	url.replace("{text}", SpeechCache_UrlEncode(_request.text));
+
+	HTTPClient http;
+	http.setTimeout(speechCacheTimeout);
+	http.setUserAgent("Mozilla/5.0");
+	if (!http.begin(url)) {
+		Log_Printf(LOGLEVEL_ERROR, speechCacheFetchFailed, _request.text.c_str(), -1);
+		return false;
+	}
+	const int code = http.GET();
+	if (code != HTTP_CODE_OK) {
+		http.end();
+		Log_Printf(LOGLEVEL_ERROR, speechCacheFetchFailed, _request.text.c_str(), code);
+		return false;
+	}
+	// written to a temporary file first, a clip cut off by power loss must not be played
+	const String tmpPath = path + ".tmp";
+	gFSystem.mkdir(cacheDir);
+	gFSystem.mkdir(SpeechCache_DirPath());
+	File f = gFSystem.open(tmpPath, FILE_WRITE);
+	SpeechCache_ClipWriter clip(f);
+	const int written = (f) ? http.writeToStream(&clip) : -1;
+	f.close();
+	http.end();
+	if (written <= 0) {
+		gFSystem.remove(tmpPath);
+		Log_Printf(LOGLEVEL_ERROR, speechCacheFetchFailed, _request.text.c_str(), written);
+		return false;
+	}
+	gFSystem.remove(path);
+	gFSystem.rename(tmpPath, path);
+	Log_Printf(LOGLEVEL_DEBUG, speechCacheFetched, _request.text.c_str(), _request.lang.c_str(), written);
+	return true;
+}
+
+static void SpeechCache_Task(void *parameter) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		for (;;) {
+			xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+			if (SpeechCache_Pending.empty()) {
+				xSemaphoreGive(SpeechCache_Mutex);
+				break;
+			}
+			const SpeechCache_Phrase request = SpeechCache_Pending.front();
+			xSemaphoreGive(SpeechCache_Mutex);
+
+			if (!Wlan_IsConnected() || !SpeechCache_Fetch(request)) {
+				// offline or the service refuses, try again with the next announcement
+				xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+				SpeechCache_Pending.clear();
+				xSemaphoreGive(SpeechCache_Mutex);
+				break;
+			}
+			xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+			if (!SpeechCache_Pending.empty()) {
+				SpeechCache_Pending.erase(SpeechCache_Pending.begin());
+			}
+			xSemaphoreGive(SpeechCache_Mutex);
+			vTaskDelay(portTICK_PERIOD_MS * speechCacheFetchPause);
+		}
+	}
+}
+#endif
+
+void SpeechCache_Init(void) {
+#ifdef SPEECH_CACHE_ENABLE
+	SpeechCache_Mutex = xSemaphoreCreateMutex();
+	xTaskCreatePinnedToCore(
+		SpeechCache_Task, /* Function to implement the task */
+		"speechCache", /* Name of the task */
+		4096, /* Stack size in words */
+		NULL, /* Task input parameter */
+		1, /* Priority of the task */
+		&SpeechCache_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+#endif
+}
+
+// Splits an announcement (TTS_IP_ADDRESS, TTS_CURRENT_TIME) into phrases, returns the language to speak them in.
+// The time isn't waited for: no phrases if it's not known yet.
+const char *SpeechCache_Compose(uint8_t _tellMode, std::vector<String> &_phrases) {
+	if (_tellMode == TTS_IP_ADDRESS) {
+		return SpeechPhrases_IpAddress(LANGUAGE, Wlan_GetIpAddress(), _phrases);
+	}
+	const char *lang = SpeechPhrases_Time(LANGUAGE, time(nullptr), _phrases);
+	if (_phrases.empty()) {
+		Log_Println(speechTimeUnknown, LOGLEVEL_ERROR);
+	}
+	return lang;
+}
+
+// Prepares the clips of an announcement. Returns false if some are missing (they're fetched in background then).
+bool SpeechCache_Start(const char *_lang, const std::vector<String> &_phrases) {
+	SpeechCache_Cancel();
+#ifdef SPEECH_CACHE_ENABLE
+	bool complete = true;
+	for (const String &phrase : _phrases) {
+		const String path = SpeechCache_ClipPath(_lang, phrase.c_str());
+		if (!gFSystem.exists(path)) {
+			complete = false;
+			SpeechCache_Request(_lang, phrase, false);
+		} else if (complete) {
+			SpeechCache_Sequence.push_back(path);
+		}
+	}
+	if (!complete) {
+		SpeechCache_Sequence.clear();
+		xTaskNotifyGive(SpeechCache_TaskHandle);
+		return false;
+	}
+	return !SpeechCache_Sequence.empty();
+#else
+	return false;
+#endif
+}
+
+// True while the clips of an announcement are played
+bool SpeechCache_IsActive(void) {
+	return !SpeechCache_Sequence.empty();
+}
+
+// Next clip of the announcement. Returns false at the end, the announcement isn't active anymore then.
+bool SpeechCache_NextClip(String &_path) {
+	if (SpeechCache_SequencePos >= SpeechCache_Sequence.size()) {
+		SpeechCache_Cancel();
+		return false;
+	}
+	_path = SpeechCache_Sequence[SpeechCache_SequencePos++];
+	return true;
+}
+
+void SpeechCache_Cancel(void) {
+	SpeechCache_Sequence.clear();
+	SpeechCache_SequencePos = 0;
+}
+
+// Fetches all phrases the announcements can be made of. _ttsUrl replaces speechTtsUrl for these requests
+// ({lang} and {text} are substituted), nullptr to use the default.
+bool SpeechCache_Prewarm(const char *_ttsUrl) {
+#ifdef SPEECH_CACHE_ENABLE
+	const bool custom = (_ttsUrl && *_ttsUrl);
+	if (custom) {
+		xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+		SpeechCache_CustomUrl = _ttsUrl;
+		xSemaphoreGive(SpeechCache_Mutex);
+	}
+	const char *lang;
+	std::vector<String> words;
+	switch (LANGUAGE) {
+		case DE:
+			lang = "de";
+			words = {"Punkt", "Es ist", "Uhr"};
+			break;
+		case FR:
+			lang = "fr";
+			words = {"point"};
+			break;
+		default:
+			lang = "en";
+			words = {"point"};
+	}
+	for (const String &word : words) {
+		SpeechCache_Request(lang, word, custom);
+	}
+	for (uint16_t i = 0; i < 256; i++) {
+		// octets of the IP address, hours and minutes
+		SpeechCache_Request(lang, String(i), custom);
+	}
+	#if (LANGUAGE != DE)
+	// the time is told in English
+	for (const char *word : {"It is", "oh", "AM", "PM"}) {
+		SpeechCache_Request("en", word, custom);
+	}
+	if (LANGUAGE == FR) {
+		for (uint8_t i = 1; i < 60; i++) {
+			SpeechCache_Request("en", String(i), custom);
+		}
+	}
+	#endif
+	Log_Printf(LOGLEVEL_NOTICE, speechCachePrewarm, SpeechCache_GetPending());
+	xTaskNotifyGive(SpeechCache_TaskHandle);
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Removes all clips, e.g. after pre-warming from a stand-in endpoint
+void SpeechCache_Clear(void) {
+#ifdef SPEECH_CACHE_ENABLE
+	File dir = gFSystem.open(SpeechCache_DirPath());
+	if (!dir || !dir.isDirectory()) {
+		return;
+	}
+	bool isDir;
+	for (String path = dir.getNextFileName(&isDir); !path.isEmpty(); path = dir.getNextFileName(&isDir)) {
+		if (!isDir) {
+			gFSystem.remove(path);
+		}
+	}
+	dir.close();
+#endif
+}
+
+uint32_t SpeechCache_GetPending(void) {
+#ifdef SPEECH_CACHE_ENABLE
+	xSemaphoreTake(SpeechCache_Mutex, portMAX_DELAY);
+	const uint32_t pending = SpeechCache_Pending.size();
+	xSemaphoreGive(SpeechCache_Mutex);
+	return pending;
+#else
+	return 0;
+#endif
+}
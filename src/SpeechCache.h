@@ -0,0 +1,14 @@
+#pragma once
+
+#include <WString.h>
+#include <vector>
+
+void SpeechCache_Init(void);
+const char *SpeechCache_Compose(uint8_t _tellMode, std::vector<String> &_phrases);
+bool SpeechCache_Start(const char *_lang, const std::vector<String> &_phrases);
+bool SpeechCache_IsActive(void);
+bool SpeechCache_NextClip(String &_path);
+void SpeechCache_Cancel(void);
+bool SpeechCache_Prewarm(const char *_ttsUrl);
+void SpeechCache_Clear(void);
+uint32_t SpeechCache_GetPending(void);
@@ -0,0 +1,76 @@
+#include <Arduino.h>
+
+#include "SpeechPhrases.h"
+
+#include "Hash.h"
+#include "values.h"
+
+#include <stdio.h>
+
+// The octets of the IP address with the separator of the language in between, returns the language to speak them in
+const char *SpeechPhrases_IpAddress(uint8_t _language, const String &_ip, std::vector<String> &_phrases) {
+	const char *separator;
+	const char *lang;
+	switch (_language) {
+		case DE:
+			separator = "Punkt";
+			lang = "de";
+			break;
+		case FR:
+			separator = "point";
+			lang = "fr";
+			break;
+		default:
+			separator = "point";
+			lang = "en";
+	}
+	_phrases.clear();
+	int start = 0;
+	for (;;) {
+		const int dot = _ip.indexOf('.', start);
+		_phrases.push_back(_ip.substring(start, (dot < 0) ? _ip.length() : dot));
+		if (dot < 0) {
+			break;
+		}
+		_phrases.push_back(separator);
+		start = dot + 1;
+	}
+	return lang;
+}
+
+// The local time _now in German or (all other languages) in English, returns the language to speak it in.
+// No phrases if the clock wasn't set yet.
+const char *SpeechPhrases_Time(uint8_t _language, time_t _now, std::vector<String> &_phrases) {
+	_phrases.clear();
+	struct tm timeinfo;
+	const bool known = (_now >= speechTimeValidFrom) && localtime_r(&_now, &timeinfo);
+	if (_language == DE) {
+		if (known) {
+			_phrases.push_back("Es ist");
+			_phrases.push_back(String(timeinfo.tm_hour));
+			_phrases.push_back("Uhr");
+			if (timeinfo.tm_min) {
+				_phrases.push_back(String(timeinfo.tm_min));
+			}
+		}
+		return "de";
+	}
+	if (known) {
+		const int hour = (timeinfo.tm_hour % 12) ? timeinfo.tm_hour % 12 : 12;
+		_phrases.push_back("It is");
+		_phrases.push_back(String(hour));
+		if (timeinfo.tm_min) {
+			if (timeinfo.tm_min < 10) {
+				_phrases.push_back("oh");
+			}
+			_phrases.push_back(String(timeinfo.tm_min));
+		}
+		_phrases.push_back((timeinfo.tm_hour < 12) ? "AM" : "PM");
+	}
+	return "en";
+}
+
+// Name of the clip of a phrase in the cache directory (_name has speechClipNameSize bytes): language and hash of the text
+void SpeechPhrases_ClipName(const char *_lang, const char *_text, char *_name) {
+	snprintf(_name, speechClipNameSize, "/%.4s-%08x.mp3", _lang, static_cast<unsigned>(Hash_Fnv1aStr(_text)));
+}
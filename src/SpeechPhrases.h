@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+#include <vector>
+
+// Phrases the announcements of the speech cache are made of and the names of their clips on the SD card. Kept
+// free of the network and the SD card, so it's compiled and checked on a PC as well.
+
+static constexpr size_t speechClipNameSize = 24; // "/en-0123abcd.mp3" and the terminator, with room for the language
+static constexpr time_t speechTimeValidFrom = 1577836800; // 2020-01-01, before that the clock wasn't set by NTP
+
+const char *SpeechPhrases_IpAddress(uint8_t _language, const String &_ip, std::vector<String> &_phrases);
+const char *SpeechPhrases_Time(uint8_t _language, time_t _now, std::vector<String> &_phrases);
+void SpeechPhrases_ClipName(const char *_lang, const char *_text, char *_name);
@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "StreamBuffer.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+// Watches the input buffer of a webstream in playtime instead of bytes, as the same buffer holds 30 s of a
+// 32 kbit/s stream but only 4 s of a 256 kbit/s one. The jitter of the connection is measured as the largest
+// dip of the buffer and decays slowly, the watermarks follow it:
+// - low watermark: a buffer that's not larger than the usual dip is about to run dry -> Rebuffering
+// - high watermark: low watermark plus a margin, reached again -> Playing
+// Rebuffering is reported (log, web UI) but doesn't pause the output: the audio library only reads from the
+// network within audio->loop() while it's running, pausing the decoder would stop the refill as well.
+// The size of the buffer itself is fixed by the audio library (it already lives in PSRAM if available). So the
+// only recovery is the reconnect: a connection that breaks down is not reported as error anymore, the audio task
+// reconnects to the station with increasing delays, so weak Wi-Fi results in a short pause instead of skipping
+// the station.
+static constexpr uint32_t streamBufferDefaultBitRate = 128000; // bit/s, until the decoder knows better
+static constexpr uint32_t streamBufferMinLowWatermark = 1000; // ms
+static constexpr uint32_t streamBufferMinMargin = 2000; // ms between low and high watermark
+static constexpr uint32_t streamBufferEmpty = 100; // ms, less is considered empty
+static constexpr uint32_t streamBufferStallTimeout = 8000; // ms being empty until the connection is given up
+static constexpr uint32_t streamBufferJitterDecay = 250; // ms, jitter and peak are lowered this often
+static constexpr uint8_t streamBufferReconnectAttempts = 6; // 1, 2, 4, 8, 16, 16 s
+static constexpr uint32_t streamBufferReconnectMaxDelay = 16000; // ms
+
+static StreamBufferState StreamBuffer_State = StreamBufferState::Idle;
+static streamBufferInfo StreamBuffer_Info;
+static uint32_t StreamBuffer_PeakMs = 0; // highest recent fill, follows a lower one slowly
+static uint32_t StreamBuffer_JitterTimestamp = 0;
+static uint32_t StreamBuffer_EmptySince = 0; // 0: not empty
+static uint8_t StreamBuffer_Attempts = 0; // reconnects without reaching the high watermark in between
+static uint32_t StreamBuffer_ReconnectTimestamp = 0; // 0: no reconnect pending
+
+// A new station was started
+void StreamBuffer_Start(void) {
+	StreamBuffer_State = StreamBufferState::Prebuffering;
+	StreamBuffer_Info = {0, 0, streamBufferMinLowWatermark, streamBufferMinLowWatermark + streamBufferMinMargin, 0, 0};
+	StreamBuffer_PeakMs = 0;
+	StreamBuffer_JitterTimestamp = millis();
+	StreamBuffer_EmptySince = 0;
+	StreamBuffer_Attempts = 0;
+	StreamBuffer_ReconnectTimestamp = 0;
+}
+
+void StreamBuffer_Stop(void) {
+	StreamBuffer_State = StreamBufferState::Idle;
+	StreamBuffer_ReconnectTimestamp = 0;
+}
+
+StreamBufferState StreamBuffer_GetState(void) {
+	return StreamBuffer_State;
+}
+
+// Called by the audio task after every audio->loop() while a webstream is running (not paused)
+StreamBufferState StreamBuffer_Update(uint32_t _inBufferFilled, uint32_t _inBufferSize, uint32_t _bitRate) {
+	if (StreamBuffer_State == StreamBufferState::Idle) {
+		return StreamBuffer_State;
+	}
+	if (_bitRate < 8000) {
+		_bitRate = streamBufferDefaultBitRate;
+	}
+	const uint32_t bufferedMs = static_cast<uint64_t>(_inBufferFilled) * 8000 / _bitRate;
+	const uint32_t capacityMs = static_cast<uint64_t>(_inBufferSize) * 8000 / _bitRate;
+	StreamBuffer_Info.bufferedMs = bufferedMs;
+	StreamBuffer_Info.capacityMs = capacityMs;
+
+	// jitter
+	if (bufferedMs >= StreamBuffer_PeakMs) {
+		StreamBuffer_PeakMs = bufferedMs;
+	} else if (StreamBuffer_State != StreamBufferState::Prebuffering) {
+		StreamBuffer_Info.jitterMs = std::max(StreamBuffer_Info.jitterMs, StreamBuffer_PeakMs - bufferedMs);
+	}
+	if ((millis() - StreamBuffer_JitterTimestamp) >= streamBufferJitterDecay) {
+		StreamBuffer_JitterTimestamp = millis();
+		StreamBuffer_Info.jitterMs -= StreamBuffer_Info.jitterMs / 64;
+		StreamBuffer_PeakMs -= (StreamBuffer_PeakMs - bufferedMs) / 8; // a lower but steady fill is no jitter
+	}
+
+	// watermarks, the high one has to be reachable with the buffer at hand
+	const uint32_t reachableMs = capacityMs * 9 / 10;
+	StreamBuffer_Info.highWatermarkMs = std::min(reachableMs, std::max(streamBufferMinLowWatermark, StreamBuffer_Info.jitterMs) + std::max(streamBufferMinMargin, StreamBuffer_Info.jitterMs));
+	StreamBuffer_Info.lowWatermarkMs = std::min(std::max(streamBufferMinLowWatermark, StreamBuffer_Info.jitterMs), StreamBuffer_Info.highWatermarkMs / 2);
+
+	// connection alive?
+	if (bufferedMs >= streamBufferEmpty) {
+		StreamBuffer_EmptySince = 0;
+	} else if (!StreamBuffer_EmptySince) {
+		StreamBuffer_EmptySince = millis();
+	} else if ((millis() - StreamBuffer_EmptySince) > streamBufferStallTimeout) {
+		StreamBuffer_EmptySince = 0;
+		return StreamBufferState::Stalled;
+	}
+
+	switch (StreamBuffer_State) {
+		case StreamBufferState::Prebuffering:
+		case StreamBufferState::Rebuffering:
+			if (bufferedMs >= StreamBuffer_Info.highWatermarkMs) {
+				StreamBuffer_State = StreamBufferState::Playing;
+				StreamBuffer_Attempts = 0; // the connection has proven to work
+			}
+			break;
+		case StreamBufferState::Playing:
+			if (bufferedMs < StreamBuffer_Info.lowWatermarkMs) {
+				StreamBuffer_State = StreamBufferState::Rebuffering;
+				Log_Printf(LOGLEVEL_NOTICE, streamBufferLow, bufferedMs, StreamBuffer_Info.lowWatermarkMs, StreamBuffer_Info.jitterMs);
+			}
+			break;
+		default:
+			break;
+	}
+	return StreamBuffer_State;
+}
+
+// The connection was lost. Returns false if the station keeps failing and should be given up.
+bool StreamBuffer_ScheduleReconnect(void) {
+	if (StreamBuffer_State == StreamBufferState::Idle || StreamBuffer_Attempts >= streamBufferReconnectAttempts) {
+		return false;
+	}
+	const uint32_t delay = std::min(streamBufferReconnectMaxDelay, 1000u << StreamBuffer_Attempts);
+	StreamBuffer_Attempts++;
+	StreamBuffer_Info.reconnects++;
+	StreamBuffer_ReconnectTimestamp = millis() + delay;
+	if (!StreamBuffer_ReconnectTimestamp) {
+		StreamBuffer_ReconnectTimestamp = 1;
+	}
+	StreamBuffer_State = StreamBufferState::Prebuffering;
+	StreamBuffer_PeakMs = 0;
+	StreamBuffer_EmptySince = 0;
+	Log_Printf(LOGLEVEL_NOTICE, webstreamReconnectScheduled, delay / 1000, StreamBuffer_Attempts, streamBufferReconnectAttempts);
+	return true;
+}
+
+bool StreamBuffer_ReconnectPending(void) {
+	return StreamBuffer_ReconnectTimestamp != 0;
+}
+
+// Returns true once when it's time to connect again
+bool StreamBuffer_ReconnectDue(void) {
+	if (!StreamBuffer_ReconnectTimestamp || static_cast<int32_t>(millis() - StreamBuffer_ReconnectTimestamp) < 0) {
+		return false;
+	}
+	StreamBuffer_ReconnectTimestamp = 0;
+	return true;
+}
+
+streamBufferInfo StreamBuffer_GetInfo(void) {
+	return StreamBuffer_Info;
+}
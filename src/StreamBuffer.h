@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class StreamBufferState : uint8_t {
+	Idle, // no webstream
+	Prebuffering, // (re)connected, until the high watermark is reached. The audio library starts decoding on its own.
+	Playing,
+	Rebuffering, // fell below the low watermark, a dropout is near. Only reported, playback isn't held to refill.
+	Stalled // empty for too long, the connection is dead
+};
+
+typedef struct {
+	uint32_t bufferedMs; // playtime in the input buffer
+	uint32_t capacityMs; // playtime the input buffer can hold
+	uint32_t lowWatermarkMs;
+	uint32_t highWatermarkMs;
+	uint32_t jitterMs; // largest recent dip of the buffer, decays slowly
+	uint32_t reconnects; // since the station was started
+} streamBufferInfo;
+
+void StreamBuffer_Start(void);
+void StreamBuffer_Stop(void);
+StreamBufferState StreamBuffer_GetState(void);
+StreamBufferState StreamBuffer_Update(uint32_t _inBufferFilled, uint32_t _inBufferSize, uint32_t _bitRate);
+bool StreamBuffer_ScheduleReconnect(void);
+bool StreamBuffer_ReconnectPending(void);
+bool StreamBuffer_ReconnectDue(void);
+streamBufferInfo StreamBuffer_GetInfo(void);
@@ -5,11 +5,13 @@
 
 #include "Audio.h"
 #include "AudioPlayer.h"
+#include "Catalog.h"
 #include "Led.h"
 #include "Log.h"
 #include "Mqtt.h"
 #include "Port.h"
 #include "Power.h"
+#include "ResumeJournal.h"
 #include "Rfid.h"
 #include "SdCard.h"
 #include "esp_system.h"
@@ -178,6 +180,7 @@ void System_SleepHandler(void) {
 void System_PreparePowerDown(void) {
 
 	AudioPlayer_Exit();
+	ResumeJournal_Exit();
 // Disable amps in order to avoid ugly noises when powering off
 #ifdef GPIO_PA_EN
 	Log_Println("shutdown amplifier..", LOGLEVEL_NOTICE);
@@ -194,6 +197,7 @@ void System_PreparePowerDown(void) {
 #ifdef USE_LAST_VOLUME_AFTER_REBOOT
 	gPrefsSettings.putUInt("previousVolume", AudioPlayer_GetCurrentVolume());
 #endif
+	Catalog_Exit();
 	SdCard_Exit();
 
 	Serial.flush();
@@ -0,0 +1,306 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "TrackControl.h"
+
+#include "Log.h"
+#include "values.h"
+
+// Track to continue with after a track command (NEXTTRACK, PREVIOUSTRACK, FIRSTTRACK, LASTTRACK)
+trackMove TrackControl_Move(uint8_t _command, uint8_t _playMode, size_t _track, size_t _trackCount, bool _repeatPlaylist, uint32_t _playedSeconds) {
+	switch (_command) {
+		case NEXTTRACK:
+			// Allow next track if current track played in playlist isn't the last track.
+			// Exception: loop-playlist is active. In this case playback restarts at the first track of the playlist.
+			if (_track + 1 < _trackCount) {
+				return {TrackStep::Jump, _track + 1};
+			}
+			if (_repeatPlaylist) {
+				return {TrackStep::Jump, 0};
+			}
+			return {TrackStep::Refuse, _track};
+
+		case PREVIOUSTRACK:
+			if (_playMode == WEBSTREAM) {
+				return {TrackStep::Refuse, _track};
+			}
+			if (_playMode == LOCAL_M3U) {
+				return (_track > 0) ? trackMove {TrackStep::Jump, _track - 1} : trackMove {TrackStep::Refuse, _track};
+			}
+			if (_track == 0 && !_repeatPlaylist) {
+				return {TrackStep::Restart, _track};
+			}
+			if (_playedSeconds >= 5) {
+				// play current track again when it's been playing for a while already
+				return {TrackStep::Jump, _track};
+			}
+			if (_track == 0) {
+				// Go back to last track in loop-mode when first track is played
+				return {TrackStep::Jump, _trackCount - 1};
+			}
+			return {TrackStep::Jump, _track - 1};
+
+		case FIRSTTRACK:
+			return {TrackStep::Jump, 0};
+
+		case LASTTRACK:
+			if (_track + 1 < _trackCount) {
+				return {TrackStep::Jump, _trackCount - 1};
+			}
+			return {TrackStep::Refuse, _track};
+
+		default:
+			return {TrackStep::Refuse, _track};
+	}
+}
+
+// Track to continue with when the current one is over. If endless-loop is requested, the track-number isn't incremented.
+size_t TrackControl_Finished(size_t _track, bool _repeatTrack) {
+	return (_repeatTrack) ? _track : _track + 1;
+}
+
+// Checks if the playlist is over once the track number was changed
+PlaylistStep TrackControl_CheckEnd(size_t _track, size_t _trackCount, size_t _playUntilTrack, bool _repeatPlaylist, bool _sleepAfterPlaylist, bool _sleepAfterTrack) {
+	if (_playUntilTrack > 0 && _playUntilTrack == _track) {
+		return PlaylistStep::UntilReached;
+	}
+	if (_track < _trackCount) {
+		return PlaylistStep::Continue;
+	}
+	if (!_repeatPlaylist) {
+		return (_sleepAfterPlaylist) ? PlaylistStep::FinishedSleep : PlaylistStep::Finished;
+	}
+	if (_sleepAfterPlaylist || _sleepAfterTrack) {
+		return PlaylistStep::Sleep;
+	}
+	return PlaylistStep::Wrap;
+}
+
+// Resumes a paused track before it's changed
+static void TrackControl_Resume(playProps &_props, TrackControlActions &_actions) {
+	if (_props.pausePlay) {
+		_actions.pauseResume();
+		_props.pausePlay = false;
+	}
+}
+
+// End loop if button was pressed
+static void TrackControl_EndRepeatTrack(playProps &_props, TrackControlActions &_actions) {
+	if (_props.repeatCurrentTrack) {
+		_props.repeatCurrentTrack = false;
+		_actions.repeatModeChanged();
+	}
+}
+
+// Continues with the track chosen by a track command
+static void TrackControl_Jump(playProps &_props, TrackControlActions &_actions, size_t _track, const char *_message) {
+	_props.currentTrackNumber = _track;
+	if (_props.saveLastPlayPosition) {
+		_actions.savePosition(_props.currentTrackNumber, _props.currentTrackNumber);
+		Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
+	}
+	Log_Println(_message, LOGLEVEL_INFO);
+	if (!_props.playlistFinished) {
+		_actions.stopSong();
+	}
+}
+
+// One decision step of the audio task, after a new playlist arrived, a track finished or a track command
+// (stop, pause, next, previous, first, last track) was received. A command that arrives with a new playlist or the
+// end of a track is left pending for the next step: it applies to the track that starts now (or the finished
+// playlist), the track number isn't checked against the end of the playlist before that.
+TrackLoop TrackControl_Step(playProps &_props, bool _newPlaylist, uint8_t &_pendingCommand, TrackControlActions &_actions) {
+	if (_newPlaylist) {
+		_props.pausePlay = false;
+		_props.trackFinished = false;
+		_props.playlistFinished = false;
+	}
+	const bool trackFinished = _props.trackFinished;
+	if (trackFinished) {
+		_props.trackFinished = false;
+		if (_props.playMode == NO_PLAYLIST || _props.playlist == nullptr) {
+			_props.playlistFinished = true;
+			return TrackLoop::Skip;
+		}
+		if (_props.saveLastPlayPosition && _props.currentTrackNumber + 1u < _props.playlist->size()) {
+			// Only save if there's another track, otherwise it will be saved at end of playlist anyway
+			_actions.savePosition(_props.currentTrackNumber, _props.currentTrackNumber + 1);
+		}
+		if (_props.sleepAfterCurrentTrack) { // Go to sleep if "sleep after track" was requested
+			_props.playlistFinished = true;
+			_props.playMode = NO_PLAYLIST;
+			_actions.requestSleep();
+			return TrackLoop::Quit;
+		}
+		_props.currentTrackNumber = TrackControl_Finished(_props.currentTrackNumber, _props.repeatCurrentTrack);
+		if (_props.repeatCurrentTrack) {
+			Log_Println(repeatTrackDueToPlaymode, LOGLEVEL_INFO);
+			_actions.indicateRewind();
+		}
+	}
+
+	uint8_t command = NO_ACTION;
+	if (!_newPlaylist && !trackFinished) {
+		command = _pendingCommand;
+		_pendingCommand = NO_ACTION;
+	}
+
+	// Prevents from staying in mode BUSY forever when error occured (e.g. directory empty that should be played)
+	if (_props.playlistFinished && command != NO_ACTION && _props.playMode != BUSY) {
+		Log_Println(noPlaymodeChangeIfIdle, LOGLEVEL_NOTICE);
+		_actions.indicateError();
+		return TrackLoop::Skip;
+	}
+	if (_props.playlist == nullptr) {
+		return TrackLoop::Skip;
+	}
+
+	const size_t trackCount = _props.playlist->size();
+	trackMove move;
+	switch (command) {
+		case STOP:
+			_actions.stopSong();
+			Log_Println(cmndStop, LOGLEVEL_INFO);
+			_props.pausePlay = true;
+			_props.playlistFinished = true;
+			_props.playMode = NO_PLAYLIST;
+			_actions.playlistEnded();
+			return TrackLoop::Skip;
+
+		case PAUSEPLAY:
+			_actions.pauseResume();
+			Log_Println((_props.pausePlay) ? cmndResumeFromPause : cmndPause, LOGLEVEL_INFO);
+			if (_props.saveLastPlayPosition && !_props.pausePlay) {
+				_actions.savePosition(_props.currentTrackNumber, _props.currentTrackNumber, true);
+			}
+			_props.pausePlay = !_props.pausePlay;
+			return TrackLoop::Skip;
+
+		case NEXTTRACK:
+		case LASTTRACK:
+			TrackControl_Resume(_props, _actions);
+			if (command == NEXTTRACK) {
+				TrackControl_EndRepeatTrack(_props, _actions);
+			}
+			move = TrackControl_Move(command, _props.playMode, _props.currentTrackNumber, trackCount, _props.repeatPlaylist, 0);
+			if (move.step != TrackStep::Jump) {
+				Log_Println(lastTrackAlreadyActive, LOGLEVEL_NOTICE);
+				_actions.indicateError();
+				return TrackLoop::Skip;
+			}
+			TrackControl_Jump(_props, _actions, move.track, (command == NEXTTRACK) ? cmndNextTrack : cmndLastTrack);
+			break;
+
+		case PREVIOUSTRACK:
+			TrackControl_Resume(_props, _actions);
+			TrackControl_EndRepeatTrack(_props, _actions);
+			move = TrackControl_Move(PREVIOUSTRACK, _props.playMode, _props.currentTrackNumber, trackCount, _props.repeatPlaylist, _actions.playedSeconds());
+			if (_props.playMode == WEBSTREAM) {
+				Log_Println(trackChangeWebstream, LOGLEVEL_INFO);
+				_actions.indicateError();
+				return TrackLoop::Skip;
+			}
+			if (_props.playMode == LOCAL_M3U) {
+				Log_Println(cmndPrevTrack, LOGLEVEL_INFO);
+				if (move.step != TrackStep::Jump) {
+					_actions.indicateError();
+					return TrackLoop::Skip;
+				}
+				_props.currentTrackNumber = move.track;
+				break;
+			}
+			if (move.step == TrackStep::Restart) {
+				if (_props.saveLastPlayPosition) {
+					_actions.savePosition(_props.currentTrackNumber, _props.currentTrackNumber);
+				}
+				_actions.stopSong();
+				_actions.indicateRewind();
+				// consider track as finished, when audio lib call was not successful
+				if (_actions.play(true) != TrackStart::Started) {
+					_actions.indicateError();
+					_props.trackFinished = true;
+					return TrackLoop::Skip;
+				}
+				Log_Println(trackStart, LOGLEVEL_INFO);
+				return TrackLoop::Skip;
+			}
+			TrackControl_Jump(_props, _actions, move.track, cmndPrevTrack);
+			break;
+
+		case FIRSTTRACK:
+			TrackControl_Resume(_props, _actions);
+			TrackControl_Jump(_props, _actions, TrackControl_Move(FIRSTTRACK, _props.playMode, _props.currentTrackNumber, trackCount, _props.repeatPlaylist, 0).track, cmndFirstTrack);
+			break;
+
+		case NO_ACTION:
+			break;
+
+		default:
+			Log_Println(cmndDoesNotExist, LOGLEVEL_NOTICE);
+			_actions.indicateError();
+			return TrackLoop::Skip;
+	}
+
+	const PlaylistStep playlistStep = TrackControl_CheckEnd(_props.currentTrackNumber, trackCount, _props.playUntilTrackNumber, _props.repeatPlaylist, _props.sleepAfterPlaylist, _props.sleepAfterCurrentTrack);
+	switch (playlistStep) {
+		case PlaylistStep::UntilReached:
+			if (_props.saveLastPlayPosition) {
+				// the track number might be past the end of the playlist
+				_actions.savePosition(0, 0);
+			}
+			_props.playlistFinished = true;
+			_props.playMode = NO_PLAYLIST;
+			_actions.requestSleep();
+			return TrackLoop::Skip;
+
+		case PlaylistStep::Finished:
+		case PlaylistStep::FinishedSleep:
+			Log_Println(endOfPlaylistReached, LOGLEVEL_NOTICE);
+			if (_props.saveLastPlayPosition) {
+				// Set back to first track
+				_actions.savePosition(0, 0);
+			}
+			_props.playlistFinished = true;
+			_props.playMode = NO_PLAYLIST;
+			_actions.playlistEnded();
+			_props.currentTrackNumber = 0;
+			if (playlistStep == PlaylistStep::FinishedSleep) {
+				_actions.requestSleep();
+			}
+			return TrackLoop::Skip;
+
+		case PlaylistStep::Sleep: // sleep after current track/playlist was requested
+			Log_Println(endOfPlaylistReached, LOGLEVEL_NOTICE);
+			_props.playlistFinished = true;
+			_props.playMode = NO_PLAYLIST;
+			_actions.requestSleep();
+			return TrackLoop::Skip;
+
+		case PlaylistStep::Wrap: // Repeat playlist; set current track number back to 0
+			Log_Println(endOfPlaylistReached, LOGLEVEL_NOTICE);
+			Log_Println(repeatPlaylistDueToPlaymode, LOGLEVEL_NOTICE);
+			_props.currentTrackNumber = 0;
+			if (_props.saveLastPlayPosition) {
+				_actions.savePosition(0, 0);
+			}
+			break;
+
+		case PlaylistStep::Continue:
+			break;
+	}
+
+	switch (_actions.play(false)) {
+		case TrackStart::Started:
+			_props.playlistFinished = false;
+			return TrackLoop::Playing;
+		case TrackStart::Missing:
+			_props.trackFinished = true;
+			return TrackLoop::Skip;
+		case TrackStart::Failed:
+		default:
+			// consider track as finished, when audio lib call was not successful
+			_actions.indicateError();
+			_props.trackFinished = true;
+			return TrackLoop::Skip;
+	}
+}
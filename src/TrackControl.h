@@ -0,0 +1,66 @@
+#pragma once
+
+#include "AudioPlayer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decisions of the audio task about which track to play next. Kept free of FreeRTOS and the audio library (the
+// task carries out the side effects through TrackControlActions), so the transitions can be compiled and checked
+// on a PC as well.
+
+enum class TrackStep : uint8_t {
+	Refuse, // not possible (e.g. next at the last track), indicate an error
+	Jump, // continue with track
+	Restart // play the current track again from its start (previous at the first track)
+};
+
+typedef struct {
+	TrackStep step;
+	size_t track;
+} trackMove;
+
+enum class PlaylistStep : uint8_t {
+	Continue, // track is within the playlist
+	UntilReached, // playUntilTrackNumber reached: stop and sleep
+	Finished, // end of the playlist: stop
+	FinishedSleep, // end of the playlist: stop and sleep (sleepAfterPlaylist)
+	Sleep, // end of a repeated playlist, but sleep was requested
+	Wrap // end of a repeated playlist: continue with the first track
+};
+
+
+enum class TrackStart : uint8_t {
+	Started,
+	Missing, // file doesn't exist, continue with the next one
+	Failed
+};
+
+enum class TrackLoop : uint8_t {
+	Skip, // done for this pass of the loop
+	Playing, // a track was started
+	Quit // sleep after the track was requested, the audio task ends
+};
+
+// Side effects of a decision step, carried out by the audio task (or by a simulation on a PC)
+class TrackControlActions {
+public:
+	virtual void stopSong(void) = 0; // including the rest of the song in the DSP
+	virtual void pauseResume(void) = 0;
+	virtual uint32_t playedSeconds(void) = 0;
+	// Saves the position to the RFID tag: entry _entry of the playlist, from its start or (_atPlayPosition) from
+	// where it's playing, continuing with _track
+	virtual void savePosition(size_t _entry, size_t _track, bool _atPlayPosition = false) = 0;
+	virtual void indicateError(void) = 0;
+	virtual void indicateRewind(void) = 0;
+	virtual void requestSleep(void) = 0;
+	virtual void repeatModeChanged(void) = 0;
+	virtual void playlistEnded(void) = 0; // stopped or over: no title, no cover
+	// Starts the current track of the playlist, _restart: previous at the first track, it's played from its start
+	virtual TrackStart play(bool _restart) = 0;
+};
+
+trackMove TrackControl_Move(uint8_t _command, uint8_t _playMode, size_t _track, size_t _trackCount, bool _repeatPlaylist, uint32_t _playedSeconds);
+size_t TrackControl_Finished(size_t _track, bool _repeatTrack);
+PlaylistStep TrackControl_CheckEnd(size_t _track, size_t _trackCount, size_t _playUntilTrack, bool _repeatPlaylist, bool _sleepAfterPlaylist, bool _sleepAfterTrack);
+TrackLoop TrackControl_Step(playProps &_props, bool _newPlaylist, uint8_t &_pendingCommand, TrackControlActions &_actions);
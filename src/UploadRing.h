@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Ring of upload slots between the web server (producer) and the storage task (consumer). The slot buffers belong
+// to the caller, the ring only hands them over: a slot is published with its length once it's full (or the upload
+// is complete) and belongs to the consumer until it's released. The producer keeps the fill of the slot it's
+// writing to itself, so it never touches the length of a slot the consumer might still be writing to the card.
+// Kept free of the web server and FreeRTOS, so it's compiled and checked on a PC as well.
+template <uint32_t Slots>
+class UploadRing {
+public:
+	// Only while neither side is using the ring
+	void reset(void) {
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+		headFill = 0;
+	}
+
+	// Producer: true if all slots wait for the consumer
+	bool full(void) const {
+		return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) == Slots;
+	}
+
+	// Producer: copies as much of _data as fits into the current slot and publishes the slot once it's full
+	// (_published). Returns the number of bytes taken, 0 if the ring is full.
+	size_t put(uint8_t *const *_buffers, size_t _slotSize, const uint8_t *_data, size_t _len, bool &_published) {
+		_published = false;
+		if (full()) {
+			return 0;
+		}
+		const uint32_t h = head.load(std::memory_order_relaxed);
+		const size_t n = std::min(_len, _slotSize - headFill);
+		memcpy(_buffers[h % Slots] + headFill, _data, n);
+		headFill += n;
+		if (headFill == _slotSize) {
+			publish(h);
+			_published = true;
+		}
+		return n;
+	}
+
+	// Producer: publishes the partly filled slot at the end of the upload. The slot was free when put() started
+	// to fill it and stays with the producer till it's published, so there's no need to wait.
+	void flush(void) {
+		if (headFill) {
+			publish(head.load(std::memory_order_relaxed));
+		}
+	}
+
+	// Consumer: the oldest published slot and its length. False if there's none.
+	bool peek(uint32_t &_slot, size_t &_len) const {
+		const uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		_slot = t % Slots;
+		_len = fill[_slot];
+		return true;
+	}
+
+	// Consumer: hands the slot returned by peek() back to the producer
+	void release(void) {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer: true if every published slot was released
+	bool drained(void) const {
+		return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+	}
+
+private:
+	void publish(uint32_t _head) {
+		fill[_head % Slots] = headFill;
+		headFill = 0;
+		head.store(_head + 1, std::memory_order_release);
+	}
+
+	size_t fill[Slots] = {}; // length of a published slot, written by the producer before head moves past it
+	size_t headFill = 0; // bytes in the slot the producer is writing to (producer only)
+	std::atomic<uint32_t> head {0}; // written by the producer only
+	std::atomic<uint32_t> tail {0}; // written by the consumer only
+};
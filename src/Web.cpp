@@ -7,20 +7,32 @@
 #include "AsyncJson.h"
 #include "AudioPlayer.h"
 #include "Battery.h"
+#include "Catalog.h"
 #include "Cmd.h"
 #include "Common.h"
+#include "Dsp.h"
 #include "ESPAsyncWebServer.h"
 #include "EnumUtils.h"
+#include "ExplorerList.h"
 #include "Ftp.h"
 #include "HTMLbinary.h"
 #include "HallEffectSensor.h"
+#include "Hash.h"
+#include "HttpRange.h"
 #include "Led.h"
 #include "Log.h"
 #include "MemX.h"
+#include "PlaybackStats.h"
 #include "Mqtt.h"
+#include "ResumeJournal.h"
 #include "Rfid.h"
+#include "SdArbiter.h"
 #include "SdCard.h"
+#include "SpeechCache.h"
+#include "StreamBuffer.h"
 #include "System.h"
+#include "UploadRing.h"
+#include "WebsocketState.h"
 #include "Wlan.h"
 #include "freertos/ringbuf.h"
 #include "revision.h"
@@ -29,7 +41,9 @@
 
 #include <Update.h>
 #include <WiFi.h>
+#include <atomic>
 #include <esp_task_wdt.h>
+#include <memory>
 #include <nvs.h>
 
 typedef struct {
@@ -43,25 +57,57 @@ AsyncEventSource events("/events");
 
 static bool webserverStarted = false;
 
+// Uploads are handed from the web server to the storage task through a lock-free single producer / single consumer
+// ring of slots. Head and tail run freely and are only wrapped on access, so a full ring can be told from an empty one.
+// A slot is as large as a cluster of the SD card (bigger slots increase write-performance), both sides block on a
+// task notification while the ring is full or empty.
+// The SD drivers can't DMA from PSRAM, they'd write such a buffer sector by sector. So slots in PSRAM are copied to
+// a bounce buffer in internal RAM first, which takes a fraction of the time the SD card needs for the cluster.
 #ifdef BOARD_HAS_PSRAM
-static const uint32_t start_chunk_size = 16384; // bigger chunks increase write-performance to SD-Card
+static constexpr uint32_t uploadSlots = 8; // in PSRAM, evens out the SD card pausing to erase or allocate clusters
+static constexpr size_t uploadMaxSlotSize = 32768;
 #else
-static const uint32_t start_chunk_size = 4096; // save memory if no PSRAM is available
+static constexpr uint32_t uploadSlots = 2; // save memory if no PSRAM is available
+static constexpr size_t uploadMaxSlotSize = 4096;
 #endif
+static constexpr size_t retry_count = 2; // how often we retry is a malloc fails (also the times we halfe the slot size)
+static constexpr uint32_t uploadNotifyData = 1; // a slot was filled
+static constexpr uint32_t uploadNotifyFinal = 2; // the last slot was filled
+static constexpr uint32_t uploadNotifyAbort = 4; // the client went away
 
-static constexpr uint32_t nr_of_buffers = 2; // at least two buffers. No speed improvement yet with more than two.
-static constexpr size_t retry_count = 2; // how often we retry is a malloc fails (also the times we halfe the chunk_size)
-
-uint8_t *buffer[nr_of_buffers];
-size_t chunk_size;
-volatile uint32_t size_in_buffer[nr_of_buffers];
-volatile bool buffer_full[nr_of_buffers];
-uint32_t index_buffer_write = 0;
-uint32_t index_buffer_read = 0;
+typedef struct {
+	uint32_t bytes;
+	uint32_t durationMs;
+	uint32_t stallMs; // web server waiting for the SD card
+	uint32_t slotSize;
+	uint32_t slots;
+} uploadStats;
+
+static uint8_t *uploadBuffer[uploadSlots];
+static size_t uploadSlotSize;
+#ifdef BOARD_HAS_PSRAM
+static uint8_t *uploadBounce = nullptr; // DMA capable, up to one slot
+static size_t uploadBounceSize = 0;
+#endif
+static UploadRing<uploadSlots> uploadRing; // web server fills the slots, storage task writes them to the SD card
+static volatile TaskHandle_t uploadWaitingProducer = NULL; // web server waiting for a free slot
+static volatile bool uploadAborted = false;
+static uint32_t uploadStallMs = 0; // time the web server waited for the SD card
+static bool uploadExclusive = false; // pause playback, RFID and LEDs during the upload
+static uploadStats lastUploadStats = {0, 0, 0, 0, 0};
 
 static SemaphoreHandle_t explorerFileUploadFinished;
 static TaskHandle_t fileStorageTaskHandle;
 
+// Websocket messages are formatted into a small pool of buffers, allocated once when the web server starts. Changes of
+// the playback state are collected by websocketState and pushed by Web_Cyclic().
+static constexpr uint8_t websocketPoolSlots = 3;
+static constexpr size_t websocketMessageSize = 1024;
+
+static char *websocketPool[websocketPoolSlots];
+static std::atomic<bool> websocketPoolUsed[websocketPoolSlots];
+static WebsocketState websocketState;
+
 void Web_DumpSdToNvs(const char *_filename);
 static void handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
 static void explorerHandleFileUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
@@ -73,6 +119,8 @@ static void explorerHandleCreateRequest(AsyncWebServerRequest *request);
 static void explorerHandleRenameRequest(AsyncWebServerRequest *request);
 static void explorerHandleAudioRequest(AsyncWebServerRequest *request);
 static void handleTrackProgressRequest(AsyncWebServerRequest *request);
+static void handleCatalogRequest(AsyncWebServerRequest *request);
+static void handleSpeechCacheRequest(AsyncWebServerRequest *request);
 static void handleGetSavedSSIDs(AsyncWebServerRequest *request);
 static void handlePostSavedSSIDs(AsyncWebServerRequest *request, JsonVariant &json);
 static void handleDeleteSavedSSIDs(AsyncWebServerRequest *request);
@@ -93,6 +141,8 @@ static void onWebsocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *clien
 static void settingsToJSON(JsonObject obj, const String section);
 static bool JSONToSettings(JsonObject obj);
 static void webserverStart(void);
+static void websocketPushState(void);
+static void websocketRequestFullState(void);
 
 // IPAddress converters, for a description see: https://arduinojson.org/news/2021/05/04/version-6-18-0/
 void convertFromJson(JsonVariantConst src, IPAddress &dst) {
@@ -117,46 +167,67 @@ struct SpiRamAllocator {
 };
 using SpiRamJsonDocument = BasicJsonDocument<SpiRamAllocator>;
 
-static void destroyDoubleBuffer() {
-	for (size_t i = 0; i < nr_of_buffers; i++) {
-		free(buffer[i]);
-		buffer[i] = nullptr;
+static void destroyUploadRing() {
+	for (size_t i = 0; i < uploadSlots; i++) {
+		free(uploadBuffer[i]);
+		uploadBuffer[i] = nullptr;
 	}
+#ifdef BOARD_HAS_PSRAM
+	free(uploadBounce);
+	uploadBounce = nullptr;
+	uploadBounceSize = 0;
+#endif
 }
 
-static bool allocateDoubleBuffer() {
+static bool allocateUploadRing() {
 	const auto checkAndAlloc = [](uint8_t *&ptr, const size_t memSize) -> bool {
 		if (ptr) {
 			// memory is there, so nothing to do
 			return true;
 		}
-		// try to allocate buffer in faster internal RAM, not in PSRAM
-		// ptr = (uint8_t *) malloc(memSize);
-		ptr = (uint8_t *) heap_caps_aligned_alloc(32, memSize, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL);
+#ifdef BOARD_HAS_PSRAM
+		ptr = (uint8_t *) heap_caps_aligned_alloc(32, memSize, MALLOC_CAP_SPIRAM);
+#else
+		// internal RAM, the SD driver writes it by DMA
+		ptr = (uint8_t *) heap_caps_aligned_alloc(32, memSize, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+#endif
 		return (ptr != nullptr);
 	};
 
-	chunk_size = start_chunk_size;
+	const size_t slotSize = std::min(std::max<size_t>(SdCard_GetClusterSize(), 4096), uploadMaxSlotSize);
+	if (uploadBuffer[0] && uploadSlotSize != slotSize) {
+		// left from an upload to another card
+		destroyUploadRing();
+	}
+	uploadSlotSize = slotSize;
 	size_t retries = retry_count;
 	while (retries) {
-		if (chunk_size < 256) {
+		if (uploadSlotSize < 256) {
 			// give up, since there is not even 256 bytes of memory left
 			break;
 		}
 		bool success = true;
-		for (size_t i = 0; i < nr_of_buffers; i++) {
-			success &= checkAndAlloc(buffer[i], chunk_size);
+		for (size_t i = 0; i < uploadSlots; i++) {
+			success &= checkAndAlloc(uploadBuffer[i], uploadSlotSize);
 		}
+#ifdef BOARD_HAS_PSRAM
+		// a smaller bounce buffer only means more write calls per slot
+		for (size_t bounceSize = uploadSlotSize; success && !uploadBounce && bounceSize >= 512; bounceSize /= 2) {
+			uploadBounce = (uint8_t *) heap_caps_aligned_alloc(32, bounceSize, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+			uploadBounceSize = (uploadBounce) ? bounceSize : 0;
+		}
+		success &= (uploadBounce != nullptr);
+#endif
 		if (success) {
 			return true;
 		} else {
-			// one of our buffer went OOM --> free all buffer and retry with less chunk size
-			destroyDoubleBuffer();
-			chunk_size /= 2;
+			// one of our buffer went OOM --> free all buffer and retry with less slot size
+			destroyUploadRing();
+			uploadSlotSize /= 2;
 			retries--;
 		}
 	}
-	destroyDoubleBuffer();
+	destroyUploadRing();
 	return false;
 }
 
@@ -254,7 +325,7 @@ bool listNVSKeys(const char *_namespace, void *data, bool (*callback)(const char
 
 // callback for writing a NVS entry to file
 bool DumpNvsToSdCallback(const char *key, void *data) {
-	String s = gPrefsRfid.getString(key);
+	String s = ResumeJournal_GetEntry(key, "");
 	File *file = (File *) data;
 	file->printf("%s%s%s%s\n", stringOuterDelimiter, key, stringOuterDelimiter, s.c_str());
 	return true;
@@ -331,6 +402,7 @@ void Web_Cyclic(void) {
 		lastCleanupClientsTimestamp = millis();
 		ws.cleanupClients();
 	}
+	websocketPushState();
 }
 // handle not found
 void notFound(AsyncWebServerRequest *request) {
@@ -344,6 +416,9 @@ void notFound(AsyncWebServerRequest *request) {
 void webserverStart(void) {
 	if (!webserverStarted && (Wlan_IsConnected() || (WiFi.getMode() == WIFI_AP))) {
 		// attach AsyncWebSocket for Mgmt-Interface
+		for (uint8_t i = 0; i < websocketPoolSlots; i++) {
+			websocketPool[i] = (char *) x_malloc(websocketMessageSize);
+		}
 		ws.onEvent(onWebsocketEvent);
 		wServer.addHandler(&ws);
 
@@ -501,6 +576,7 @@ void webserverStart(void) {
 			// make a backup first
 			Web_DumpNvsToSd("rfidTags", backupFile);
 			if (gPrefsRfid.clear()) {
+				ResumeJournal_Forget(nullptr);
 				request->send(200);
 			} else {
 				request->send(500);
@@ -525,7 +601,7 @@ void webserverStart(void) {
 			"/explorer", HTTP_POST, [](AsyncWebServerRequest *request) {
 				// we are finished with the upload
 				if (!request->_tempObject) {
-					request->onDisconnect([]() { destroyDoubleBuffer(); });
+					request->onDisconnect([]() { destroyUploadRing(); });
 					request->send(200);
 				}
 			},
@@ -543,6 +619,12 @@ void webserverStart(void) {
 
 		wServer.on("/trackprogress", HTTP_GET, handleTrackProgressRequest);
 
+		wServer.on("/catalog", HTTP_GET, handleCatalogRequest);
+
+		wServer.on("/speechcache", HTTP_GET, handleSpeechCacheRequest);
+		wServer.on("/speechcache", HTTP_POST, handleSpeechCacheRequest);
+		wServer.on("/speechcache", HTTP_DELETE, handleSpeechCacheRequest);
+
 		wServer.on("/savedSSIDs", HTTP_GET, handleGetSavedSSIDs);
 		wServer.addHandler(new AsyncCallbackJsonWebHandler("/savedSSIDs", handlePostSavedSSIDs));
 
@@ -658,6 +740,31 @@ bool JSONToSettings(JsonObject doc) {
 			return false;
 		}
 	}
+#ifdef DSP_ENABLE
+	if (doc.containsKey("dsp")) {
+		// equalizer & limiter
+		if (!Dsp_SetPreset(doc["dsp"]["preset"].as<uint8_t>()) || !Dsp_SetLimiterEnabled(doc["dsp"]["limiter"].as<bool>()) || !Dsp_SetNormalizeEnabled(doc["dsp"]["normalize"].as<bool>())) {
+			Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, "dsp");
+			return false;
+		}
+		// gains of the custom equalizer
+		if (doc["dsp"].containsKey("bands")) {
+			JsonArray bandsArr = doc["dsp"]["bands"].as<JsonArray>();
+			if (bandsArr.size() != dspCustomBandCount) {
+				Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, "dsp");
+				return false;
+			}
+			int8_t gains[dspCustomBandCount];
+			for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+				gains[i] = bandsArr[i].as<int8_t>();
+			}
+			if (!Dsp_SetCustomBands(gains)) {
+				Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, "dsp");
+				return false;
+			}
+		}
+	}
+#endif
 	if (doc.containsKey("ftp")) {
 		const char *_ftpUser = doc["ftp"]["username"];
 		const char *_ftpPwd = doc["ftp"]["password"];
@@ -709,6 +816,7 @@ bool JSONToSettings(JsonObject doc) {
 	} else if (doc.containsKey("rfidMod")) {
 		const char *_rfidIdModId = doc["rfidMod"]["rfidIdMod"];
 		uint8_t _modId = doc["rfidMod"]["modId"];
+		ResumeJournal_Forget(_rfidIdModId);
 		if (_modId <= 0) {
 			gPrefsRfid.remove(_rfidIdModId);
 		} else {
@@ -733,6 +841,7 @@ bool JSONToSettings(JsonObject doc) {
 		char rfidString[275];
 		snprintf(rfidString, sizeof(rfidString) / sizeof(rfidString[0]), "%s%s%s0%s%u%s0", stringDelimiter, _fileOrUrlAscii, stringDelimiter, stringDelimiter, _playMode, stringDelimiter);
 		gPrefsRfid.putString(_rfidIdAssinId, rfidString);
+		ResumeJournal_Forget(_rfidIdAssinId);
 #ifdef DONT_ACCEPT_SAME_RFID_TWICE_ENABLE
 		Rfid_ResetOldRfid(); // Set old rfid-id to crap in order to allow to re-apply a new assigned rfid-tag exactly once
 #endif
@@ -759,7 +868,7 @@ bool JSONToSettings(JsonObject doc) {
 			Cmd_Action(cmd);
 		}
 	} else if (doc.containsKey("trackinfo")) {
-		Web_SendWebsocketData(0, 30);
+		websocketRequestFullState();
 	} else if (doc.containsKey("coverimg")) {
 		Web_SendWebsocketData(0, 40);
 	} else if (doc.containsKey("volume")) {
@@ -772,6 +881,7 @@ bool JSONToSettings(JsonObject doc) {
 		if (doc["trackProgress"].containsKey("posPercent")) {
 			gPlayProperties.seekmode = SEEK_POS_PERCENT;
 			gPlayProperties.currentRelPos = doc["trackProgress"]["posPercent"].as<uint8_t>();
+			AudioPlayer_WakeUp();
 		}
 		Web_SendWebsocketData(0, 80);
 	}
@@ -827,6 +937,21 @@ static void settingsToJSON(JsonObject obj, const String section) {
 		JsonObject playlistObj = obj.createNestedObject("playlist");
 		playlistObj["sortMode"] = EnumUtils::underlying_value(AudioPlayer_GetPlaylistSortMode());
 	}
+#ifdef DSP_ENABLE
+	// equalizer & limiter
+	if ((section == "") || (section == "dsp")) {
+		JsonObject dspObj = obj.createNestedObject("dsp");
+		dspObj["preset"] = EnumUtils::underlying_value(Dsp_GetPreset());
+		dspObj["limiter"] = Dsp_IsLimiterEnabled();
+		dspObj["normalize"] = Dsp_IsNormalizeEnabled();
+		int8_t gains[dspCustomBandCount];
+		Dsp_GetCustomBands(gains);
+		JsonArray bandsArr = dspObj.createNestedArray("bands");
+		for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+			bandsArr.add(gains[i]);
+		}
+	}
+#endif
 #ifdef BATTERY_MEASURE_ENABLE
 	if ((section == "") || (section == "battery")) {
 		// battery settings
@@ -855,6 +980,15 @@ static void settingsToJSON(JsonObject obj, const String section) {
 		defaultsObj["nightBrightness"].set(2u); // LED_INITIAL_NIGHT_BRIGHTNESS
 #endif
 		defaultsObj["sortMode"].set(EnumUtils::underlying_value(AUDIOPLAYER_PLAYLIST_SORT_MODE_DEFAULT));
+#ifdef DSP_ENABLE
+		defaultsObj["dspPreset"].set(EnumUtils::underlying_value(dspPreset::FLAT));
+		defaultsObj["dspLimiter"].set(true);
+		defaultsObj["dspNormalize"].set(false);
+		JsonArray dspBandsArr = defaultsObj.createNestedArray("dspBands");
+		for (uint8_t i = 0; i < dspCustomBandCount; i++) {
+			dspBandsArr.add(0);
+		}
+#endif
 #ifdef BATTERY_MEASURE_ENABLE
 	#ifdef MEASURE_BATTERY_VOLTAGE
 		defaultsObj["warnLowVoltage"].set(s_warningLowVoltage);
@@ -1037,9 +1171,9 @@ void handlePostSettings(AsyncWebServerRequest *request, JsonVariant &json) {
 void handleDebugRequest(AsyncWebServerRequest *request) {
 
 #ifdef BOARD_HAS_PSRAM
-	SpiRamJsonDocument doc(2048);
+	SpiRamJsonDocument doc(3072);
 #else
-	StaticJsonDocument<2048> doc;
+	StaticJsonDocument<3072> doc;
 #endif
 
 	JsonObject infoObj = doc.createNestedObject("info");
@@ -1070,6 +1204,52 @@ void handleDebugRequest(AsyncWebServerRequest *request) {
 		taskObj["stackHighWaterMark"] = task_status_arr[i].usStackHighWaterMark;
 	}
 #endif
+	// time from sending a command to the audio task until it's handled
+	const commandLatency latency = AudioPlayer_GetCommandLatency();
+	JsonObject latencyObj = infoObj.createNestedObject("audioCommandLatency");
+	latencyObj["count"] = latency.count;
+	latencyObj["lastUs"] = latency.lastUs;
+	latencyObj["avgUs"] = latency.avgUs;
+	latencyObj["maxUs"] = latency.maxUs;
+	// playback health, to tell a slow SD card from a decoder short of CPU
+	const playbackStats playback = PlaybackStats_Get();
+	JsonObject playbackObj = infoObj.createNestedObject("playback");
+	playbackObj["underruns"] = playback.underruns;
+	playbackObj["starvedMs"] = playback.starvedMs;
+	JsonArray fillArr = playbackObj.createNestedArray("inBufferFill");
+	for (uint8_t percent : playback.inBufferFill) {
+		fillArr.add(percent);
+	}
+	const auto latencyToJson = [](JsonObject obj, const playbackLatency &latency) {
+		obj["p50Us"] = latency.p50;
+		obj["p95Us"] = latency.p95;
+		obj["p99Us"] = latency.p99;
+		obj["maxUs"] = latency.max;
+	};
+	latencyToJson(playbackObj.createNestedObject("decode"), playback.decode);
+	latencyToJson(playbackObj.createNestedObject("sdRead"), playback.sdRead);
+	// webstream buffer in playtime and its watermarks
+	const streamBufferInfo streamBuffer = StreamBuffer_GetInfo();
+	JsonObject streamObj = playbackObj.createNestedObject("webstream");
+	streamObj["bufferedMs"] = streamBuffer.bufferedMs;
+	streamObj["capacityMs"] = streamBuffer.capacityMs;
+	streamObj["lowWatermarkMs"] = streamBuffer.lowWatermarkMs;
+	streamObj["highWatermarkMs"] = streamBuffer.highWatermarkMs;
+	streamObj["jitterMs"] = streamBuffer.jitterMs;
+	streamObj["reconnects"] = streamBuffer.reconnects;
+	// last file upload through the explorer
+	JsonObject uploadObj = infoObj.createNestedObject("lastUpload");
+	uploadObj["bytes"] = lastUploadStats.bytes;
+	uploadObj["durationMs"] = lastUploadStats.durationMs;
+	uploadObj["stallMs"] = lastUploadStats.stallMs;
+	uploadObj["slots"] = lastUploadStats.slots;
+	uploadObj["slotSize"] = lastUploadStats.slotSize;
+	// SD card shared between playback and uploads
+	const sdArbiterStats arbiter = SdArbiter_GetStats();
+	JsonObject arbiterObj = infoObj.createNestedObject("sdArbiter");
+	arbiterObj["bandwidth"] = arbiter.bandwidth;
+	arbiterObj["throttledMs"] = arbiter.throttledMs;
+	arbiterObj["yieldedMs"] = arbiter.yieldedMs;
 	String serializedJsonString;
 	serializeJson(infoObj, serializedJsonString);
 	if (doc.overflowed()) {
@@ -1102,7 +1282,129 @@ bool processJsonRequest(char *_serialJson) {
 	return JSONToSettings(obj);
 }
 
-// Sends JSON-answers via websocket
+static char *websocketPoolTake(void) {
+	for (uint8_t i = 0; i < websocketPoolSlots; i++) {
+		bool expected = false;
+		if (websocketPool[i] && websocketPoolUsed[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			return websocketPool[i];
+		}
+	}
+	return nullptr;
+}
+
+static void websocketPoolGive(char *_buf) {
+	for (uint8_t i = 0; i < websocketPoolSlots; i++) {
+		if (websocketPool[i] == _buf) {
+			websocketPoolUsed[i].store(false, std::memory_order_release);
+		}
+	}
+}
+
+// Serializes doc into a buffer of the pool and sends it to a client (0: all clients). The library copies the
+// message once and shares it between all clients.
+static void websocketSend(uint32_t client, JsonDocument &doc) {
+	char *jBuf = websocketPoolTake();
+	if (!jBuf) {
+		Log_Println("Websocket: Cannot send data (no message buffer free)!", LOGLEVEL_ERROR);
+		return;
+	}
+	const size_t len = serializeJson(doc, jBuf, websocketMessageSize);
+	if (doc.overflowed()) {
+		// JSON buffer too small for data
+		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
+	}
+
+	if (client == 0) {
+		ws.textAll(jBuf, len);
+	} else {
+		ws.text(client, jBuf, len);
+	}
+	websocketPoolGive(jBuf);
+}
+
+// The next push contains the complete playback state (a client connected)
+void websocketRequestFullState(void) {
+	websocketState.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+}
+
+// Pushes the pending changes of the playback state to all clients, called from Web_Cyclic()
+void websocketPushState(void) {
+	if (!websocketState.due(millis())) {
+		return;
+	}
+	if (!webserverStarted || ws.count() == 0) {
+		websocketState.discard();
+		return;
+	}
+	if (!ws.availableForWriteAll()) {
+		// a client is busy, keep collecting the changes
+		return;
+	}
+
+	websocketPlayback now;
+	now.pausePlay = gPlayProperties.pausePlay;
+	now.currentTrackNumber = gPlayProperties.currentTrackNumber;
+	now.numberOfTracks = (gPlayProperties.playlist) ? gPlayProperties.playlist->size() : 0;
+	now.volume = AudioPlayer_GetCurrentVolume();
+	now.playMode = gPlayProperties.playMode;
+	now.posPermille = lround(gPlayProperties.currentRelPos * 10);
+	now.name = gPlayProperties.title;
+	now.time = AudioPlayer_GetCurrentTime();
+	now.duration = AudioPlayer_GetFileDuration();
+	const uint16_t fields = websocketState.take(now, millis());
+
+	StaticJsonDocument<1024> doc;
+	JsonObject object = doc.to<JsonObject>();
+	if (fields & websocketFieldsTrackinfo) {
+		JsonObject entry = object.createNestedObject("trackinfo");
+		if (fields & websocketFieldPausePlay) {
+			entry["pausePlay"] = now.pausePlay;
+		}
+		if (fields & websocketFieldTrackNumber) {
+			entry["currentTrackNumber"] = now.currentTrackNumber + 1;
+		}
+		if (fields & websocketFieldNumberOfTracks) {
+			entry["numberOfTracks"] = now.numberOfTracks;
+		}
+		if (fields & websocketFieldTrackVolume) {
+			entry["volume"] = now.volume;
+		}
+		if (fields & websocketFieldName) {
+			entry["name"] = websocketState.name(); // the copy that was compared
+		}
+		if (fields & websocketFieldTrackPosition) {
+			entry["posPercent"] = now.posPermille / 10.0;
+		}
+		if (fields & websocketFieldPlayMode) {
+			entry["playMode"] = now.playMode;
+		}
+	}
+	if (fields & websocketFieldCoverimg) {
+		object["coverimg"] = "coverimg";
+	}
+	if (fields & websocketFieldVolume) {
+		object["volume"] = now.volume;
+	}
+	if (fields & websocketFieldsProgress) {
+		JsonObject entry = object.createNestedObject("trackProgress");
+		if (fields & websocketFieldPosition) {
+			entry["posPercent"] = now.posPermille / 10.0;
+		}
+		if (fields & websocketFieldTime) {
+			entry["time"] = now.time;
+		}
+		if (fields & websocketFieldDuration) {
+			entry["duration"] = now.duration;
+		}
+	}
+
+	if (fields) {
+		websocketSend(0, doc);
+	}
+}
+
+// Sends JSON-answers via websocket. Changes of the playback state (trackinfo, coverimg, volume, trackProgress) to all
+// clients are collected and pushed by Web_Cyclic().
 void Web_SendWebsocketData(uint32_t client, uint8_t code) {
 	if (!webserverStarted) {
 		// webserver not yet started
@@ -1112,6 +1414,27 @@ void Web_SendWebsocketData(uint32_t client, uint8_t code) {
 		// we do not have any webclient connected
 		return;
 	}
+	if (client == 0) {
+		uint8_t state = 0;
+		switch (code) {
+			case 30:
+				state = websocketStateTrackinfo;
+				break;
+			case 40:
+				state = websocketStateCoverimg;
+				break;
+			case 50:
+				state = websocketStateVolume;
+				break;
+			case 80:
+				state = websocketStateProgress;
+				break;
+		}
+		if (state) {
+			websocketState.request(state);
+			return;
+		}
+	}
 	// check if we can send message to the client(s)
 	if (client == 0) {
 		if (!ws.availableForWriteAll()) {
@@ -1124,7 +1447,6 @@ void Web_SendWebsocketData(uint32_t client, uint8_t code) {
 			return;
 		}
 	}
-	char *jBuf = (char *) x_calloc(1024, sizeof(char));
 	StaticJsonDocument<1024> doc;
 	JsonObject object = doc.to<JsonObject>();
 
@@ -1167,18 +1489,7 @@ void Web_SendWebsocketData(uint32_t client, uint8_t code) {
 		entry["duration"] = AudioPlayer_GetFileDuration();
 	};
 
-	serializeJson(doc, jBuf, 1024);
-	if (doc.overflowed()) {
-		// JSON buffer too small for data
-		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
-	}
-
-	if (client == 0) {
-		ws.printfAll(jBuf);
-	} else {
-		ws.printf(client, jBuf);
-	}
-	free(jBuf);
+	websocketSend(client, doc);
 }
 
 // Processes websocket-requests
@@ -1224,8 +1535,18 @@ void onWebsocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
 	}
 }
 
+// True if the GET parameter is given without a value or as 1/true
+static bool explorerParamIsTrue(AsyncWebServerRequest *request, const char *name) {
+	if (!request->hasParam(name)) {
+		return false;
+	}
+	const String &value = request->getParam(name)->value();
+	return value.isEmpty() || value == "1" || value.equalsIgnoreCase("true");
+}
+
 // Handles file upload request from the explorer
-// requires a GET parameter path, as directory path to the file
+// requires a GET parameter path, as directory path to the file. The upload shares the SD card with the playback
+// (see SdArbiter). With the GET parameter exclusive (=1/true) the playback is paused instead and the upload is faster.
 void explorerHandleFileUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
 
 	System_UpdateActivityTimer();
@@ -1244,9 +1565,10 @@ void explorerHandleFileUpload(AsyncWebServerRequest *request, String filename, s
 
 		Log_Printf(LOGLEVEL_INFO, writingFile, filePath);
 
-		if (!allocateDoubleBuffer()) {
+		if (!allocateUploadRing()) {
 			// we failed to allocate enough memory
 			Log_Println(unableToAllocateMem, LOGLEVEL_ERROR);
+			uploadAborted = true; // drop the following chunks of this upload
 			handleUploadError(request, 500);
 			return;
 		}
@@ -1256,13 +1578,11 @@ void explorerHandleFileUpload(AsyncWebServerRequest *request, String filename, s
 			explorerFileUploadFinished = xSemaphoreCreateBinary();
 		}
 
-		// reset buffers
-		index_buffer_write = 0;
-		index_buffer_read = 0;
-		for (uint32_t i = 0; i < nr_of_buffers; i++) {
-			size_in_buffer[i] = 0;
-			buffer_full[i] = false;
-		}
+		// reset ring
+		uploadRing.reset();
+		uploadAborted = false;
+		uploadStallMs = 0;
+		uploadExclusive = explorerParamIsTrue(request, "exclusive");
 
 		// Create Task for handling the storage of the data
 		const char *filePathCopy = x_strdup(filePath);
@@ -1280,51 +1600,43 @@ void explorerHandleFileUpload(AsyncWebServerRequest *request, String filename, s
 		request->onDisconnect([]() {
 			// client went away before we were finished...
 			// trigger task suicide, since we can not use Log_Println here
-			xTaskNotify(fileStorageTaskHandle, 2u, eSetValueWithOverwrite);
+			uploadAborted = true;
+			xTaskNotify(fileStorageTaskHandle, uploadNotifyAbort, eSetBits);
 		});
 	}
 
-	if (len) {
-		// wait till buffer is ready
-		while (buffer_full[index_buffer_write]) {
-			vTaskDelay(2u);
-		}
-
-		size_t len_to_write = len;
-		size_t space_left = chunk_size - size_in_buffer[index_buffer_write];
-		if (space_left < len_to_write) {
-			len_to_write = space_left;
-		}
-		// write content to buffer
-		memcpy(buffer[index_buffer_write] + size_in_buffer[index_buffer_write], data, len_to_write);
-		size_in_buffer[index_buffer_write] += len_to_write;
-
-		// check if buffer is filled. If full, signal that ready and change buffers
-		if (size_in_buffer[index_buffer_write] == chunk_size) {
-			// signal, that buffer is ready. Increment index
-			buffer_full[index_buffer_write] = true;
-			index_buffer_write = (index_buffer_write + 1) % nr_of_buffers;
-
-			// if still content left, put it into next buffer
-			if (len_to_write < len) {
-				// wait till new buffer is ready
-				while (buffer_full[index_buffer_write]) {
-					vTaskDelay(2u);
+	while (len && !uploadAborted) {
+		// wait till a slot is free
+		if (uploadRing.full()) {
+			const uint32_t stallStart = millis();
+			while (uploadRing.full() && !uploadAborted) {
+				uploadWaitingProducer = xTaskGetCurrentTaskHandle();
+				if (!uploadRing.full()) {
+					// a slot got freed before we announced that we're waiting
+					uploadWaitingProducer = NULL;
+					break;
 				}
-				size_t len_left_to_write = len - len_to_write;
-				memcpy(buffer[index_buffer_write], data + len_to_write, len_left_to_write);
-				size_in_buffer[index_buffer_write] = len_left_to_write;
+				ulTaskNotifyTake(pdTRUE, portTICK_PERIOD_MS * 10);
 			}
+			uploadWaitingProducer = NULL;
+			uploadStallMs += millis() - stallStart;
 		}
-	}
 
-	if (final) {
-		// if file not completely done yet, signal that buffer is filled
-		if (size_in_buffer[index_buffer_write] > 0) {
-			buffer_full[index_buffer_write] = true;
+		// write content to the slot, a full slot is handed over to the storage task
+		bool published = false;
+		const size_t lenWritten = uploadRing.put(uploadBuffer, uploadSlotSize, data, len, published);
+		data += lenWritten;
+		len -= lenWritten;
+		if (published) {
+			xTaskNotify(fileStorageTaskHandle, uploadNotifyData, eSetBits);
 		}
+	}
+
+	if (final && !uploadAborted) {
+		// if file not completely done yet, hand over the partly filled slot
+		uploadRing.flush();
 		// notify storage task that last data was stored on the ring buffer
-		xTaskNotify(fileStorageTaskHandle, 1u, eSetValueWithOverwrite);
+		xTaskNotify(fileStorageTaskHandle, uploadNotifyFinal, eSetBits);
 		// watit until the storage task is sending the signal to finish
 		xSemaphoreTake(explorerFileUploadFinished, portMAX_DELAY);
 	}
@@ -1347,6 +1659,24 @@ void feedTheDog(void) {
 #endif
 }
 
+// Writes a slot to the file, slots in PSRAM through the DMA capable bounce buffer
+static bool explorerWriteUploadSlot(File &file, const uint8_t *data, size_t len) {
+#ifdef BOARD_HAS_PSRAM
+	while (len) {
+		const size_t n = std::min(len, uploadBounceSize);
+		memcpy(uploadBounce, data, n);
+		if (file.write(uploadBounce, n) != n) {
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+#else
+	return file.write(data, len) == len;
+#endif
+}
+
 // task for writing uploaded data from buffer to SD
 // parameter contains the target file path and must be freed by the task.
 void explorerHandleFileStorageTask(void *parameter) {
@@ -1358,130 +1688,201 @@ void explorerHandleFileStorageTask(void *parameter) {
 	uint32_t transferStartTimestamp = millis();
 	uint32_t lastUpdateTimestamp = millis();
 	uint32_t maxUploadDelay = 20; // After this delay (in seconds) task will be deleted as transfer is considered to be finally broken
+	uint32_t notifications = 0;
 
-	BaseType_t uploadFileNotification;
-	uint32_t uploadFileNotificationValue;
 	uploadFile = gFSystem.open(filePath, "w", true); // open file with create=true to make sure parent directories are created
-	uploadFile.setBufferSize(chunk_size);
+	SdCard_InvalidateSubdirectoryCache();
+	Catalog_Invalidate();
+#ifdef BOARD_HAS_PSRAM
+	// writes of a whole buffer bypass the stdio buffer, which might be in PSRAM as well
+	uploadFile.setBufferSize(uploadBounceSize);
+#else
+	uploadFile.setBufferSize(uploadSlotSize);
+#endif
 
-	// pause some tasks to get more free CPU time for the upload
-	vTaskSuspend(AudioTaskHandle);
-	Led_TaskPause();
-	Rfid_TaskPause();
+	if (uploadExclusive) {
+		// pause some tasks to get more free CPU time for the upload
+		vTaskSuspend(AudioTaskHandle);
+		Led_TaskPause();
+		Rfid_TaskPause();
+	}
 
 	for (;;) {
-		// check buffer is full with enough data or all data already sent
-		uploadFileNotification = xTaskNotifyWait(0, 0, &uploadFileNotificationValue, 0);
-		if ((buffer_full[index_buffer_read]) || (uploadFileNotification == pdPASS && uploadFileNotificationValue == 1u)) {
-
-			while (buffer_full[index_buffer_read]) {
-				chunkCount++;
-				size_t item_size = size_in_buffer[index_buffer_read];
-				if (!uploadFile.write(buffer[index_buffer_read], item_size)) {
-					bytesNok += item_size;
-					feedTheDog();
-				} else {
-					bytesOk += item_size;
-				}
-				// update handling of buffers
-				size_in_buffer[index_buffer_read] = 0;
-				buffer_full[index_buffer_read] = 0;
-				index_buffer_read = (index_buffer_read + 1) % nr_of_buffers;
-				// update timestamp
-				lastUpdateTimestamp = millis();
+		// write all slots handed over by the web server
+		uint32_t slot;
+		size_t slotLen;
+		while (uploadRing.peek(slot, slotLen)) {
+			chunkCount++;
+			if (!uploadExclusive) {
+				SdArbiter_BackgroundBegin(slotLen);
 			}
-
-			if (uploadFileNotification == pdPASS) {
-				uploadFile.close();
-				Log_Printf(LOGLEVEL_INFO, fileWritten, filePath, bytesNok + bytesOk, (millis() - transferStartTimestamp), (bytesNok + bytesOk) / (millis() - transferStartTimestamp));
-				Log_Printf(LOGLEVEL_DEBUG, "Bytes [ok] %zu / [not ok] %zu, Chunks: %zu\n", bytesOk, bytesNok, chunkCount);
-				// done exit loop to terminate
-				break;
+			const bool written = explorerWriteUploadSlot(uploadFile, uploadBuffer[slot], slotLen);
+			if (!uploadExclusive) {
+				SdArbiter_BackgroundEnd();
 			}
-		} else {
-			if (lastUpdateTimestamp + maxUploadDelay * 1000 < millis() || (uploadFileNotification == pdPASS && uploadFileNotificationValue == 2u)) {
-				Log_Println(webTxCanceled, LOGLEVEL_ERROR);
-				free(parameter);
+			if (!written) {
+				bytesNok += slotLen;
+				feedTheDog();
+			} else {
+				bytesOk += slotLen;
+			}
+			// release the slot and wake up the web server if it's waiting for one
+			uploadRing.release();
+			TaskHandle_t waiting = uploadWaitingProducer;
+			if (waiting) {
+				xTaskNotifyGive(waiting);
+			}
+			lastUpdateTimestamp = millis();
+		}
+
+		if (notifications & uploadNotifyAbort || lastUpdateTimestamp + maxUploadDelay * 1000 < millis()) {
+			uploadFile.close();
+			Log_Println(webTxCanceled, LOGLEVEL_ERROR);
+			uploadAborted = true;
+			free(parameter);
+			if (uploadExclusive) {
 				// resume the paused tasks
 				Led_TaskResume();
 				vTaskResume(AudioTaskHandle);
 				Rfid_TaskResume();
-				// destroy double buffer memory, since the upload was interrupted
-				destroyDoubleBuffer();
-				// just delete task without signaling (abort)
-				vTaskDelete(NULL);
-				return;
 			}
-			vTaskDelay(portTICK_PERIOD_MS * 2);
-			continue;
+			// destroy the ring buffer memory, since the upload was interrupted
+			destroyUploadRing();
+			// just delete task without signaling (abort)
+			vTaskDelete(NULL);
+			return;
 		}
+
+		if (notifications & uploadNotifyFinal && uploadRing.drained()) {
+			uploadFile.close();
+			const uint32_t duration = std::max<uint32_t>(millis() - transferStartTimestamp, 1u);
+			const uint32_t bytes = bytesNok + bytesOk;
+			Log_Printf(LOGLEVEL_INFO, fileWritten, filePath, (size_t) bytes, (unsigned long) duration, (unsigned long) (bytes / duration));
+			Log_Printf(LOGLEVEL_DEBUG, uploadThroughput, (unsigned long) (bytes / 1024), (unsigned long) duration, (unsigned long) uploadStallMs, (unsigned long) uploadSlots, uploadSlotSize);
+			Log_Printf(LOGLEVEL_DEBUG, "Bytes [ok] %zu / [not ok] %zu, Chunks: %zu\n", bytesOk, bytesNok, chunkCount);
+			lastUploadStats = {bytes, duration, uploadStallMs, (uint32_t) uploadSlotSize, uploadSlots};
+			// done exit loop to terminate
+			break;
+		}
+
+		// sleep till the web server hands over the next slot
+		uint32_t bits = 0;
+		xTaskNotifyWait(0, ULONG_MAX, &bits, portTICK_PERIOD_MS * 1000);
+		notifications |= bits;
 	}
 	free(parameter);
-	// resume the paused tasks
-	Led_TaskResume();
-	vTaskResume(AudioTaskHandle);
-	Rfid_TaskResume();
+	if (uploadExclusive) {
+		// resume the paused tasks
+		Led_TaskResume();
+		vTaskResume(AudioTaskHandle);
+		Rfid_TaskResume();
+	}
 	// send signal to upload function to terminate
 	xSemaphoreGive(explorerFileUploadFinished);
 	vTaskDelete(NULL);
 }
 
 // Sends a list of the content of a directory as JSON file
-// requires a GET parameter path for the directory
+// requires a GET parameter path for the directory. The entries are written to a chunked response straight from
+// the directory, so memory use doesn't depend on the number of files. Optional parameters:
+// - offset, limit: skip the first offset entries and send at most limit entries (paging)
+// - details: add size and mtime (seconds since epoch) of the entries, takes longer as each entry is opened
+// Every chunk reads at most explorerChunkEntries directory entries, so skipping a large offset doesn't block the
+// web server.
 void explorerHandleListRequest(AsyncWebServerRequest *request) {
 #ifdef NO_SDCARD
 	request->send(200, "application/json; charset=utf-8", "[]"); // maybe better to send 404 here?
 	return;
 #endif
-#ifdef BOARD_HAS_PSRAM
-	SpiRamJsonDocument jsonBuffer(65636);
-#else
-	StaticJsonDocument<8192> jsonBuffer;
-#endif
+	struct listState {
+		listState(File _root, const explorerPaging &_paging, bool _details)
+			: cursor(_root, _paging, _details)
+			, details(_details) { }
+		ExplorerListCursor cursor;
+		bool details;
+		uint8_t phase = 0; // 0: '[' to send, 1: entries, 2: ']' to send, 3: done
+		bool first = true;
+		String pending; // entry, not completely sent yet
+		size_t pendingPos = 0;
+	};
 
-	String serializedJsonString;
-	JsonArray obj = jsonBuffer.createNestedArray();
-	File root;
-	if (request->hasParam("path")) {
-		AsyncWebParameter *param;
-		param = request->getParam("path");
-		const char *filePath = param->value().c_str();
-		root = gFSystem.open(filePath);
-	} else {
-		root = gFSystem.open("/");
+	explorerPaging paging;
+	if (!ExplorerList_ParsePaging((request->hasParam("offset")) ? &request->getParam("offset")->value() : nullptr, (request->hasParam("limit")) ? &request->getParam("limit")->value() : nullptr, paging)) {
+		request->send(400, "text/plain; charset=utf-8", "offset and limit must be non-negative numbers");
+		return;
 	}
-
+	File root = gFSystem.open((request->hasParam("path")) ? request->getParam("path")->value().c_str() : "/");
 	if (!root) {
 		Log_Println(failedToOpenDirectory, LOGLEVEL_DEBUG);
+		request->send(404);
 		return;
 	}
-
 	if (!root.isDirectory()) {
 		Log_Println(notADirectory, LOGLEVEL_DEBUG);
+		root.close();
+		request->send(404);
 		return;
 	}
+	auto state = std::make_shared<listState>(root, paging, request->hasParam("details"));
 
-	bool isDir = false;
-	String MyfileName = root.getNextFileName(&isDir);
-	while (MyfileName != "") {
-		// ignore hidden folders, e.g. MacOS spotlight files
-		if (!MyfileName.startsWith("/.")) {
-			JsonObject entry = obj.createNestedObject();
-			entry["name"] = MyfileName.substring(MyfileName.lastIndexOf('/') + 1);
-			if (isDir) {
-				entry["dir"].set(true);
+	AsyncWebServerResponse *response = request->beginChunkedResponse("application/json; charset=utf-8",
+		[state](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+			maxLen = maxLen >> 1; // some sort of bug with actual size available, reduce the len
+			size_t len = 0;
+			if (state->phase == 0 && len < maxLen) {
+				buffer[len++] = '[';
+				state->phase = 1;
 			}
-		}
-		MyfileName = root.getNextFileName(&isDir);
-	}
-	root.close();
-
-	serializeJson(obj, serializedJsonString);
-	if (jsonBuffer.overflowed()) {
-		// JSON buffer too small for data
-		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
-	}
-	request->send(200, "application/json; charset=utf-8", serializedJsonString);
+			state->cursor.startChunk();
+			while (state->phase == 1 && len < maxLen) {
+				if (state->pending.isEmpty()) {
+					// next entry of the directory
+					explorerEntry dirEntry;
+					const ExplorerStep step = state->cursor.next(dirEntry);
+					if (step == ExplorerStep::Done) {
+						state->phase = 2;
+						break;
+					}
+					if (step == ExplorerStep::ChunkFull) {
+						if (!len) {
+							// only skipped entries so far, whitespace keeps the response going (0 would end it)
+							buffer[len++] = ' ';
+						}
+						break;
+					}
+					StaticJsonDocument<512> entry;
+					entry["name"] = dirEntry.path.substring(dirEntry.path.lastIndexOf('/') + 1);
+					if (dirEntry.isDir) {
+						entry["dir"].set(true);
+					}
+					if (state->details) {
+						if (!dirEntry.isDir) {
+							entry["size"] = dirEntry.size;
+						}
+						entry["mtime"] = dirEntry.mtime;
+					}
+					String json;
+					serializeJson(entry, json);
+					state->pending = (state->first) ? json : "," + json;
+					state->first = false;
+					state->pendingPos = 0;
+				}
+				// as much as fits, the rest goes into the next chunk
+				const size_t n = std::min(maxLen - len, state->pending.length() - state->pendingPos);
+				memcpy(buffer + len, state->pending.c_str() + state->pendingPos, n);
+				len += n;
+				state->pendingPos += n;
+				if (state->pendingPos == state->pending.length()) {
+					state->pending = "";
+				}
+			}
+			if (state->phase == 2 && len < maxLen) {
+				buffer[len++] = ']';
+				state->phase = 3;
+			}
+			return len;
+		});
+	request->send(response);
 }
 
 bool explorerDeleteDirectory(File dir) {
@@ -1531,25 +1932,59 @@ void explorerHandleDownloadRequest(AsyncWebServerRequest *request) {
 		return;
 	}
 
-	// ready to serve the file for download.
+	const size_t fileSize = file.size();
+	char etag[httpETagSize];
+	char lastModified[httpDateSize];
+	HttpRange_Validators(fileSize, file.getLastWrite(), etag, lastModified);
+
+	if (request->hasHeader("If-None-Match") && HttpRange_IfNoneMatch(request->getHeader("If-None-Match")->value().c_str(), etag)) {
+		AsyncWebServerResponse *response = request->beginResponse(304);
+		response->addHeader("ETag", etag);
+		request->send(response);
+		return;
+	}
+
+	// Range: a single range is served partially (206), e.g. to resume a download or to seek in audio.
+	// If-Range: only if the file is still the one the client has the first part of, otherwise all of it.
+	size_t rangeStart = 0;
+	size_t rangeEnd = fileSize; // exclusive
+	bool partial = false;
+	if (request->hasHeader("Range") && (!request->hasHeader("If-Range") || HttpRange_IfRange(request->getHeader("If-Range")->value().c_str(), etag, lastModified))) {
+		const HttpRangeResult range = HttpRange_Parse(request->getHeader("Range")->value().c_str(), fileSize, rangeStart, rangeEnd);
+		if (range == HttpRangeResult::Unsatisfiable) {
+			AsyncWebServerResponse *response = request->beginResponse(416);
+			response->addHeader("Content-Range", "bytes */" + String(fileSize));
+			request->send(response);
+			return;
+		}
+		partial = (range == HttpRangeResult::Partial);
+	}
+	if (rangeStart && !file.seek(rangeStart)) {
+		request->send(500);
+		return;
+	}
+
+	// ready to serve the file for download. The file is closed when the response is destroyed, even if the client aborts.
 	String dataType = "application/octet-stream";
-	struct fileBlk {
-		File dataFile;
-	};
-	fileBlk *fileObj = new fileBlk;
-	fileObj->dataFile = file;
-	request->_tempObject = (void *) fileObj;
-
-	AsyncWebServerResponse *response = request->beginResponse(dataType, fileObj->dataFile.size(), [request](uint8_t *buffer, size_t maxlen, size_t index) -> size_t {
-		fileBlk *fileObj = (fileBlk *) request->_tempObject;
-		size_t thisSize = fileObj->dataFile.read(buffer, maxlen);
-		if ((index + thisSize) >= fileObj->dataFile.size()) {
-			fileObj->dataFile.close();
-			request->_tempObject = NULL;
-			delete fileObj;
-		}
-		return thisSize;
+	AsyncWebServerResponse *response = request->beginResponse(dataType, rangeEnd - rangeStart, [file, rangeStart, rangeEnd](uint8_t *buffer, size_t maxlen, size_t index) mutable -> size_t {
+		const size_t pos = rangeStart + index;
+		size_t len = std::min(maxlen, rangeEnd - pos);
+		if (len > 512) {
+			// as much as the TCP window takes, but in whole sectors of the SD card
+			len = ((pos + len) & ~size_t(511)) - pos;
+		}
+		if (file.position() != pos) {
+			file.seek(pos);
+		}
+		return file.read(buffer, len);
 	});
+	if (partial) {
+		response->setCode(206);
+		response->addHeader("Content-Range", "bytes " + String(rangeStart) + "-" + String(rangeEnd - 1) + "/" + String(fileSize));
+	}
+	response->addHeader("Accept-Ranges", "bytes");
+	response->addHeader("ETag", etag);
+	response->addHeader("Last-Modified", lastModified);
 	String filename = String(param->value().c_str());
 	response->addHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
 	request->send(response);
@@ -1566,8 +2001,10 @@ void explorerHandleDeleteRequest(AsyncWebServerRequest *request) {
 		if (gFSystem.exists(filePath)) {
 			// stop playback, file to delete might be in use
 			Cmd_Action(CMD_STOP);
+			Catalog_Invalidate();
 			file = gFSystem.open(filePath);
 			if (file.isDirectory()) {
+				SdCard_InvalidateSubdirectoryCache();
 				if (explorerDeleteDirectory(file)) {
 					Log_Printf(LOGLEVEL_INFO, "DELETE:  %s deleted", filePath);
 				} else {
@@ -1598,6 +2035,8 @@ void explorerHandleCreateRequest(AsyncWebServerRequest *request) {
 		param = request->getParam("path");
 		const char *filePath = param->value().c_str();
 		if (gFSystem.mkdir(filePath)) {
+			SdCard_InvalidateSubdirectoryCache();
+			Catalog_Invalidate();
 			Log_Printf(LOGLEVEL_INFO, "CREATE:  %s created", filePath);
 		} else {
 			Log_Printf(LOGLEVEL_ERROR, "CREATE:  Cannot create %s", filePath);
@@ -1621,6 +2060,8 @@ void explorerHandleRenameRequest(AsyncWebServerRequest *request) {
 		const char *dstFullFilePath = dstPath->value().c_str();
 		if (gFSystem.exists(srcFullFilePath)) {
 			if (gFSystem.rename(srcFullFilePath, dstFullFilePath)) {
+				SdCard_InvalidateSubdirectoryCache();
+				Catalog_Invalidate();
 				Log_Printf(LOGLEVEL_INFO, "RENAME:  %s renamed to %s", srcFullFilePath, dstFullFilePath);
 			} else {
 				Log_Printf(LOGLEVEL_ERROR, "RENAME:  Cannot rename %s", srcFullFilePath);
@@ -1670,6 +2111,137 @@ void handleTrackProgressRequest(AsyncWebServerRequest *request) {
 	request->send(200, "application/json", json);
 }
 
+// Handles media catalog requests: state of the catalog and, if parameter path is given, the tracks within that
+// directory and its subdirectories. The tracks are streamed as chunked response, every chunk continues the walk
+// through the catalog where the last one stopped and visits at most catalogChunkRecords records. Optional parameters:
+// - offset, limit: skip the first offset tracks and send at most limit tracks (default 20)
+void handleCatalogRequest(AsyncWebServerRequest *request) {
+	constexpr uint32_t catalogChunkRecords = 64;
+	struct catalogState {
+		String path;
+		CatalogCursor cursor;
+		size_t skip; // tracks still to skip (offset)
+		size_t remaining; // tracks still to send (limit)
+		uint8_t phase = 0; // 0: head to send, 1: tracks, 2: done
+		bool first = true;
+		String pending; // not completely sent yet
+		size_t pendingPos = 0;
+	};
+
+	const long offset = (request->hasParam("offset")) ? request->getParam("offset")->value().toInt() : 0;
+	const long limit = (request->hasParam("limit")) ? request->getParam("limit")->value().toInt() : 20;
+	if (offset < 0 || limit < 0) {
+		request->send(400, "text/plain; charset=utf-8", "offset and limit must not be negative");
+		return;
+	}
+	auto state = std::make_shared<catalogState>();
+	state->skip = offset;
+	state->remaining = (request->hasParam("path")) ? limit : 0;
+	if (state->remaining) {
+		state->path = request->getParam("path")->value();
+	}
+
+	AsyncWebServerResponse *response = request->beginChunkedResponse("application/json; charset=utf-8",
+		[state](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+			maxLen = maxLen >> 1; // some sort of bug with actual size available, reduce the len
+			size_t len = 0;
+			bool walked = false;
+			if (state->phase == 0) {
+				state->pending = "{\"ready\":" + String(Catalog_IsReady() ? "true" : "false");
+				state->pending += ",\"scanning\":" + String(Catalog_IsScanning() ? "true" : "false");
+				state->pending += ",\"tracks\":" + String(Catalog_GetTrackCount());
+				state->pending += ",\"dirs\":" + String(Catalog_GetDirCount());
+				state->pending += (state->remaining) ? ",\"list\":[" : "}";
+				state->phase = (state->remaining) ? 1 : 2;
+			}
+			while (len < maxLen) {
+				if (state->pendingPos < state->pending.length()) {
+					// as much as fits, the rest goes into the next chunk
+					const size_t n = std::min(maxLen - len, state->pending.length() - state->pendingPos);
+					memcpy(buffer + len, state->pending.c_str() + state->pendingPos, n);
+					len += n;
+					state->pendingPos += n;
+					continue;
+				}
+				state->pending = "";
+				state->pendingPos = 0;
+				if (state->phase != 1) {
+					break;
+				}
+				if (!state->remaining || state->cursor.done) {
+					state->pending = "]}";
+					state->phase = 2;
+					continue;
+				}
+				if (walked) {
+					// one step through the catalog per chunk, don't block the web server
+					break;
+				}
+				walked = true;
+				const size_t room = maxLen - len;
+				auto addTrack = [&state, room](const CatalogTrack &track) {
+					if (state->skip) {
+						state->skip--;
+						return true;
+					}
+					StaticJsonDocument<768> entry;
+					entry["path"] = String(track.dir) + "/" + track.name;
+					entry["codec"] = Catalog_CodecName(track.codec);
+					entry["size"] = track.size;
+					entry["duration"] = track.durationMs / 1000;
+					if (*track.title) {
+						entry["title"] = track.title;
+					}
+					if (*track.artist) {
+						entry["artist"] = track.artist;
+					}
+					if (*track.album) {
+						entry["album"] = track.album;
+					}
+					if (track.gain != catalogNoGain) {
+						entry["gain"] = track.gain / 100.0f;
+					}
+					String json;
+					serializeJson(entry, json);
+					state->pending += (state->first) ? json : "," + json;
+					state->first = false;
+					state->remaining--;
+					return state->remaining && state->pending.length() < room;
+				};
+				if (!Catalog_ForEachTrack(state->path.c_str(), addTrack, &state->cursor, catalogChunkRecords)) {
+					// no catalog or it was replaced by a new scan in the meantime
+					state->remaining = 0;
+				}
+				if (state->pending.isEmpty() && !len) {
+					// only records of other directories so far, whitespace keeps the response going
+					buffer[len++] = ' ';
+				}
+			}
+			return len;
+		});
+	request->send(response);
+	System_UpdateActivityTimer();
+}
+
+// Handles speech cache requests: POST fetches all phrases of the announcements (optionally from the TTS endpoint
+// given by parameter url), DELETE removes the cached clips. Returns the number of phrases still to be fetched.
+void handleSpeechCacheRequest(AsyncWebServerRequest *request) {
+	if (request->method() == HTTP_POST) {
+		const String url = (request->hasParam("url")) ? request->getParam("url")->value() : "";
+		if (!SpeechCache_Prewarm(url.c_str())) {
+			request->send(501, "text/plain; charset=utf-8", "speech cache disabled");
+			return;
+		}
+	} else if (request->method() == HTTP_DELETE) {
+		SpeechCache_Clear();
+	}
+	AsyncJsonResponse *response = new AsyncJsonResponse(false, 64);
+	JsonObject obj = response->getRoot();
+	obj["pending"] = SpeechCache_GetPending();
+	response->setLength();
+	request->send(response);
+}
+
 void handleGetSavedSSIDs(AsyncWebServerRequest *request) {
 	AsyncJsonResponse *response = new AsyncJsonResponse(true);
 	JsonArray json_ssids = response->getRoot();
@@ -1773,7 +2345,7 @@ void handlePostWiFiConfig(AsyncWebServerRequest *request, JsonVariant &json) {
 }
 
 static bool tagIdToJSON(const String tagId, JsonObject entry) {
-	String s = gPrefsRfid.getString(tagId.c_str(), "-1"); // Try to lookup rfidId in NVS
+	String s = ResumeJournal_GetEntry(tagId.c_str(), "-1"); // Try to lookup rfidId in NVS
 	if (!s.compareTo("-1")) {
 		return false;
 	}
@@ -1926,6 +2498,7 @@ static void handlePostRFIDRequest(AsyncWebServerRequest *request, JsonVariant &j
 	char rfidString[275];
 	snprintf(rfidString, sizeof(rfidString) / sizeof(rfidString[0]), "%s%s%s0%s%u%s0", stringDelimiter, _fileOrUrlAscii, stringDelimiter, stringDelimiter, _playModeOrModId, stringDelimiter);
 	gPrefsRfid.putString(tagId.c_str(), rfidString);
+	ResumeJournal_Forget(tagId.c_str());
 
 	String s = gPrefsRfid.getString(tagId.c_str(), "-1");
 	if (s.compareTo(rfidString)) {
@@ -1957,6 +2530,7 @@ static void handleDeleteRFIDRequest(AsyncWebServerRequest *request) {
 			Cmd_Action(CMD_STOP);
 		}
 		if (gPrefsRfid.remove(tagId.c_str())) {
+			ResumeJournal_Forget(tagId.c_str());
 			Log_Printf(LOGLEVEL_INFO, "/rfid (DELETE): tag %s removed successfuly", tagId);
 			request->send(200, "text/plain; charset=utf-8", tagId + " removed successfuly");
 		} else {
@@ -2064,15 +2638,104 @@ void Web_DumpSdToNvs(const char *_filename) {
 	}
 
 	Led_SetPause(false);
+	ResumeJournal_Forget(nullptr); // positions from before the restore are outdated
 	Log_Printf(LOGLEVEL_NOTICE, importCountNokNvs, invalidCount);
 	tmpFile.close();
 	gFSystem.remove(_filename);
 }
 
+// Cover image of the current track, extracted once and kept in RAM (PSRAM if available)
+struct CoverImage {
+	~CoverImage() { free(data); }
+
+	char etag[27];
+	char mimeType[64];
+	uint8_t *data = nullptr;
+	size_t size = 0;
+};
+static std::shared_ptr<CoverImage> coverCache;
+
+#ifdef BOARD_HAS_PSRAM
+static constexpr size_t coverCacheMaxSize = 1024 * 1024;
+#else
+static constexpr size_t coverCacheMaxSize = 32768; // larger covers are streamed from the SD card
+#endif
+
+// Parses the header of the cover image (ID3v2 APIC frame or FLAC PICTURE block) found by the audio library
+// with a single block read. Returns the mime type and where the image data is located in the file.
+static bool parseCoverHeader(File &coverFile, char *mimeType, size_t &dataStart, size_t &dataLen) {
+	uint8_t buf[512];
+	char fileType[4];
+	if (coverFile.readBytes(fileType, 4) != 4 || !coverFile.seek(gPlayProperties.coverFilePos)) {
+		return false;
+	}
+	const size_t len = coverFile.read(buf, sizeof(buf));
+	if (len < 16) {
+		return false;
+	}
+	size_t pos = 0;
+	auto readBe32 = [&buf, &pos]() {
+		const uint32_t value = (static_cast<uint32_t>(buf[pos]) << 24) | (buf[pos + 1] << 16) | (buf[pos + 2] << 8) | buf[pos + 3];
+		pos += 4;
+		return value;
+	};
+
+	if (strncmp(fileType, "ID3", 3) == 0) { // mp3 (ID3v2)
+		// encoding (1 Byte), mime type and description (null terminated), picture type (1 Byte) between them
+		const uint8_t encoding = buf[pos++];
+		const uint8_t *mimeEnd = static_cast<const uint8_t *>(memchr(buf + pos, 0, len - pos));
+		if (!mimeEnd || static_cast<size_t>(mimeEnd - buf - pos) >= sizeof(CoverImage::mimeType)) {
+			return false;
+		}
+		strcpy(mimeType, reinterpret_cast<const char *>(buf + pos));
+		pos = mimeEnd - buf + 2;
+		if (encoding == 1 || encoding == 2) {
+			// UTF-16 and UTF-16BE are terminated with two zero bytes
+			while (pos + 1 < len && (buf[pos] || buf[pos + 1])) {
+				pos += 2;
+			}
+			pos += 2;
+		} else {
+			while (pos < len && buf[pos]) {
+				pos++;
+			}
+			pos++;
+		}
+		if (pos > len || pos >= gPlayProperties.coverFileSize) {
+			return false;
+		}
+		dataStart = gPlayProperties.coverFilePos + pos;
+		dataLen = gPlayProperties.coverFileSize - pos;
+		return true;
+	}
+	if (strncmp(fileType, "fLaC", 4) == 0) { // flac
+		// cover filesize (3 Bytes) and picture type (4 Bytes), then length prefixed mime type and description
+		pos = 7;
+		const uint32_t mimeLen = readBe32();
+		if (mimeLen >= sizeof(CoverImage::mimeType) || pos + mimeLen + 4 > len) {
+			return false;
+		}
+		memcpy(mimeType, buf + pos, mimeLen);
+		mimeType[mimeLen] = '\0';
+		pos += mimeLen;
+		const uint32_t descriptionLen = readBe32();
+		// description, width, height, color depth and number of colors
+		pos += descriptionLen + 16;
+		if (pos + 4 > len) {
+			return false;
+		}
+		dataLen = readBe32();
+		dataStart = gPlayProperties.coverFilePos + pos;
+		return true;
+	}
+	return false;
+}
+
 // handle album cover image request
 static void handleCoverImageRequest(AsyncWebServerRequest *request) {
 
 	if (!gPlayProperties.coverFilePos || !gPlayProperties.playlist) {
+		coverCache.reset();
 		String stationLogoUrl = AudioPlayer_GetStationLogoUrl();
 		if (stationLogoUrl != "") {
 			// serve station logo
@@ -2095,78 +2758,65 @@ static void handleCoverImageRequest(AsyncWebServerRequest *request) {
 			}
 		return;
 	}
-	char *coverFileName = gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
-	Log_Println(coverFileName, LOGLEVEL_DEBUG);
+	const Playlist::Path coverFilePath = gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber);
+	const char *coverFileName = coverFilePath.c_str();
 
-	File coverFile = gFSystem.open(coverFileName, FILE_READ);
-	char mimeType[255];
-	char fileType[4];
-	coverFile.readBytes(fileType, 4);
-	if (strncmp(fileType, "ID3", 3) == 0) { // mp3 (ID3v2) Routine
-		// seek to start position
-		coverFile.seek(gPlayProperties.coverFilePos);
-		uint8_t encoding = coverFile.read();
-		// mime-type (null terminated)
-		for (uint8_t i = 0u; i < 255; i++) {
-			mimeType[i] = coverFile.read();
-			if (uint8_t(mimeType[i]) == 0) {
-				break;
-			}
-		}
-		// skip image type (1 Byte)
-		coverFile.read();
-		// skip description (null terminated)
-		for (uint8_t i = 0u; i < 255; i++) {
-			if (uint8_t(coverFile.read()) == 0) {
-				break;
-			}
-		}
-		// UTF-16 and UTF-16BE are terminated with an extra 0
-		if (encoding == 1 || encoding == 2) {
-			coverFile.read();
-		}
-	} else if (strncmp(fileType, "fLaC", 4) == 0) { // flac Routine
-		uint32_t length = 0; // length of strings: MIME type, description of the picture, binary picture data
-		coverFile.seek(gPlayProperties.coverFilePos + 7); // pass cover filesize (3 Bytes) and picture type (4 Bytes)
-		for (int i = 0; i < 4; ++i) { // length of mime type string
-			length = (length << 8) | coverFile.read();
-		}
-		for (uint8_t i = 0u; i < length; i++) {
-			mimeType[i] = coverFile.read();
-		}
-		mimeType[length] = '\0';
+	// the cover is identified by its file and position within, so the browser can revalidate without touching the SD card
+	char etag[sizeof(CoverImage::etag)];
+	snprintf(etag, sizeof(etag), "\"%08x%08x%08x\"", Hash_Fnv1aStr(coverFileName), gPlayProperties.coverFilePos, gPlayProperties.coverFileSize);
+	if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value().equals(etag)) {
+		AsyncWebServerResponse *response = request->beginResponse(304);
+		response->addHeader("ETag", etag);
+		request->send(response);
+		return;
+	}
 
-		length = 0;
-		for (int i = 0; i < 4; ++i) { // length of description string
-			length = (length << 8) | coverFile.read();
+	std::shared_ptr<CoverImage> cover = coverCache;
+	if (!cover || strcmp(cover->etag, etag) != 0) {
+		coverCache.reset();
+		Log_Println(coverFileName, LOGLEVEL_DEBUG);
+		File coverFile = gFSystem.open(coverFileName, FILE_READ);
+		char mimeType[sizeof(CoverImage::mimeType)];
+		size_t dataStart, dataLen;
+		if (!coverFile || !parseCoverHeader(coverFile, mimeType, dataStart, dataLen)) {
+			request->send(404);
+			return;
 		}
-		coverFile.seek(length + 16, SeekCur); // pass description, width, height, color depth, number of colors
+		Log_Printf(LOGLEVEL_NOTICE, "serve cover image (%s): %s", mimeType, coverFileName);
 
-		length = 0;
-		for (int i = 0; i < 4; ++i) { // length of picture data
-			length = (length << 8) | coverFile.read();
+		cover = std::make_shared<CoverImage>();
+		if (dataLen <= coverCacheMaxSize) {
+			cover->data = static_cast<uint8_t *>(x_malloc(dataLen));
 		}
-		gPlayProperties.coverFileSize = length;
+		if (!cover->data || !coverFile.seek(dataStart) || coverFile.read(cover->data, dataLen) != dataLen) {
+			// not enough memory to keep it, stream it straight from the file
+			coverFile.seek(dataStart);
+			AsyncWebServerResponse *response = request->beginResponse(mimeType, dataLen, [coverFile, dataLen](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+				File file = coverFile; // local copy of file pointer
+				const size_t willWrite = file.read(buffer, std::min(maxLen, dataLen - index));
+				if (index + willWrite >= dataLen) {
+					file.close();
+				}
+				return willWrite;
+			});
+			response->addHeader("Cache-Control", "no-cache");
+			response->addHeader("ETag", etag);
+			request->send(response);
+			return;
+		}
+		cover->size = dataLen;
+		strcpy(cover->etag, etag);
+		strcpy(cover->mimeType, mimeType);
+		coverCache = cover;
 	}
-	Log_Printf(LOGLEVEL_NOTICE, "serve cover image (%s): %s", mimeType, coverFileName);
 
-	int imageSize = gPlayProperties.coverFileSize;
-	AsyncWebServerResponse *response = request->beginChunkedResponse(mimeType, [coverFile, imageSize](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
-		// some kind of webserver bug with actual size available, reduce the len
-		if (maxLen > 1024) {
-			maxLen = 1024;
-		}
-		File file = coverFile; // local copy of file pointer
-		size_t leftToWrite = imageSize - index;
-		if (!leftToWrite) {
-			file.close();
-			return 0; // end of transfer
-		}
-		size_t willWrite = (leftToWrite > maxLen) ? maxLen : leftToWrite;
-		file.read(buffer, willWrite);
-		index += willWrite;
+	// the response keeps its own reference, so the cache can move on to the next track while it's sent
+	AsyncWebServerResponse *response = request->beginResponse(cover->mimeType, cover->size, [cover](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+		const size_t willWrite = std::min(maxLen, cover->size - index);
+		memcpy(buffer, cover->data + index, willWrite);
 		return willWrite;
 	});
-	response->addHeader("Cache Control", "no-cache, must-revalidate");
+	response->addHeader("Cache-Control", "no-cache");
+	response->addHeader("ETag", etag);
 	request->send(response);
 }
@@ -0,0 +1,82 @@
+#include "WebsocketState.h"
+
+#include <string.h>
+
+// True if a push is pending and the last one is long enough ago
+bool WebsocketState::due(uint32_t _millis) const {
+	return pending.load() && (_millis - lastPush) >= websocketPushInterval;
+}
+
+// Takes the pending pushes: the fields of them that changed since the last push (all of them after a request of
+// the complete state). Requests arriving meanwhile go into the next push.
+uint16_t WebsocketState::take(const websocketPlayback &_now, uint32_t _millis) {
+	const uint8_t states = pending.exchange(0);
+	lastPush = _millis;
+	if (states & websocketStateFull) {
+		trackinfoValid = false;
+		volumeValid = false;
+		progressValid = false;
+	}
+
+	uint16_t fields = 0;
+	if (states & websocketStateTrackinfo) {
+		const bool all = !trackinfoValid;
+		if (all || pausePlay != _now.pausePlay) {
+			pausePlay = _now.pausePlay;
+			fields |= websocketFieldPausePlay;
+		}
+		if (all || currentTrackNumber != _now.currentTrackNumber) {
+			currentTrackNumber = _now.currentTrackNumber;
+			fields |= websocketFieldTrackNumber;
+		}
+		if (all || numberOfTracks != _now.numberOfTracks) {
+			numberOfTracks = _now.numberOfTracks;
+			fields |= websocketFieldNumberOfTracks;
+		}
+		if (all || trackVolume != _now.volume) {
+			trackVolume = _now.volume;
+			fields |= websocketFieldTrackVolume;
+		}
+		if (all || strncmp(trackName, _now.name, sizeof(trackName) - 1)) {
+			strncpy(trackName, _now.name, sizeof(trackName) - 1);
+			fields |= websocketFieldName;
+		}
+		if (all || trackPosPermille != _now.posPermille) {
+			trackPosPermille = _now.posPermille;
+			fields |= websocketFieldTrackPosition;
+		}
+		if (all || playMode != _now.playMode) {
+			playMode = _now.playMode;
+			fields |= websocketFieldPlayMode;
+		}
+		trackinfoValid = true;
+	}
+	if (states & websocketStateCoverimg) {
+		// the image itself isn't known here, every change is pushed
+		fields |= websocketFieldCoverimg;
+	}
+	if (states & websocketStateVolume) {
+		if (!volumeValid || volume != _now.volume) {
+			volume = _now.volume;
+			fields |= websocketFieldVolume;
+		}
+		volumeValid = true;
+	}
+	if (states & websocketStateProgress) {
+		const bool all = !progressValid;
+		if (all || posPermille != _now.posPermille) {
+			posPermille = _now.posPermille;
+			fields |= websocketFieldPosition;
+		}
+		if (all || time != _now.time) {
+			time = _now.time;
+			fields |= websocketFieldTime;
+		}
+		if (all || duration != _now.duration) {
+			duration = _now.duration;
+			fields |= websocketFieldDuration;
+		}
+		progressValid = true;
+	}
+	return fields;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Changes of the playback state aren't pushed to the websocket clients at once: they're collected (any task
+// may request a push) and sent to all clients together at most every websocketPushInterval, containing only
+// the fields that changed since the last push. Kept free of the web server, so it's compiled and checked on a
+// PC as well.
+
+static constexpr uint32_t websocketPushInterval = 250; // ms
+static constexpr uint8_t websocketStateTrackinfo = 1; // pending pushes
+static constexpr uint8_t websocketStateCoverimg = 2;
+static constexpr uint8_t websocketStateVolume = 4;
+static constexpr uint8_t websocketStateProgress = 8;
+static constexpr uint8_t websocketStateFull = 16; // a client asked for the complete state
+
+// Fields of a push, returned by WebsocketState::take()
+static constexpr uint16_t websocketFieldPausePlay = 1 << 0; // trackinfo
+static constexpr uint16_t websocketFieldTrackNumber = 1 << 1;
+static constexpr uint16_t websocketFieldNumberOfTracks = 1 << 2;
+static constexpr uint16_t websocketFieldTrackVolume = 1 << 3;
+static constexpr uint16_t websocketFieldName = 1 << 4;
+static constexpr uint16_t websocketFieldTrackPosition = 1 << 5;
+static constexpr uint16_t websocketFieldPlayMode = 1 << 6;
+static constexpr uint16_t websocketFieldCoverimg = 1 << 7; // coverimg
+static constexpr uint16_t websocketFieldVolume = 1 << 8; // volume
+static constexpr uint16_t websocketFieldPosition = 1 << 9; // trackProgress
+static constexpr uint16_t websocketFieldTime = 1 << 10;
+static constexpr uint16_t websocketFieldDuration = 1 << 11;
+static constexpr uint16_t websocketFieldsTrackinfo = (1 << 7) - 1;
+static constexpr uint16_t websocketFieldsProgress = websocketFieldPosition | websocketFieldTime | websocketFieldDuration;
+
+static constexpr size_t websocketNameSize = 255;
+
+// Playback state at the time of a push
+typedef struct {
+	bool pausePlay;
+	size_t currentTrackNumber; // 0 based
+	size_t numberOfTracks;
+	uint8_t volume;
+	uint8_t playMode;
+	int32_t posPermille;
+	const char *name;
+	uint32_t time;
+	uint32_t duration;
+} websocketPlayback;
+
+class WebsocketState {
+public:
+	// Any task: a push of _states is due
+	void request(uint8_t _states) {
+		pending.fetch_or(_states);
+	}
+	// Nobody's listening, the next client asks for the complete state
+	void discard(void) {
+		pending.store(0);
+	}
+	bool due(uint32_t _millis) const;
+	uint16_t take(const websocketPlayback &_now, uint32_t _millis);
+	// Name as of the last push
+	const char *name(void) const {
+		return trackName;
+	}
+
+private:
+	std::atomic<uint8_t> pending {0};
+	uint32_t lastPush = 0;
+
+	// what the clients got with the last push (only used by take())
+	bool trackinfoValid = false;
+	bool pausePlay = false;
+	size_t currentTrackNumber = 0;
+	size_t numberOfTracks = 0;
+	uint8_t trackVolume = 0;
+	uint8_t playMode = 0;
+	int32_t trackPosPermille = 0;
+	char trackName[websocketNameSize] = {};
+	bool volumeValid = false;
+	uint8_t volume = 0;
+	bool progressValid = false;
+	int32_t posPermille = 0;
+	uint32_t time = 0;
+	uint32_t duration = 0;
+};
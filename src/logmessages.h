@@ -251,3 +251,30 @@ extern const char cantConnectToWifi[];
 extern const char wifiSetLastSSID[];
 extern const char mDNSStarted[];
 extern const char mDNSFailed[];
+extern const char playlistFromIndex[];
+extern const char playlistIndexWritten[];
+extern const char playlistIndexWriteFailed[];
+extern const char m3uLineTooLong[];
+extern const char m3uLazyIndexed[];
+extern const char playlistShuffled[];
+extern const char catalogScanStarted[];
+extern const char catalogScanResumed[];
+extern const char catalogScanFinished[];
+extern const char catalogWriteFailed[];
+extern const char trackGapMeasured[];
+extern const char seekIndexBuilt[];
+extern const char seekIndexPruned[];
+extern const char resumeJournalReplayed[];
+extern const char resumeJournalWritten[];
+extern const char resumeJournalWriteFailed[];
+extern const char streamBufferLow[];
+extern const char webstreamReconnectScheduled[];
+extern const char webstreamReconnect[];
+extern const char speechCacheFetched[];
+extern const char speechCacheFetchFailed[];
+extern const char speechCachePrewarm[];
+extern const char speechTimeUnknown[];
+extern const char uploadThroughput[];
+extern const char playlistPathTooLong[];
+extern const char playlistIndexStale[];
+extern const char playlistIndexPruned[];
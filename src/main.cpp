@@ -8,6 +8,7 @@
 #include "Battery.h"
 #include "Bluetooth.h"
 #include "Button.h"
+#include "Catalog.h"
 #include "Cmd.h"
 #include "Common.h"
 #include "Ftp.h"
@@ -20,9 +21,12 @@
 #include "Port.h"
 #include "Power.h"
 #include "Queues.h"
+#include "ResumeJournal.h"
 #include "Rfid.h"
 #include "RotaryEncoder.h"
+#include "SdArbiter.h"
 #include "SdCard.h"
+#include "SpeechCache.h"
 #include "System.h"
 #include "Web.h"
 #include "Wlan.h"
@@ -153,6 +157,9 @@ void setup() {
 
 	Battery_Init();
 
+	// The audio task goes through the SD arbiter from its start
+	SdArbiter_Init();
+
 	// Init audio before power on to avoid speaker noise
 	AudioPlayer_Init();
 
@@ -192,6 +199,12 @@ void setup() {
 	System_ShowWakeUpReason();
 	// print SD card info
 	SdCard_PrintInfo();
+	// applies the resume positions of the last power cycle
+	ResumeJournal_Init();
+	// scans the SD card in background
+	Catalog_Init();
+	// fetches phrases of announcements in background
+	SpeechCache_Init();
 
 	Ftp_Init();
 	Mqtt_Init();
@@ -57,6 +57,12 @@
 	//#define SAVE_PLAYPOS_BEFORE_SHUTDOWN  // When playback is active and mode audiobook was selected, last play-position is saved automatically when shutdown is initiated
 	//#define SAVE_PLAYPOS_WHEN_RFID_CHANGE // When playback is active and mode audiobook was selected, last play-position is saved automatically for old playlist when new RFID-tag is applied
 	//#define HALLEFFECT_SENSOR_ENABLE      // Support for hallsensor. For fine-tuning please adjust HallEffectSensor.h Please note: only user-support provided (https://forum.espuino.de/t/magnetische-hockey-tags/1449/35)
+	//#define PLAYLIST_INDEX_ENABLE         // Keeps a sorted index of every played directory on the SD card (see cacheDir). Large directories start much faster: the index is checked against a quick walk over the names, stale ones are rebuilt in background.
+	//#define SUBDIRECTORY_CACHE_ENABLE     // Remembers the subdirectories for RANDOM_SUBDIRECTORY_OF_DIRECTORY-cards in RAM, so repeated taps pick without scanning the SD card. Changes via FTP or the web explorer drop the cache.
+	//#define MEDIA_CATALOG_ENABLE          // Walks the SD card in background and keeps a catalog of all tracks (duration, tags) in cacheDir. Available via /catalog, continues after deep sleep.
+	//#define DSP_ENABLE                    // Equalizer presets, a 5 band custom equalizer and a limiter in the audio path (fixed point, selectable in the web-interface). Adds about 1.5 ms latency.
+	//#define SEEK_INDEX_ENABLE             // Exact seeking and progress for VBR mp3 files (e.g. audiobooks) by a table of frame positions, built in background and cached in cacheDir.
+	//#define SPEECH_CACHE_ENABLE           // Keeps the phrases of spoken announcements (IP address, time) in cacheDir, so they start at once and work without the online TTS service. Fetches them from translate.google.com unless speechTtsUrl is changed.
 	#define VOLUMECURVE 0 					// 0=square, 1=logarithmic (1 is more flatten at lower volume)
 
 	//################## set PAUSE_WHEN_RFID_REMOVED behaviour #############################
@@ -209,6 +215,16 @@
 	// Where to store the backup-file for NVS-records
 	constexpr const char backupFile[] = "/backup.txt"; // File is written every time a (new) RFID-assignment via GUI is done
 
+	// Hidden folder on the SD card where ESPuino keeps its caches (e.g. playlist index)
+	constexpr const char cacheDir[] = "/.espuino";
+
+	// Online TTS service the speech cache fetches its phrases from ({lang} and {text} are substituted)
+	constexpr const char speechTtsUrl[] = "http://translate.google.com/translate_tts?ie=UTF-8&client=tw-ob&tl={lang}&q={text}";
+
+	// SD card bandwidth (bytes/s) an upload via the web explorer may use while audio is played from the SD card. Uploads with
+	// the parameter exclusive=true pause playback instead and write with full speed.
+	constexpr uint32_t sdBackgroundBandwidth = 512 * 1024;
+
 	//#################### Settings for optional Modules##############################
 	// (optinal) Neopixel
 	#ifdef NEOPIXEL_ENABLE
@@ -290,6 +306,7 @@
 		constexpr const char topicLedBrightnessState[] = "State/ESPuino/LedBrightness";
 		constexpr const char topicWiFiRssiState[] = "State/ESPuino/WifiRssi";
 		constexpr const char topicSRevisionState[] = "State/ESPuino/SoftwareRevision";
+		constexpr const char topicPlaybackStatsState[] = "State/ESPuino/PlaybackStats";
 		#ifdef BATTERY_MEASURE_ENABLE
 		constexpr const char topicBatteryVoltage[] = "State/ESPuino/Voltage";
 		constexpr const char topicBatterySOC[]     = "State/ESPuino/Battery";
@@ -0,0 +1,125 @@
+#pragma once
+
+// Just enough of the Arduino core to build the hardware-free modules of ESPuino on a PC (pio test -e native).
+// Time is virtual: millis() only moves when the code under test calls delay()/vTaskDelay() or a test calls
+// NativeTime_Advance(). So time dependent code runs deterministically and as fast as the PC allows.
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef bool boolean;
+
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline uint64_t NativeTime_Us = 0;
+extern uint8_t NativeLog_Level; // messages up to this level are printed (test/native/Log.cpp)
+
+inline void NativeTime_Advance(uint32_t _ms) {
+	NativeTime_Us += static_cast<uint64_t>(_ms) * 1000u;
+}
+
+inline uint32_t millis(void) {
+	return NativeTime_Us / 1000u;
+}
+
+inline uint32_t micros(void) {
+	return NativeTime_Us;
+}
+
+inline void delay(uint32_t _ms) {
+	NativeTime_Advance(_ms);
+}
+
+inline void yield(void) { }
+
+inline long random(long _max) {
+	return (_max > 0) ? rand() % _max : 0;
+}
+
+inline long random(long _min, long _max) {
+	return (_max > _min) ? _min + random(_max - _min) : _min;
+}
+
+// Arduino's String on top of std::string, only the members used by ESPuino
+class String : public std::string {
+public:
+	String() = default;
+	String(const char *_str)
+		: std::string((_str) ? _str : "") { }
+	String(const std::string &_str)
+		: std::string(_str) { }
+	explicit String(int _value)
+		: std::string(std::to_string(_value)) { }
+	explicit String(unsigned int _value)
+		: std::string(std::to_string(_value)) { }
+	explicit String(long _value)
+		: std::string(std::to_string(_value)) { }
+	explicit String(unsigned long _value)
+		: std::string(std::to_string(_value)) { }
+
+	bool isEmpty(void) const {
+		return empty();
+	}
+	bool startsWith(const String &_prefix) const {
+		return compare(0, _prefix.length(), _prefix) == 0;
+	}
+	bool endsWith(const String &_suffix) const {
+		return length() >= _suffix.length() && compare(length() - _suffix.length(), _suffix.length(), _suffix) == 0;
+	}
+	int indexOf(char _c, size_t _from = 0) const {
+		const size_t pos = find(_c, _from);
+		return (pos == npos) ? -1 : static_cast<int>(pos);
+	}
+	int indexOf(const String &_str, size_t _from = 0) const {
+		const size_t pos = find(_str, _from);
+		return (pos == npos) ? -1 : static_cast<int>(pos);
+	}
+	int lastIndexOf(char _c) const {
+		const size_t pos = rfind(_c);
+		return (pos == npos) ? -1 : static_cast<int>(pos);
+	}
+	String substring(size_t _from, size_t _to = npos) const {
+		return (_from >= length()) ? String() : String(substr(_from, (_to == npos) ? npos : _to - std::min(_to, _from)));
+	}
+	long toInt(void) const {
+		return strtol(c_str(), nullptr, 10);
+	}
+	int compareTo(const String &_other) const {
+		return compare(_other);
+	}
+	bool equals(const String &_other) const {
+		return *this == _other;
+	}
+	bool concat(const String &_str) {
+		append(_str);
+		return true;
+	}
+	void toLowerCase(void) {
+		std::transform(begin(), end(), begin(), [](unsigned char c) {
+			return tolower(c);
+		});
+	}
+};
+
+inline String operator+(const String &_a, const String &_b) {
+	return String(static_cast<const std::string &>(_a) + static_cast<const std::string &>(_b));
+}
+
+inline String operator+(const String &_a, const char *_b) {
+	return _a + String(_b);
+}
+
+inline String operator+(const char *_a, const String &_b) {
+	return String(_a) + _b;
+}
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
@@ -0,0 +1,126 @@
+#pragma once
+
+// Stand-in for the Audio class of ESP32-audioI2S. It doesn't decode anything: a file "plays" at
+// fakeAudioByteRate bytes per second of virtual time (see Arduino.h), so a track of 160 kB lasts 10 s.
+// When the end is reached, audio_eof_mp3() is called like the library does.
+
+#include "Arduino.h"
+#include "FS.h"
+
+extern __attribute__((weak)) void audio_eof_mp3(const char *info);
+
+constexpr uint32_t fakeAudioByteRate = 16000; // 128 kbit/s
+
+class Audio {
+public:
+	bool connecttoFS(fs::FS &_fs, const char *_path, int32_t _fileStartPos = -1) {
+		stopSong();
+		file = _fs.open(_path, FILE_READ);
+		if (!file || file.isDirectory()) {
+			file = File();
+			return false;
+		}
+		path = _path;
+		fileSize = file.size();
+		filePos = (_fileStartPos > 0) ? std::min<uint32_t>(_fileStartPos, fileSize) : 0;
+		running = true;
+		lastLoop = millis();
+		connects++;
+		return true;
+	}
+	bool connecttohost(const char *_host, const char * = "", const char * = "") {
+		stopSong();
+		path = _host;
+		fileSize = 0; // endless
+		filePos = 0;
+		running = true;
+		lastLoop = millis();
+		connects++;
+		return true;
+	}
+
+	// Moves the position by the virtual time passed since the last call
+	void loop(void) {
+		const uint32_t now = millis();
+		if (running) {
+			filePos += static_cast<uint64_t>(now - lastLoop) * fakeAudioByteRate / 1000;
+			if (fileSize && filePos >= fileSize) {
+				const String finished = path;
+				stopSong();
+				filePos = fileSize;
+				if (audio_eof_mp3) {
+					audio_eof_mp3(finished.c_str());
+				}
+			}
+		}
+		lastLoop = now;
+	}
+
+	uint32_t stopSong(void) {
+		const uint32_t pos = filePos;
+		running = false;
+		file.close();
+		path = String();
+		return pos;
+	}
+	bool pauseResume(void) {
+		if (path.isEmpty()) {
+			return false;
+		}
+		running = !running;
+		lastLoop = millis();
+		return true;
+	}
+	bool isRunning(void) const {
+		return running;
+	}
+
+	bool setFilePos(uint32_t _pos) {
+		if (!fileSize || _pos > fileSize) {
+			return false;
+		}
+		filePos = _pos;
+		return true;
+	}
+	uint32_t getFilePos(void) const {
+		return filePos;
+	}
+	uint32_t getFileSize(void) const {
+		return fileSize;
+	}
+	uint32_t getAudioDataStartPos(void) const {
+		return 0;
+	}
+	uint32_t getAudioCurrentTime(void) const {
+		return filePos / fakeAudioByteRate;
+	}
+	uint32_t getAudioFileDuration(void) const {
+		return fileSize / fakeAudioByteRate;
+	}
+	uint32_t getSampleRate(void) const {
+		return 44100;
+	}
+	uint32_t inBufferFilled(void) const {
+		return 0;
+	}
+	uint32_t inBufferSize(void) const {
+		return 0;
+	}
+	void setVolume(uint8_t _volume, uint8_t = 0) {
+		volume = _volume;
+	}
+	uint8_t getVolume(void) const {
+		return volume;
+	}
+
+	uint32_t connects = 0; // connecttoFS()/connecttohost() calls that succeeded, for the tests
+
+private:
+	File file;
+	String path;
+	uint32_t fileSize = 0;
+	uint32_t filePos = 0;
+	uint32_t lastLoop = 0;
+	uint8_t volume = 0;
+	bool running = false;
+};
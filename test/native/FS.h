@@ -0,0 +1,238 @@
+#pragma once
+
+// fs::FS and fs::File of the Arduino core, backed by a directory of the PC. Paths are absolute within the
+// filesystem ("/music/a.mp3") and are mapped below the root directory given to the constructor.
+
+#include "Arduino.h"
+
+#include <filesystem>
+#include <memory>
+#include <sys/stat.h>
+#include <vector>
+
+#define FILE_READ	"r"
+#define FILE_WRITE	"w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+	SeekSet = 0,
+	SeekCur = 1,
+	SeekEnd = 2
+};
+
+class File {
+public:
+	File() = default;
+
+	size_t write(const uint8_t *_buf, size_t _size) {
+		return (state && state->file) ? fwrite(_buf, 1, _size, state->file) : 0;
+	}
+	size_t write(uint8_t _c) {
+		return write(&_c, 1);
+	}
+	size_t print(const char *_str) {
+		return write(reinterpret_cast<const uint8_t *>(_str), strlen(_str));
+	}
+	size_t print(const String &_str) {
+		return print(_str.c_str());
+	}
+	int read(void) {
+		uint8_t c;
+		return (read(&c, 1) == 1) ? c : -1;
+	}
+	size_t read(uint8_t *_buf, size_t _size) {
+		return (state && state->file) ? fread(_buf, 1, _size, state->file) : 0;
+	}
+	int available(void) {
+		return size() - position();
+	}
+	void flush(void) {
+		if (state && state->file) {
+			fflush(state->file);
+		}
+	}
+	bool seek(uint32_t _pos, SeekMode _mode = SeekSet) {
+		static constexpr int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+		return state && state->file && fseek(state->file, (_mode == SeekSet) ? static_cast<long>(_pos) : static_cast<int32_t>(_pos), whence[_mode]) == 0;
+	}
+	size_t position(void) const {
+		return (state && state->file) ? ftell(state->file) : 0;
+	}
+	size_t size(void) const {
+		if (!state || !state->file) {
+			return 0;
+		}
+		fflush(state->file);
+		struct stat st;
+		return (fstat(fileno(state->file), &st) == 0) ? st.st_size : 0;
+	}
+	bool setBufferSize(size_t _size) {
+		return state && state->file && setvbuf(state->file, nullptr, _IOFBF, _size) == 0;
+	}
+	void close(void) {
+		state.reset();
+	}
+	time_t getLastWrite(void) {
+		struct stat st;
+		return (state && stat(state->hostPath.c_str(), &st) == 0) ? st.st_mtime : 0;
+	}
+	const char *path(void) const {
+		return (state) ? state->path.c_str() : nullptr;
+	}
+	const char *name(void) const {
+		return (state) ? state->path.c_str() + state->path.lastIndexOf('/') + 1 : nullptr;
+	}
+	bool isDirectory(void) const {
+		return state && state->isDirectory;
+	}
+	operator bool() const {
+		return state && (state->file || state->isDirectory);
+	}
+
+	// Entries of a directory, in the order of their names to make runs reproducible
+	File openNextFile(const char *_mode = FILE_READ);
+	String getNextFileName(bool *_isDir = nullptr) {
+		if (!isDirectory() || state->next >= state->entries.size()) {
+			return String();
+		}
+		const Entry &entry = state->entries[state->next++];
+		if (_isDir) {
+			*_isDir = entry.isDirectory;
+		}
+		return entry.path;
+	}
+	void rewindDirectory(void) {
+		if (state) {
+			state->next = 0;
+		}
+	}
+
+private:
+	friend class FS;
+
+	struct Entry {
+		String path;
+		bool isDirectory;
+	};
+
+	struct State {
+		~State() {
+			if (file) {
+				fclose(file);
+			}
+		}
+		String path;
+		std::string hostPath;
+		std::string root;
+		FILE *file = nullptr;
+		bool isDirectory = false;
+		std::vector<Entry> entries;
+		size_t next = 0;
+	};
+
+	static File openHost(const std::string &_root, const String &_path, const char *_mode) {
+		File f;
+		auto state = std::make_shared<State>();
+		state->path = _path;
+		state->root = _root;
+		state->hostPath = _root + static_cast<const std::string &>(_path);
+		std::error_code ec;
+		if (std::filesystem::is_directory(state->hostPath, ec)) {
+			state->isDirectory = true;
+			for (const auto &entry : std::filesystem::directory_iterator(state->hostPath, ec)) {
+				const String parent = (_path == "/") ? String() : _path;
+				state->entries.push_back({parent + "/" + String(entry.path().filename().string()), entry.is_directory()});
+			}
+			std::sort(state->entries.begin(), state->entries.end(), [](const Entry &a, const Entry &b) {
+				return a.path < b.path;
+			});
+		} else {
+			const std::string mode = (_mode[0] == 'r' && _mode[1] != '+') ? "rb" : std::string(_mode) + "b";
+			state->file = fopen(state->hostPath.c_str(), mode.c_str());
+			if (!state->file) {
+				return f;
+			}
+		}
+		f.state = state;
+		return f;
+	}
+
+	std::shared_ptr<State> state;
+};
+
+class FS {
+public:
+	explicit FS(const std::string &_root)
+		: root(_root) {
+		while (!root.empty() && root.back() == '/') {
+			root.pop_back();
+		}
+	}
+
+	File open(const char *_path, const char *_mode = FILE_READ, const bool _create = false) {
+		if (!_path || _path[0] != '/') {
+			return File();
+		}
+		if (_create && _mode[0] != 'r') {
+			std::error_code ec;
+			std::filesystem::create_directories(std::filesystem::path(root + _path).parent_path(), ec);
+		}
+		return File::openHost(root, _path, _mode);
+	}
+	File open(const String &_path, const char *_mode = FILE_READ, const bool _create = false) {
+		return open(_path.c_str(), _mode, _create);
+	}
+	bool exists(const char *_path) {
+		struct stat st;
+		return _path && _path[0] == '/' && stat((root + _path).c_str(), &st) == 0;
+	}
+	bool exists(const String &_path) {
+		return exists(_path.c_str());
+	}
+	bool remove(const char *_path) {
+		return ::remove((root + _path).c_str()) == 0;
+	}
+	bool remove(const String &_path) {
+		return remove(_path.c_str());
+	}
+	bool rename(const char *_pathFrom, const char *_pathTo) {
+		return ::rename((root + _pathFrom).c_str(), (root + _pathTo).c_str()) == 0;
+	}
+	bool rename(const String &_pathFrom, const String &_pathTo) {
+		return rename(_pathFrom.c_str(), _pathTo.c_str());
+	}
+	bool mkdir(const char *_path) {
+		std::error_code ec;
+		return std::filesystem::create_directory(root + _path, ec) || std::filesystem::is_directory(root + _path, ec);
+	}
+	bool mkdir(const String &_path) {
+		return mkdir(_path.c_str());
+	}
+	bool rmdir(const char *_path) {
+		std::error_code ec;
+		return std::filesystem::is_directory(root + _path, ec) && std::filesystem::remove(root + _path, ec);
+	}
+	bool rmdir(const String &_path) {
+		return rmdir(_path.c_str());
+	}
+
+private:
+	std::string root;
+};
+
+inline File File::openNextFile(const char *_mode) {
+	bool isDir = false;
+	const String next = getNextFileName(&isDir);
+	return (next.isEmpty()) ? File() : openHost(state->root, next, _mode);
+}
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
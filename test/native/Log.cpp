@@ -0,0 +1,40 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Log.h"
+
+#include <stdarg.h>
+
+// Errors and notices go to stdout (shown by pio test -v), the rest would only drown the test output. Tests that
+// run through many commands lower NativeLog_Level to LOGLEVEL_ERROR.
+uint8_t NativeLog_Level = LOGLEVEL_NOTICE;
+
+void Log_Init(void) { }
+
+void Log_Print(const char *_logBuffer, const uint8_t _minLogLevel, bool printTimestamp) {
+	if (_minLogLevel <= NativeLog_Level) {
+		fputs(_logBuffer, stdout);
+	}
+}
+
+void Log_Println(const char *_logBuffer, const uint8_t _minLogLevel) {
+	if (_minLogLevel <= NativeLog_Level) {
+		puts(_logBuffer);
+	}
+}
+
+int Log_Printf(const uint8_t _minLogLevel, const char *format, ...) {
+	if (_minLogLevel > NativeLog_Level) {
+		return 0;
+	}
+	va_list args;
+	va_start(args, format);
+	const int len = vprintf(format, args);
+	va_end(args);
+	putchar('\n');
+	return len;
+}
+
+String Log_GetRingBuffer(void) {
+	return String();
+}
@@ -0,0 +1,21 @@
+#include <Arduino.h>
+
+#include "MemX.h"
+
+// There's no PSRAM on the PC, everything comes from the heap
+
+char *x_strdup(const char *_str) {
+	return strdup(_str);
+}
+
+void *x_malloc(uint32_t _allocSize) {
+	return malloc(_allocSize);
+}
+
+char *x_calloc(uint32_t _allocSize, uint32_t _unitSize) {
+	return static_cast<char *>(calloc(_allocSize, _unitSize));
+}
+
+void *x_realloc(void *_ptr, uint32_t _allocSize) {
+	return realloc(_ptr, _allocSize);
+}
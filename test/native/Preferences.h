@@ -0,0 +1,102 @@
+#pragma once
+
+// NVS (Preferences of the Arduino core) in memory: every key holds the bytes of its value, so a value reads back
+// with the type it was written with. Nothing survives the test run.
+
+#include "Arduino.h"
+
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+	bool begin(const char *, bool = false, const char * = nullptr) {
+		return true;
+	}
+	void end(void) { }
+	bool clear(void) {
+		values.clear();
+		return true;
+	}
+	bool remove(const char *_key) {
+		return values.erase(_key) > 0;
+	}
+	bool isKey(const char *_key) {
+		return values.count(_key) > 0;
+	}
+
+	size_t putBool(const char *_key, bool _value) {
+		return put(_key, static_cast<uint8_t>(_value));
+	}
+	size_t putUChar(const char *_key, uint8_t _value) {
+		return put(_key, _value);
+	}
+	size_t putUShort(const char *_key, uint16_t _value) {
+		return put(_key, _value);
+	}
+	size_t putUInt(const char *_key, uint32_t _value) {
+		return put(_key, _value);
+	}
+	size_t putULong(const char *_key, uint32_t _value) {
+		return put(_key, _value);
+	}
+	size_t putFloat(const char *_key, float _value) {
+		return put(_key, _value);
+	}
+	size_t putString(const char *_key, const String &_value) {
+		values[_key].assign(_value.begin(), _value.end());
+		return _value.length();
+	}
+	size_t putBytes(const char *_key, const void *_value, size_t _len) {
+		values[_key].assign(static_cast<const uint8_t *>(_value), static_cast<const uint8_t *>(_value) + _len);
+		return _len;
+	}
+
+	bool getBool(const char *_key, bool _default = false) {
+		return get<uint8_t>(_key, _default);
+	}
+	uint8_t getUChar(const char *_key, uint8_t _default = 0) {
+		return get(_key, _default);
+	}
+	uint16_t getUShort(const char *_key, uint16_t _default = 0) {
+		return get(_key, _default);
+	}
+	uint32_t getUInt(const char *_key, uint32_t _default = 0) {
+		return get(_key, _default);
+	}
+	uint32_t getULong(const char *_key, uint32_t _default = 0) {
+		return get(_key, _default);
+	}
+	float getFloat(const char *_key, float _default = NAN) {
+		return get(_key, _default);
+	}
+	String getString(const char *_key, const String &_default = String()) {
+		auto it = values.find(_key);
+		return (it == values.end()) ? _default : String(std::string(it->second.begin(), it->second.end()));
+	}
+	size_t getBytesLength(const char *_key) {
+		auto it = values.find(_key);
+		return (it == values.end()) ? 0 : it->second.size();
+	}
+	size_t getBytes(const char *_key, void *_buf, size_t _maxLen) {
+		auto it = values.find(_key);
+		if (it == values.end() || it->second.size() > _maxLen) {
+			return 0;
+		}
+		memcpy(_buf, it->second.data(), it->second.size());
+		return it->second.size();
+	}
+
+private:
+	template <typename T>
+	size_t put(const char *_key, T _value) {
+		return putBytes(_key, &_value, sizeof(_value));
+	}
+	template <typename T>
+	T get(const char *_key, T _default) {
+		T value;
+		return (getBytes(_key, &value, sizeof(value)) == sizeof(value)) ? value : _default;
+	}
+
+	std::map<std::string, std::vector<uint8_t>> values;
+};
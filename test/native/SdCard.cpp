@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include <FS.h>
+
+#include "M3u.h"
+#include "Playlist.h"
+
+// SdCard.h pulls in the SD driver, so only the parts used by Playlist are here.
+// The SD card is a directory of the PC, tests point it to theirs: gFSystem = fs::FS(dir);
+fs::FS gFSystem(".");
+
+// Entries of a m3u file, parsed like on the board
+bool SdCard_ReadPlaylistEntries(const char *_source, const std::function<bool(const char *, uint32_t)> &_onEntry) {
+	File f = gFSystem.open(_source);
+	if (!f) {
+		return false;
+	}
+	return M3u_ForEachEntry(f, _onEntry);
+}
+
+bool SdCard_ReadPlaylistEntry(const char *_source, uint32_t _offset, char *_buf, size_t _bufLen) {
+	File f = gFSystem.open(_source);
+	if (!f || !f.seek(_offset)) {
+		return false;
+	}
+	const size_t bytesRead = f.read(reinterpret_cast<uint8_t *>(_buf), _bufLen - 1);
+	_buf[bytesRead] = '\0';
+	_buf[strcspn(_buf, "\r\n")] = '\0';
+	size_t len = strlen(_buf);
+	while (len > 0 && isspace(static_cast<uint8_t>(_buf[len - 1]))) {
+		_buf[--len] = '\0';
+	}
+	return len > 0;
+}
@@ -0,0 +1,7 @@
+#include <Arduino.h>
+
+#include "System.h"
+
+// Only the settings of System, the modules under test read and store theirs there
+Preferences gPrefsRfid;
+Preferences gPrefsSettings;
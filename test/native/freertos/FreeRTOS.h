@@ -0,0 +1,20 @@
+#pragma once
+
+// The parts of FreeRTOS the hardware-free modules use. There's a single thread on the PC: waiting just moves the
+// virtual time of Arduino.h forward.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE			   0
+#define pdTRUE			   1
+#define pdPASS			   pdTRUE
+#define pdFAIL			   pdFALSE
+#define portMAX_DELAY	   UINT32_MAX
+#define portTICK_PERIOD_MS 1
+
+// after the types: Arduino.h includes this header as well, like the ESP32 core does
+#include "Arduino.h"
@@ -0,0 +1,58 @@
+#pragma once
+
+// In-memory FreeRTOS queues. Items are copied like on the board. As nobody else can fill or empty a queue while
+// the only thread waits, a blocking call returns after its timeout (of virtual time) at most.
+
+#include "FreeRTOS.h"
+
+#include <deque>
+#include <vector>
+
+struct QueueDefinition {
+	std::deque<std::vector<uint8_t>> items;
+	UBaseType_t length;
+	UBaseType_t itemSize;
+};
+
+typedef QueueDefinition *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t _length, UBaseType_t _itemSize) {
+	return new QueueDefinition {{}, _length, _itemSize};
+}
+
+inline void vQueueDelete(QueueHandle_t _queue) {
+	delete _queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t _queue, const void *_item, TickType_t _ticksToWait) {
+	if (_queue->items.size() >= _queue->length) {
+		if (_ticksToWait != portMAX_DELAY) {
+			NativeTime_Advance(_ticksToWait * portTICK_PERIOD_MS);
+		}
+		return pdFAIL;
+	}
+	const uint8_t *item = static_cast<const uint8_t *>(_item);
+	_queue->items.emplace_back(item, item + _queue->itemSize);
+	return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t _queue, void *_item, TickType_t _ticksToWait) {
+	if (_queue->items.empty()) {
+		if (_ticksToWait != portMAX_DELAY) {
+			NativeTime_Advance(_ticksToWait * portTICK_PERIOD_MS);
+		}
+		return pdFALSE;
+	}
+	memcpy(_item, _queue->items.front().data(), _queue->itemSize);
+	_queue->items.pop_front();
+	return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t _queue) {
+	return _queue->items.size();
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t _queue) {
+	_queue->items.clear();
+	return pdPASS;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// FreeRTOS mutexes. With a single thread a mutex is free whenever it's taken, unless the code under test didn't
+// give it back: then taking it fails (after its timeout of virtual time) instead of blocking forever.
+
+#include "FreeRTOS.h"
+
+struct SemaphoreDefinition {
+	bool taken = false;
+};
+
+typedef SemaphoreDefinition *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+	return new SemaphoreDefinition;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t _semaphore) {
+	delete _semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t _semaphore, TickType_t _ticksToWait) {
+	if (_semaphore->taken) {
+		if (_ticksToWait != portMAX_DELAY) {
+			NativeTime_Advance(_ticksToWait * portTICK_PERIOD_MS);
+		}
+		return pdFALSE;
+	}
+	_semaphore->taken = true;
+	return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t _semaphore) {
+	if (!_semaphore->taken) {
+		return pdFALSE;
+	}
+	_semaphore->taken = false;
+	return pdTRUE;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+inline void vTaskDelay(TickType_t _ticks) {
+	NativeTime_Advance(_ticks * portTICK_PERIOD_MS);
+}
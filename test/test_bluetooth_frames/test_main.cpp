@@ -0,0 +1,122 @@
+#include "BluetoothFrames.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+// Bluetooth_RepackFrames() has to write the same frames as the reference Bluetooth_RepackFramesScalar(), for
+// every block size and for frame buffers that aren't word aligned. Plus a benchmark of both.
+
+// Layout of Frame in ESP32-A2DP (SoundData.h): packed, so the A2DP library may hand over unaligned buffers
+struct __attribute__((packed)) Frame {
+	int16_t channel1;
+	int16_t channel2;
+};
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static std::vector<uint32_t> randomSamples(size_t _count, uint32_t _seed) {
+	std::mt19937 rnd(_seed);
+	std::vector<uint32_t> samples(_count);
+	for (uint32_t &sample : samples) {
+		sample = rnd();
+	}
+	return samples;
+}
+
+static void test_channels(void) {
+	const uint32_t samples[] = {0x12345678, 0xFFFF0001, 0x8000FFFF, 0x00000000};
+	Frame frames[4];
+	Bluetooth_RepackFrames(frames, samples, 4);
+	TEST_ASSERT_EQUAL(0x1234, frames[0].channel1);
+	TEST_ASSERT_EQUAL(0x5678, frames[0].channel2);
+	TEST_ASSERT_EQUAL(-1, frames[1].channel1);
+	TEST_ASSERT_EQUAL(1, frames[1].channel2);
+	TEST_ASSERT_EQUAL(-32768, frames[2].channel1);
+	TEST_ASSERT_EQUAL(-1, frames[2].channel2);
+	TEST_ASSERT_EQUAL(0, frames[3].channel1);
+	TEST_ASSERT_EQUAL(0, frames[3].channel2);
+}
+
+static void test_equivalence(void) {
+	const std::vector<uint32_t> samples = randomSamples(1031, 1);
+	// frames at every byte offset within a word, the first three aren't aligned
+	alignas(4) uint8_t expected[1031 * sizeof(Frame) + 4];
+	alignas(4) uint8_t actual[1031 * sizeof(Frame) + 4];
+	for (uint32_t misalign = 0; misalign < 4; misalign++) {
+		for (uint32_t count = 0; count <= 1031; count++) {
+			memset(expected, 0xA5, sizeof(expected));
+			memset(actual, 0xA5, sizeof(actual));
+			Bluetooth_RepackFramesScalar(reinterpret_cast<Frame *>(expected + misalign), samples.data(), count);
+			Bluetooth_RepackFrames(reinterpret_cast<Frame *>(actual + misalign), samples.data(), count);
+			char message[48];
+			snprintf(message, sizeof(message), "misalign %u, %u frames", misalign, count);
+			// bytes behind the block must stay untouched as well
+			TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected, actual, sizeof(expected), message);
+		}
+	}
+}
+
+// get_data_channels() repacks in two parts if the requested frames wrap around the end of the ring
+static void test_ring_wrap(void) {
+	constexpr uint32_t ringSize = 2048;
+	const std::vector<uint32_t> ring = randomSamples(ringSize, 2);
+	std::vector<Frame> expected(512);
+	std::vector<Frame> actual(512);
+	for (uint32_t start : {0u, 1u, 1535u, 1536u, 1800u, 2047u}) {
+		for (uint32_t i = 0; i < expected.size(); i++) {
+			Bluetooth_RepackFramesScalar(&expected[i], &ring[(start + i) % ringSize], 1);
+		}
+		const uint32_t first = std::min<uint32_t>(actual.size(), ringSize - start);
+		Bluetooth_RepackFrames(actual.data(), ring.data() + start, first);
+		Bluetooth_RepackFrames(actual.data() + first, ring.data(), actual.size() - first);
+		TEST_ASSERT_EQUAL_MEMORY(expected.data(), actual.data(), expected.size() * sizeof(Frame));
+	}
+}
+
+static volatile uint32_t benchmarkSink;
+
+template <typename Repack>
+static double nsPerFrame(uint32_t _frames, uint32_t _misalign, Repack _repack) {
+	const std::vector<uint32_t> samples = randomSamples(_frames, 3);
+	std::vector<uint32_t> buf(_frames + 1);
+	Frame *frames = reinterpret_cast<Frame *>(reinterpret_cast<uint8_t *>(buf.data()) + _misalign);
+	const uint32_t rounds = 20000000 / _frames;
+	double best = 1e9;
+	for (int run = 0; run < 3; run++) {
+		uint32_t check = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t round = 0; round < rounds; round++) {
+			_repack(frames, samples.data(), _frames);
+			check += buf[round % _frames];
+		}
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+		benchmarkSink = check; // keeps the stores alive
+	}
+	return best / (static_cast<double>(rounds) * _frames);
+}
+
+static void benchmark_repack(void) {
+	for (const uint32_t frames : {128u, 512u}) {
+		const double scalar = nsPerFrame(frames, 0, Bluetooth_RepackFramesScalar<Frame>);
+		const double words = nsPerFrame(frames, 0, Bluetooth_RepackFrames<Frame>);
+		const double unaligned = nsPerFrame(frames, 2, Bluetooth_RepackFrames<Frame>);
+		char message[160];
+		snprintf(message, sizeof(message), "%3u frames: scalar %.3f ns/frame, words %.3f ns/frame (%.1fx), unaligned fallback %.3f ns/frame", frames, scalar, words, scalar / words, unaligned);
+		TEST_MESSAGE(message);
+	}
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_channels);
+	RUN_TEST(test_equivalence);
+	RUN_TEST(test_ring_wrap);
+	RUN_TEST(benchmark_repack);
+	return UNITY_END();
+}
@@ -0,0 +1,271 @@
+#include <Arduino.h>
+
+#include "Dsp.h"
+#include "EnumUtils.h"
+
+#include <chrono>
+#include <unity.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+// The DSP chain hands out every sample two blocks (64 samples) late, bypassed or not. Switching between both
+// must neither drop nor repeat a block, the end of a file is flushed and nothing of it comes back after a reset.
+// The limiter's gain must not step. Plus a benchmark of the chain per block for every preset.
+
+static constexpr uint32_t blockSize = 32;
+static constexpr uint32_t latency = 2 * blockSize;
+static constexpr uint32_t sampleRate = 44100;
+
+void setUp(void) {
+	Dsp_SetPreset(EnumUtils::underlying_value(dspPreset::FLAT));
+	Dsp_SetNormalizeEnabled(false);
+	Dsp_SetLimiterEnabled(true);
+	Dsp_SetTrackGain(0);
+	const int8_t flat[dspCustomBandCount] = {};
+	Dsp_SetCustomBands(flat);
+}
+
+void tearDown(void) { }
+
+static uint32_t stereo(int16_t _left, int16_t _right) {
+	return (static_cast<uint32_t>(static_cast<uint16_t>(_left)) << 16) | static_cast<uint16_t>(_right);
+}
+
+static int16_t left(uint32_t _sample) {
+	return _sample >> 16;
+}
+
+static int16_t right(uint32_t _sample) {
+	return _sample & 0xFFFF;
+}
+
+// Distinct samples, so a dropped or repeated block can't go unnoticed
+static uint32_t rampSample(uint32_t _n) {
+	const int16_t value = 1000 + (_n * 7) % 20000;
+	return stereo(value, -value);
+}
+
+static void processBlocks(const uint32_t *_in, uint32_t *_out, uint32_t _blocks) {
+	for (uint32_t i = 0; i < _blocks * blockSize; i++) {
+		uint32_t sample = _in[i];
+		Dsp_Process(&sample);
+		_out[i] = sample;
+	}
+}
+
+static void test_bypass_only_delays(void) {
+	std::vector<uint32_t> in(blockSize * 20), out(in.size());
+	for (uint32_t n = 0; n < in.size(); n++) {
+		in[n] = rampSample(n);
+	}
+	processBlocks(in.data(), out.data(), 2); // whatever was left in the chain
+	processBlocks(in.data() + latency, out.data() + latency, 18);
+	for (uint32_t n = latency; n < out.size(); n++) {
+		TEST_ASSERT_EQUAL(in[n - latency], out[n]);
+	}
+}
+
+// Track gains switch the chain on and off at block boundaries, every output sample has to be the input of two
+// blocks before: unchanged (bypassed) or at half the level (-6 dB)
+static void test_bypass_transitions_keep_every_sample(void) {
+	Dsp_SetNormalizeEnabled(true);
+	constexpr uint32_t blocks = 200;
+	std::vector<uint32_t> in(blockSize * blocks), out(in.size());
+	for (uint32_t n = 0; n < in.size(); n++) {
+		in[n] = rampSample(n);
+	}
+	uint32_t bypassed = 0, processed = 0;
+	for (uint32_t block = 0; block < blocks; block++) {
+		if (block % 10 == 0) {
+			// applied right away at the next block, like at the start of a track
+			Dsp_SetTrackGain((block % 20 == 0) ? -602 : 0);
+		}
+		processBlocks(in.data() + block * blockSize, out.data() + block * blockSize, 1);
+		if (block < 2) {
+			continue;
+		}
+		const uint32_t first = block * blockSize;
+		const bool unchanged = (out[first] == in[first - latency]);
+		(unchanged ? bypassed : processed)++;
+		for (uint32_t n = first; n < first + blockSize; n++) {
+			char message[64];
+			snprintf(message, sizeof(message), "block %u, sample %u", block, n - first);
+			if (unchanged) {
+				TEST_ASSERT_EQUAL_MESSAGE(in[n - latency], out[n], message);
+			} else {
+				TEST_ASSERT_INT_WITHIN_MESSAGE(1, left(in[n - latency]) / 2, left(out[n]), message);
+				TEST_ASSERT_INT_WITHIN_MESSAGE(1, right(in[n - latency]) / 2, right(out[n]), message);
+			}
+		}
+	}
+	// the output shows the mode of the block two before: blocks 0 to 197, 100 processed (0-9, 20-29, ...),
+	// 98 bypassed (10-19, ..., 190-197)
+	TEST_ASSERT_EQUAL(98, bypassed);
+	TEST_ASSERT_EQUAL(100, processed);
+}
+
+// The end of a file comes out complete with the flush, in either mode. After a reset the next file starts with
+// silence, not with the end of the one before.
+static void flushAndReset(const char *_mode, int _divisor) {
+	constexpr uint32_t length = 1000; // not a multiple of the block size
+	std::vector<uint32_t> in(length), out(length + dspMaxLatency);
+	for (uint32_t n = 0; n < in.size(); n++) {
+		in[n] = rampSample(n);
+	}
+	Dsp_Reset();
+	for (uint32_t n = 0; n < length; n++) {
+		uint32_t sample = in[n];
+		Dsp_Process(&sample);
+		out[n] = sample;
+	}
+	const uint32_t flushed = Dsp_Flush(out.data() + length);
+	TEST_ASSERT_EQUAL_MESSAGE(dspMaxLatency, flushed, _mode);
+	for (uint32_t n = 0; n < latency; n++) {
+		TEST_ASSERT_EQUAL_MESSAGE(0, out[n], _mode);
+	}
+	for (uint32_t n = latency; n < out.size(); n++) {
+		TEST_ASSERT_INT_WITHIN_MESSAGE(1, left(in[n - latency]) / _divisor, left(out[n]), _mode);
+		TEST_ASSERT_INT_WITHIN_MESSAGE(1, right(in[n - latency]) / _divisor, right(out[n]), _mode);
+	}
+
+	// a stopped file: only some samples, dropped by the reset
+	for (uint32_t n = 0; n < 100; n++) {
+		uint32_t sample = in[n];
+		Dsp_Process(&sample);
+	}
+	Dsp_Reset();
+	uint32_t rest[dspMaxLatency];
+	TEST_ASSERT_EQUAL_MESSAGE(0, Dsp_Flush(rest), _mode);
+	for (uint32_t n = 0; n < latency; n++) {
+		uint32_t sample = in[n];
+		Dsp_Process(&sample);
+		TEST_ASSERT_EQUAL_MESSAGE(0, sample, _mode);
+	}
+	// a short file is flushed with only what it brought
+	TEST_ASSERT_EQUAL_MESSAGE(latency, Dsp_Flush(rest), _mode);
+}
+
+static void test_flush_and_reset(void) {
+	flushAndReset("bypassed", 1);
+	Dsp_SetNormalizeEnabled(true);
+	Dsp_SetTrackGain(-602);
+	uint32_t sample = 0;
+	Dsp_Process(&sample); // picked up at the block boundary
+	flushAndReset("processed", 2);
+}
+
+// The equalizer must start from silence after a bypass, not ring with what it saw before
+static void test_filters_restart_silent(void) {
+	std::vector<uint32_t> in(blockSize * 40), out(in.size());
+	for (uint32_t n = 0; n < in.size(); n++) {
+		in[n] = ((n / 50) % 2) ? stereo(30000, 30000) : stereo(-30000, -30000);
+	}
+	Dsp_SetPreset(EnumUtils::underlying_value(dspPreset::BASS_BOOST));
+	processBlocks(in.data(), out.data(), 40);
+	// the pre-gain ramps back to unity, then the chain is bypassed
+	Dsp_SetPreset(EnumUtils::underlying_value(dspPreset::FLAT));
+	std::vector<uint32_t> silence(in.size(), 0);
+	processBlocks(silence.data(), out.data(), 40);
+	Dsp_SetPreset(EnumUtils::underlying_value(dspPreset::BASS_BOOST));
+	processBlocks(silence.data(), out.data(), 40);
+	for (uint32_t n = 0; n < out.size(); n++) {
+		TEST_ASSERT_EQUAL(0, out[n]);
+	}
+}
+
+static void test_limiter_holds_threshold(void) {
+	Dsp_SetPreset(EnumUtils::underlying_value(dspPreset::BASS_BOOST));
+	std::vector<uint32_t> in(blockSize * 400), out(in.size());
+	for (uint32_t n = 0; n < in.size(); n++) {
+		// 100 Hz square wave at full scale, boosted by the low shelf
+		in[n] = ((n / 220) % 2) ? stereo(INT16_MAX, INT16_MAX) : stereo(INT16_MIN + 1, INT16_MIN + 1);
+	}
+	processBlocks(in.data(), out.data(), 400);
+	int peak = 0;
+	for (uint32_t n = 0; n < out.size(); n++) {
+		peak = std::max({peak, abs(left(out[n])), abs(right(out[n]))});
+	}
+	TEST_ASSERT_LESS_THAN(32113 + 1, peak);
+	TEST_ASSERT_GREATER_THAN(30000, peak);
+}
+
+// A quiet passage followed by a loud one, both far above the threshold after +12 dB normalization. The gain
+// (output / input) has to glide into the limiting instead of stepping at a block boundary.
+static void test_limiter_gain_glides(void) {
+	Dsp_SetNormalizeEnabled(true);
+	Dsp_SetTrackGain(1200);
+	Dsp_Reset(); // no gain left over from the tests before
+	constexpr uint32_t blocks = 300;
+	std::vector<uint32_t> in(blockSize * blocks), out(in.size());
+	for (uint32_t n = 0; n < in.size(); n++) {
+		// constant levels, so the gain can be read per sample
+		const int16_t value = (n < in.size() / 3) ? 4000 : ((n < in.size() * 2 / 3) ? 16000 : 6000);
+		in[n] = stereo(value, -value);
+	}
+	processBlocks(in.data(), out.data(), blocks);
+	const float trackGain = powf(10.0f, 12.0f / 20.0f);
+	float maxStep = 0;
+	int peak = 0;
+	for (uint32_t n = 2 * latency; n < out.size(); n++) {
+		const float gain = left(out[n]) / (left(in[n - latency]) * trackGain);
+		const float previousGain = left(out[n - 1]) / (left(in[n - 1 - latency]) * trackGain);
+		maxStep = std::max(maxStep, fabsf(gain - previousGain));
+		peak = std::max({peak, abs(left(out[n])), abs(right(out[n]))});
+	}
+	char message[64];
+	snprintf(message, sizeof(message), "largest gain step %.4f", maxStep);
+	TEST_MESSAGE(message);
+	// the gain halves within the block before the loud passage: 1/64 per sample
+	TEST_ASSERT_LESS_THAN_MESSAGE(20, static_cast<int>(maxStep * 1000), message);
+	TEST_ASSERT_LESS_THAN(32113 + 1, peak);
+}
+
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void benchmark_block(void) {
+	constexpr uint32_t blocks = sampleRate * 60 / blockSize; // a minute of audio
+	std::vector<uint32_t> in(blockSize * 64);
+	for (uint32_t n = 0; n < in.size(); n++) {
+		const int16_t value = 12000 * sinf(2 * PI * 440 * n / sampleRate);
+		in[n] = stereo(value, value / 2);
+	}
+	std::vector<uint32_t> out(in.size());
+	const int8_t bands[dspCustomBandCount] = {6, -3, 2, -4, 5};
+	Dsp_SetCustomBands(bands);
+	static const char *names[] = {"flat (bypassed)", "bass boost", "speech", "loudness", "soft", "custom (5 bands)"};
+	for (uint8_t preset = 0; preset < 6; preset++) {
+		Dsp_SetPreset(preset);
+		processBlocks(in.data(), out.data(), 64); // let the pre-gain ramp settle
+		const uint64_t startCycles = cycles();
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t block = 0; block < blocks; block++) {
+			processBlocks(in.data() + (block % 64) * blockSize, out.data() + (block % 64) * blockSize, 1);
+		}
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / blocks;
+		const double cyclesPerBlock = static_cast<double>(cycles() - startCycles) / blocks;
+		char message[160];
+		snprintf(message, sizeof(message), "%-16s %7.0f cycles/block (TSC), %6.0f ns/block, %.2f %% of a block's play time", names[preset], cyclesPerBlock, ns, ns / (1e9 * blockSize / sampleRate) * 100);
+		TEST_MESSAGE(message);
+	}
+}
+
+int main(int argc, char **argv) {
+	Dsp_Init();
+	UNITY_BEGIN();
+	RUN_TEST(test_bypass_only_delays);
+	RUN_TEST(test_bypass_transitions_keep_every_sample);
+	RUN_TEST(test_filters_restart_silent);
+	RUN_TEST(test_flush_and_reset);
+	RUN_TEST(test_limiter_holds_threshold);
+	RUN_TEST(test_limiter_gain_glides);
+	RUN_TEST(benchmark_block);
+	return UNITY_END();
+}
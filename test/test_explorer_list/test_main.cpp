@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include <FS.h>
+
+#include "ExplorerList.h"
+
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+// Paging of the /explorer listing: offset and limit are parsed strictly, negative values are rejected. The walk
+// over the directory honours both, skips hidden entries and never reads more than explorerChunkEntries entries
+// per chunk of the response, however large the offset.
+
+extern fs::FS gFSystem;
+
+static constexpr uint32_t fileCount = 100;
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static void test_paging_parameters(void) {
+	explorerPaging paging;
+	TEST_ASSERT_TRUE(ExplorerList_ParsePaging(nullptr, nullptr, paging));
+	TEST_ASSERT_EQUAL(0, paging.offset);
+	TEST_ASSERT_TRUE(paging.limit == SIZE_MAX);
+
+	const String offset("40"), limit("10");
+	TEST_ASSERT_TRUE(ExplorerList_ParsePaging(&offset, &limit, paging));
+	TEST_ASSERT_EQUAL(40, paging.offset);
+	TEST_ASSERT_EQUAL(10, paging.limit);
+
+	const String zero("0"), huge("99999999999999999999999");
+	TEST_ASSERT_TRUE(ExplorerList_ParsePaging(&zero, &huge, paging));
+	TEST_ASSERT_EQUAL(0, paging.offset);
+	TEST_ASSERT_TRUE(paging.limit == SIZE_MAX);
+
+	// toInt() took these as 0 or as a huge number
+	for (const char *bad : {"-1", "-100000", "", "abc", "10abc", "1.5"}) {
+		const String value(bad);
+		TEST_ASSERT_FALSE_MESSAGE(ExplorerList_ParsePaging(&value, nullptr, paging), bad);
+		TEST_ASSERT_FALSE_MESSAGE(ExplorerList_ParsePaging(nullptr, &value, paging), bad);
+	}
+}
+
+// A directory with fileCount files (f000 ... f099), a sub directory and hidden entries in between
+static void makeDirectory(void) {
+	static char dir[] = "/tmp/espuino-explorer-XXXXXX";
+	TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+	gFSystem = fs::FS(dir);
+	gFSystem.mkdir("/list");
+	for (uint32_t i = 0; i < fileCount; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/list/f%03u", i);
+		File f = gFSystem.open(path, FILE_WRITE);
+		f.print(String(path));
+	}
+	for (const char *hidden : {"/list/.Spotlight-V100", "/list/.DS_Store", "/list/f050.", "/list/.f051"}) {
+		File f = gFSystem.open(hidden, FILE_WRITE);
+		f.print("x");
+	}
+	gFSystem.mkdir("/list/sub");
+}
+
+struct listing {
+	std::vector<explorerEntry> entries;
+	uint32_t chunks = 0;
+};
+
+// Runs the cursor like the chunk callback of the web server does
+static listing list(const explorerPaging &_paging, bool _details = false) {
+	listing result;
+	ExplorerListCursor cursor(gFSystem.open("/list"), _paging, _details);
+	for (;;) {
+		result.chunks++;
+		TEST_ASSERT_LESS_THAN(100, result.chunks);
+		cursor.startChunk();
+		ExplorerStep step;
+		explorerEntry entry;
+		while ((step = cursor.next(entry)) == ExplorerStep::Entry) {
+			result.entries.push_back(entry);
+		}
+		if (step == ExplorerStep::Done) {
+			return result;
+		}
+	}
+}
+
+static String name(const explorerEntry &_entry) {
+	return _entry.path.substring(_entry.path.lastIndexOf('/') + 1);
+}
+
+static void test_whole_directory(void) {
+	const listing all = list({0, SIZE_MAX});
+	// f050. is no hidden entry, the sub directory comes last
+	TEST_ASSERT_EQUAL(fileCount + 2, all.entries.size());
+	for (uint32_t i = 0; i < fileCount; i++) {
+		char expected[8];
+		snprintf(expected, sizeof(expected), "f%03u", i);
+		TEST_ASSERT_EQUAL_STRING(expected, name(all.entries[i + ((i > 50) ? 1 : 0)]).c_str());
+		TEST_ASSERT_FALSE(all.entries[i].isDir);
+	}
+	TEST_ASSERT_EQUAL_STRING("f050.", name(all.entries[51]).c_str());
+	TEST_ASSERT_EQUAL_STRING("sub", name(all.entries.back()).c_str());
+	TEST_ASSERT_TRUE(all.entries.back().isDir);
+	// 106 directory entries (hidden ones included) and the end: 4 chunks
+	TEST_ASSERT_EQUAL(4, all.chunks);
+}
+
+static void test_pages(void) {
+	const listing page = list({40, 10});
+	TEST_ASSERT_EQUAL(10, page.entries.size());
+	TEST_ASSERT_EQUAL_STRING("f040", name(page.entries.front()).c_str());
+	TEST_ASSERT_EQUAL_STRING("f049", name(page.entries.back()).c_str());
+
+	// the last page is short
+	const listing last = list({95, 10});
+	TEST_ASSERT_EQUAL(7, last.entries.size());
+	TEST_ASSERT_EQUAL_STRING("f094", name(last.entries.front()).c_str());
+	TEST_ASSERT_EQUAL_STRING("sub", name(last.entries.back()).c_str());
+
+	// pages cover the directory without gaps or overlaps
+	std::vector<String> paged;
+	for (size_t offset = 0;; offset += 7) {
+		const listing part = list({offset, 7});
+		for (const explorerEntry &entry : part.entries) {
+			paged.push_back(name(entry));
+		}
+		if (part.entries.size() < 7) {
+			break;
+		}
+	}
+	const listing all = list({0, SIZE_MAX});
+	TEST_ASSERT_EQUAL(all.entries.size(), paged.size());
+	for (size_t i = 0; i < paged.size(); i++) {
+		TEST_ASSERT_EQUAL_STRING(name(all.entries[i]).c_str(), paged[i].c_str());
+	}
+}
+
+static void test_bounds(void) {
+	// limit 0 doesn't read the directory at all
+	const listing none = list({0, 0});
+	TEST_ASSERT_EQUAL(0, none.entries.size());
+	TEST_ASSERT_EQUAL(1, none.chunks);
+
+	// an offset past the end: the whole directory is skipped, but in chunks
+	const listing beyond = list({SIZE_MAX, 10});
+	TEST_ASSERT_EQUAL(0, beyond.entries.size());
+	TEST_ASSERT_EQUAL(4, beyond.chunks);
+
+	const listing exact = list({fileCount + 2, 10});
+	TEST_ASSERT_EQUAL(0, exact.entries.size());
+}
+
+static void test_details(void) {
+	const listing page = list({0, 3}, true);
+	TEST_ASSERT_EQUAL(3, page.entries.size());
+	for (const explorerEntry &entry : page.entries) {
+		TEST_ASSERT_FALSE(entry.isDir);
+		TEST_ASSERT_EQUAL(entry.path.length(), entry.size); // every file holds its path
+		TEST_ASSERT_TRUE(entry.mtime > 0);
+	}
+	const listing sub = list({fileCount + 1, 1}, true);
+	TEST_ASSERT_EQUAL(1, sub.entries.size());
+	TEST_ASSERT_TRUE(sub.entries[0].isDir);
+	TEST_ASSERT_EQUAL(0, sub.entries[0].size);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_paging_parameters);
+	makeDirectory();
+	RUN_TEST(test_whole_directory);
+	RUN_TEST(test_pages);
+	RUN_TEST(test_bounds);
+	RUN_TEST(test_details);
+	return UNITY_END();
+}
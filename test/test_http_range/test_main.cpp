@@ -0,0 +1,108 @@
+#include <Arduino.h>
+
+#include "HttpRange.h"
+
+#include <unity.h>
+
+// Conditional and partial downloads of /explorerdownload: a single byte range is served partially, malformed
+// ranges and several of them are ignored (the whole file), ranges without a byte in the file are refused (416).
+// If-Range only lets a range through for the same file, If-None-Match takes lists and weak tags.
+
+static constexpr size_t fileSize = 1000;
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static void assertPartial(const char *_header, size_t _start, size_t _end, size_t _size = fileSize) {
+	size_t start = 12345, end = 12345;
+	TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(HttpRangeResult::Partial), static_cast<int>(HttpRange_Parse(_header, _size, start, end)), _header);
+	TEST_ASSERT_EQUAL_MESSAGE(_start, start, _header);
+	TEST_ASSERT_EQUAL_MESSAGE(_end, end, _header);
+}
+
+static void assertResult(const char *_header, HttpRangeResult _result, size_t _size = fileSize) {
+	size_t start = 12345, end = 12345;
+	TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(_result), static_cast<int>(HttpRange_Parse(_header, _size, start, end)), _header);
+	// left alone unless partial
+	TEST_ASSERT_EQUAL_MESSAGE(12345, start, _header);
+	TEST_ASSERT_EQUAL_MESSAGE(12345, end, _header);
+}
+
+static void test_ranges(void) {
+	assertPartial("bytes=0-99", 0, 100);
+	assertPartial("bytes=100-", 100, fileSize);
+	assertPartial("bytes=999-999", 999, 1000);
+	assertPartial("bytes=500-5000", 500, fileSize); // the end is cut to the file
+	assertPartial("bytes=0-99999999999999999999999", 0, fileSize);
+	assertPartial("bytes=-100", 900, fileSize);
+	assertPartial("bytes=-1", 999, fileSize);
+	assertPartial("bytes=-5000", 0, fileSize); // the whole file, but as range
+	assertPartial("bytes=0-0", 0, 1);
+}
+
+static void test_unsatisfiable(void) {
+	// served as the whole file with 200 before
+	assertResult("bytes=-0", HttpRangeResult::Unsatisfiable);
+	assertResult("bytes=1000-", HttpRangeResult::Unsatisfiable);
+	assertResult("bytes=1000-2000", HttpRangeResult::Unsatisfiable);
+	assertResult("bytes=99999999999999999999999-", HttpRangeResult::Unsatisfiable);
+	// an empty file has no byte to send
+	assertResult("bytes=0-", HttpRangeResult::Unsatisfiable, 0);
+	assertResult("bytes=-10", HttpRangeResult::Unsatisfiable, 0);
+}
+
+static void test_ignored(void) {
+	for (const char *header : {"", "bytes=", "bytes=-", "bytes=abc-", "bytes=10-abc", "bytes=10", "bytes=5-3", "bytes=0-1,5-9", "bytes= 0-10", "bytes=0-10 ", "items=0-10", "Bytes=0-10", "bytes=+5-10", "bytes=--5"}) {
+		assertResult(header, HttpRangeResult::Full);
+	}
+}
+
+static void test_validators(void) {
+	char etag[httpETagSize];
+	char lastModified[httpDateSize];
+	HttpRange_Validators(fileSize, 1700000000, etag, lastModified);
+	TEST_ASSERT_EQUAL_STRING("\"000003e86553f100\"", etag);
+	TEST_ASSERT_EQUAL_STRING("Tue, 14 Nov 2023 22:13:20 GMT", lastModified);
+
+	// a changed file gets another tag
+	char other[httpETagSize];
+	HttpRange_Validators(fileSize + 1, 1700000000, other, lastModified);
+	TEST_ASSERT_TRUE(strcmp(etag, other) != 0);
+	HttpRange_Validators(fileSize, 1700000001, other, lastModified);
+	TEST_ASSERT_TRUE(strcmp(etag, other) != 0);
+}
+
+static void test_if_none_match(void) {
+	const char *etag = "\"000003e86553f100\"";
+	TEST_ASSERT_TRUE(HttpRange_IfNoneMatch("\"000003e86553f100\"", etag));
+	TEST_ASSERT_TRUE(HttpRange_IfNoneMatch("W/\"000003e86553f100\"", etag));
+	TEST_ASSERT_TRUE(HttpRange_IfNoneMatch("\"abc\", \"000003e86553f100\"", etag));
+	TEST_ASSERT_TRUE(HttpRange_IfNoneMatch("\"abc\",W/\"000003e86553f100\" ", etag));
+	TEST_ASSERT_TRUE(HttpRange_IfNoneMatch("*", etag));
+	TEST_ASSERT_FALSE(HttpRange_IfNoneMatch("", etag));
+	TEST_ASSERT_FALSE(HttpRange_IfNoneMatch("\"000003e86553f101\"", etag));
+	TEST_ASSERT_FALSE(HttpRange_IfNoneMatch("000003e86553f100", etag)); // not quoted
+	TEST_ASSERT_FALSE(HttpRange_IfNoneMatch("\"000003e86553f100", etag));
+}
+
+static void test_if_range(void) {
+	const char *etag = "\"000003e86553f100\"";
+	const char *lastModified = "Tue, 14 Nov 2023 22:13:20 GMT";
+	TEST_ASSERT_TRUE(HttpRange_IfRange(etag, etag, lastModified));
+	TEST_ASSERT_TRUE(HttpRange_IfRange(lastModified, etag, lastModified));
+	// weak tags never match, a changed file neither
+	TEST_ASSERT_FALSE(HttpRange_IfRange("W/\"000003e86553f100\"", etag, lastModified));
+	TEST_ASSERT_FALSE(HttpRange_IfRange("\"000003e86553f101\"", etag, lastModified));
+	TEST_ASSERT_FALSE(HttpRange_IfRange("Tue, 14 Nov 2023 22:13:21 GMT", etag, lastModified));
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_ranges);
+	RUN_TEST(test_unsatisfiable);
+	RUN_TEST(test_ignored);
+	RUN_TEST(test_validators);
+	RUN_TEST(test_if_none_match);
+	RUN_TEST(test_if_range);
+	return UNITY_END();
+}
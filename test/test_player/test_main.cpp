@@ -0,0 +1,428 @@
+#include <Arduino.h>
+
+#include "Audio.h"
+#include "FS.h"
+#include "Log.h"
+#include "TrackControl.h"
+#include "values.h"
+
+#include <chrono>
+#include <filesystem>
+#include <freertos/queue.h>
+#include <random>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+// Runs the decisions of the audio task (TrackControl_Step(), the code AudioPlayer_Task uses) against the fake Audio
+// class, a filesystem in a temporary directory, in-memory queues and virtual time. The simulated task only carries
+// out the side effects and counts them.
+
+typedef std::vector<String> Sim_Playlist;
+
+static fs::FS *Sim_FS = nullptr;
+static std::string Sim_Root;
+static std::vector<String> Sim_Tracks;
+
+struct Sim_Player : public TrackControlActions {
+	QueueHandle_t trackQueue; // Playlist *
+	QueueHandle_t trackControlQueue; // uint8_t
+	Audio audio;
+	playProps props = {};
+	uint8_t trackCommand = NO_ACTION;
+	bool quit = false; // the task ended to go to sleep
+	// side effects
+	uint32_t sleepRequests = 0;
+	uint32_t errors = 0;
+	uint32_t rewinds = 0;
+	uint32_t repeatModeChanges = 0;
+	uint32_t playlistEnds = 0;
+	uint32_t saves = 0;
+	size_t savedEntry = 0; // stand in for the NVS entry of the RFID tag
+	size_t savedTrack = 0;
+	bool savedAtPlayPosition = false;
+
+	void stopSong(void) override {
+		audio.stopSong();
+	}
+	void pauseResume(void) override {
+		audio.pauseResume();
+	}
+	uint32_t playedSeconds(void) override {
+		return audio.getAudioCurrentTime();
+	}
+	void savePosition(size_t _entry, size_t _track, bool _atPlayPosition) override {
+		TEST_ASSERT_LESS_THAN(props.playlist->size(), _entry);
+		saves++;
+		savedEntry = _entry;
+		savedTrack = _track;
+		savedAtPlayPosition = _atPlayPosition;
+	}
+	void indicateError(void) override {
+		errors++;
+	}
+	void indicateRewind(void) override {
+		rewinds++;
+	}
+	void requestSleep(void) override {
+		sleepRequests++;
+	}
+	void repeatModeChanged(void) override {
+		repeatModeChanges++;
+	}
+	void playlistEnded(void) override {
+		playlistEnds++;
+	}
+	TrackStart play(bool _restart) override {
+		TEST_ASSERT_LESS_THAN(props.playlist->size(), props.currentTrackNumber);
+		const Playlist::Path track = props.playlist->at(props.currentTrackNumber);
+		if (!strncmp("http", track, 4)) {
+			return (audio.connecttohost(track)) ? TrackStart::Started : TrackStart::Failed;
+		}
+		if (!_restart && !Sim_FS->exists(track)) {
+			return TrackStart::Missing;
+		}
+		return (audio.connecttoFS(*Sim_FS, track)) ? TrackStart::Started : TrackStart::Failed;
+	}
+};
+
+static Sim_Player *Sim_Current = nullptr; // player whose audio->loop() runs, for audio_eof_mp3()
+
+void audio_eof_mp3(const char *info) {
+	Sim_Current->props.trackFinished = true;
+}
+
+// One pass of the loop of AudioPlayer_Task, limited to the track handling
+static TrackLoop Sim_Loop(Sim_Player &p) {
+	if (p.quit) {
+		return TrackLoop::Quit;
+	}
+	xQueueReceive(p.trackControlQueue, &p.trackCommand, 0);
+	Playlist *newPlaylist;
+	const bool received = (xQueueReceive(p.trackQueue, &newPlaylist, 0) == pdPASS);
+	Sim_Current = &p;
+	p.audio.loop();
+	if (!received && !p.props.trackFinished && p.trackCommand == NO_ACTION) {
+		return TrackLoop::Playing;
+	}
+	if (received) {
+		p.audio.stopSong();
+		freePlaylist(p.props.playlist);
+		p.props.playlist = newPlaylist;
+	}
+	const TrackLoop step = TrackControl_Step(p.props, received, p.trackCommand, p);
+	p.quit = (step == TrackLoop::Quit);
+	return step;
+}
+
+static void Sim_Init(Sim_Player &p) {
+	p.trackQueue = xQueueCreate(1, sizeof(Playlist *));
+	p.trackControlQueue = xQueueCreate(1, sizeof(uint8_t));
+	p.props.playMode = NO_PLAYLIST;
+	p.props.playlistFinished = true;
+}
+
+static void Sim_Exit(Sim_Player &p) {
+	p.audio.stopSong();
+	freePlaylist(p.props.playlist);
+	p.props.playlist = nullptr;
+	vQueueDelete(p.trackQueue);
+	vQueueDelete(p.trackControlQueue);
+}
+
+// What AudioPlayer_SetPlaylist() does: set the play properties and hand over the playlist
+static void Sim_Play(Sim_Player &p, uint8_t _playMode, const Sim_Playlist &_tracks, size_t _startTrack = 0) {
+	p.quit = false; // woken up again
+	p.props.playMode = _playMode;
+	p.props.currentTrackNumber = _startTrack;
+	p.props.playUntilTrackNumber = 0;
+	p.props.repeatCurrentTrack = (_playMode == SINGLE_TRACK_LOOP || _playMode == AUDIOBOOK_LOOP);
+	p.props.repeatPlaylist = (_playMode == ALL_TRACKS_OF_DIR_SORTED_LOOP || _playMode == ALL_TRACKS_OF_DIR_RANDOM_LOOP);
+	p.props.saveLastPlayPosition = (_playMode == AUDIOBOOK);
+	p.props.sleepAfterCurrentTrack = false;
+	p.props.sleepAfterPlaylist = false;
+	Playlist *playlist = new Playlist();
+	for (const String &track : _tracks) {
+		TEST_ASSERT_TRUE(playlist->push_back(track.c_str()));
+	}
+	TEST_ASSERT_EQUAL(pdPASS, xQueueSend(p.trackQueue, &playlist, 0));
+}
+
+static void Sim_Command(Sim_Player &p, uint8_t _command) {
+	TEST_ASSERT_EQUAL(pdPASS, xQueueSend(p.trackControlQueue, &_command, 0));
+}
+
+// What has to hold after every pass of the loop, whatever happened
+static void Sim_AssertConsistent(const Sim_Player &p, TrackLoop _step, uint32_t _pass) {
+	char message[32];
+	snprintf(message, sizeof(message), "pass %u", _pass);
+	if (p.props.playMode == NO_PLAYLIST) {
+		TEST_ASSERT_TRUE_MESSAGE(p.props.playlistFinished, message);
+	}
+	if (p.props.playlist && !p.props.playlistFinished && !p.props.trackFinished) {
+		TEST_ASSERT_LESS_THAN_MESSAGE(p.props.playlist->size(), p.props.currentTrackNumber, message);
+	}
+	if (_step == TrackLoop::Playing && !p.props.pausePlay && !p.props.playlistFinished && !p.props.trackFinished) {
+		TEST_ASSERT_TRUE_MESSAGE(p.audio.isRunning(), message);
+	}
+}
+
+// A random playlist of the tracks on the card, with a track that doesn't exist or a webstream now and then
+static Sim_Playlist Sim_RandomPlaylist(std::mt19937 &_rng, uint8_t _playMode) {
+	Sim_Playlist tracks;
+	if (_playMode == WEBSTREAM) {
+		tracks.push_back("http://radio.example/stream");
+		return tracks;
+	}
+	const size_t count = (_playMode == SINGLE_TRACK || _playMode == SINGLE_TRACK_LOOP || _playMode == AUDIOBOOK || _playMode == AUDIOBOOK_LOOP) ? 1 : 1 + _rng() % Sim_Tracks.size();
+	for (size_t i = 0; i < count; i++) {
+		tracks.push_back((_rng() % 50) ? Sim_Tracks[_rng() % Sim_Tracks.size()] : String("/music/missing.mp3"));
+	}
+	return tracks;
+}
+
+static uint8_t Sim_RandomCommand(std::mt19937 &_rng) {
+	static constexpr uint8_t commands[] = {NO_ACTION, NO_ACTION, STOP, PAUSEPLAY, NEXTTRACK, NEXTTRACK, PREVIOUSTRACK, PREVIOUSTRACK, FIRSTTRACK, LASTTRACK, 99};
+	return commands[_rng() % sizeof(commands)];
+}
+
+static uint8_t Sim_RandomPlayMode(std::mt19937 &_rng) {
+	static constexpr uint8_t modes[] = {SINGLE_TRACK, SINGLE_TRACK_LOOP, AUDIOBOOK, AUDIOBOOK_LOOP, ALL_TRACKS_OF_DIR_SORTED, ALL_TRACKS_OF_DIR_RANDOM, ALL_TRACKS_OF_DIR_SORTED_LOOP, ALL_TRACKS_OF_DIR_RANDOM_LOOP, WEBSTREAM, LOCAL_M3U};
+	return modes[_rng() % sizeof(modes)];
+}
+
+void setUp(void) {
+	char dir[] = "/tmp/espuino-native-XXXXXX";
+	TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+	Sim_Root = dir;
+	Sim_FS = new fs::FS(Sim_Root);
+	TEST_ASSERT_TRUE(Sim_FS->mkdir("/music"));
+	// tracks of 1 to 20 seconds, sparse files as only their size matters to the fake Audio class
+	Sim_Tracks.clear();
+	for (uint32_t i = 0; i < 12; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/music/%02u.mp3", i + 1);
+		File f = Sim_FS->open(path, FILE_WRITE);
+		TEST_ASSERT_TRUE(f);
+		f.close();
+		std::filesystem::resize_file(Sim_Root + path, (1 + (i * 7) % 20) * fakeAudioByteRate);
+		Sim_Tracks.push_back(path);
+	}
+	NativeTime_Us = 0;
+}
+
+void tearDown(void) {
+	NativeLog_Level = LOGLEVEL_NOTICE;
+	delete Sim_FS;
+	Sim_FS = nullptr;
+	std::filesystem::remove_all(Sim_Root);
+}
+
+static void test_plays_playlist_to_the_end(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED, Sim_Playlist(Sim_Tracks.begin(), Sim_Tracks.begin() + 3));
+	TEST_ASSERT_EQUAL(TrackLoop::Playing, Sim_Loop(p));
+	TEST_ASSERT_TRUE(p.audio.isRunning());
+	TEST_ASSERT_EQUAL(0, p.props.currentTrackNumber);
+	// 1 s, 8 s and 15 s
+	for (uint32_t ms = 0; ms < 25000; ms += 100) {
+		NativeTime_Advance(100);
+		Sim_Loop(p);
+	}
+	TEST_ASSERT_EQUAL(3, p.audio.connects);
+	TEST_ASSERT_TRUE(p.props.playlistFinished);
+	TEST_ASSERT_EQUAL(NO_PLAYLIST, p.props.playMode);
+	TEST_ASSERT_EQUAL(0, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(1, p.playlistEnds);
+	TEST_ASSERT_EQUAL(0, p.errors);
+	Sim_Exit(p);
+}
+
+static void test_audiobook_saves_position_and_sleeps(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED, Sim_Playlist(Sim_Tracks.begin(), Sim_Tracks.begin() + 3));
+	p.props.saveLastPlayPosition = true;
+	p.props.sleepAfterPlaylist = true;
+	Sim_Loop(p);
+	Sim_Command(p, NEXTTRACK);
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(1, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(1, p.savedTrack);
+	Sim_Command(p, PAUSEPLAY);
+	Sim_Loop(p);
+	TEST_ASSERT_TRUE(p.props.pausePlay);
+	TEST_ASSERT_TRUE(p.savedAtPlayPosition);
+	Sim_Command(p, NEXTTRACK); // resumes
+	Sim_Loop(p);
+	TEST_ASSERT_FALSE(p.props.pausePlay);
+	TEST_ASSERT_FALSE(p.savedAtPlayPosition);
+	Sim_Command(p, NEXTTRACK); // already the last track
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(1, p.errors);
+	NativeTime_Advance(20000);
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(1, p.sleepRequests);
+	TEST_ASSERT_EQUAL(0, p.savedEntry);
+	TEST_ASSERT_EQUAL(0, p.savedTrack);
+	Sim_Exit(p);
+}
+
+static void test_previous_restarts_or_goes_back(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED, Sim_Tracks, 5);
+	Sim_Loop(p);
+	NativeTime_Advance(6000);
+	Sim_Command(p, PREVIOUSTRACK); // played for 6 s: same track from its start
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(5, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(0, p.audio.getFilePos());
+	Sim_Command(p, PREVIOUSTRACK);
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(4, p.props.currentTrackNumber);
+	Sim_Command(p, FIRSTTRACK);
+	Sim_Loop(p);
+	const uint32_t connects = p.audio.connects;
+	Sim_Command(p, PREVIOUSTRACK); // first track: restarted
+	TEST_ASSERT_EQUAL(TrackLoop::Skip, Sim_Loop(p));
+	TEST_ASSERT_EQUAL(0, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(connects + 1, p.audio.connects);
+	TEST_ASSERT_EQUAL(1, p.rewinds);
+	TEST_ASSERT_TRUE(p.audio.isRunning());
+	TEST_ASSERT_EQUAL(0, p.errors);
+	Sim_Exit(p);
+}
+
+// Next track ends the repetition of a track, a missing file is skipped without an error
+static void test_repeat_track_and_missing_file(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, SINGLE_TRACK_LOOP, {Sim_Tracks[0], "/music/missing.mp3", Sim_Tracks[1]});
+	Sim_Loop(p);
+	NativeTime_Advance(1500); // 1 s track: repeated
+	Sim_Loop(p);
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(0, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(1, p.rewinds);
+	TEST_ASSERT_EQUAL(2, p.audio.connects);
+	Sim_Command(p, NEXTTRACK);
+	TEST_ASSERT_EQUAL(TrackLoop::Skip, Sim_Loop(p));
+	TEST_ASSERT_FALSE(p.props.repeatCurrentTrack);
+	TEST_ASSERT_EQUAL(1, p.repeatModeChanges);
+	TEST_ASSERT_TRUE(p.props.trackFinished);
+	TEST_ASSERT_EQUAL(TrackLoop::Playing, Sim_Loop(p));
+	TEST_ASSERT_EQUAL(2, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(0, p.errors);
+	Sim_Exit(p);
+}
+
+// A command that arrives with the end of a track waits till the next track started (or the playlist is over):
+// pausing the single track of an audiobook at its end used to save the position of the entry after it
+static void test_command_at_end_of_track(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, AUDIOBOOK, {Sim_Tracks[0]});
+	Sim_Loop(p);
+	NativeTime_Advance(1500);
+	Sim_Command(p, PAUSEPLAY);
+	TEST_ASSERT_EQUAL(TrackLoop::Skip, Sim_Loop(p));
+	TEST_ASSERT_TRUE(p.props.playlistFinished);
+	TEST_ASSERT_EQUAL(0, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(PAUSEPLAY, p.trackCommand);
+	TEST_ASSERT_EQUAL(TrackLoop::Skip, Sim_Loop(p)); // nothing to pause anymore
+	TEST_ASSERT_EQUAL(NO_ACTION, p.trackCommand);
+	TEST_ASSERT_EQUAL(1, p.errors);
+
+	// next track at the end of a track: the one after the next
+	Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED, Sim_Tracks);
+	Sim_Loop(p);
+	NativeTime_Advance(1500);
+	Sim_Command(p, NEXTTRACK);
+	TEST_ASSERT_EQUAL(TrackLoop::Playing, Sim_Loop(p));
+	TEST_ASSERT_EQUAL(1, p.props.currentTrackNumber);
+	Sim_Loop(p);
+	TEST_ASSERT_EQUAL(2, p.props.currentTrackNumber);
+	TEST_ASSERT_EQUAL(1, p.errors);
+	Sim_Exit(p);
+}
+
+// Sleep after the track ends the task
+static void test_sleep_after_track(void) {
+	Sim_Player p;
+	Sim_Init(p);
+	Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED, Sim_Tracks);
+	Sim_Loop(p);
+	p.props.sleepAfterCurrentTrack = true;
+	NativeTime_Advance(1500);
+	TEST_ASSERT_EQUAL(TrackLoop::Quit, Sim_Loop(p));
+	TEST_ASSERT_EQUAL(1, p.sleepRequests);
+	TEST_ASSERT_EQUAL(NO_PLAYLIST, p.props.playMode);
+	TEST_ASSERT_TRUE(p.props.playlistFinished);
+	Sim_Exit(p);
+}
+
+// Random commands, playlists and delays through the decisions of the audio task
+static void test_random_commands_stay_consistent(void) {
+	constexpr uint32_t passes = 200000;
+	std::mt19937 rng(20261017);
+	NativeLog_Level = LOGLEVEL_ERROR;
+	Sim_Player p;
+	Sim_Init(p);
+	for (uint32_t pass = 0; pass < passes; pass++) {
+		if (rng() % 40 == 0 || p.props.playlist == nullptr || p.quit) {
+			const uint8_t playMode = Sim_RandomPlayMode(rng);
+			const Sim_Playlist tracks = Sim_RandomPlaylist(rng, playMode);
+			Sim_Play(p, playMode, tracks, rng() % tracks.size());
+			p.props.sleepAfterCurrentTrack = (rng() % 20 == 0);
+			p.props.sleepAfterPlaylist = (rng() % 10 == 0);
+			p.props.playUntilTrackNumber = (rng() % 10 == 0) ? rng() % (tracks.size() + 1) : 0;
+		} else {
+			const uint8_t command = Sim_RandomCommand(rng);
+			if (command != NO_ACTION) {
+				Sim_Command(p, command);
+			}
+		}
+		NativeTime_Advance(rng() % 4000);
+		Sim_AssertConsistent(p, Sim_Loop(p), pass);
+	}
+	Sim_Exit(p);
+}
+
+// Commands per second the simulated audio task handles, including the accesses to the filesystem
+static void test_benchmark_commands(void) {
+	constexpr uint32_t steps = 1000000;
+	std::mt19937 rng(42);
+	NativeLog_Level = LOGLEVEL_ERROR;
+	Sim_Player p;
+	Sim_Init(p);
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t step = 0; step < steps; step++) {
+		if (p.props.playlistFinished) {
+			Sim_Play(p, ALL_TRACKS_OF_DIR_SORTED_LOOP, Sim_Tracks, rng() % Sim_Tracks.size());
+		} else {
+			Sim_Command(p, Sim_RandomCommand(rng));
+		}
+		NativeTime_Advance(rng() % 4000);
+		Sim_Loop(p);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	char message[96];
+	snprintf(message, sizeof(message), "%u commands in %.2f s: %.0f commands/s, %u tracks started", steps, seconds, steps / seconds, p.audio.connects);
+	TEST_MESSAGE(message);
+	Sim_Exit(p);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_plays_playlist_to_the_end);
+	RUN_TEST(test_audiobook_saves_position_and_sleeps);
+	RUN_TEST(test_previous_restarts_or_goes_back);
+	RUN_TEST(test_repeat_track_and_missing_file);
+	RUN_TEST(test_command_at_end_of_track);
+	RUN_TEST(test_sleep_after_track);
+	RUN_TEST(test_random_commands_stay_consistent);
+	RUN_TEST(test_benchmark_commands);
+	return UNITY_END();
+}
@@ -0,0 +1,276 @@
+#include <Arduino.h>
+#include <FS.h>
+
+#include "M3u.h"
+#include "NatSort.h"
+#include "Playlist.h"
+#include "strnatcmp.h"
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <unity.h>
+#include <vector>
+
+// The natural sort keys of NatSort_Key() have to order exactly like strnatcmp()/strnatcasecmp(), which
+// AudioPlayer used as comparators before Playlist::sortByKey(). Checked on hand picked cases and on random
+// names, plus a benchmark of both ways to sort. Also m3u parsing with M3u_ForEachEntry() and lazy playlists.
+
+extern fs::FS gFSystem;
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static std::vector<uint8_t> key(const char *_str, bool _foldCase) {
+	std::vector<uint8_t> out(NatSort_Key(_str, nullptr, _foldCase));
+	NatSort_Key(_str, out.data(), _foldCase);
+	return out;
+}
+
+// Sign of the comparison done by Playlist::sortByKey()
+static int keyCompare(const char *_a, const char *_b, bool _foldCase) {
+	const std::vector<uint8_t> a = key(_a, _foldCase);
+	const std::vector<uint8_t> b = key(_b, _foldCase);
+	const int res = memcmp(a.data(), b.data(), std::min(a.size(), b.size()));
+	if (res != 0) {
+		return (res < 0) ? -1 : 1;
+	}
+	return (a.size() < b.size()) ? -1 : (a.size() > b.size()) ? 1 : 0;
+}
+
+static int sign(int _value) {
+	return (_value > 0) - (_value < 0);
+}
+
+static void assertOrder(const char *_a, const char *_b, bool _foldCase) {
+	char message[600];
+	snprintf(message, sizeof(message), "\"%s\" < \"%s\"", _a, _b);
+	TEST_ASSERT_EQUAL_MESSAGE(-1, keyCompare(_a, _b, _foldCase), message);
+	TEST_ASSERT_EQUAL_MESSAGE(1, keyCompare(_b, _a, _foldCase), message);
+	const int expected = sign(_foldCase ? strnatcasecmp(_a, _b) : strnatcmp(_a, _b));
+	TEST_ASSERT_EQUAL_MESSAGE(-1, expected, message);
+}
+
+static void test_leading_zeros(void) {
+	// runs with a leading zero compare digit by digit (like decimals), a shorter run first
+	assertOrder("01", "1", false);
+	assertOrder("001", "01", false);
+	assertOrder("track01.mp3", "track1.mp3", false);
+	assertOrder("track01.mp3", "track02.mp3", false);
+	assertOrder("0.5", "0.10", false);
+	assertOrder("x0", "x00", false);
+	assertOrder("09", "1", false);
+}
+
+static void test_mixed_digits_and_text(void) {
+	assertOrder("track2.mp3", "track10.mp3", false);
+	assertOrder("v1.9", "v1.10", false);
+	assertOrder("a1b2", "a1b10", false);
+	assertOrder("x9y", "x10a", false);
+	assertOrder("2 Song", "10 Song", false);
+	assertOrder("Disc 1/10.mp3", "Disc 2/1.mp3", false);
+	assertOrder("abc", "abc1", false);
+	assertOrder("1a", "1b", false);
+	assertOrder("9", "a", false);
+}
+
+static void test_whitespace_and_case(void) {
+	// strnatcmp skips whitespace
+	TEST_ASSERT_EQUAL(0, keyCompare("a 1", "a1", false));
+	TEST_ASSERT_EQUAL(0, keyCompare("  track 2", "track2", false));
+	TEST_ASSERT_EQUAL(0, keyCompare("Track10", "tRACK10", true));
+	assertOrder("B", "a", false);
+	assertOrder("a", "B", true);
+	assertOrder("Track9", "track10", true);
+}
+
+// The key stores the length of a digit run in a byte. FAT limits a path component to 255 characters (and
+// Playlist entries to maxPathLength - 1), so a run never exceeds the cap.
+static void test_digit_run_cap(void) {
+	const std::string run254(254, '9');
+	const std::string run255 = "1" + std::string(254, '0');
+	assertOrder(run254.c_str(), run255.c_str(), false);
+	assertOrder(run255.c_str(), std::string(255, '9').c_str(), false);
+	assertOrder(("/" + run254).c_str(), ("/" + run255).c_str(), false);
+	assertOrder(std::string(254, '0').c_str(), std::string(255, '0').c_str(), false);
+	assertOrder(std::string(255, '0').c_str(), (std::string(254, '0') + "1").c_str(), false);
+	const std::string almost = std::string(254, '5');
+	assertOrder((almost + "1").c_str(), (almost + "2").c_str(), false);
+	TEST_ASSERT_EQUAL(0, keyCompare(run255.c_str(), run255.c_str(), false));
+}
+
+// Only entries relative to the base path are resolved into a Path and limited by maxPathLength. m3u lines and
+// webstream URLs are stored and handed out in full.
+static void test_long_absolute_entries_are_kept(void) {
+	Playlist playlist("/music");
+	const std::string url = "http://stream.example.com/live.mp3?token=" + std::string(600, 'x');
+	const std::string longName = "/music/" + std::string(300, 'a') + ".mp3";
+	const std::string otherDir = "/hoerspiel/" + std::string(300, 'b') + ".mp3";
+	TEST_ASSERT_TRUE(playlist.push_back(url.c_str()));
+	TEST_ASSERT_TRUE(playlist.push_back(longName.c_str()));
+	TEST_ASSERT_TRUE(playlist.push_back(otherDir.c_str()));
+	TEST_ASSERT_TRUE(playlist.push_back("/music/short.mp3"));
+	TEST_ASSERT_EQUAL(3, playlist.size());
+	TEST_ASSERT_EQUAL_STRING(url.c_str(), playlist[0].c_str());
+	TEST_ASSERT_EQUAL_STRING(otherDir.c_str(), playlist[1].c_str());
+	TEST_ASSERT_EQUAL_STRING("/music/short.mp3", playlist[2].c_str());
+}
+
+static std::string writeM3u(const std::string &_content) {
+	char dir[] = "/tmp/espuino-playlist-XXXXXX";
+	TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+	gFSystem = fs::FS(dir);
+	File f = gFSystem.open("/list.m3u", FILE_WRITE);
+	TEST_ASSERT_EQUAL(_content.size(), f.write(reinterpret_cast<const uint8_t *>(_content.data()), _content.size()));
+	f.close();
+	return dir;
+}
+
+static std::vector<std::pair<std::string, uint32_t>> readM3u(void) {
+	std::vector<std::pair<std::string, uint32_t>> entries;
+	File f = gFSystem.open("/list.m3u");
+	TEST_ASSERT_TRUE(M3u_ForEachEntry(f, [&entries](const char *line, uint32_t offset) {
+		entries.emplace_back(line, offset);
+		return true;
+	}));
+	return entries;
+}
+
+// Lines of any length up to m3uMaxLineLength are entries, also across the 512 byte blocks of the reader
+static void test_m3u_long_lines(void) {
+	const std::string url = "http://stream.example.com/live.mp3?token=" + std::string(1500, 'x');
+	const std::string huge(m3uMaxLineLength + 1, 'y');
+	const std::string content = "\xEF\xBB\xBF#EXTM3U\r\n#EXTINF:-1,Radio\r\n" + url + "\r\n\r\n  /music/a.mp3  \n" + huge + "\n" + std::string(511, 'z');
+	const std::string dir = writeM3u(content);
+	const auto entries = readM3u();
+	TEST_ASSERT_EQUAL(3, entries.size());
+	TEST_ASSERT_EQUAL_STRING(url.c_str(), entries[0].first.c_str());
+	TEST_ASSERT_EQUAL(content.find("http"), entries[0].second);
+	TEST_ASSERT_EQUAL_STRING("/music/a.mp3", entries[1].first.c_str());
+	TEST_ASSERT_EQUAL(content.find("/music"), entries[1].second);
+	TEST_ASSERT_EQUAL_STRING(std::string(511, 'z').c_str(), entries[2].first.c_str());
+
+	// a lazy playlist reads short entries from the file, long ones are kept in RAM
+	Playlist lazy;
+	TEST_ASSERT_TRUE(lazy.setSource("/list.m3u"));
+	for (const auto &entry : entries) {
+		TEST_ASSERT_TRUE(lazy.push_back_offset(entry.second, entry.first.c_str()));
+	}
+	TEST_ASSERT_EQUAL(3, lazy.size());
+	TEST_ASSERT_EQUAL_STRING(url.c_str(), lazy[0].c_str());
+	TEST_ASSERT_EQUAL_STRING("/music/a.mp3", lazy[1].c_str());
+	TEST_ASSERT_TRUE(lazy.materialize());
+	TEST_ASSERT_EQUAL(3, lazy.size());
+	TEST_ASSERT_EQUAL_STRING(url.c_str(), lazy[0].c_str());
+	TEST_ASSERT_EQUAL_STRING(std::string(511, 'z').c_str(), lazy[2].c_str());
+	std::filesystem::remove_all(dir);
+}
+
+static std::string randomName(std::mt19937 &_rnd, size_t _maxLen) {
+	static const char chars[] = "00011229 aAbB._-";
+	std::string name(_rnd() % (_maxLen + 1), ' ');
+	for (char &c : name) {
+		c = chars[_rnd() % (sizeof(chars) - 1)];
+	}
+	return name;
+}
+
+static void test_random_names_match_strnatcmp(void) {
+	std::mt19937 rnd(4711);
+	for (uint32_t i = 0; i < 200000; i++) {
+		const std::string a = randomName(rnd, 12);
+		const std::string b = randomName(rnd, 12);
+		char message[64];
+		snprintf(message, sizeof(message), "\"%s\" vs \"%s\"", a.c_str(), b.c_str());
+		TEST_ASSERT_EQUAL_MESSAGE(sign(strnatcmp(a.c_str(), b.c_str())), keyCompare(a.c_str(), b.c_str(), false), message);
+		TEST_ASSERT_EQUAL_MESSAGE(sign(strnatcasecmp(a.c_str(), b.c_str())), keyCompare(a.c_str(), b.c_str(), true), message);
+	}
+}
+
+// The comparators of AudioPlayer
+static bool sortHelperStrnatcasecmp(const char *a, const char *b) {
+	return strnatcasecmp(a, b) < 0;
+}
+
+static bool sortHelperStrcmp(const char *a, const char *b) {
+	return strcmp(a, b) < 0;
+}
+
+static size_t natcaseKey(const char *_str, uint8_t *_out) {
+	return NatSort_Key(_str, _out, true);
+}
+
+// Files of an album like they're found on SD cards: track number (with or without leading zero), title, extension
+static void fillPlaylist(Playlist &_playlist, size_t _entries, uint32_t _seed) {
+	static const char *titles[] = {"Intro", "Kapitel", "chapter", "Teil", "Song", "Outro"};
+	std::mt19937 rnd(_seed);
+	char path[Playlist::maxPathLength];
+	for (size_t i = 0; i < _entries; i++) {
+		const uint32_t track = rnd() % (_entries * 2) + 1;
+		snprintf(path, sizeof(path), (rnd() % 4) ? "/music/Hoerspiel/%u - %s %u.mp3" : "/music/Hoerspiel/%03u - %s %u.mp3", track, titles[rnd() % 6], static_cast<unsigned>(rnd() % 100));
+		TEST_ASSERT_TRUE(_playlist.push_back(path));
+	}
+}
+
+static void test_sort_by_key_matches_comparator(void) {
+	Playlist byComparator("/music/Hoerspiel");
+	Playlist byKey("/music/Hoerspiel");
+	fillPlaylist(byComparator, 3000, 42);
+	fillPlaylist(byKey, 3000, 42);
+	TEST_ASSERT_TRUE(byComparator.sort(sortHelperStrnatcasecmp));
+	TEST_ASSERT_TRUE(byKey.sortByKey(natcaseKey));
+	TEST_ASSERT_TRUE(byKey.isSorted());
+	TEST_ASSERT_EQUAL(byComparator.size(), byKey.size());
+	for (size_t i = 0; i < byKey.size(); i++) {
+		// std::sort isn't stable, entries comparing equal may swap places
+		TEST_ASSERT_EQUAL_MESSAGE(0, strnatcasecmp(byComparator[i], byKey[i]), byKey[i].c_str());
+		if (i) {
+			TEST_ASSERT_FALSE(sortHelperStrnatcasecmp(byKey[i], byKey[i - 1]));
+		}
+	}
+}
+
+template <typename Sort>
+static double measure(size_t _entries, Sort _sort) {
+	constexpr int runs = 5;
+	double best = 1e9;
+	for (int run = 0; run < runs; run++) {
+		Playlist playlist("/music/Hoerspiel");
+		fillPlaylist(playlist, _entries, 1234);
+		const auto start = std::chrono::steady_clock::now();
+		TEST_ASSERT_TRUE(_sort(playlist));
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+static void benchmark_sort(void) {
+	for (const size_t entries : {1000, 5000, 20000}) {
+		const double natcase = measure(entries, [](Playlist &p) {
+			return p.sort(sortHelperStrnatcasecmp);
+		});
+		const double strcmpOnly = measure(entries, [](Playlist &p) {
+			return p.sort(sortHelperStrcmp);
+		});
+		const double keyed = measure(entries, [](Playlist &p) {
+			return p.sortByKey(natcaseKey);
+		});
+		char message[160];
+		snprintf(message, sizeof(message), "%5u entries: strnatcasecmp %.2f ms, strcmp %.2f ms, sortByKey %.2f ms (%.1fx faster than strnatcasecmp)", static_cast<unsigned>(entries), natcase, strcmpOnly, keyed, natcase / keyed);
+		TEST_MESSAGE(message);
+	}
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_leading_zeros);
+	RUN_TEST(test_mixed_digits_and_text);
+	RUN_TEST(test_whitespace_and_case);
+	RUN_TEST(test_digit_run_cap);
+	RUN_TEST(test_long_absolute_entries_are_kept);
+	RUN_TEST(test_m3u_long_lines);
+	RUN_TEST(test_random_names_match_strnatcmp);
+	RUN_TEST(test_sort_by_key_matches_comparator);
+	RUN_TEST(benchmark_sort);
+	return UNITY_END();
+}
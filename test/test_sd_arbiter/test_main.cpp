@@ -0,0 +1,123 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SdArbiter.h"
+
+#include <unity.h>
+
+// The SD arbiter on virtual time: background clients write as fast as they like while audio is idle, are held to
+// sdBackgroundBandwidth (with a burst of a quarter second) while audio is read from the card and give way while
+// the input buffer of the decoder is less than half full. Several clients share one budget.
+
+static constexpr uint32_t burst = sdBackgroundBandwidth / 4;
+
+void setUp(void) {
+	// long enough without reads of the decoder for audio to count as idle
+	NativeTime_Advance(1000);
+}
+
+void tearDown(void) { }
+
+// One round of the audio task reading from the SD card
+static void audioLoop(uint32_t _inBufferFilled = 900, uint32_t _inBufferSize = 1000) {
+	SdArbiter_AudioBegin();
+	SdArbiter_AudioEnd(true, _inBufferFilled, _inBufferSize);
+}
+
+// Waiting time of a background access
+static uint32_t background(size_t _bytes) {
+	const uint32_t start = millis();
+	SdArbiter_BackgroundBegin(_bytes);
+	SdArbiter_BackgroundEnd();
+	return millis() - start;
+}
+
+static void test_idle_audio_does_not_throttle(void) {
+	const sdArbiterStats before = SdArbiter_GetStats();
+	for (uint32_t i = 0; i < 100; i++) {
+		TEST_ASSERT_EQUAL(0, background(1024 * 1024));
+	}
+	// playback of a webstream doesn't read the card
+	SdArbiter_AudioBegin();
+	SdArbiter_AudioEnd(false, 0, 1000);
+	TEST_ASSERT_EQUAL(0, background(1024 * 1024));
+	const sdArbiterStats after = SdArbiter_GetStats();
+	TEST_ASSERT_EQUAL(sdBackgroundBandwidth, after.bandwidth);
+	TEST_ASSERT_EQUAL(before.throttledMs, after.throttledMs);
+	TEST_ASSERT_EQUAL(before.yieldedMs, after.yieldedMs);
+}
+
+// 2 MiB in chunks of 32 KiB: the burst goes at once, the rest at sdBackgroundBandwidth
+static void test_token_bucket_limits_bandwidth(void) {
+	background(1); // idle: the budget starts full
+	const sdArbiterStats before = SdArbiter_GetStats();
+	constexpr size_t chunk = 32 * 1024;
+	constexpr size_t total = 2 * 1024 * 1024;
+	const uint32_t start = millis();
+	uint32_t firstWait = UINT32_MAX;
+	for (size_t written = 0; written < total; written += chunk) {
+		audioLoop();
+		const uint32_t waited = background(chunk);
+		if (waited && firstWait == UINT32_MAX) {
+			firstWait = written;
+		}
+	}
+	const uint32_t elapsed = millis() - start;
+	// the last chunk is booked, but not paid back yet
+	const uint32_t expected = static_cast<uint64_t>(total - burst - chunk) * 1000 / sdBackgroundBandwidth;
+	char message[64];
+	snprintf(message, sizeof(message), "%u ms for %u bytes", elapsed, static_cast<unsigned>(total));
+	TEST_MESSAGE(message);
+	TEST_ASSERT_UINT32_WITHIN_MESSAGE(total / chunk * 2, expected, elapsed, message);
+	// nothing waits while the burst lasts
+	TEST_ASSERT_EQUAL(burst + chunk, firstWait);
+	const sdArbiterStats after = SdArbiter_GetStats();
+	TEST_ASSERT_EQUAL(elapsed, after.throttledMs - before.throttledMs);
+	TEST_ASSERT_EQUAL(before.yieldedMs, after.yieldedMs);
+}
+
+// What one client overdraws, the next one pays back
+static void test_clients_share_the_budget(void) {
+	background(1);
+	audioLoop();
+	// a large write of the upload gets through on the full budget...
+	TEST_ASSERT_EQUAL(0, background(4 * burst));
+	// ...and a small read of the catalog scan waits for the three quarters overdrawn
+	audioLoop();
+	TEST_ASSERT_EQUAL(static_cast<uint64_t>(3 * burst) * 1000 / sdBackgroundBandwidth + 1, background(512));
+	// the budget refills with time
+	NativeTime_Advance(500);
+	audioLoop();
+	TEST_ASSERT_EQUAL(0, background(burst / 2));
+}
+
+// A hungry decoder goes first: the background access waits until the buffer is refilled or the decoder stops
+// reading (no reads for 200 ms)
+static void test_yield_to_hungry_decoder(void) {
+	background(1);
+	const sdArbiterStats before = SdArbiter_GetStats();
+	audioLoop(499, 1000);
+	TEST_ASSERT_EQUAL(200, background(512));
+	sdArbiterStats after = SdArbiter_GetStats();
+	TEST_ASSERT_EQUAL(200, after.yieldedMs - before.yieldedMs);
+	TEST_ASSERT_EQUAL(before.throttledMs, after.throttledMs);
+
+	// half full is enough
+	audioLoop(500, 1000);
+	TEST_ASSERT_EQUAL(0, background(512));
+	// an empty buffer of unknown size isn't waited for
+	audioLoop(0, 0);
+	TEST_ASSERT_EQUAL(0, background(512));
+	after = SdArbiter_GetStats();
+	TEST_ASSERT_EQUAL(200, after.yieldedMs - before.yieldedMs);
+}
+
+int main(int argc, char **argv) {
+	SdArbiter_Init();
+	UNITY_BEGIN();
+	RUN_TEST(test_idle_audio_does_not_throttle);
+	RUN_TEST(test_token_bucket_limits_bandwidth);
+	RUN_TEST(test_clients_share_the_budget);
+	RUN_TEST(test_yield_to_hungry_decoder);
+	return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include <Arduino.h>
+
+#include "SpeechPhrases.h"
+#include "values.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// The announcements of the speech cache are put together from phrases that are spoken and cached one by one. The
+// IP address is told in the language of the device, the time in German or English. Before NTP set the clock
+// there's no time to tell. The clip of a phrase is named by its language and text.
+
+void setUp(void) { }
+void tearDown(void) { }
+
+// 2024-03-05 in UTC at _hour:_min
+static time_t at(int _hour, int _min) {
+	return 1709596800 + _hour * 3600 + _min * 60;
+}
+
+static void assertPhrases(const std::vector<const char *> &_expected, const std::vector<String> &_phrases) {
+	TEST_ASSERT_EQUAL(_expected.size(), _phrases.size());
+	for (size_t i = 0; i < _expected.size(); i++) {
+		TEST_ASSERT_EQUAL_STRING(_expected[i], _phrases[i].c_str());
+	}
+}
+
+static void test_ip_address(void) {
+	std::vector<String> phrases;
+	TEST_ASSERT_EQUAL_STRING("de", SpeechPhrases_IpAddress(DE, "192.168.4.1", phrases));
+	assertPhrases({"192", "Punkt", "168", "Punkt", "4", "Punkt", "1"}, phrases);
+	TEST_ASSERT_EQUAL_STRING("fr", SpeechPhrases_IpAddress(FR, "10.0.0.7", phrases));
+	assertPhrases({"10", "point", "0", "point", "0", "point", "7"}, phrases);
+	TEST_ASSERT_EQUAL_STRING("en", SpeechPhrases_IpAddress(EN, "10.0.0.7", phrases));
+	assertPhrases({"10", "point", "0", "point", "0", "point", "7"}, phrases);
+}
+
+static void test_time_german(void) {
+	std::vector<String> phrases;
+	TEST_ASSERT_EQUAL_STRING("de", SpeechPhrases_Time(DE, at(7, 5), phrases));
+	assertPhrases({"Es ist", "7", "Uhr", "5"}, phrases);
+	SpeechPhrases_Time(DE, at(0, 0), phrases);
+	assertPhrases({"Es ist", "0", "Uhr"}, phrases);
+	SpeechPhrases_Time(DE, at(23, 59), phrases);
+	assertPhrases({"Es ist", "23", "Uhr", "59"}, phrases);
+}
+
+static void test_time_english(void) {
+	std::vector<String> phrases;
+	TEST_ASSERT_EQUAL_STRING("en", SpeechPhrases_Time(EN, at(7, 5), phrases));
+	assertPhrases({"It is", "7", "oh", "5", "AM"}, phrases);
+	SpeechPhrases_Time(EN, at(0, 0), phrases);
+	assertPhrases({"It is", "12", "AM"}, phrases);
+	SpeechPhrases_Time(EN, at(12, 30), phrases);
+	assertPhrases({"It is", "12", "30", "PM"}, phrases);
+	// French devices tell the time in English
+	TEST_ASSERT_EQUAL_STRING("en", SpeechPhrases_Time(FR, at(19, 10), phrases));
+	assertPhrases({"It is", "7", "10", "PM"}, phrases);
+}
+
+// Without NTP the clock starts at 1970, that time isn't told
+static void test_time_unknown(void) {
+	std::vector<String> phrases = {"left", "over"};
+	TEST_ASSERT_EQUAL_STRING("de", SpeechPhrases_Time(DE, 0, phrases));
+	TEST_ASSERT_TRUE(phrases.empty());
+	TEST_ASSERT_EQUAL_STRING("en", SpeechPhrases_Time(EN, 3600 * 24 * 400, phrases));
+	TEST_ASSERT_TRUE(phrases.empty());
+	SpeechPhrases_Time(EN, speechTimeValidFrom, phrases);
+	TEST_ASSERT_FALSE(phrases.empty());
+}
+
+// Clips are named by language and hash of the text, a name must not change or the cache is fetched again
+static void test_clip_name(void) {
+	char name[speechClipNameSize];
+	SpeechPhrases_ClipName("en", "", name);
+	TEST_ASSERT_EQUAL_STRING("/en-811c9dc5.mp3", name); // FNV-1a of nothing
+	SpeechPhrases_ClipName("en", "a", name);
+	TEST_ASSERT_EQUAL_STRING("/en-e40c292c.mp3", name);
+
+	char other[speechClipNameSize];
+	SpeechPhrases_ClipName("de", "a", other);
+	TEST_ASSERT_EQUAL_STRING("/de-e40c292c.mp3", other);
+	SpeechPhrases_ClipName("en", "It is", name);
+	SpeechPhrases_ClipName("en", "It is ", other);
+	TEST_ASSERT_TRUE(strcmp(name, other) != 0);
+
+	// a language that's too long is cut, the name still fits
+	SpeechPhrases_ClipName("toolonglanguage", "a", name);
+	TEST_ASSERT_EQUAL_STRING("/tool-e40c292c.mp3", name);
+}
+
+int main(int argc, char **argv) {
+	// the times of the tests are local times
+	setenv("TZ", "UTC0", 1);
+	tzset();
+	UNITY_BEGIN();
+	RUN_TEST(test_ip_address);
+	RUN_TEST(test_time_german);
+	RUN_TEST(test_time_english);
+	RUN_TEST(test_time_unknown);
+	RUN_TEST(test_clip_name);
+	return UNITY_END();
+}
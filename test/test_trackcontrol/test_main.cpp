@@ -0,0 +1,74 @@
+#include <Arduino.h>
+
+#include "TrackControl.h"
+#include "values.h"
+
+#include <unity.h>
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static void assertMove(TrackStep _step, size_t _track, trackMove _move) {
+	TEST_ASSERT_EQUAL(static_cast<int>(_step), static_cast<int>(_move.step));
+	TEST_ASSERT_EQUAL(_track, _move.track);
+}
+
+static void test_next_track(void) {
+	assertMove(TrackStep::Jump, 4, TrackControl_Move(NEXTTRACK, ALL_TRACKS_OF_DIR_SORTED, 3, 10, false, 0));
+	assertMove(TrackStep::Refuse, 9, TrackControl_Move(NEXTTRACK, ALL_TRACKS_OF_DIR_SORTED, 9, 10, false, 0));
+	// repeat playlist continues with the first track
+	assertMove(TrackStep::Jump, 0, TrackControl_Move(NEXTTRACK, ALL_TRACKS_OF_DIR_SORTED_LOOP, 9, 10, true, 0));
+	assertMove(TrackStep::Refuse, 0, TrackControl_Move(NEXTTRACK, SINGLE_TRACK, 0, 1, false, 0));
+}
+
+static void test_previous_track(void) {
+	assertMove(TrackStep::Jump, 2, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED, 3, 10, false, 0));
+	// the current track again if it's played for 5 s or more
+	assertMove(TrackStep::Jump, 3, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED, 3, 10, false, 5));
+	assertMove(TrackStep::Restart, 0, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED, 0, 10, false, 0));
+	assertMove(TrackStep::Restart, 0, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED, 0, 10, false, 30));
+	// repeat playlist goes back to the last track
+	assertMove(TrackStep::Jump, 9, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED_LOOP, 0, 10, true, 0));
+	assertMove(TrackStep::Jump, 0, TrackControl_Move(PREVIOUSTRACK, ALL_TRACKS_OF_DIR_SORTED_LOOP, 0, 10, true, 7));
+}
+
+static void test_previous_track_webstream_and_m3u(void) {
+	assertMove(TrackStep::Refuse, 0, TrackControl_Move(PREVIOUSTRACK, WEBSTREAM, 0, 1, false, 0));
+	// m3u playlists ignore the play time and never wrap
+	assertMove(TrackStep::Jump, 2, TrackControl_Move(PREVIOUSTRACK, LOCAL_M3U, 3, 10, false, 30));
+	assertMove(TrackStep::Refuse, 0, TrackControl_Move(PREVIOUSTRACK, LOCAL_M3U, 0, 10, true, 0));
+}
+
+static void test_first_and_last_track(void) {
+	assertMove(TrackStep::Jump, 0, TrackControl_Move(FIRSTTRACK, ALL_TRACKS_OF_DIR_SORTED, 7, 10, false, 0));
+	assertMove(TrackStep::Jump, 9, TrackControl_Move(LASTTRACK, ALL_TRACKS_OF_DIR_SORTED, 7, 10, false, 0));
+	assertMove(TrackStep::Refuse, 9, TrackControl_Move(LASTTRACK, ALL_TRACKS_OF_DIR_SORTED, 9, 10, false, 0));
+	assertMove(TrackStep::Refuse, 4, TrackControl_Move(PAUSEPLAY, ALL_TRACKS_OF_DIR_SORTED, 4, 10, false, 0));
+}
+
+static void test_track_finished(void) {
+	TEST_ASSERT_EQUAL(5, TrackControl_Finished(4, false));
+	TEST_ASSERT_EQUAL(4, TrackControl_Finished(4, true));
+}
+
+static void test_playlist_end(void) {
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::Continue), static_cast<int>(TrackControl_CheckEnd(9, 10, 0, false, false, false)));
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::UntilReached), static_cast<int>(TrackControl_CheckEnd(3, 10, 3, false, false, false)));
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::Finished), static_cast<int>(TrackControl_CheckEnd(10, 10, 0, false, false, false)));
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::FinishedSleep), static_cast<int>(TrackControl_CheckEnd(10, 10, 0, false, true, false)));
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::Sleep), static_cast<int>(TrackControl_CheckEnd(10, 10, 0, true, false, true)));
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::Wrap), static_cast<int>(TrackControl_CheckEnd(10, 10, 0, true, false, false)));
+	// playUntilTrackNumber 0 means "not set"
+	TEST_ASSERT_EQUAL(static_cast<int>(PlaylistStep::Continue), static_cast<int>(TrackControl_CheckEnd(0, 10, 0, false, false, false)));
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_next_track);
+	RUN_TEST(test_previous_track);
+	RUN_TEST(test_previous_track_webstream_and_m3u);
+	RUN_TEST(test_first_and_last_track);
+	RUN_TEST(test_track_finished);
+	RUN_TEST(test_playlist_end);
+	return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#include "UploadRing.h"
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+// UploadRing hands the slots of an explorer upload from the web server to the storage task. The length of a
+// slot the storage task is still writing must not change while the web server fills the next one, and the
+// stream has to arrive complete and in order whatever the timing of both sides.
+
+void setUp(void) { }
+void tearDown(void) { }
+
+template <uint32_t Slots>
+struct Ring {
+	Ring(size_t _slotSize)
+		: slotSize(_slotSize) {
+		for (auto &buf : storage) {
+			buf.resize(_slotSize);
+		}
+		for (uint32_t i = 0; i < Slots; i++) {
+			buffers[i] = storage[i].data();
+		}
+	}
+	size_t put(const uint8_t *_data, size_t _len, bool &_published) {
+		return ring.put(buffers, slotSize, _data, _len, _published);
+	}
+
+	UploadRing<Slots> ring;
+	size_t slotSize;
+	std::vector<uint8_t> storage[Slots];
+	uint8_t *buffers[Slots];
+};
+
+// With one slot on its way to the card and the other one filled, the ring is full: the web server used to reset
+// the length of the slot after the one it published, which is the one being written
+static void test_length_of_slot_in_use_stays(void) {
+	Ring<2> r(4096);
+	std::vector<uint8_t> data(4096 * 3, 0x5A);
+	bool published;
+	TEST_ASSERT_EQUAL(4096, r.put(data.data(), data.size(), published));
+	TEST_ASSERT_TRUE(published);
+
+	uint32_t slot;
+	size_t len;
+	TEST_ASSERT_TRUE(r.ring.peek(slot, len));
+	TEST_ASSERT_EQUAL(0, slot);
+	TEST_ASSERT_EQUAL(4096, len);
+
+	// the storage task is writing slot 0, the web server fills slot 1
+	TEST_ASSERT_EQUAL(4096, r.put(data.data(), data.size(), published));
+	TEST_ASSERT_TRUE(published);
+	TEST_ASSERT_TRUE(r.ring.full());
+	TEST_ASSERT_EQUAL(0, r.put(data.data(), data.size(), published));
+	TEST_ASSERT_FALSE(published);
+	TEST_ASSERT_TRUE(r.ring.peek(slot, len));
+	TEST_ASSERT_EQUAL(0, slot);
+	TEST_ASSERT_EQUAL(4096, len);
+
+	// slot 0 is written, the web server starts on it again while slot 1 is written
+	r.ring.release();
+	TEST_ASSERT_EQUAL(100, r.put(data.data(), 100, published));
+	TEST_ASSERT_FALSE(published);
+	TEST_ASSERT_TRUE(r.ring.peek(slot, len));
+	TEST_ASSERT_EQUAL(1, slot);
+	TEST_ASSERT_EQUAL(4096, len);
+	r.ring.release();
+	TEST_ASSERT_TRUE(r.ring.drained());
+
+	// the rest of the upload
+	r.ring.flush();
+	TEST_ASSERT_TRUE(r.ring.peek(slot, len));
+	TEST_ASSERT_EQUAL(0, slot);
+	TEST_ASSERT_EQUAL(100, len);
+	r.ring.release();
+	TEST_ASSERT_TRUE(r.ring.drained());
+	r.ring.flush(); // nothing left
+	TEST_ASSERT_TRUE(r.ring.drained());
+}
+
+static void test_reset(void) {
+	Ring<2> r(512);
+	const uint8_t data[300] = {};
+	bool published;
+	r.put(data, sizeof(data), published);
+	r.ring.reset();
+	r.ring.flush();
+	TEST_ASSERT_TRUE(r.ring.drained());
+}
+
+// Web server and storage task on their own threads, both pausing at random: the file has to be the upload
+template <uint32_t Slots>
+static void streamThroughRing(size_t _slotSize, uint32_t _seed) {
+	Ring<Slots> r(_slotSize);
+	std::mt19937 rnd(_seed);
+	std::vector<uint8_t> upload(_slotSize * 40 + rnd() % _slotSize);
+	for (uint8_t &b : upload) {
+		b = rnd();
+	}
+	std::vector<uint8_t> file;
+	std::atomic<bool> final {false};
+
+	std::thread storage([&]() {
+		std::mt19937 rnd(_seed + 1);
+		for (;;) {
+			uint32_t slot;
+			size_t len;
+			if (r.ring.peek(slot, len)) {
+				const uint8_t *buf = r.buffers[slot];
+				for (size_t i = 0; i < len; i++) {
+					file.push_back(buf[i]);
+					if (rnd() % 4096 == 0) {
+						std::this_thread::yield(); // the SD card takes its time
+					}
+				}
+				r.ring.release();
+			} else if (final.load() && r.ring.drained()) {
+				break;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	size_t pos = 0;
+	while (pos < upload.size()) {
+		// chunks of the web server, up to a TCP segment
+		size_t len = std::min<size_t>(1 + rnd() % 1460, upload.size() - pos);
+		while (len) {
+			bool published;
+			const size_t n = r.put(upload.data() + pos, len, published);
+			if (!n) {
+				std::this_thread::yield(); // waiting for a free slot
+			}
+			pos += n;
+			len -= n;
+		}
+	}
+	r.ring.flush();
+	final.store(true);
+	storage.join();
+
+	char message[64];
+	snprintf(message, sizeof(message), "%u slots of %u bytes", Slots, static_cast<unsigned>(_slotSize));
+	TEST_ASSERT_EQUAL_MESSAGE(upload.size(), file.size(), message);
+	TEST_ASSERT_EQUAL_MEMORY_MESSAGE(upload.data(), file.data(), upload.size(), message);
+}
+
+static void test_stream_arrives_intact(void) {
+	for (uint32_t seed = 1; seed <= 20; seed++) {
+		streamThroughRing<2>(4096, seed);
+		streamThroughRing<8>(32768, seed);
+		streamThroughRing<2>(512, seed);
+	}
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_length_of_slot_in_use_stays);
+	RUN_TEST(test_reset);
+	RUN_TEST(test_stream_arrives_intact);
+	return UNITY_END();
+}
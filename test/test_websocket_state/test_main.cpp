@@ -0,0 +1,170 @@
+#include "WebsocketState.h"
+
+#include <string.h>
+#include <thread>
+#include <unity.h>
+
+// The websocket clients get the playback state in pushes at most every websocketPushInterval: requests of any
+// task are merged into one push, which only carries the fields that changed since the last one. A client that
+// connects asks for the complete state.
+
+void setUp(void) { }
+void tearDown(void) { }
+
+static websocketPlayback playing(void) {
+	websocketPlayback now;
+	now.pausePlay = false;
+	now.currentTrackNumber = 2;
+	now.numberOfTracks = 12;
+	now.volume = 9;
+	now.playMode = 3;
+	now.posPermille = 125;
+	now.name = "Track 3";
+	now.time = 20;
+	now.duration = 160;
+	return now;
+}
+
+// A client connected: everything it asked for, in one push
+static void test_full_state_after_connect(void) {
+	WebsocketState state;
+	TEST_ASSERT_FALSE(state.due(1000));
+	state.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	TEST_ASSERT_TRUE(state.due(1000));
+	const uint16_t fields = state.take(playing(), 1000);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldsTrackinfo | websocketFieldVolume | websocketFieldsProgress, fields);
+	TEST_ASSERT_EQUAL_STRING("Track 3", state.name());
+	TEST_ASSERT_FALSE(state.due(2000));
+
+	// the next client gets it all again, though nothing changed
+	state.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldsTrackinfo | websocketFieldVolume | websocketFieldsProgress, state.take(playing(), 2000));
+}
+
+// Requests within the push interval are merged into one push
+static void test_requests_merge(void) {
+	WebsocketState state;
+	state.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	state.take(playing(), 1000);
+
+	websocketPlayback now = playing();
+	now.volume = 10;
+	state.request(websocketStateVolume);
+	TEST_ASSERT_FALSE(state.due(1000 + websocketPushInterval - 1));
+	now.time = 21;
+	now.posPermille = 131;
+	state.request(websocketStateProgress);
+	state.request(websocketStateProgress);
+	state.request(websocketStateCoverimg);
+	TEST_ASSERT_TRUE(state.due(1000 + websocketPushInterval));
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldVolume | websocketFieldPosition | websocketFieldTime | websocketFieldCoverimg, state.take(now, 1000 + websocketPushInterval));
+	TEST_ASSERT_FALSE(state.due(1000 + 10 * websocketPushInterval));
+}
+
+// Requests from several tasks at once: none gets lost
+static void test_concurrent_requests_merge(void) {
+	WebsocketState state;
+	std::thread a([&]() {
+		for (int i = 0; i < 10000; i++) {
+			state.request(websocketStateTrackinfo);
+		}
+	});
+	std::thread b([&]() {
+		for (int i = 0; i < 10000; i++) {
+			state.request(websocketStateProgress);
+		}
+	});
+	a.join();
+	b.join();
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldsTrackinfo | websocketFieldsProgress, state.take(playing(), 1000));
+}
+
+// Only what changed since the last push, a field changed and changed back isn't sent
+static void test_only_changed_fields(void) {
+	WebsocketState state;
+	state.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	state.take(playing(), 1000);
+
+	websocketPlayback now = playing();
+	now.pausePlay = true;
+	state.request(websocketStateTrackinfo);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldPausePlay, state.take(now, 2000));
+
+	now.pausePlay = false;
+	now.currentTrackNumber = 3;
+	now.posPermille = 0;
+	state.request(websocketStateTrackinfo | websocketStateProgress);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldPausePlay | websocketFieldTrackNumber | websocketFieldTrackPosition | websocketFieldPosition, state.take(now, 3000));
+
+	// nothing changed: nothing to send
+	state.request(websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	TEST_ASSERT_EQUAL_HEX16(0, state.take(now, 4000));
+
+	// a changed field that wasn't requested waits for its request
+	now.duration = 200;
+	state.request(websocketStateVolume);
+	TEST_ASSERT_EQUAL_HEX16(0, state.take(now, 5000));
+	state.request(websocketStateProgress);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldDuration, state.take(now, 6000));
+}
+
+// Trackinfo and trackProgress both carry the position, each one is compared with what it sent last
+static void test_position_per_message(void) {
+	WebsocketState state;
+	state.request(websocketStateFull | websocketStateTrackinfo | websocketStateVolume | websocketStateProgress);
+	state.take(playing(), 1000);
+
+	websocketPlayback now = playing();
+	now.posPermille = 200;
+	state.request(websocketStateProgress);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldPosition, state.take(now, 2000));
+	state.request(websocketStateTrackinfo);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldTrackPosition, state.take(now, 3000));
+}
+
+// The name is compared by content, a new title in the same buffer is sent
+static void test_name_change(void) {
+	WebsocketState state;
+	char title[websocketNameSize];
+	strcpy(title, "Track 3");
+	websocketPlayback now = playing();
+	now.name = title;
+	state.request(websocketStateFull | websocketStateTrackinfo);
+	state.take(now, 1000);
+
+	strcpy(title, "Track 4");
+	state.request(websocketStateTrackinfo);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldName, state.take(now, 2000));
+	TEST_ASSERT_EQUAL_STRING("Track 4", state.name());
+
+	// longer than a title can be: cut, and not sent again and again
+	char longTitle[2 * websocketNameSize];
+	memset(longTitle, 'x', sizeof(longTitle) - 1);
+	longTitle[sizeof(longTitle) - 1] = '\0';
+	now.name = longTitle;
+	state.request(websocketStateTrackinfo);
+	TEST_ASSERT_EQUAL_HEX16(websocketFieldName, state.take(now, 3000));
+	TEST_ASSERT_EQUAL(websocketNameSize - 1, strlen(state.name()));
+	state.request(websocketStateTrackinfo);
+	TEST_ASSERT_EQUAL_HEX16(0, state.take(now, 4000));
+}
+
+// Nobody's listening: the pending pushes are dropped
+static void test_discard(void) {
+	WebsocketState state;
+	state.request(websocketStateTrackinfo | websocketStateProgress);
+	state.discard();
+	TEST_ASSERT_FALSE(state.due(1000));
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_full_state_after_connect);
+	RUN_TEST(test_requests_merge);
+	RUN_TEST(test_concurrent_requests_merge);
+	RUN_TEST(test_only_changed_fields);
+	RUN_TEST(test_position_per_message);
+	RUN_TEST(test_name_change);
+	RUN_TEST(test_discard);
+	return UNITY_END();
+}